@@ -0,0 +1,395 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "AnisoRoughness.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/Timer.h"
+#include "SampleFramework11/Random.h"
+
+//=================================================================================================
+// Operation counting
+//=================================================================================================
+
+static uint64 NumALUOps = 0;
+static uint64 NumTranscendentalOps = 0;
+
+// Scalar that counts every operation done with it. Division counts as a reciprocal and a multiply,
+// the same as on the GPU. Only used from a single thread.
+struct CountedFloat
+{
+    float v;
+
+    CountedFloat() : v(0.0f)
+    {
+    }
+
+    CountedFloat(float x) : v(x)
+    {
+    }
+};
+
+static CountedFloat CountALU(float result)
+{
+    ++NumALUOps;
+    return CountedFloat(result);
+}
+
+static CountedFloat CountTranscendental(float result)
+{
+    ++NumALUOps;
+    ++NumTranscendentalOps;
+    return CountedFloat(result);
+}
+
+static CountedFloat operator+(CountedFloat a, CountedFloat b) { return CountALU(a.v + b.v); }
+static CountedFloat operator-(CountedFloat a, CountedFloat b) { return CountALU(a.v - b.v); }
+static CountedFloat operator*(CountedFloat a, CountedFloat b) { return CountALU(a.v * b.v); }
+static CountedFloat operator-(CountedFloat a) { return CountALU(-a.v); }
+
+static CountedFloat operator/(CountedFloat a, CountedFloat b)
+{
+    CountTranscendental(0.0f);
+    return CountALU(a.v / b.v);
+}
+
+static bool operator<(CountedFloat a, CountedFloat b) { CountALU(0.0f); return a.v < b.v; }
+static bool operator>(CountedFloat a, CountedFloat b) { CountALU(0.0f); return a.v > b.v; }
+
+static CountedFloat Sqrt(CountedFloat x) { return CountTranscendental(std::sqrt(x.v)); }
+static CountedFloat Rsqrt(CountedFloat x) { return CountTranscendental(1.0f / std::sqrt(x.v)); }
+static CountedFloat Exp(CountedFloat x) { return CountTranscendental(std::exp(x.v)); }
+static CountedFloat Max(CountedFloat a, CountedFloat b) { return CountALU(std::max(a.v, b.v)); }
+static CountedFloat Saturate(CountedFloat x) { return CountALU(Clamp(x.v, 0.0f, 1.0f)); }
+
+static float Sqrt(float x) { return std::sqrt(x); }
+static float Rsqrt(float x) { return 1.0f / std::sqrt(x); }
+static float Exp(float x) { return std::exp(x); }
+static float Max(float a, float b) { return std::max(a, b); }
+static float Saturate(float x) { return Clamp(x, 0.0f, 1.0f); }
+
+template<typename T> struct Vector3
+{
+    T x;
+    T y;
+    T z;
+
+    Vector3(T x_, T y_, T z_) : x(x_), y(y_), z(z_)
+    {
+    }
+
+    explicit Vector3(const Float3& v) : x(v.x), y(v.y), z(v.z)
+    {
+    }
+};
+
+template<typename T> static Vector3<T> Add(const Vector3<T>& a, const Vector3<T>& b)
+{
+    return Vector3<T>(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+template<typename T> static T Dot(const Vector3<T>& a, const Vector3<T>& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+template<typename T> static Vector3<T> Normalize(const Vector3<T>& v)
+{
+    T invLength = Rsqrt(Dot(v, v));
+    return Vector3<T>(v.x * invLength, v.y * invLength, v.z * invLength);
+}
+
+// mul(v, worldToTangent) from Mesh.hlsl, where the rows of tangentToWorld are the frame vectors
+template<typename T> static Vector3<T> ToTangent(const Vector3<T>& v, const Vector3<T> frame[3])
+{
+    return Vector3<T>(Dot(v, frame[0]), Dot(v, frame[1]), Dot(v, frame[2]));
+}
+
+//=================================================================================================
+// Specular terms from Mesh.hlsl
+//=================================================================================================
+
+// Inputs for a single evaluation. The tangent frame is the identity, so the directions and the
+// normal are in both world and tangent space.
+struct ShadingSample
+{
+    Float3 Normal;
+    Float3 LightDir;
+    Float3 ViewDir;
+    Float2 LEANB;
+    Float4 LEANM;
+    Float3 AnisoRoughness;
+};
+
+static const Float3 TangentFrame[3] = { Float3(1.0f, 0.0f, 0.0f), Float3(0.0f, 1.0f, 0.0f), Float3(0.0f, 0.0f, 1.0f) };
+
+template<typename T> static T Beckmann_G1(T m, T nDotX)
+{
+    T nDotX2 = nDotX * nDotX;
+    T tanTheta = Sqrt((1.0f - nDotX2) / nDotX2);
+    T a = 1.0f / (m * tanTheta);
+    T a2 = a * a;
+
+    T g = 1.0f;
+    if(a < 1.6f)
+        g = g * ((3.535f * a + 2.181f * a2) / (1.0f + 2.276f * a + 2.577f * a2));
+
+    return g;
+}
+
+template<typename T> static T GGX_V1(T m2, T nDotX)
+{
+    return 1.0f / (nDotX + Sqrt(m2 + (1.0f - m2) * nDotX * nDotX));
+}
+
+// Specular term of CalcLightingLEAN
+template<typename T> static T LEANSpecular(const ShadingSample& sample, float roughness, float scaleFactor, bool clean)
+{
+    const Vector3<T> frame[3] = { Vector3<T>(TangentFrame[0]), Vector3<T>(TangentFrame[1]), Vector3<T>(TangentFrame[2]) };
+    const Vector3<T> n(sample.Normal);
+    const Vector3<T> l(sample.LightDir);
+    const Vector3<T> v(sample.ViewDir);
+
+    T nDotL = Saturate(Dot(n, l));
+
+    T m = roughness;
+    T s = 2.0f / (m * m) - 2.0f;
+    T invS = 1.0f / s;
+
+    Vector3<T> ht = Normalize(ToTangent(Normalize(Add(v, l)), frame));
+
+    T scale = scaleFactor;
+    T scale2 = scale * scale;
+    T d = 0.0f;
+    if(clean)
+    {
+        T bx = sample.LEANB.x * scale;
+        T by = sample.LEANB.y * scale;
+        T M = sample.LEANM.w * scale2;
+
+        T hx = ht.x / ht.z;
+        T hy = ht.y / ht.z;
+
+        T variance = M - (bx * bx + by * by);
+        variance = variance + invS;
+
+        T e = (hx - bx) * (hx - bx) + (hy - by) * (hy - by);
+        if(ht.z > 0.0f && variance > 0.0f)
+            d = Exp(-0.5f * e / variance) / (variance * Pi * 2.0f);
+    }
+    else
+    {
+        T bx = sample.LEANB.x * scale;
+        T by = sample.LEANB.y * scale;
+        T mxx = sample.LEANM.x * scale2 + invS;
+        T myy = sample.LEANM.y * scale2 + invS;
+        T mxy = sample.LEANM.z * scale2;
+
+        T sigmaXX = mxx - bx * bx;
+        T sigmaYY = myy - by * by;
+        T sigmaXY = mxy - bx * by;
+        T det = sigmaXX * sigmaYY - sigmaXY * sigmaXY;
+
+        T hx = ht.x / ht.z - bx;
+        T hy = ht.y / ht.z - by;
+        T e = hx * hx * sigmaYY + hy * hy * sigmaXX - 2.0f * hx * hy * sigmaXY;
+        if(ht.z > 0.0f && det > 0.0f)
+            d = Exp(-0.5f * e / det) / (Sqrt(det) * Pi * 2.0f);
+    }
+
+    T nDotV = Max(Dot(n, v), 0.0001f);
+    T g = Beckmann_G1(m, nDotL) * Beckmann_G1(m, nDotV);
+
+    return d * g * (1.0f / (4.0f * nDotL * nDotV));
+}
+
+// Specular term of CalcLightingAniso, plus decoding the map and computing the mean slope
+template<typename T> static T AnisoSpecular(const ShadingSample& sample, float roughness, bool ggx)
+{
+    const Vector3<T> frame[3] = { Vector3<T>(TangentFrame[0]), Vector3<T>(TangentFrame[1]), Vector3<T>(TangentFrame[2]) };
+    const Vector3<T> n(sample.Normal);
+    const Vector3<T> l(sample.LightDir);
+    const Vector3<T> v(sample.ViewDir);
+
+    // DecodeAnisoRoughness
+    T sigmaXX = sample.AnisoRoughness.x;
+    T sigmaYY = sample.AnisoRoughness.y;
+    T sigmaXY = sample.AnisoRoughness.z - 0.5f * (sigmaXX + sigmaYY);
+
+    T meanSlopeX = n.x / n.z;
+    T meanSlopeY = n.y / n.z;
+
+    T nDotL = Saturate(Dot(n, l));
+    T nDotV = Max(Dot(n, v), 0.0001f);
+
+    Vector3<T> ht = Normalize(ToTangent(Normalize(Add(v, l)), frame));
+
+    T m2 = T(roughness) * roughness;
+    T ax = 2.0f * sigmaXX + m2;
+    T ay = 2.0f * sigmaYY + m2;
+    T axy = 2.0f * sigmaXY;
+    T det = ax * ay - axy * axy;
+
+    T specular = 0.0f;
+    if(ht.z > 0.0f && det > 0.0f)
+    {
+        T sx = ht.x / ht.z - meanSlopeX;
+        T sy = ht.y / ht.z - meanSlopeY;
+        T e = (sx * sx * ay + sy * sy * ax - 2.0f * sx * sy * axy) / det;
+        T nDotH2 = ht.z * ht.z;
+        T norm = Pi * Sqrt(det) * nDotH2 * nDotH2;
+
+        T a2 = 0.5f * (ax + ay);
+
+        if(ggx)
+        {
+            T d = 1.0f / (norm * (1.0f + e) * (1.0f + e));
+            specular = d * GGX_V1(a2, nDotL) * GGX_V1(a2, nDotV);
+        }
+        else
+        {
+            T d = Exp(-e) / norm;
+            T a = Sqrt(a2);
+            T g = Beckmann_G1(a, nDotL) * Beckmann_G1(a, nDotV);
+            specular = d * g * (1.0f / (4.0f * nDotL * nDotV));
+        }
+    }
+
+    return specular;
+}
+
+template<typename T> static T EvaluateMode(uint32 mode, const ShadingSample& sample, float roughness, float scaleFactor)
+{
+    if(mode == AnisoRoughnessBenchmark::LEAN)
+        return LEANSpecular<T>(sample, roughness, scaleFactor, false);
+    else if(mode == AnisoRoughnessBenchmark::CLEAN)
+        return LEANSpecular<T>(sample, roughness, scaleFactor, true);
+    else
+        return AnisoSpecular<T>(sample, roughness, mode == AnisoRoughnessBenchmark::AnisoGGX);
+}
+
+static float EvaluateMode(uint32 mode, const ShadingSample& sample, float roughness, float scaleFactor)
+{
+    return EvaluateMode<float>(mode, sample, roughness, scaleFactor);
+}
+
+// Random direction in the hemisphere around the normal
+static Float3 RandomDirection(Random& random, const Float3& normal)
+{
+    while(true)
+    {
+        Float3 dir(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f));
+        const float lengthSq = Float3::Dot(dir, dir);
+        if(lengthSq > 0.0001f && lengthSq <= 1.0f && Float3::Dot(dir, normal) > 0.01f && dir.z > 0.01f)
+            return dir / std::sqrt(lengthSq);
+    }
+}
+
+//=================================================================================================
+// AnisoRoughnessBenchmark
+//=================================================================================================
+
+AnisoRoughnessBenchmark::AnisoRoughnessBenchmark() : NumEvaluations(0), Roughness(0.0f)
+{
+}
+
+void AnisoRoughnessBenchmark::Run(const MomentPyramid& moments, const BakeSettings& settings, const BakedMaps& maps,
+                                  const BakedTexture& anisoRoughnessMap, float roughness, uint32 numEvaluations)
+{
+    NumEvaluations = numEvaluations;
+    Roughness = roughness;
+
+    // The LEAN map is fetched once per slice in Mesh.hlsl, for both LEAN and CLEAN
+    Costs[LEAN].Fetches = maps.LEANMap.ArraySize;
+    Costs[LEAN].FetchBytes = maps.LEANMap.TexelSize * maps.LEANMap.ArraySize;
+    Costs[CLEAN].Fetches = Costs[LEAN].Fetches;
+    Costs[CLEAN].FetchBytes = Costs[LEAN].FetchBytes;
+    Costs[AnisoBeckmann].Fetches = 1;
+    Costs[AnisoBeckmann].FetchBytes = anisoRoughnessMap.TexelSize;
+    Costs[AnisoGGX].Fetches = 1;
+    Costs[AnisoGGX].FetchBytes = anisoRoughnessMap.TexelSize;
+
+    // Random texels from the filtered mip levels, where the maps aren't trivial. The average
+    // normal stands in for the filtered normal map.
+    Random random;
+    const uint32 numMipLevels = static_cast<uint32>(moments.Levels.size());
+    std::vector<ShadingSample> samples(numEvaluations);
+    for(uint32 i = 0; i < numEvaluations; ++i)
+    {
+        const uint32 mipLevel = std::min(1 + random.NextUInt(std::max(numMipLevels - 1, 1u)), numMipLevels - 1);
+        const MomentPyramid::Level& level = moments.Levels[mipLevel];
+        const uint32 x = random.NextUInt(level.Width);
+        const uint32 y = random.NextUInt(level.Height);
+        const uint32 idx = y * level.Width + x;
+
+        ShadingSample& sample = samples[i];
+        sample.Normal = Float3::Normalize(Float3(level.Data[MomentPyramid::AvgNormalX][idx],
+                                                 level.Data[MomentPyramid::AvgNormalY][idx],
+                                                 level.Data[MomentPyramid::AvgNormalZ][idx]));
+        sample.LightDir = RandomDirection(random, sample.Normal);
+        sample.ViewDir = RandomDirection(random, sample.Normal);
+
+        const Float4 leanB = maps.LEANMap.Texel(mipLevel, 0, x, y);
+        sample.LEANB = Float2(leanB.x, leanB.y);
+        sample.LEANM = maps.LEANMap.Texel(mipLevel, 1, x, y);
+
+        const Float4 aniso = anisoRoughnessMap.Texel(mipLevel, 0, x, y);
+        sample.AnisoRoughness = Float3(aniso.x, aniso.y, aniso.z);
+    }
+
+    const double invNumEvaluations = 1.0 / std::max(numEvaluations, 1u);
+    for(uint32 mode = 0; mode < NumModes; ++mode)
+    {
+        ModeCost& cost = Costs[mode];
+
+        NumALUOps = 0;
+        NumTranscendentalOps = 0;
+        for(uint32 i = 0; i < numEvaluations; ++i)
+            EvaluateMode<CountedFloat>(mode, samples[i], roughness, settings.ScaleFactor);
+
+        cost.ALUOps = NumALUOps * invNumEvaluations;
+        cost.TranscendentalOps = NumTranscendentalOps * invNumEvaluations;
+
+        Timer timer;
+
+        double specularSum = 0.0;
+        for(uint32 i = 0; i < numEvaluations; ++i)
+            specularSum += EvaluateMode(mode, samples[i], roughness, settings.ScaleFactor);
+
+        timer.Update();
+        cost.Nanoseconds = timer.DeltaSecondsD() * 1000000000.0 * invNumEvaluations;
+        cost.MeanSpecular = specularSum * invNumEvaluations;
+    }
+}
+
+std::wstring AnisoRoughnessBenchmark::ToString() const
+{
+    static const wchar* Names[NumModes] = { L"LEAN", L"CLEAN", L"Anisotropic (Beckmann)", L"Anisotropic (GGX)" };
+
+    std::wstring text = L"Evaluations: " + SampleFramework11::ToString(NumEvaluations);
+    text += L", roughness: " + SampleFramework11::ToString(Roughness) + L"\n";
+    for(uint32 mode = 0; mode < NumModes; ++mode)
+    {
+        const ModeCost& cost = Costs[mode];
+        text += std::wstring(Names[mode]) + L": " + SampleFramework11::ToString(cost.Fetches) + L" fetches, ";
+        text += SampleFramework11::ToString(cost.FetchBytes) + L" bytes/pixel, ";
+        text += SampleFramework11::ToString(cost.ALUOps) + L" ALU ops (";
+        text += SampleFramework11::ToString(cost.TranscendentalOps) + L" transcendental), ";
+        text += SampleFramework11::ToString(cost.Nanoseconds) + L"ns/evaluation, mean specular ";
+        text += SampleFramework11::ToString(cost.MeanSpecular);
+        if(mode + 1 < NumModes)
+            text += L"\n";
+    }
+
+    return text;
+}
\ No newline at end of file
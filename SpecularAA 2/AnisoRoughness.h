@@ -0,0 +1,63 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "MapBaker.h"
+
+using namespace SampleFramework11;
+
+// Compares the per-pixel cost of shading with the anisotropic roughness map against LEAN and
+// CLEAN mapping. Fetches are counted from the formats of the baked maps, and the ALU cost comes
+// from C++ versions of the specular terms in Mesh.hlsl, which are run once with a scalar type
+// that counts every operation and once with plain floats to time them. The diffuse and Fresnel
+// terms and the normal map fetch are the same for every mode, so they're left out.
+struct AnisoRoughnessBenchmark
+{
+    enum Modes
+    {
+        LEAN = 0,
+        CLEAN,
+        AnisoBeckmann,
+        AnisoGGX,
+
+        NumModes
+    };
+
+    struct ModeCost
+    {
+        uint32 Fetches;
+        uint32 FetchBytes;
+        double ALUOps;                  // Averaged over the evaluations, since the G term branches
+        double TranscendentalOps;       // Included in ALUOps: rcp, rsqrt, sqrt and exp
+        double Nanoseconds;
+        double MeanSpecular;            // For checking that the modes give similar results
+
+        ModeCost() : Fetches(0), FetchBytes(0), ALUOps(0.0), TranscendentalOps(0.0), Nanoseconds(0.0),
+                     MeanSpecular(0.0)
+        {
+        }
+    };
+
+    uint32 NumEvaluations;
+    float Roughness;
+    ModeCost Costs[NumModes];
+
+    AnisoRoughnessBenchmark();
+
+    // Evaluates the specular term of each mode for random texels of the maps, with random light
+    // and view directions. roughness is the base roughness.
+    void Run(const MomentPyramid& moments, const BakeSettings& settings, const BakedMaps& maps,
+             const BakedTexture& anisoRoughnessMap, float roughness, uint32 numEvaluations);
+
+    std::wstring ToString() const;
+};
\ No newline at end of file
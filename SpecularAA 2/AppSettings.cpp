@@ -25,11 +25,15 @@ BoolGUI AppSettings::MSAAMode(L"MSAA", true, KeyboardState::M);
 BoolGUI AppSettings::EnableDiffuse(L"Enable Diffuse", true, KeyboardState::J);
 BoolGUI AppSettings::EnableSpecular(L"Enable Specular", true, KeyboardState::I);
 BoolGUI AppSettings::VMFDiffuseAA(L"Enable VMF Diffuse AA", false, KeyboardState::U);
+BoolGUI AppSettings::UseMomentSAT(L"Moment SAT Filtering", false, KeyboardState::O);
+BoolGUI AppSettings::CompactMaps(L"Compact Maps", false, KeyboardState::C);
+BoolGUI AppSettings::CompressedMaps(L"BC Compressed Maps", false, KeyboardState::B);
 
 SpecularAAModeGUI AppSettings::SpecularAAMode;
 NormalMapGUI AppSettings::NormalMap;
 SuperSamplingModeGUI AppSettings::SuperSamplingMode;
 SpecularBRDFGUI AppSettings::SpecularBRDF;
+GeometricAAModeGUI AppSettings::GeometricAAMode;
 
 std::vector<GUIObject*> AppSettings::GUIObjects;
 std::vector<Slider*> AppSettings::Sliders;
@@ -45,6 +49,13 @@ const WCHAR* NormalMapGUI::Names[NormalMapGUI::NumValues] =
     L"Blank",
 };
 
+const WCHAR* GeometricAAModeGUI::Names[GeometricAAModeGUI::NumValues] =
+{
+    L"Disabled",
+    L"Vertex Curvature",
+    L"Screen-Space Derivatives",
+};
+
 void AppSettings::Initialize(ID3D11Device* device)
 {
     // Sliders
@@ -81,10 +92,14 @@ void AppSettings::Initialize(ID3D11Device* device)
     TextGUIs.push_back(&EnableDiffuse);
     TextGUIs.push_back(&EnableSpecular);
     TextGUIs.push_back(&VMFDiffuseAA);
+    TextGUIs.push_back(&UseMomentSAT);
+    TextGUIs.push_back(&CompactMaps);
+    TextGUIs.push_back(&CompressedMaps);
 
     TextGUIs.push_back(&SpecularAAMode);
     TextGUIs.push_back(&NormalMap);
     TextGUIs.push_back(&SpecularBRDF);
+    TextGUIs.push_back(&GeometricAAMode);
 
     for(uintptr i = 0; i < Sliders.size(); ++i)
         GUIObjects.push_back(Sliders[i]);
@@ -37,6 +37,7 @@ public:
         Toksvig = 4,
         PrecomputedVMF = 5,
         PrecomputedToksvig = 6,
+        AnisotropicRoughness = 7,
 
         NumValues
     };
@@ -52,6 +53,7 @@ public:
             L"Toksvig",
             L"Precomputed VMF",
             L"Precomputed Toksvig",
+            L"Anisotropic Roughness",
         };
 
         SetNames(Names);
@@ -133,6 +135,27 @@ public:
     }
 };
 
+class GeometricAAModeGUI : public TextGUI
+{
+public:
+
+    enum Values
+    {
+        Disabled = 0,
+        VertexCurvature,
+        ScreenSpace,
+
+        NumValues
+    };
+
+    static const WCHAR* Names[NumValues];
+
+    GeometricAAModeGUI() : TextGUI(L"Geometric AA Mode", Disabled, NumValues, KeyboardState::G)
+    {
+        SetNames(Names);
+    }
+};
+
 class AppSettings
 {
 public:
@@ -152,11 +175,15 @@ public:
     static BoolGUI EnableDiffuse;
     static BoolGUI EnableSpecular;
     static BoolGUI VMFDiffuseAA;
+    static BoolGUI UseMomentSAT;
+    static BoolGUI CompactMaps;
+    static BoolGUI CompressedMaps;
 
     static SpecularAAModeGUI SpecularAAMode;
     static NormalMapGUI NormalMap;
     static SuperSamplingModeGUI SuperSamplingMode;
     static SpecularBRDFGUI SpecularBRDF;
+    static GeometricAAModeGUI GeometricAAMode;
 
     // Collections of GUI objects
     static std::vector<GUIObject*> GUIObjects;
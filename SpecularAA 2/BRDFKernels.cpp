@@ -0,0 +1,476 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "BRDFKernels.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/Timer.h"
+#include "SampleFramework11/Random.h"
+
+namespace BRDFKernels
+{
+
+//=================================================================================================
+// Lane helpers
+//=================================================================================================
+
+static float LaneSqrt(float x) { return std::sqrt(x); }
+static Float8 LaneSqrt(const Float8& x) { return Float8::Sqrt(x); }
+
+static float LaneMax(float a, float b) { return std::max(a, b); }
+static Float8 LaneMax(const Float8& a, const Float8& b) { return Float8::Max(a, b); }
+
+static float LaneSaturate(float x) { return Saturate(x); }
+static Float8 LaneSaturate(const Float8& x) { return Float8::Saturate(x); }
+
+static float LaneExp(float x) { return std::exp(x); }
+static Float8 LaneExp(const Float8& x) { return Float8::Exp2(x * 1.442695041f); }
+
+static float LaneSelect(bool mask, float a, float b) { return mask ? a : b; }
+static Float8 LaneSelect(const Float8& mask, const Float8& a, const Float8& b) { return Float8::Select(mask, a, b); }
+
+template<typename T> static T Dot(const Vector3<T>& a, const Vector3<T>& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+template<typename T> static Vector3<T> Normalize(const Vector3<T>& v)
+{
+    const T invLength = 1.0f / LaneSqrt(Dot(v, v));
+    return Vector3<T>(v.x * invLength, v.y * invLength, v.z * invLength);
+}
+
+//=================================================================================================
+// Kernels
+//=================================================================================================
+
+template<typename T> T Fresnel(const T& specAlbedo, const Vector3<T>& h, const Vector3<T>& l)
+{
+    const T lDotH = LaneSaturate(Dot(l, h));
+    const T x = 1.0f - lDotH;
+    const T x2 = x * x;
+    const T fresnel = specAlbedo + (1.0f - specAlbedo) * (x2 * x2 * x);
+
+    // Disable specular entirely if the albedo is set to 0.0
+    return LaneSelect(specAlbedo <= 0.0f, T(0.0f), fresnel);
+}
+
+template<typename T> T Beckmann_G1(const T& m, const T& nDotX)
+{
+    const T nDotX2 = nDotX * nDotX;
+    const T tanTheta = LaneSqrt((1.0f - nDotX2) / nDotX2);
+    const T a = 1.0f / (m * tanTheta);
+    const T a2 = a * a;
+
+    const T g = (3.535f * a + 2.181f * a2) / (1.0f + 2.276f * a + 2.577f * a2);
+    return LaneSelect(a < 1.6f, g, T(1.0f));
+}
+
+template<typename T> T Beckmann_Specular(const T& m, const Vector3<T>& n, const Vector3<T>& h,
+                                         const Vector3<T>& v, const Vector3<T>& l)
+{
+    const T nDotH = LaneMax(Dot(n, h), T(0.0001f));
+    const T nDotL = LaneSaturate(Dot(n, l));
+    const T nDotV = LaneMax(Dot(n, v), T(0.0001f));
+
+    const T nDotH2 = nDotH * nDotH;
+    const T nDotH4 = nDotH2 * nDotH2;
+    const T m2 = m * m;
+
+    // Calculate the distribution term
+    const T tanTheta2 = (1.0f - nDotH2) / nDotH2;
+    const T expTerm = LaneExp(-tanTheta2 / m2);
+    const T d = expTerm / (Pi * m2 * nDotH4);
+
+    // Calculate the matching geometric term
+    const T g1i = Beckmann_G1(m, nDotL);
+    const T g1o = Beckmann_G1(m, nDotV);
+    const T g = g1i * g1o;
+
+    return d * g * (1.0f / (4.0f * nDotL * nDotV));
+}
+
+template<typename T> T GGX_V1(const T& m2, const T& nDotX)
+{
+    return 1.0f / (nDotX + LaneSqrt(m2 + (1.0f - m2) * nDotX * nDotX));
+}
+
+template<typename T> T GGX_Specular(const T& m, const Vector3<T>& n, const Vector3<T>& h,
+                                    const Vector3<T>& v, const Vector3<T>& l)
+{
+    const T nDotH = LaneSaturate(Dot(n, h));
+    const T nDotL = LaneSaturate(Dot(n, l));
+    const T nDotV = LaneSaturate(Dot(n, v));
+
+    const T m2 = m * m;
+
+    // Calculate the distribution term
+    const T x = nDotH * nDotH * (m2 - 1.0f) + 1.0f;
+    const T d = m2 / (Pi * x * x);
+
+    // Calculate the matching visibility term
+    const T v1i = GGX_V1(m2, nDotL);
+    const T v1o = GGX_V1(m2, nDotV);
+    const T vis = v1i * v1o;
+
+    return d * vis;
+}
+
+// The branch on nDotL in Mesh.hlsl becomes a select, so lanes with the light behind the normal
+// still evaluate the BRDF and throw the result away
+template<typename T> T CalcLighting(const Vector3<T>& n, const Vector3<T>& l, const Vector3<T>& v,
+                                    const T& diffuseAlbedo, const T& specularAlbedo, const T& roughness,
+                                    SpecularBRDF brdf)
+{
+    const T nDotL = LaneSaturate(Dot(n, l));
+    const Vector3<T> h = Normalize(Vector3<T>(v.x + l.x, v.y + l.y, v.z + l.z));
+
+    T specular;
+    if(brdf == SpecularBRDFGGX)
+        specular = GGX_Specular(roughness, n, h, v, l);
+    else
+        specular = Beckmann_Specular(roughness, n, h, v, l);
+
+    const T fresnel = Fresnel(specularAlbedo, h, l);
+    const T lighting = (diffuseAlbedo * InvPi + fresnel * specular) * nDotL;
+
+    return LaneSelect(nDotL > 0.0f, LaneMax(lighting, T(0.0f)), T(0.0f));
+}
+
+#define InstantiateKernels_(T)                                                                                  \
+    template T Fresnel<T>(const T&, const Vector3<T>&, const Vector3<T>&);                                      \
+    template T Beckmann_G1<T>(const T&, const T&);                                                              \
+    template T Beckmann_Specular<T>(const T&, const Vector3<T>&, const Vector3<T>&, const Vector3<T>&,          \
+                                    const Vector3<T>&);                                                         \
+    template T GGX_V1<T>(const T&, const T&);                                                                   \
+    template T GGX_Specular<T>(const T&, const Vector3<T>&, const Vector3<T>&, const Vector3<T>&,               \
+                               const Vector3<T>&);                                                              \
+    template T CalcLighting<T>(const Vector3<T>&, const Vector3<T>&, const Vector3<T>&, const T&, const T&,     \
+                               const T&, SpecularBRDF);
+
+InstantiateKernels_(float)
+InstantiateKernels_(Float8)
+
+#undef InstantiateKernels_
+
+}
+
+using namespace BRDFKernels;
+
+//=================================================================================================
+// Batches
+//=================================================================================================
+
+void LightingBatch::Resize(uint32 count)
+{
+    Count = count;
+    for(uint32 i = 0; i < NumChannels; ++i)
+        Data[i].resize(count);
+}
+
+template<typename T> static T LoadChannel(const LightingBatch& batch, uint32 channel, uint32 idx);
+
+template<> float LoadChannel<float>(const LightingBatch& batch, uint32 channel, uint32 idx)
+{
+    return batch.Data[channel][idx];
+}
+
+template<> Float8 LoadChannel<Float8>(const LightingBatch& batch, uint32 channel, uint32 idx)
+{
+    return Float8::Load(&batch.Data[channel][idx]);
+}
+
+template<typename T> static Vector3<T> LoadVector(const LightingBatch& batch, uint32 channel, uint32 idx)
+{
+    return Vector3<T>(LoadChannel<T>(batch, channel + 0, idx), LoadChannel<T>(batch, channel + 1, idx),
+                      LoadChannel<T>(batch, channel + 2, idx));
+}
+
+template<typename T> static T EvaluateLighting(const LightingBatch& batch, const LightingParams& params, uint32 idx)
+{
+    return CalcLighting<T>(LoadVector<T>(batch, LightingBatch::NormalX, idx),
+                           LoadVector<T>(batch, LightingBatch::LightDirX, idx),
+                           LoadVector<T>(batch, LightingBatch::ViewDirX, idx),
+                           T(params.DiffuseAlbedo), T(params.SpecularAlbedo),
+                           LoadChannel<T>(batch, LightingBatch::Roughness, idx), params.BRDF);
+}
+
+static void EvaluateLightingScalar(const LightingBatch& batch, const LightingParams& params, uint32 start,
+                                   float* results)
+{
+    for(uint32 i = start; i < batch.Count; ++i)
+        results[i] = EvaluateLighting<float>(batch, params, i);
+}
+
+void EvaluateLighting(const LightingBatch& batch, const LightingParams& params, float* results)
+{
+    const uint32 numVectorized = batch.Count - batch.Count % Float8::Width;
+    for(uint32 i = 0; i < numVectorized; i += Float8::Width)
+        EvaluateLighting<Float8>(batch, params, i).Store(results + i);
+
+    EvaluateLightingScalar(batch, params, numVectorized, results);
+}
+
+void EvaluateLightingScalar(const LightingBatch& batch, const LightingParams& params, float* results)
+{
+    EvaluateLightingScalar(batch, params, 0, results);
+}
+
+//=================================================================================================
+// BRDFKernelBenchmark
+//=================================================================================================
+
+// Random direction on the sphere
+static Float3 RandomSphereDirection(Random& random)
+{
+    while(true)
+    {
+        Float3 dir(random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f), random.NextFloat(-1.0f, 1.0f));
+        const float lengthSq = Float3::Dot(dir, dir);
+        if(lengthSq > 0.0001f && lengthSq <= 1.0f)
+            return dir / std::sqrt(lengthSq);
+    }
+}
+
+// Relative error that treats matching infinities/NaNs as exact, since the kernels are allowed to
+// produce them in the same places as the HLSL (Beckmann_Specular with nDotL == 0, for instance)
+static float RelativeError(float value, float reference)
+{
+    const bool valueFinite = std::isfinite(value);
+    const bool referenceFinite = std::isfinite(reference);
+    if(!valueFinite || !referenceFinite)
+        return valueFinite == referenceFinite ? 0.0f : FLT_MAX;
+
+    return std::abs(value - reference) / std::max(std::abs(reference), 1.0f);
+}
+
+// Evaluates a kernel with float and with Float8, and compares both against the reference
+template<typename ScalarFn, typename SIMDFn>
+static float CheckTerm(uint32 count, const float* reference, ScalarFn scalarFn, SIMDFn simdFn)
+{
+    float maxError = 0.0f;
+    for(uint32 i = 0; i < count; ++i)
+        maxError = std::max(maxError, RelativeError(scalarFn(i), reference[i]));
+
+    float lanes[Float8::Width];
+    for(uint32 i = 0; i + Float8::Width <= count; i += Float8::Width)
+    {
+        simdFn(i).Store(lanes);
+        for(uint32 lane = 0; lane < Float8::Width; ++lane)
+            maxError = std::max(maxError, RelativeError(lanes[lane], reference[i + lane]));
+    }
+
+    return maxError;
+}
+
+BRDFKernelBenchmark::BRDFKernelBenchmark() : NumEvaluations(0), NumIterations(0), UsesAVX2(false)
+{
+    for(uint32 i = 0; i < NumTerms; ++i)
+        MaxError[i] = 0.0f;
+}
+
+void BRDFKernelBenchmark::Run(uint32 numEvaluations, uint32 numIterations)
+{
+    NumEvaluations = numEvaluations;
+    NumIterations = std::max(numIterations, 1u);
+
+    UsesAVX2 = SIMD_AVX2_ != 0;
+
+    // Random pairs over the whole sphere, so that grazing angles and lights/views behind the
+    // normal are covered, with roughness values from the clamp used in PS() up to 1
+    Random random;
+    LightingBatch batch;
+    batch.Resize(numEvaluations);
+    std::vector<Float3> lightPositions(numEvaluations);
+    std::vector<Float3> cameraPositions(numEvaluations);
+    for(uint32 i = 0; i < numEvaluations; ++i)
+    {
+        // The batch gets the directions that CalcPointLight computes from the light and camera
+        // positions, since near the peak of a sharp lobe a 1 ulp change in the half vector is
+        // enough to change the result by more than the tolerance
+        lightPositions[i] = RandomSphereDirection(random);
+        cameraPositions[i] = RandomSphereDirection(random);
+        const Float3 n = RandomSphereDirection(random);
+        const Float3 l = lightPositions[i] / lightPositions[i].Length();
+        const Float3 v = Float3::Normalize(cameraPositions[i]);
+        const Float3* dirs[3] = { &n, &l, &v };
+        for(uint32 d = 0; d < 3; ++d)
+        {
+            batch.Data[LightingBatch::NormalX + d * 3 + 0][i] = dirs[d]->x;
+            batch.Data[LightingBatch::NormalX + d * 3 + 1][i] = dirs[d]->y;
+            batch.Data[LightingBatch::NormalX + d * 3 + 2][i] = dirs[d]->z;
+        }
+        batch.Data[LightingBatch::Roughness][i] = random.NextFloat(0.01f, 1.0f);
+    }
+
+    const LightingParams params;
+    auto sampleN = [&](uint32 i) { return Float3(batch.Data[0][i], batch.Data[1][i], batch.Data[2][i]); };
+    auto sampleL = [&](uint32 i) { return Float3(batch.Data[3][i], batch.Data[4][i], batch.Data[5][i]); };
+    auto sampleV = [&](uint32 i) { return Float3(batch.Data[6][i], batch.Data[7][i], batch.Data[8][i]); };
+    auto sampleH = [&](uint32 i) { return Float3::Normalize(sampleV(i) + sampleL(i)); };
+    auto roughness = [&](uint32 i) { return batch.Data[LightingBatch::Roughness][i]; };
+    auto nDotL = [&](uint32 i) { return Saturate(Float3::Dot(sampleN(i), sampleL(i))); };
+
+    // Everything below uses the scalar functions from MeshShading as the reference
+    std::vector<float> reference(numEvaluations);
+
+    for(uint32 i = 0; i < numEvaluations; ++i)
+        reference[i] = ::Fresnel(Float3(params.SpecularAlbedo), sampleH(i), sampleL(i)).x;
+    MaxError[TermFresnel] = CheckTerm(numEvaluations, reference.data(),
+        [&](uint32 i)
+        {
+            const Vector3<float> v = LoadVector<float>(batch, LightingBatch::ViewDirX, i);
+            const Vector3<float> l = LoadVector<float>(batch, LightingBatch::LightDirX, i);
+            return Fresnel<float>(params.SpecularAlbedo, Normalize(Vector3<float>(v.x + l.x, v.y + l.y, v.z + l.z)), l);
+        },
+        [&](uint32 i)
+        {
+            const Vector3<Float8> v = LoadVector<Float8>(batch, LightingBatch::ViewDirX, i);
+            const Vector3<Float8> l = LoadVector<Float8>(batch, LightingBatch::LightDirX, i);
+            return Fresnel<Float8>(params.SpecularAlbedo, Normalize(Vector3<Float8>(v.x + l.x, v.y + l.y, v.z + l.z)), l);
+        });
+
+    std::vector<float> nDotLs(numEvaluations);
+    for(uint32 i = 0; i < numEvaluations; ++i)
+        nDotLs[i] = nDotL(i);
+
+    for(uint32 i = 0; i < numEvaluations; ++i)
+        reference[i] = ::Beckmann_G1(roughness(i), nDotLs[i]);
+    MaxError[TermBeckmannG1] = CheckTerm(numEvaluations, reference.data(),
+        [&](uint32 i) { return Beckmann_G1<float>(roughness(i), nDotLs[i]); },
+        [&](uint32 i)
+        {
+            return Beckmann_G1<Float8>(LoadChannel<Float8>(batch, LightingBatch::Roughness, i), Float8::Load(&nDotLs[i]));
+        });
+
+    for(uint32 i = 0; i < numEvaluations; ++i)
+        reference[i] = ::GGX_V1(roughness(i) * roughness(i), nDotLs[i]);
+    MaxError[TermGGXV1] = CheckTerm(numEvaluations, reference.data(),
+        [&](uint32 i) { return GGX_V1<float>(roughness(i) * roughness(i), nDotLs[i]); },
+        [&](uint32 i)
+        {
+            const Float8 m = LoadChannel<Float8>(batch, LightingBatch::Roughness, i);
+            return GGX_V1<Float8>(m * m, Float8::Load(&nDotLs[i]));
+        });
+
+    // The specular terms are checked with the half vector that CalcLighting would compute
+    auto checkSpecular = [&](SpecularBRDF brdf)
+    {
+        for(uint32 i = 0; i < numEvaluations; ++i)
+        {
+            if(brdf == SpecularBRDFGGX)
+                reference[i] = ::GGX_Specular(roughness(i), sampleN(i), sampleH(i), sampleV(i), sampleL(i));
+            else
+                reference[i] = ::Beckmann_Specular(roughness(i), sampleN(i), sampleH(i), sampleV(i), sampleL(i));
+        }
+
+        auto specular = [&](auto lane, uint32 i)
+        {
+            typedef decltype(lane) T;
+            const Vector3<T> n = LoadVector<T>(batch, LightingBatch::NormalX, i);
+            const Vector3<T> l = LoadVector<T>(batch, LightingBatch::LightDirX, i);
+            const Vector3<T> v = LoadVector<T>(batch, LightingBatch::ViewDirX, i);
+            const Vector3<T> h = Normalize(Vector3<T>(v.x + l.x, v.y + l.y, v.z + l.z));
+            const T m = LoadChannel<T>(batch, LightingBatch::Roughness, i);
+            return brdf == SpecularBRDFGGX ? GGX_Specular<T>(m, n, h, v, l) : Beckmann_Specular<T>(m, n, h, v, l);
+        };
+
+        return CheckTerm(numEvaluations, reference.data(),
+                         [&](uint32 i) { return specular(0.0f, i); },
+                         [&](uint32 i) { return specular(Float8(0.0f), i); });
+    };
+
+    MaxError[TermBeckmannSpecular] = checkSpecular(SpecularBRDFBeckmann);
+    MaxError[TermGGXSpecular] = checkSpecular(SpecularBRDFGGX);
+
+    // CalcLighting is static in MeshShading, so it goes through CalcPointLight with a unit light
+    // at distance 1 from a shading point at the origin, which makes the attenuation exactly 1
+    MaxError[TermCalcLighting] = 0.0f;
+    std::vector<float> results(numEvaluations);
+    for(uint32 brdf = 0; brdf < NumSpecularBRDFs; ++brdf)
+    {
+        LightingParams brdfParams = params;
+        brdfParams.BRDF = SpecularBRDF(brdf);
+
+        ShadingConstants constants;
+        constants.BRDF = brdfParams.BRDF;
+
+        for(uint32 i = 0; i < numEvaluations; ++i)
+        {
+            constants.CameraPosWS = cameraPositions[i];
+            ShadingPointLight light;
+            light.Position = lightPositions[i];
+            light.Color = Float3(1.0f);
+            light.Falloff = 0.0f;
+            reference[i] = CalcPointLight(constants, sampleN(i), light, Float3(brdfParams.DiffuseAlbedo),
+                                          Float3(brdfParams.SpecularAlbedo), roughness(i), Float3(0.0f)).x;
+        }
+
+        EvaluateLightingScalar(batch, brdfParams, results.data());
+        for(uint32 i = 0; i < numEvaluations; ++i)
+            MaxError[TermCalcLighting] = std::max(MaxError[TermCalcLighting], RelativeError(results[i], reference[i]));
+
+        EvaluateLighting(batch, brdfParams, results.data());
+        for(uint32 i = 0; i < numEvaluations; ++i)
+            MaxError[TermCalcLighting] = std::max(MaxError[TermCalcLighting], RelativeError(results[i], reference[i]));
+
+        BRDFResult& result = Results[brdf];
+
+        Timer timer;
+        for(uint32 iteration = 0; iteration < NumIterations; ++iteration)
+            EvaluateLightingScalar(batch, brdfParams, results.data());
+        timer.Update();
+        result.ScalarSeconds = timer.DeltaSecondsD();
+
+        for(uint32 iteration = 0; iteration < NumIterations; ++iteration)
+            EvaluateLighting(batch, brdfParams, results.data());
+        timer.Update();
+        result.SIMDSeconds = timer.DeltaSecondsD();
+    }
+}
+
+bool BRDFKernelBenchmark::Passed(float tolerance) const
+{
+    for(uint32 i = 0; i < NumTerms; ++i)
+        if(!(MaxError[i] <= tolerance))
+            return false;
+    return true;
+}
+
+std::wstring BRDFKernelBenchmark::ToString() const
+{
+    static const wchar* TermNames[NumTerms] = { L"Fresnel", L"Beckmann_G1", L"Beckmann_Specular", L"GGX_V1",
+                                                L"GGX_Specular", L"CalcLighting" };
+
+    std::wstring text = L"Evaluations: " + SampleFramework11::ToString(NumEvaluations);
+    text += L" x " + SampleFramework11::ToString(NumIterations) + L" iterations, ";
+    text += SampleFramework11::ToString(uint32(Float8::Width)) + (UsesAVX2 ? L"-wide AVX2\n" : L"-wide scalar fallback\n");
+
+    text += L"Max relative error:";
+    for(uint32 i = 0; i < NumTerms; ++i)
+        text += std::wstring(L" ") + TermNames[i] + L" " + SampleFramework11::ToString(MaxError[i]);
+
+    const double numEvaluations = double(NumEvaluations) * NumIterations;
+    for(uint32 brdf = 0; brdf < NumSpecularBRDFs; ++brdf)
+    {
+        const BRDFResult& result = Results[brdf];
+        const double scalarRate = numEvaluations / std::max(result.ScalarSeconds, 1e-9) / 1000000.0;
+        const double simdRate = numEvaluations / std::max(result.SIMDSeconds, 1e-9) / 1000000.0;
+        text += L"\n" + std::wstring(SpecularBRDFName(SpecularBRDF(brdf))) + L": scalar ";
+        text += SampleFramework11::ToString(scalarRate) + L"M evaluations/s, SIMD ";
+        text += SampleFramework11::ToString(simdRate) + L"M evaluations/s (";
+        text += SampleFramework11::ToString(simdRate / std::max(scalarRate, 1e-9)) + L"x)";
+    }
+
+    return text;
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/SIMD.h"
+
+#include "MeshShading.h"
+
+using namespace SampleFramework11;
+
+// The BRDF terms from Mesh.hlsl, written once against a lane type so that they can be evaluated
+// for a single pixel/light pair with float, or for 8 at a time with Float8. The albedos are
+// grayscale like they are in the app, so CalcLighting returns the factor that the light color
+// is multiplied by instead of an RGB value.
+namespace BRDFKernels
+{
+    template<typename T> struct Vector3
+    {
+        T x;
+        T y;
+        T z;
+
+        Vector3()
+        {
+        }
+
+        Vector3(const T& x_, const T& y_, const T& z_) : x(x_), y(y_), z(z_)
+        {
+        }
+    };
+
+    template<typename T> T Fresnel(const T& specAlbedo, const Vector3<T>& h, const Vector3<T>& l);
+    template<typename T> T Beckmann_G1(const T& m, const T& nDotX);
+    template<typename T> T Beckmann_Specular(const T& m, const Vector3<T>& n, const Vector3<T>& h,
+                                             const Vector3<T>& v, const Vector3<T>& l);
+    template<typename T> T GGX_V1(const T& m2, const T& nDotX);
+    template<typename T> T GGX_Specular(const T& m, const Vector3<T>& n, const Vector3<T>& h,
+                                        const Vector3<T>& v, const Vector3<T>& l);
+
+    // n, l and v need to be normalized. Lanes where the light is behind the normal return 0.
+    template<typename T> T CalcLighting(const Vector3<T>& n, const Vector3<T>& l, const Vector3<T>& v,
+                                        const T& diffuseAlbedo, const T& specularAlbedo, const T& roughness,
+                                        SpecularBRDF brdf);
+}
+
+// A batch of pixel/light pairs in structure-of-arrays form. The directions are the normal, the
+// direction to the light, and the direction to the camera, all normalized.
+struct LightingBatch
+{
+    enum Channels
+    {
+        NormalX = 0,
+        NormalY,
+        NormalZ,
+        LightDirX,
+        LightDirY,
+        LightDirZ,
+        ViewDirX,
+        ViewDirY,
+        ViewDirZ,
+        Roughness,
+
+        NumChannels
+    };
+
+    uint32 Count;
+    std::vector<float> Data[NumChannels];
+
+    LightingBatch() : Count(0)
+    {
+    }
+
+    void Resize(uint32 count);
+};
+
+struct LightingParams
+{
+    SpecularBRDF BRDF;
+    float DiffuseAlbedo;
+    float SpecularAlbedo;
+
+    LightingParams() : BRDF(SpecularBRDFGGX), DiffuseAlbedo(0.5f), SpecularAlbedo(0.05f)
+    {
+    }
+};
+
+// Evaluates CalcLighting for every pair in the batch, Float8::Width pairs at a time. The pairs
+// that don't fill a whole Float8 go through the scalar version.
+void EvaluateLighting(const LightingBatch& batch, const LightingParams& params, float* results);
+
+// Evaluates CalcLighting for every pair in the batch with the scalar version
+void EvaluateLightingScalar(const LightingBatch& batch, const LightingParams& params, float* results);
+
+// Checks the kernels against the C++ port of Mesh.hlsl in MeshShading, and times the scalar and
+// SIMD paths. Every term is compared separately, over random directions and roughness values
+// that include grazing angles and lights behind the surface.
+struct BRDFKernelBenchmark
+{
+    enum Terms
+    {
+        TermFresnel = 0,
+        TermBeckmannG1,
+        TermBeckmannSpecular,
+        TermGGXV1,
+        TermGGXSpecular,
+        TermCalcLighting,
+
+        NumTerms
+    };
+
+    struct BRDFResult
+    {
+        double ScalarSeconds;
+        double SIMDSeconds;
+
+        BRDFResult() : ScalarSeconds(0.0), SIMDSeconds(0.0)
+        {
+        }
+    };
+
+    uint32 NumEvaluations;
+    uint32 NumIterations;
+    bool UsesAVX2;
+    float MaxError[NumTerms];           // Relative to max(|reference|, 1)
+    BRDFResult Results[NumSpecularBRDFs];
+
+    BRDFKernelBenchmark();
+
+    void Run(uint32 numEvaluations, uint32 numIterations);
+
+    bool Passed(float tolerance) const;
+    std::wstring ToString() const;
+};
\ No newline at end of file
@@ -0,0 +1,540 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "BatchBaker.h"
+
+#include "SampleFramework11/Exceptions.h"
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/FileIO.h"
+#include "SampleFramework11/Timer.h"
+
+const wchar* BatchStageName(BatchStage stage)
+{
+    static const wchar* Names[NumBatchStages] = { L"Decode", L"Moments", L"Solve", L"Compress", L"Write" };
+    return Names[stage];
+}
+
+//=================================================================================================
+// BatchManifest
+//=================================================================================================
+
+static std::wstring Trim(const std::wstring& str)
+{
+    const std::wstring::size_type start = str.find_first_not_of(L" \t");
+    if(start == std::wstring::npos)
+        return std::wstring();
+    const std::wstring::size_type end = str.find_last_not_of(L" \t");
+    return str.substr(start, end - start + 1);
+}
+
+static bool IsRelativePath(const std::wstring& path)
+{
+    if(path.length() > 0 && (path[0] == L'\\' || path[0] == L'/'))
+        return false;
+    return path.length() < 2 || path[1] != L':';
+}
+
+void BatchManifest::LoadFromFile(const wchar* filePath)
+{
+    if(FileExists(filePath) == false)
+        throw Exception(L"Manifest not found: " + std::wstring(filePath));
+
+    const std::string text = ReadFileAsString(filePath);
+    const std::wstring manifestDir = GetDirectoryFromFilePath(filePath);
+
+    Entries.clear();
+
+    uint64 lineStart = 0;
+    uint32 lineNumber = 0;
+    while(lineStart < text.length())
+    {
+        uint64 lineEnd = text.find_first_of("\r\n", lineStart);
+        if(lineEnd == std::string::npos)
+            lineEnd = text.length();
+        const std::string ansiLine = text.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        ++lineNumber;
+
+        const std::wstring line = Trim(AnsiToWString(ansiLine.c_str()));
+        if(line.length() == 0 || line[0] == L'#')
+            continue;
+
+        Entry entry;
+        entry.Path = line;
+
+        const std::wstring::size_type separator = line.rfind(L'|');
+        if(separator != std::wstring::npos)
+        {
+            entry.Path = Trim(line.substr(0, separator));
+            const std::wstring priority = Trim(line.substr(separator + 1));
+            std::wistringstream stream(priority);
+            wchar c;
+            if(!(stream >> entry.Priority) || stream.get(c))
+                throw Exception(L"Invalid priority on line " + ToString(lineNumber) + L" of the manifest: " + priority);
+        }
+
+        if(entry.Path.length() == 0)
+            continue;
+
+        if(IsRelativePath(entry.Path))
+            entry.Path = manifestDir + entry.Path;
+
+        Entries.push_back(entry);
+    }
+}
+
+//=================================================================================================
+// BatchStats
+//=================================================================================================
+
+BatchMapResult::BatchMapResult() : Index(0), NumCompleted(0), Width(0), Height(0), CacheHit(false),
+                                   CompressedCacheHit(false), Failed(false)
+{
+    for(uint32 i = 0; i < NumBatchStages; ++i)
+        StageSeconds[i] = 0.0;
+}
+
+double BatchStats::MapsPerSecond() const
+{
+    return Seconds > 0.0 ? (NumMaps - NumFailed) / Seconds : 0.0;
+}
+
+double BatchStats::TexelsPerSecond() const
+{
+    return Seconds > 0.0 ? TexelsProcessed / Seconds : 0.0;
+}
+
+std::wstring BatchStats::ToString() const
+{
+    std::wstring text = L"Processed " + SampleFramework11::ToString(NumMaps) + L" maps in ";
+    text += SampleFramework11::ToString(Seconds) + L"s using " + SampleFramework11::ToString(NumThreads);
+    text += L" threads (" + SampleFramework11::ToString(MapsPerSecond()) + L" maps/s, ";
+    text += SampleFramework11::ToString(TexelsPerSecond() / 1000000.0) + L" MTexels/s)\n";
+    text += L"  Baked: " + SampleFramework11::ToString(NumBaked) + L", skipped cache hits: ";
+    text += SampleFramework11::ToString(NumCacheHits) + L" bakes, " + SampleFramework11::ToString(NumCompressedCacheHits);
+    text += L" compressions, failed: " + SampleFramework11::ToString(NumFailed) + L"\n";
+    text += L"  Peak maps in flight: " + SampleFramework11::ToString(PeakMapsInFlight) + L", tasks stolen: ";
+    text += SampleFramework11::ToString(NumSteals);
+
+    double totalSeconds = 0.0;
+    for(uint32 i = 0; i < NumBatchStages; ++i)
+        totalSeconds += Stages[i].Seconds;
+
+    for(uint32 i = 0; i < NumBatchStages; ++i)
+    {
+        const BatchStageStats& stage = Stages[i];
+        text += L"\n  " + std::wstring(BatchStageName(BatchStage(i))) + L": ";
+        text += SampleFramework11::ToString(stage.Seconds) + L"s (";
+        text += SampleFramework11::ToString(totalSeconds > 0.0 ? stage.Seconds * 100.0 / totalSeconds : 0.0) + L"%), ";
+        text += SampleFramework11::ToString(stage.NumMaps) + L" maps, ";
+        text += SampleFramework11::ToString(stage.NumMaps > 0 ? stage.Seconds * 1000.0 / stage.NumMaps : 0.0);
+        text += L"ms per map, peak queue " + SampleFramework11::ToString(stage.PeakQueued);
+    }
+
+    return text;
+}
+
+//=================================================================================================
+// BatchBaker
+//=================================================================================================
+
+// A map on its way through the pipeline. Everything a stage doesn't need anymore is freed as
+// soon as the stage is done, so that a map only holds on to the data for its next stage.
+struct BatchBaker::Item
+{
+    uint32 Index;
+    int32 Priority;
+    BatchStage NextStage;
+    NormalMapData NormalMap;
+    uint64 CacheKey;
+    std::unique_ptr<MapBaker> Baker;
+    BakedMaps Maps;
+    CompressedMaps Compressed;
+    BatchMapResult Result;
+
+    Item() : Index(0), Priority(0), NextStage(BatchStageDecode), CacheKey(0)
+    {
+    }
+};
+
+// The stage that a map normally goes to after the given one, used for reserving queue space
+static BatchStage DefaultNextStage(BatchStage stage, bool compress)
+{
+    if(stage == BatchStageSolve && compress == false)
+        return BatchStageWrite;
+    return BatchStage(stage + 1);
+}
+
+// Where the maps of an entry are written, minus the suffix of each map
+static std::wstring OutputPrefix(const BatchSettings& settings, const std::wstring& path)
+{
+    return settings.OutputDir + L"\\" + GetFileNameWithoutExtension(path.c_str());
+}
+
+// Maps with the same file name in different directories would overwrite each other's output, so
+// the batch is refused before anything is baked. Windows file names don't care about case.
+static void CheckOutputPrefixes(const BatchManifest& manifest, const BatchSettings& settings)
+{
+    std::map<std::wstring, uint64> prefixes;
+    for(uint64 i = 0; i < manifest.Entries.size(); ++i)
+    {
+        std::wstring prefix = OutputPrefix(settings, manifest.Entries[i].Path);
+        for(uint64 c = 0; c < prefix.length(); ++c)
+            prefix[c] = towlower(prefix[c]);
+
+        std::map<std::wstring, uint64>::const_iterator existing = prefixes.find(prefix);
+        if(existing != prefixes.end())
+            throw Exception(L"The maps of " + manifest.Entries[existing->second].Path + L" and "
+                            + manifest.Entries[i].Path + L" would both be written to "
+                            + OutputPrefix(settings, manifest.Entries[i].Path) + L"_*.dds");
+
+        prefixes[prefix] = i;
+    }
+}
+
+BatchBaker::BatchBaker() :  manifest(NULL),
+                            settings(NULL),
+                            progress(NULL),
+                            nextItem(0),
+                            queueDepth(1),
+                            numInFlight(0),
+                            numCompleted(0)
+{
+    for(uint32 i = 0; i < NumBatchStages; ++i)
+        numRunning[i] = 0;
+}
+
+void BatchBaker::Run(const BatchManifest& manifest_, const BatchSettings& settings_, const ProgressFunction& progress_)
+{
+    CheckOutputPrefixes(manifest_, settings_);
+
+    manifest = &manifest_;
+    settings = &settings_;
+    progress = &progress_;
+
+    stats = BatchStats();
+    stats.NumMaps = manifest->Entries.size();
+
+    scheduler.Initialize(settings->NumThreads);
+    stats.NumThreads = scheduler.NumThreads();
+    queueDepth = settings->QueueDepth > 0 ? settings->QueueDepth : stats.NumThreads;
+
+    if(settings->CacheDir.length() > 0)
+        cache.Initialize(settings->CacheDir.c_str());
+    CreateDirectoryW(settings->OutputDir.c_str(), NULL);
+
+    order.resize(manifest->Entries.size());
+    for(uint32 i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](uint32 a, uint32 b)
+    {
+        return manifest->Entries[a].Priority > manifest->Entries[b].Priority;
+    });
+
+    nextItem = 0;
+    numInFlight = 0;
+    numCompleted = 0;
+    for(uint32 i = 0; i < NumBatchStages; ++i)
+        numRunning[i] = 0;
+
+    Timer timer;
+
+    {
+        std::lock_guard<std::mutex> lock(pipelineMutex);
+        Pump();
+    }
+    scheduler.Wait();
+
+    timer.Update();
+
+    _ASSERT(numInFlight == 0 && numCompleted == order.size());
+
+    stats.Seconds = timer.ElapsedSecondsD();
+    stats.NumSteals = scheduler.NumSteals();
+
+    scheduler.Shutdown();
+
+    manifest = NULL;
+    settings = NULL;
+    progress = NULL;
+}
+
+// Hands out work to the free threads, starting with the stages closest to the end of the
+// pipeline. Must be called with the pipeline lock held.
+void BatchBaker::Pump()
+{
+    // Stalled maps go first, since their stage can't start anything else until they're gone
+    for(int32 stage = NumBatchStages - 1; stage >= 0; --stage)
+    {
+        std::vector<Item*>& blocked = stalled[stage];
+        while(blocked.size() > 0 && queues[blocked[0]->NextStage].size() < queueDepth)
+        {
+            PushQueue(blocked[0]);
+            blocked.erase(blocked.begin());
+        }
+    }
+
+    uint32 numBusy = 0;
+    for(uint32 i = 0; i < NumBatchStages; ++i)
+        numBusy += numRunning[i];
+
+    uint32 numFree = stats.NumThreads > numBusy ? stats.NumThreads - numBusy : 0;
+    for(int32 stageIdx = NumBatchStages - 1; stageIdx >= 0 && numFree > 0; --stageIdx)
+    {
+        const BatchStage stage = BatchStage(stageIdx);
+        while(numFree > 0 && CanStart(stage))
+        {
+            Item* item = NULL;
+            if(stage == BatchStageDecode)
+            {
+                item = new Item();
+                item->Index = order[nextItem++];
+                item->Priority = manifest->Entries[item->Index].Priority;
+                item->Result.Index = item->Index;
+                item->Result.Path = manifest->Entries[item->Index].Path;
+
+                ++numInFlight;
+                stats.PeakMapsInFlight = std::max(stats.PeakMapsInFlight, numInFlight);
+            }
+            else
+                item = PopQueue(stage);
+
+            ++numRunning[stage];
+            --numFree;
+
+            scheduler.Spawn([this, item, stage](uint32 threadIdx)
+            {
+                ExecuteStage(item, stage);
+            });
+        }
+    }
+}
+
+// A stage can start a map if it has one waiting, isn't holding on to any stalled maps, and
+// there's room in the next queue for this map on top of the ones it's already working on
+bool BatchBaker::CanStart(BatchStage stage) const
+{
+    if(stalled[stage].size() > 0)
+        return false;
+
+    if(stage == BatchStageDecode)
+    {
+        if(nextItem >= order.size())
+            return false;
+    }
+    else if(queues[stage].empty())
+        return false;
+
+    if(stage == BatchStageWrite)
+        return true;
+
+    const BatchStage next = DefaultNextStage(stage, settings->Compress);
+    return queues[next].size() + numRunning[stage] < queueDepth;
+}
+
+// Takes the map with the highest priority, and the earliest one in the manifest for ties
+BatchBaker::Item* BatchBaker::PopQueue(BatchStage stage)
+{
+    std::vector<Item*>& queue = queues[stage];
+    uint64 best = 0;
+    for(uint64 i = 1; i < queue.size(); ++i)
+    {
+        if(queue[i]->Priority > queue[best]->Priority
+           || (queue[i]->Priority == queue[best]->Priority && queue[i]->Index < queue[best]->Index))
+            best = i;
+    }
+
+    Item* item = queue[best];
+    queue.erase(queue.begin() + best);
+    return item;
+}
+
+void BatchBaker::PushQueue(Item* item)
+{
+    std::vector<Item*>& queue = queues[item->NextStage];
+    queue.push_back(item);
+
+    BatchStageStats& stageStats = stats.Stages[item->NextStage];
+    stageStats.PeakQueued = std::max(stageStats.PeakQueued, static_cast<uint32>(queue.size()));
+}
+
+void BatchBaker::ExecuteStage(Item* item, BatchStage stage)
+{
+    Timer timer;
+
+    try
+    {
+        switch(stage)
+        {
+            case BatchStageDecode: Decode(*item); break;
+            case BatchStageMoments: GenerateMoments(*item); break;
+            case BatchStageSolve: Solve(*item); break;
+            case BatchStageCompress: Compress(*item); break;
+            case BatchStageWrite: Write(*item); break;
+            default: break;
+        }
+    }
+    catch(const Exception& e)
+    {
+        item->Result.Failed = true;
+        item->Result.Error = e.GetMessage();
+        item->NextStage = NumBatchStages;
+    }
+    catch(const std::exception& e)
+    {
+        item->Result.Failed = true;
+        item->Result.Error = AnsiToWString(e.what());
+        item->NextStage = NumBatchStages;
+    }
+
+    timer.Update();
+    item->Result.StageSeconds[stage] = timer.ElapsedSecondsD();
+
+    std::lock_guard<std::mutex> lock(pipelineMutex);
+    FinishStage(item, stage);
+    Pump();
+}
+
+// Moves a map on to its next stage, or retires it. Must be called with the pipeline lock held.
+void BatchBaker::FinishStage(Item* item, BatchStage stage)
+{
+    --numRunning[stage];
+
+    BatchStageStats& stageStats = stats.Stages[stage];
+    stageStats.Seconds += item->Result.StageSeconds[stage];
+    ++stageStats.NumMaps;
+
+    if(item->NextStage < NumBatchStages)
+    {
+        if(queues[item->NextStage].size() < queueDepth)
+            PushQueue(item);
+        else
+            stalled[stage].push_back(item);
+        return;
+    }
+
+    BatchMapResult& result = item->Result;
+    if(result.Failed)
+        ++stats.NumFailed;
+    else
+    {
+        if(result.CacheHit)
+            ++stats.NumCacheHits;
+        else
+            ++stats.NumBaked;
+        if(result.CompressedCacheHit)
+            ++stats.NumCompressedCacheHits;
+        stats.TexelsProcessed += uint64(result.Width) * result.Height;
+    }
+
+    result.NumCompleted = ++numCompleted;
+    if(*progress)
+        (*progress)(result);
+
+    delete item;
+    --numInFlight;
+}
+
+//=================================================================================================
+// Stages
+//=================================================================================================
+
+void BatchBaker::Decode(Item& item)
+{
+    const std::wstring& path = manifest->Entries[item.Index].Path;
+    if(FileExists(path.c_str()) == false)
+        throw Exception(L"File not found: " + path);
+
+    item.NormalMap.LoadFromFile(path.c_str());
+    item.Result.Width = item.NormalMap.Width;
+    item.Result.Height = item.NormalMap.Height;
+    item.NextStage = BatchStageMoments;
+
+    if(settings->CacheDir.length() > 0)
+    {
+        item.CacheKey = MapCache::ComputeKey(item.NormalMap, settings->Bake);
+
+        CachedMaps cachedMaps;
+        if(cache.Load(item.CacheKey, cachedMaps))
+        {
+            cachedMaps.CopyTo(item.Maps);
+            item.Result.CacheHit = true;
+            item.NextStage = settings->Compress ? BatchStageCompress : BatchStageWrite;
+            std::vector<uint32>().swap(item.NormalMap.Texels);
+        }
+    }
+}
+
+void BatchBaker::GenerateMoments(Item& item)
+{
+    item.Baker.reset(new MapBaker());
+    item.Baker->GenerateMoments(item.NormalMap);
+    std::vector<uint32>().swap(item.NormalMap.Texels);
+    item.NextStage = BatchStageSolve;
+}
+
+void BatchBaker::Solve(Item& item)
+{
+    item.Baker->ResolveVMFMaps(item.Maps.VMFMap, item.Maps.RoughnessMap);
+    item.Baker->ResolveLEANMap(settings->Bake, item.Maps.LEANMap);
+    item.Baker.reset();
+
+    if(settings->CacheDir.length() > 0)
+        cache.Store(item.CacheKey, item.Maps);
+
+    item.NextStage = DefaultNextStage(BatchStageSolve, settings->Compress);
+}
+
+void BatchBaker::Compress(Item& item)
+{
+    uint64 compressedKey = 0;
+    if(settings->CacheDir.length() > 0)
+    {
+        compressedKey = MapCache::ComputeCompressedKey(item.CacheKey, settings->Quality);
+
+        CachedCompressedMaps cachedMaps;
+        if(cache.LoadCompressed(compressedKey, cachedMaps))
+        {
+            cachedMaps.CopyTo(item.Compressed);
+            item.Result.CompressedCacheHit = true;
+            item.NextStage = BatchStageWrite;
+            return;
+        }
+    }
+
+    MapCompressor compressor;
+    compressor.Compress(item.Maps, settings->Quality, item.Compressed);
+
+    if(settings->CacheDir.length() > 0)
+        cache.StoreCompressed(compressedKey, item.Compressed);
+
+    item.NextStage = BatchStageWrite;
+}
+
+void BatchBaker::Write(Item& item)
+{
+    const std::wstring prefix = OutputPrefix(*settings, item.Result.Path);
+
+    item.Maps.LEANMap.WriteToDDSFile((prefix + L"_LEAN.dds").c_str());
+    item.Maps.VMFMap.WriteToDDSFile((prefix + L"_VMF.dds").c_str());
+    item.Maps.RoughnessMap.WriteToDDSFile((prefix + L"_Roughness.dds").c_str());
+
+    if(settings->Compress)
+    {
+        item.Compressed.LEANMap.WriteToDDSFile((prefix + L"_LEAN_BC.dds").c_str());
+        item.Compressed.VMFDirectionMap.WriteToDDSFile((prefix + L"_VMFDirection_BC.dds").c_str());
+        item.Compressed.VMFShapeMap.WriteToDDSFile((prefix + L"_VMFShape_BC.dds").c_str());
+        item.Compressed.RoughnessMap.WriteToDDSFile((prefix + L"_Roughness_BC.dds").c_str());
+    }
+
+    item.NextStage = NumBatchStages;
+}
\ No newline at end of file
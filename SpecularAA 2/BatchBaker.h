@@ -0,0 +1,189 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/ThreadPool.h"
+
+#include "MapBaker.h"
+#include "MapCache.h"
+#include "MapCompression.h"
+
+using namespace SampleFramework11;
+
+// The stages that every map in a batch goes through, in order. Maps that are found in the
+// cache skip straight from decoding to compression or writing.
+enum BatchStage
+{
+    BatchStageDecode = 0,       // Loading the normal map, and checking the cache
+    BatchStageMoments,          // Building the moment pyramid
+    BatchStageSolve,            // Resolving the vMF/roughness and LEAN maps
+    BatchStageCompress,         // Block compression, only when a BC quality is specified
+    BatchStageWrite,            // Writing the DDS files
+
+    NumBatchStages
+};
+
+const wchar* BatchStageName(BatchStage stage);
+
+// A list of normal maps to bake, as a text file with one path per line. Paths can be followed by
+// "|priority", and maps with a higher priority are baked first (the default is 0). Relative
+// paths are relative to the manifest, and empty lines and lines starting with '#' are skipped.
+struct BatchManifest
+{
+    struct Entry
+    {
+        std::wstring Path;
+        int32 Priority;
+
+        Entry() : Priority(0)
+        {
+        }
+    };
+
+    std::vector<Entry> Entries;
+
+    void LoadFromFile(const wchar* filePath);
+};
+
+struct BatchSettings
+{
+    BakeSettings Bake;
+    std::wstring OutputDir;
+    std::wstring CacheDir;          // Empty to bake everything from scratch
+    bool Compress;
+    BCQuality Quality;
+    uint32 NumThreads;              // 0 for one per hardware thread
+
+    // Maximum number of maps waiting in front of each stage, or 0 for one per thread. A stage only
+    // starts a map when there's room for it in the next queue, and a stage that still ends up with
+    // nowhere to put a map stops taking new ones, so the number of maps in memory stays bounded
+    // no matter how long the manifest is.
+    uint32 QueueDepth;
+
+    BatchSettings() : Compress(false), Quality(BCQualityNormal), NumThreads(0), QueueDepth(0)
+    {
+    }
+};
+
+// The outcome of one map, passed to the progress callback as soon as the map is done
+struct BatchMapResult
+{
+    uint32 Index;                   // Position in the manifest
+    uint32 NumCompleted;            // Maps done so far, including this one
+    std::wstring Path;
+    uint32 Width;
+    uint32 Height;
+    bool CacheHit;
+    bool CompressedCacheHit;
+    bool Failed;
+    std::wstring Error;
+    double StageSeconds[NumBatchStages];
+
+    BatchMapResult();
+};
+
+struct BatchStageStats
+{
+    double Seconds;                 // Summed over every thread that ran the stage
+    uint64 NumMaps;                 // Maps that went through the stage
+    uint32 PeakQueued;              // Most maps waiting in front of the stage at once
+
+    BatchStageStats() : Seconds(0.0), NumMaps(0), PeakQueued(0)
+    {
+    }
+};
+
+struct BatchStats
+{
+    double Seconds;
+    uint32 NumThreads;
+    uint64 NumMaps;
+    uint64 NumBaked;
+    uint64 NumCacheHits;            // Maps whose bake was skipped
+    uint64 NumCompressedCacheHits;  // Maps whose compression was skipped
+    uint64 NumFailed;
+    uint64 TexelsProcessed;         // Mip 0 texels of every map that didn't fail
+    uint32 PeakMapsInFlight;        // Most maps that were decoded and not written yet at once
+    uint64 NumSteals;
+    BatchStageStats Stages[NumBatchStages];
+
+    BatchStats() : Seconds(0.0), NumThreads(1), NumMaps(0), NumBaked(0), NumCacheHits(0), NumCompressedCacheHits(0),
+                   NumFailed(0), TexelsProcessed(0), PeakMapsInFlight(0), NumSteals(0)
+    {
+    }
+
+    double MapsPerSecond() const;
+    double TexelsPerSecond() const;
+    std::wstring ToString() const;
+};
+
+// Bakes a manifest of normal maps as a pipeline, with every map going through the stages in
+// BatchStage as a separate task on a work-stealing TaskScheduler. Parallelism comes from having
+// many maps in flight instead of from splitting up a single map, so the ThreadPool loops inside
+// MapBaker and MapCompressor run serially on the thread that runs the stage.
+//
+// Tasks are only spawned when a thread is free to run them, and the later stages get the free
+// threads first, so that maps are finished before new ones are started. Within a stage, the map
+// with the highest priority goes first. A map that fails at any stage is reported and dropped,
+// and the rest of the batch carries on.
+class BatchBaker
+{
+
+public:
+
+    typedef std::function<void(const BatchMapResult& result)> ProgressFunction;
+
+    BatchBaker();
+
+    // The progress callback is called for every map as it completes, one call at a time. Throws
+    // before baking anything if two maps would be written to the same files.
+    void Run(const BatchManifest& manifest, const BatchSettings& settings, const ProgressFunction& progress);
+
+    const BatchStats& Stats() const { return stats; }
+
+protected:
+
+    struct Item;
+
+    void Pump();
+    void ExecuteStage(Item* item, BatchStage stage);
+    void FinishStage(Item* item, BatchStage stage);
+    Item* PopQueue(BatchStage stage);
+    void PushQueue(Item* item);
+    bool CanStart(BatchStage stage) const;
+
+    void Decode(Item& item);
+    void GenerateMoments(Item& item);
+    void Solve(Item& item);
+    void Compress(Item& item);
+    void Write(Item& item);
+
+    const BatchManifest* manifest;
+    const BatchSettings* settings;
+    const ProgressFunction* progress;
+
+    TaskScheduler scheduler;
+    MapCache cache;
+
+    std::mutex pipelineMutex;
+    std::vector<uint32> order;                      // Manifest indices, sorted by priority
+    uint64 nextItem;
+    uint32 queueDepth;
+    std::vector<Item*> queues[NumBatchStages];      // Maps waiting to start each stage
+    std::vector<Item*> stalled[NumBatchStages];     // Maps done with a stage, blocked by a full queue
+    uint32 numRunning[NumBatchStages];
+    uint32 numInFlight;
+    uint32 numCompleted;
+
+    BatchStats stats;
+};
\ No newline at end of file
@@ -0,0 +1,317 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "BenchmarkMatrix.h"
+#include "ImageMetrics.h"
+#include "AppSettings.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/Timer.h"
+
+// The CPU versions of the values of each GUI setting
+static const ShadingMode ShadingModes[SpecularAAModeGUI::NumValues] =
+{
+    ShadingModeDisabled,
+    ShadingModeVMF,
+    ShadingModeLEAN,
+    ShadingModeCLEAN,
+    ShadingModeToksvig,
+    ShadingModePrecomputedVMF,
+    ShadingModePrecomputedToksvig,
+    ShadingModeAnisoRoughness,
+};
+
+static const SpecularBRDF SpecularBRDFs[SpecularBRDFGUI::NumValues] =
+{
+    SpecularBRDFBeckmann,
+    SpecularBRDFGGX,
+};
+
+static const SupersamplingMode SupersamplingModes[SuperSamplingModeGUI::NumValues] =
+{
+    SupersamplingDisabled,
+    SupersamplingUniform,
+    SupersamplingTextureSpace,
+};
+
+ShadingMode ShadingModeFromGUI(uint32 value)
+{
+    return ShadingModes[std::min<uint32>(value, SpecularAAModeGUI::NumValues - 1)];
+}
+
+SpecularBRDF SpecularBRDFFromGUI(uint32 value)
+{
+    return SpecularBRDFs[std::min<uint32>(value, SpecularBRDFGUI::NumValues - 1)];
+}
+
+SupersamplingMode SupersamplingModeFromGUI(uint32 value)
+{
+    return SupersamplingModes[std::min<uint32>(value, SuperSamplingModeGUI::NumValues - 1)];
+}
+
+// Time spent baking the maps that a shading mode samples. Toksvig only needs the mips of the
+// normal map, which the app gets from GenerateMips.
+static double BakeSeconds(ShadingMode mode, const SpecularAABenchmark::NormalMapStats& stats)
+{
+    if(mode == ShadingModeVMF || mode == ShadingModePrecomputedVMF || mode == ShadingModePrecomputedToksvig)
+        return stats.MomentSeconds + stats.VMFSeconds;
+    else if(mode == ShadingModeLEAN || mode == ShadingModeCLEAN)
+        return stats.MomentSeconds + stats.LEANSeconds;
+    else if(mode == ShadingModeAnisoRoughness)
+        return stats.MomentSeconds + stats.AnisoRoughnessSeconds;
+    return 0.0;
+}
+
+// Mean of the color channels of the pixels
+static double MeanColor(const HDRImage& image)
+{
+    double sum = 0.0;
+    for(uint64 i = 0; i < image.Pixels.size(); ++i)
+        sum += image.Pixels[i].x + image.Pixels[i].y + image.Pixels[i].z;
+    return sum / std::max<uint64>(image.Pixels.size() * 3, 1);
+}
+
+static void Compare(const HDRImage& image, const HDRImage& reference, SpecularAABenchmark::Result& result)
+{
+    double errorSum = 0.0;
+    for(uint64 i = 0; i < image.Pixels.size(); ++i)
+    {
+        const Float4& p = image.Pixels[i];
+        const Float4& r = reference.Pixels[i];
+        errorSum += (p.x - r.x) * (p.x - r.x) + (p.y - r.y) * (p.y - r.y) + (p.z - r.z) * (p.z - r.z);
+    }
+
+    const double referenceMean = std::max(MeanColor(reference), 1e-9);
+    result.RMSE = std::sqrt(errorSum / std::max<uint64>(image.Pixels.size() * 3, 1));
+    result.RelativeRMSE = result.RMSE / referenceMean;
+    result.Bias = MeanColor(image) / referenceMean - 1.0;
+
+    ImageMetrics metrics;
+    metrics.Compute(ImageView(image), ImageView(reference), ImageMetricsSettings());
+    result.PSNR = metrics.PSNR;
+    result.SSIM = metrics.SSIM;
+    result.MeanDeltaE = metrics.MeanError;
+}
+
+SpecularAABenchmark::SpecularAABenchmark()
+{
+}
+
+void SpecularAABenchmark::Run(const SpecularAABenchmarkSettings& settings, const ReferenceScene& scene,
+                              uint32 normalMapIdx)
+{
+    const std::wstring path = settings.TextureDir + NormalMapGUI::Names[normalMapIdx] + L".png";
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(path.c_str());
+
+    NormalMapStats stats;
+    stats.NormalMap = normalMapIdx;
+    stats.Width = normalMap.Width;
+    stats.Height = normalMap.Height;
+
+    // The steps of MapBaker::Bake, plus the anisotropic roughness map
+    MapBaker baker;
+    BakedMaps maps;
+    BakedTexture anisoRoughnessMap;
+    Timer timer;
+    baker.GenerateMoments(normalMap);
+    timer.Update();
+    stats.MomentSeconds = timer.DeltaSecondsD();
+    baker.ResolveVMFMaps(maps.VMFMap, maps.RoughnessMap);
+    timer.Update();
+    stats.VMFSeconds = timer.DeltaSecondsD();
+    baker.ResolveLEANMap(settings.Bake, maps.LEANMap);
+    timer.Update();
+    stats.LEANSeconds = timer.DeltaSecondsD();
+    baker.ResolveAnisoRoughnessMap(anisoRoughnessMap);
+    timer.Update();
+    stats.AnisoRoughnessSeconds = timer.DeltaSecondsD();
+
+    ReferenceRenderer renderer;
+    renderer.SetNormalMap(normalMap, settings.Bake, maps, anisoRoughnessMap);
+
+    const float aspect = float(settings.Width) / settings.Height;
+    auto makeCamera = [&](CameraPreset preset)
+    {
+        FirstPersonCamera camera(aspect, Pi_4 * 0.75f, 0.01f, 100.0f);
+        ApplyCameraPreset(preset, camera);
+        return camera;
+    };
+
+    // One reference per BRDF and camera
+    const uint32 numBRDFs = SpecularBRDFGUI::NumValues;
+    std::vector<HDRImage> references(numBRDFs * NumCameraPresets);
+    stats.ReferenceSeconds = 0.0;
+    for(uint32 brdf = 0; brdf < numBRDFs; ++brdf)
+    {
+        for(uint32 cameraIdx = 0; cameraIdx < NumCameraPresets; ++cameraIdx)
+        {
+            ReferenceSettings referenceSettings = settings.Shading;
+            referenceSettings.Mode = ShadingModeDisabled;
+            referenceSettings.BRDF = SpecularBRDFs[brdf];
+            referenceSettings.GeometricAA = GeometricAADisabled;
+            referenceSettings.Supersampling = SupersamplingUniform;
+            referenceSettings.Sequence = SampleSequenceSobol;
+            referenceSettings.SequenceSeed = 1;
+            referenceSettings.UniformSamples = settings.ReferenceSamples;
+
+            HDRImage& reference = references[brdf * NumCameraPresets + cameraIdx];
+            reference.Initialize(settings.Width, settings.Height);
+
+            ReferenceStats referenceStats;
+            renderer.Render(scene, makeCamera(CameraPreset(cameraIdx)), referenceSettings, reference, referenceStats);
+            stats.ReferenceSeconds += referenceStats.Seconds;
+        }
+    }
+
+    // The most expensive supersampling modes go first, so that they don't end up running on
+    // their own at the end
+    std::vector<Result> matrix;
+    for(int32 ssMode = SuperSamplingModeGUI::NumValues - 1; ssMode >= 0; --ssMode)
+    {
+        for(uint32 brdf = 0; brdf < numBRDFs; ++brdf)
+        {
+            for(uint32 cameraIdx = 0; cameraIdx < NumCameraPresets; ++cameraIdx)
+            {
+                for(uint32 aaMode = 0; aaMode < SpecularAAModeGUI::NumValues; ++aaMode)
+                {
+                    Result result = Result();
+                    result.NormalMap = normalMapIdx;
+                    result.Camera = CameraPreset(cameraIdx);
+                    result.BRDF = SpecularBRDFs[brdf];
+                    result.Supersampling = SupersamplingModes[ssMode];
+                    result.Mode = ShadingModes[aaMode];
+                    result.BakeSeconds = BakeSeconds(result.Mode, stats);
+                    matrix.push_back(result);
+                }
+            }
+        }
+    }
+
+    timer.Update();
+    ThreadPool::GlobalPool.ParallelFor(uint32(matrix.size()), [&](uint32 taskIdx, uint32 threadIdx)
+    {
+        Result& result = matrix[taskIdx];
+
+        ReferenceSettings renderSettings = settings.Shading;
+        renderSettings.Mode = result.Mode;
+        renderSettings.BRDF = result.BRDF;
+        renderSettings.Supersampling = result.Supersampling;
+        renderSettings.Sequence = SampleSequenceSobol;
+        renderSettings.SequenceSeed = 0;
+        renderSettings.UniformSamples = settings.ShaderSSSamples;
+
+        HDRImage image;
+        image.Initialize(settings.Width, settings.Height);
+
+        ReferenceStats renderStats;
+        renderer.Render(scene, makeCamera(result.Camera), renderSettings, image, renderStats);
+
+        result.ShadingSeconds = renderStats.Seconds;
+        result.ShadedPerPixel = renderStats.NumSamples > 0 ? renderStats.SamplesPerPixel()
+                                                           : double(renderStats.NumHits) / renderStats.NumPixels;
+        Compare(image, references[result.BRDF * NumCameraPresets + result.Camera], result);
+    });
+
+    timer.Update();
+    stats.MatrixSeconds = timer.DeltaSecondsD();
+
+    results.insert(results.end(), matrix.begin(), matrix.end());
+    normalMaps.push_back(stats);
+}
+
+std::string SpecularAABenchmark::ToCSV() const
+{
+    auto ansi = [](const wchar* name)
+    {
+        const std::wstring wide = name;
+        return std::string(wide.begin(), wide.end());
+    };
+
+    std::string csv = "normal_map,camera,brdf,supersampling,mode,bake_ms,shading_ms,shaded_per_pixel,";
+    csv += "rmse,relative_rmse,bias,psnr,ssim,delta_e\n";
+    for(uint64 i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        csv += ansi(NormalMapGUI::Names[r.NormalMap]) + "," + ansi(CameraPresetName(r.Camera)) + ",";
+        csv += ansi(SpecularBRDFName(r.BRDF)) + "," + ansi(SupersamplingModeName(r.Supersampling)) + ",";
+        csv += ansi(ShadingModeName(r.Mode)) + "," + ToAnsiString(r.BakeSeconds * 1000.0) + ",";
+        csv += ToAnsiString(r.ShadingSeconds * 1000.0) + "," + ToAnsiString(r.ShadedPerPixel) + ",";
+        csv += ToAnsiString(r.RMSE) + "," + ToAnsiString(r.RelativeRMSE) + "," + ToAnsiString(r.Bias) + ",";
+        csv += ToAnsiString(r.PSNR) + "," + ToAnsiString(r.SSIM) + "," + ToAnsiString(r.MeanDeltaE) + "\n";
+    }
+
+    return csv;
+}
+
+std::wstring SpecularAABenchmark::ToString(const NormalMapStats& stats)
+{
+    auto ms = [](double seconds) { return SampleFramework11::ToString(seconds * 1000.0) + L"ms"; };
+
+    std::wstring text = std::wstring(NormalMapGUI::Names[stats.NormalMap]) + L" (";
+    text += SampleFramework11::ToString(stats.Width) + L"x" + SampleFramework11::ToString(stats.Height) + L"): ";
+    text += L"moments " + ms(stats.MomentSeconds) + L", vMF " + ms(stats.VMFSeconds);
+    text += L", LEAN " + ms(stats.LEANSeconds) + L", aniso roughness " + ms(stats.AnisoRoughnessSeconds);
+    text += L", references " + ms(stats.ReferenceSeconds) + L", matrix " + ms(stats.MatrixSeconds);
+    return text;
+}
+
+std::wstring SpecularAABenchmark::ToString() const
+{
+    std::wstring text;
+    for(uint64 i = 0; i < normalMaps.size(); ++i)
+        text += ToString(normalMaps[i]) + L"\n";
+
+    // Averaged over the normal maps, cameras, and BRDFs
+    for(uint32 ssMode = 0; ssMode < SuperSamplingModeGUI::NumValues; ++ssMode)
+    {
+        const SupersamplingMode supersampling = SupersamplingModes[ssMode];
+        text += (ssMode > 0 ? L"\n" : L"") + std::wstring(SupersamplingModeName(supersampling)) + L":";
+        for(uint32 aaMode = 0; aaMode < SpecularAAModeGUI::NumValues; ++aaMode)
+        {
+            const ShadingMode mode = ShadingModes[aaMode];
+            double bakeSum = 0.0;
+            double shadingSum = 0.0;
+            double errorSum = 0.0;
+            double biasSum = 0.0;
+            double ssimSum = 0.0;
+            uint32 count = 0;
+            for(uint64 i = 0; i < results.size(); ++i)
+            {
+                const Result& r = results[i];
+                if(r.Supersampling != supersampling || r.Mode != mode)
+                    continue;
+
+                bakeSum += r.BakeSeconds;
+                shadingSum += r.ShadingSeconds;
+                errorSum += r.RelativeRMSE;
+                biasSum += r.Bias;
+                ssimSum += r.SSIM;
+                ++count;
+            }
+
+            if(count == 0)
+                continue;
+
+            text += L"\n  " + std::wstring(ShadingModeName(mode)) + L": bake ";
+            text += SampleFramework11::ToString(bakeSum * 1000.0 / count) + L"ms, shading ";
+            text += SampleFramework11::ToString(shadingSum * 1000.0 / count) + L"ms, relative RMSE ";
+            text += SampleFramework11::ToString(errorSum / count) + L", bias ";
+            text += SampleFramework11::ToString(biasSum * 100.0 / count) + L"%, SSIM ";
+            text += SampleFramework11::ToString(ssimSum / count);
+        }
+    }
+
+    return text;
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "MapBaker.h"
+#include "ReferenceRenderer.h"
+#include "CameraPresets.h"
+
+using namespace SampleFramework11;
+
+// The CPU versions of the values of SpecularAAModeGUI, SpecularBRDFGUI, and SuperSamplingModeGUI
+ShadingMode ShadingModeFromGUI(uint32 value);
+SpecularBRDF SpecularBRDFFromGUI(uint32 value);
+SupersamplingMode SupersamplingModeFromGUI(uint32 value);
+
+// The settings of SpecularAABenchmark that stay the same for every combination
+struct SpecularAABenchmarkSettings
+{
+    ReferenceSettings Shading;          // Roughness, diffuse/specular, geometric AA, and lighting texture size
+    BakeSettings Bake;
+    std::wstring TextureDir;            // Where <NormalMapGUI name>.png is loaded from
+    uint32 Width;
+    uint32 Height;
+    uint32 ShaderSSSamples;             // Samples along each axis for ShaderSSAA, like the slider
+    uint32 ReferenceSamples;            // Samples along each axis for the reference
+
+    SpecularAABenchmarkSettings() : TextureDir(L"..\\Content\\Textures\\"), Width(320), Height(180),
+                                    ShaderSSSamples(4), ReferenceSamples(16)
+    {
+    }
+};
+
+// Sweeps every combination of SpecularAAModeGUI, SpecularBRDFGUI, and SuperSamplingModeGUI over
+// the camera presets, one NormalMapGUI map at a time, and renders each one on the CPU with
+// ReferenceRenderer. Every image is compared against a reference with ReferenceSamples^2 Sobol
+// samples per pixel and no specular AA, rendered under a different scramble. The steps of
+// MapBaker::Bake are timed separately so that each mode is charged for the maps it samples.
+//
+// The references are rendered one at a time with their tiles spread across ThreadPool::GlobalPool.
+// The combinations are then rendered in parallel with one per task, which keeps the threads busy
+// with small images and puts the shading time of each combination on a single thread.
+class SpecularAABenchmark
+{
+
+public:
+
+    struct Result
+    {
+        uint32 NormalMap;               // NormalMapGUI::Values
+        CameraPreset Camera;
+        SpecularBRDF BRDF;
+        SupersamplingMode Supersampling;
+        ShadingMode Mode;
+
+        double BakeSeconds;             // Baking the maps that the mode samples
+        double ShadingSeconds;          // Rendering the image on one thread
+        double ShadedPerPixel;          // Shaded hits, samples, or lighting texels per pixel
+        double RMSE;
+        double RelativeRMSE;            // RMSE over the mean of the reference
+        double Bias;                    // Mean relative to the mean of the reference, minus 1
+        double PSNR;                    // ImageMetrics of the tone mapped images
+        double SSIM;
+        double MeanDeltaE;
+    };
+
+    struct NormalMapStats
+    {
+        uint32 NormalMap;
+        uint32 Width;
+        uint32 Height;
+        double MomentSeconds;
+        double VMFSeconds;              // vMF and roughness maps
+        double LEANSeconds;
+        double AnisoRoughnessSeconds;
+        double ReferenceSeconds;
+        double MatrixSeconds;           // Wall-clock time of every combination
+    };
+
+    SpecularAABenchmark();
+
+    // Bakes and renders every combination for one NormalMapGUI map, adding to Results()
+    void Run(const SpecularAABenchmarkSettings& settings, const ReferenceScene& scene, uint32 normalMap);
+
+    const std::vector<Result>& Results() const { return results; }
+    const std::vector<NormalMapStats>& NormalMaps() const { return normalMaps; }
+
+    // One row per combination, with a header
+    std::string ToCSV() const;
+
+    // Per-normal-map timings, and the averages of each supersampling mode and shading mode
+    std::wstring ToString() const;
+    static std::wstring ToString(const NormalMapStats& stats);
+
+protected:
+
+    std::vector<Result> results;
+    std::vector<NormalMapStats> normalMaps;
+};
\ No newline at end of file
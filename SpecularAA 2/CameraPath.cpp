@@ -0,0 +1,259 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "CameraPath.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Exceptions.h"
+#include "SampleFramework11/Utility.h"
+
+static const uint32 CameraPathMagic = 0x48545043;          // "CPTH"
+static const uint32 CameraPathVersion = 1;
+
+struct CameraPathFileHeader
+{
+    uint32 Magic;
+    uint32 Version;
+    float TimeStep;
+    uint32 NumSettings;                 // NumCameraPathSettings of the app that wrote it
+};
+
+struct CameraPathFileFrame
+{
+    float Position[3];
+    float XRotation;
+    float YRotation;
+    uint32 NumSettingChanges;
+};
+
+const wchar* CameraMotionName(CameraMotion motion)
+{
+    static const wchar* Names[NumCameraMotions] = { L"Strafe", L"Dolly", L"Turn" };
+    return Names[motion];
+}
+
+//=================================================================================================
+// CameraPath
+//=================================================================================================
+
+CameraPath::CameraPath() : timeStep(1.0f / 60.0f)
+{
+}
+
+void CameraPath::Clear()
+{
+    frames.clear();
+    settingChanges.clear();
+}
+
+void CameraPath::AddFrame(const FirstPersonCamera& camera, const CameraPathSettingChange* changes, uint32 numChanges)
+{
+    CameraPathFrame frame;
+    frame.Position = camera.Position();
+    frame.XRotation = camera.XRotation();
+    frame.YRotation = camera.YRotation();
+    frame.FirstSettingChange = uint32(settingChanges.size());
+    frame.NumSettingChanges = numChanges;
+    frames.push_back(frame);
+
+    settingChanges.insert(settingChanges.end(), changes, changes + numChanges);
+}
+
+void CameraPath::Generate(CameraPreset preset, CameraMotion motion, float speed, uint32 numFrames, float timeStep_)
+{
+    timeStep = timeStep_;
+    Clear();
+    frames.reserve(numFrames);
+
+    FirstPersonCamera camera(16.0f / 9.0f, Pi_4 * 0.75f, 0.01f, 100.0f);
+    ApplyCameraPreset(preset, camera);
+
+    const float step = speed * timeStep;
+    for(uint32 i = 0; i < numFrames; ++i)
+    {
+        AddFrame(camera);
+
+        if(motion == CameraMotionStrafe)
+            camera.SetPosition(camera.Position() + camera.Right() * step);
+        else if(motion == CameraMotionDolly)
+            camera.SetPosition(camera.Position() + camera.Forward() * step);
+        else
+            camera.SetYRotation(camera.YRotation() + step);
+    }
+}
+
+void CameraPath::LoadFromFile(const wchar* filePath)
+{
+    File file(filePath, File::OpenRead);
+    std::vector<uint8> fileData(static_cast<size_t>(file.Size()));
+    file.Read(fileData.size(), fileData.data());
+
+    CameraPathFileHeader header;
+    if(fileData.size() < sizeof(header))
+        throw Exception(L"Camera path file is too small: " + std::wstring(filePath));
+    memcpy(&header, fileData.data(), sizeof(header));
+    if(header.Magic != CameraPathMagic)
+        throw Exception(L"Not a camera path file: " + std::wstring(filePath));
+    if(header.Version != CameraPathVersion)
+        throw Exception(L"Unsupported camera path version: " + std::wstring(filePath));
+
+    Clear();
+    timeStep = header.TimeStep;
+
+    uint64 offset = sizeof(header);
+    while(offset < fileData.size())
+    {
+        CameraPathFileFrame fileFrame;
+        if(offset + sizeof(fileFrame) > fileData.size())
+            throw Exception(L"Truncated frame in camera path file: " + std::wstring(filePath));
+        memcpy(&fileFrame, &fileData[offset], sizeof(fileFrame));
+        offset += sizeof(fileFrame);
+
+        const uint64 changesSize = uint64(fileFrame.NumSettingChanges) * sizeof(CameraPathSettingChange);
+        if(offset + changesSize > fileData.size())
+            throw Exception(L"Truncated frame in camera path file: " + std::wstring(filePath));
+
+        CameraPathFrame frame;
+        frame.Position = Float3(fileFrame.Position[0], fileFrame.Position[1], fileFrame.Position[2]);
+        frame.XRotation = fileFrame.XRotation;
+        frame.YRotation = fileFrame.YRotation;
+        frame.FirstSettingChange = uint32(settingChanges.size());
+
+        // Settings from a newer version of the app are skipped
+        for(uint32 i = 0; i < fileFrame.NumSettingChanges; ++i)
+        {
+            CameraPathSettingChange change;
+            memcpy(&change, &fileData[offset], sizeof(change));
+            offset += sizeof(change);
+            if(change.Setting < NumCameraPathSettings)
+                settingChanges.push_back(change);
+        }
+
+        frame.NumSettingChanges = uint32(settingChanges.size()) - frame.FirstSettingChange;
+        frames.push_back(frame);
+    }
+}
+
+void CameraPath::ApplyFrame(uint32 frameIdx, FirstPersonCamera& camera) const
+{
+    const CameraPathFrame& frame = frames[frameIdx];
+    camera.SetPosition(frame.Position);
+    camera.SetXRotation(frame.XRotation);
+    camera.SetYRotation(frame.YRotation);
+}
+
+//=================================================================================================
+// CameraPathRecorder
+//=================================================================================================
+
+CameraPathRecorder::CameraPathRecorder() : bufferUsed(0), numFrames(0), timeStep(1.0f / 60.0f), recording(false)
+{
+}
+
+CameraPathRecorder::~CameraPathRecorder()
+{
+    // Throwing from here would terminate the app, so a failed final write is only logged.
+    // Call Stop() explicitly to have write errors reported.
+    try
+    {
+        Stop();
+    }
+    catch(const Exception& e)
+    {
+        DebugPrint(L"Failed to finish writing the camera path: " + e.GetMessage());
+    }
+    catch(const std::exception& e)
+    {
+        DebugPrint(L"Failed to finish writing the camera path: " + AnsiToWString(e.what()));
+    }
+}
+
+void CameraPathRecorder::Start(const wchar* filePath, float timeStep_)
+{
+    Stop();
+
+    file.Open(filePath, File::OpenWrite);
+    buffer.resize(BufferSize);
+    bufferUsed = 0;
+    numFrames = 0;
+    timeStep = timeStep_;
+    recording = true;
+
+    CameraPathFileHeader header;
+    header.Magic = CameraPathMagic;
+    header.Version = CameraPathVersion;
+    header.TimeStep = timeStep;
+    header.NumSettings = NumCameraPathSettings;
+    Append(&header, sizeof(header));
+}
+
+void CameraPathRecorder::RecordFrame(const FirstPersonCamera& camera, const CameraPathSettingChange* changes,
+                                     uint32 numChanges)
+{
+    _ASSERT(recording);
+
+    const Float3 position = camera.Position();
+    CameraPathFileFrame fileFrame;
+    fileFrame.Position[0] = position.x;
+    fileFrame.Position[1] = position.y;
+    fileFrame.Position[2] = position.z;
+    fileFrame.XRotation = camera.XRotation();
+    fileFrame.YRotation = camera.YRotation();
+    fileFrame.NumSettingChanges = numChanges;
+    Append(&fileFrame, sizeof(fileFrame));
+    Append(changes, numChanges * sizeof(CameraPathSettingChange));
+
+    ++numFrames;
+}
+
+void CameraPathRecorder::Stop()
+{
+    if(recording == false)
+        return;
+
+    // Close the file even if the last write fails, so that the recorder can be restarted
+    recording = false;
+    try
+    {
+        Flush();
+    }
+    catch(...)
+    {
+        file.Close();
+        throw;
+    }
+
+    file.Close();
+}
+
+void CameraPathRecorder::Append(const void* data, uint32 size)
+{
+    const uint8* src = reinterpret_cast<const uint8*>(data);
+    while(size > 0)
+    {
+        if(bufferUsed == BufferSize)
+            Flush();
+
+        const uint32 copySize = std::min(size, BufferSize - bufferUsed);
+        memcpy(&buffer[bufferUsed], src, copySize);
+        bufferUsed += copySize;
+        src += copySize;
+        size -= copySize;
+    }
+}
+
+void CameraPathRecorder::Flush()
+{
+    if(bufferUsed > 0)
+        file.Write(bufferUsed, buffer.data());
+    bufferUsed = 0;
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/Camera.h"
+#include "SampleFramework11/FileIO.h"
+
+#include "CameraPresets.h"
+
+using namespace SampleFramework11;
+
+// How a generated path moves away from its preset. Strafe and Dolly move along the right and
+// forward vectors at a constant speed, and Turn rotates around the Y axis in place.
+enum CameraMotion
+{
+    CameraMotionStrafe = 0,
+    CameraMotionDolly,
+    CameraMotionTurn,
+
+    NumCameraMotions
+};
+
+const wchar* CameraMotionName(CameraMotion motion);
+
+// The GUI settings that a path records, which are the ones that change the shading. Enums and
+// bools are stored as their value, and sliders as the slider value. New settings go at the end,
+// so that older files still replay.
+enum CameraPathSetting
+{
+    CameraPathSettingSpecularAAMode = 0,
+    CameraPathSettingNormalMap,
+    CameraPathSettingSuperSamplingMode,
+    CameraPathSettingSpecularBRDF,
+    CameraPathSettingGeometricAAMode,
+    CameraPathSettingRoughness,
+    CameraPathSettingShaderSSSamples,
+    CameraPathSettingSampleRadius,
+    CameraPathSettingLEANScaleFactor,
+    CameraPathSettingEnableDiffuse,
+    CameraPathSettingEnableSpecular,
+    CameraPathSettingVMFDiffuseAA,
+
+    NumCameraPathSettings
+};
+
+struct CameraPathSettingChange
+{
+    uint32 Setting;
+    float Value;
+};
+
+struct CameraPathFrame
+{
+    Float3 Position;
+    float XRotation;
+    float YRotation;
+    uint32 FirstSettingChange;          // Index into CameraPath::SettingChange
+    uint32 NumSettingChanges;
+};
+
+// The state of a FirstPersonCamera for every frame of a fixed timestep, along with the settings
+// that changed on each frame, so that the same motion can be replayed frame by frame.
+//
+// Camera path files start with a header, followed by one record per frame until the end of the
+// file. Each record is the position and rotation of the camera and the number of settings that
+// changed, followed by that many setting/value pairs. The first frame of a recording has every
+// setting. Nothing in the file depends on the number of frames, so a recording can be written
+// as it goes and still be valid if the app stops early.
+class CameraPath
+{
+
+public:
+
+    CameraPath();
+
+    void Clear();
+    void AddFrame(const FirstPersonCamera& camera, const CameraPathSettingChange* changes = NULL,
+                  uint32 numChanges = 0);
+
+    // Starts at the preset and moves by speed every second, in world units or radians for Turn
+    void Generate(CameraPreset preset, CameraMotion motion, float speed, uint32 numFrames, float timeStep);
+
+    void LoadFromFile(const wchar* filePath);
+
+    void ApplyFrame(uint32 frameIdx, FirstPersonCamera& camera) const;
+
+    uint32 NumFrames() const { return uint32(frames.size()); }
+    float TimeStep() const { return timeStep; }
+    const CameraPathFrame& Frame(uint32 frameIdx) const { return frames[frameIdx]; }
+    const CameraPathSettingChange& SettingChange(uint32 idx) const { return settingChanges[idx]; }
+
+protected:
+
+    float timeStep;
+    std::vector<CameraPathFrame> frames;
+    std::vector<CameraPathSettingChange> settingChanges;
+};
+
+// Streams a camera path file to disk. The frames go into a buffer that's allocated when the
+// recording starts, and it's written out whenever it fills up, so recording a frame doesn't
+// allocate anything.
+class CameraPathRecorder
+{
+
+public:
+
+    static const uint32 BufferSize = 64 * 1024;
+
+    CameraPathRecorder();
+    ~CameraPathRecorder();
+
+    void Start(const wchar* filePath, float timeStep);
+    void RecordFrame(const FirstPersonCamera& camera, const CameraPathSettingChange* changes, uint32 numChanges);
+    void Stop();
+
+    bool Recording() const { return recording; }
+    uint32 NumFrames() const { return numFrames; }
+    float TimeStep() const { return timeStep; }
+
+protected:
+
+    void Append(const void* data, uint32 size);
+    void Flush();
+
+    File file;
+    std::vector<uint8> buffer;
+    uint32 bufferUsed;
+    uint32 numFrames;
+    float timeStep;
+    bool recording;
+};
\ No newline at end of file
@@ -0,0 +1,42 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "CameraPresets.h"
+#include "SharedConstants.h"
+
+struct CameraPresetData
+{
+    Float3 Position;
+    float XRotation;
+    float YRotation;
+};
+
+static const CameraPresetData PresetData[NumCameraPresets] =
+{
+    { Float3(0.0f, 1.0f, -10.0f), 0.0f, 0.0f },
+    { Float3(0.0f, 20.0f, 0.0f), Pi_2, 0.0f },
+    { Float3(-2.88731456f, 0.619826376f, -6.39299107f), 0.0616500117f, 0.472924948f },
+};
+
+const wchar* CameraPresetName(CameraPreset preset)
+{
+    static const wchar* Names[NumCameraPresets] = { L"Default", L"Overhead", L"Grazing" };
+    return Names[preset];
+}
+
+void ApplyCameraPreset(CameraPreset preset, FirstPersonCamera& camera)
+{
+    const CameraPresetData& data = PresetData[preset];
+    camera.SetPosition(data.Position);
+    camera.SetXRotation(data.XRotation);
+    camera.SetYRotation(data.YRotation);
+}
\ No newline at end of file
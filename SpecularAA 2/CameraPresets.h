@@ -0,0 +1,33 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/Camera.h"
+
+using namespace SampleFramework11;
+
+// Camera positions for comparing the specular AA modes. Default is where the app starts, Overhead
+// looks straight down at the plane so that every pixel has the same footprint, and Grazing looks
+// across it so that the footprints get long and thin towards the horizon.
+enum CameraPreset
+{
+    CameraPresetDefault = 0,
+    CameraPresetOverhead,
+    CameraPresetGrazing,
+
+    NumCameraPresets
+};
+
+const wchar* CameraPresetName(CameraPreset preset);
+
+void ApplyCameraPreset(CameraPreset preset, FirstPersonCamera& camera);
\ No newline at end of file
@@ -0,0 +1,596 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "FootprintFilter.h"
+
+#include "SampleFramework11/Exceptions.h"
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/Timer.h"
+#include "SampleFramework11/SIMD.h"
+
+typedef std::complex<float> Complex;
+
+// Number of texels of a level handled by each task of the direct sums
+static const uint32 TexelsPerTask = 64;
+
+// Number of columns transformed together by each task of the 2D FFT
+static const uint32 ColumnsPerTask = 8;
+
+static uint32 NumTasks(uint32 count, uint32 countPerTask)
+{
+    return (count + countPerTask - 1) / countPerTask;
+}
+
+static bool IsPow2(uint32 x)
+{
+    return x > 0 && (x & (x - 1)) == 0;
+}
+
+static int32 Wrap(int64 x, uint32 size)
+{
+    const int64 wrapped = x % int64(size);
+    return static_cast<int32>(wrapped < 0 ? wrapped + size : wrapped);
+}
+
+// std::complex multiplication checks for infinities, which is a lot slower than we need
+static Complex Mul(const Complex& a, const Complex& b)
+{
+    return Complex(a.real() * b.real() - a.imag() * b.imag(), a.real() * b.imag() + a.imag() * b.real());
+}
+
+//=================================================================================================
+// Kernels
+//=================================================================================================
+
+const wchar* FootprintKernelName(FootprintKernel kernel)
+{
+    static const wchar* Names[NumFootprintKernels] = { L"Box", L"Gaussian", L"Smoothstep", L"Cubic" };
+    return Names[kernel];
+}
+
+// Weight of a texel whose center is (offsetX, offsetY) from the center of the footprint
+static float KernelWeight(FootprintKernel kernel, float offsetX, float offsetY, float radius)
+{
+    if(kernel == FootprintKernelBox)
+        return (std::abs(offsetX) <= radius && std::abs(offsetY) <= radius) ? 1.0f : 0.0f;
+
+    const float t = std::sqrt(offsetX * offsetX + offsetY * offsetY) / radius;
+    if(t > 1.0f)
+        return 0.0f;
+
+    if(kernel == FootprintKernelGaussian)
+        return std::exp(-4.5f * t * t);
+    else if(kernel == FootprintKernelSmoothstep)
+        return 1.0f - t * t * (3.0f - 2.0f * t);
+
+    const float s = t * 2.0f;
+    if(s < 1.0f)
+        return (4.0f - 6.0f * s * s + 3.0f * s * s * s) / 6.0f;
+    return (2.0f - s) * (2.0f - s) * (2.0f - s) / 6.0f;
+}
+
+struct KernelTap
+{
+    int32 X;
+    int32 Y;
+    float Weight;
+};
+
+// The texels with a non-zero weight, relative to the texel that contains the center of the
+// footprint, in row order. fracX and fracY are the position of the center within that texel.
+// Kernels that are wider than the texture wrap around onto the same texels, so their weights
+// are added together and there are never more taps than texels.
+struct KernelTaps
+{
+    int32 MinX;
+    int32 MinY;
+    int32 MaxX;
+    int32 MaxY;
+    float InvWeightSum;
+    std::vector<KernelTap> Taps;
+
+    void Build(FootprintKernel kernel, float radius, float fracX, float fracY, uint32 wrapWidth, uint32 wrapHeight)
+    {
+        MinX = static_cast<int32>(std::ceil(fracX - 0.5f - radius));
+        MinY = static_cast<int32>(std::ceil(fracY - 0.5f - radius));
+        const int32 endX = static_cast<int32>(std::floor(fracX - 0.5f + radius)) + 1;
+        const int32 endY = static_cast<int32>(std::floor(fracY - 0.5f + radius)) + 1;
+        const uint32 sizeX = std::min<uint32>(endX - MinX, wrapWidth);
+        const uint32 sizeY = std::min<uint32>(endY - MinY, wrapHeight);
+        MaxX = MinX + sizeX - 1;
+        MaxY = MinY + sizeY - 1;
+
+        std::vector<double> weights(uint64(sizeX) * sizeY, 0.0);
+        double weightSum = 0.0;
+        for(int32 y = MinY; y < endY; ++y)
+        {
+            const uint64 row = uint64((y - MinY) % sizeY) * sizeX;
+            for(int32 x = MinX; x < endX; ++x)
+            {
+                const float weight = KernelWeight(kernel, fracX - x - 0.5f, fracY - y - 0.5f, radius);
+                weights[row + (x - MinX) % sizeX] += weight;
+                weightSum += weight;
+            }
+        }
+
+        Taps.clear();
+        for(uint32 y = 0; y < sizeY; ++y)
+        {
+            for(uint32 x = 0; x < sizeX; ++x)
+            {
+                KernelTap tap;
+                tap.X = MinX + x;
+                tap.Y = MinY + y;
+                tap.Weight = float(weights[uint64(y) * sizeX + x]);
+                if(tap.Weight > 0.0f)
+                    Taps.push_back(tap);
+            }
+        }
+
+        InvWeightSum = weightSum > 0.0 ? float(1.0 / weightSum) : 0.0f;
+    }
+};
+
+// Position of the footprint centers for a level, in mip 0 texels. The centers of texel x are
+// at (x + 0.5) * Scale.
+struct LevelFootprint
+{
+    double ScaleX;
+    double ScaleY;
+    float Radius;
+
+    LevelFootprint(uint32 baseWidth, uint32 baseHeight, uint32 mipLevel, const MomentPyramid::Level& level,
+                   const FootprintFilterSettings& settings)
+    {
+        ScaleX = double(baseWidth) / level.Width;
+        ScaleY = double(baseHeight) / level.Height;
+        Radius = settings.Radius * float(1u << mipLevel);
+    }
+
+    // With an integer scale the center is in the same spot of its texel for every texel of the
+    // level, so they can all share one set of taps
+    bool SharedTaps() const
+    {
+        return ScaleX == std::floor(ScaleX) && ScaleY == std::floor(ScaleY);
+    }
+};
+
+//=================================================================================================
+// Direct sums
+//=================================================================================================
+
+// Interleaves the 8 planes of mip 0, so that each tap is a single Float8 load
+static void InterleaveBaseLevel(const MomentPyramid::Level& level, std::vector<float>& texels)
+{
+    const uint32 numTexels = level.Width * level.Height;
+    texels.resize(uint64(numTexels) * MomentPyramid::NumPlanes);
+    ThreadPool::GlobalPool.ParallelFor(NumTasks(numTexels, TexelsPerTask), [&](uint32 taskIdx, uint32 threadIdx)
+    {
+        const uint32 end = std::min((taskIdx + 1) * TexelsPerTask, numTexels);
+        for(uint32 i = taskIdx * TexelsPerTask; i < end; ++i)
+            for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+                texels[uint64(i) * MomentPyramid::NumPlanes + plane] = level.Data[plane][i];
+    });
+}
+
+static void FilterLevelDirect(const std::vector<float>& baseTexels, uint32 baseWidth, uint32 baseHeight,
+                              const LevelFootprint& footprint, FootprintKernel kernel, const KernelTaps& sharedTaps,
+                              MomentPyramid::Level& level)
+{
+    const uint32 numTexels = level.Width * level.Height;
+    const bool shareTaps = footprint.SharedTaps();
+
+    ThreadPool::GlobalPool.ParallelFor(NumTasks(numTexels, TexelsPerTask), [&](uint32 taskIdx, uint32 threadIdx)
+    {
+        KernelTaps localTaps;
+        std::vector<int32> columns;
+        std::vector<int64> rows;
+
+        const uint32 end = std::min((taskIdx + 1) * TexelsPerTask, numTexels);
+        for(uint32 i = taskIdx * TexelsPerTask; i < end; ++i)
+        {
+            const uint32 x = i % level.Width;
+            const uint32 y = i / level.Width;
+            const double centerX = (x + 0.5) * footprint.ScaleX;
+            const double centerY = (y + 0.5) * footprint.ScaleY;
+            const int64 baseX = static_cast<int64>(std::floor(centerX));
+            const int64 baseY = static_cast<int64>(std::floor(centerY));
+
+            if(!shareTaps)
+                localTaps.Build(kernel, footprint.Radius, float(centerX - baseX), float(centerY - baseY), baseWidth, baseHeight);
+            const KernelTaps& taps = shareTaps ? sharedTaps : localTaps;
+
+            // Wrap the rows and columns once, instead of for every tap
+            columns.resize(taps.MaxX - taps.MinX + 1);
+            for(int32 tx = taps.MinX; tx <= taps.MaxX; ++tx)
+                columns[tx - taps.MinX] = Wrap(baseX + tx, baseWidth);
+            rows.resize(taps.MaxY - taps.MinY + 1);
+            for(int32 ty = taps.MinY; ty <= taps.MaxY; ++ty)
+                rows[ty - taps.MinY] = int64(Wrap(baseY + ty, baseHeight)) * baseWidth;
+
+            // The taps are summed a row at a time, since wide kernels have millions of them and
+            // a single running sum loses too much precision
+            Float8 sum = 0.0f;
+            Float8 rowSum = 0.0f;
+            int32 currRow = taps.MinY;
+            for(uint64 tapIdx = 0; tapIdx < taps.Taps.size(); ++tapIdx)
+            {
+                const KernelTap& tap = taps.Taps[tapIdx];
+                if(tap.Y != currRow)
+                {
+                    sum += rowSum;
+                    rowSum = 0.0f;
+                    currRow = tap.Y;
+                }
+
+                const int64 texelIdx = rows[tap.Y - taps.MinY] + columns[tap.X - taps.MinX];
+                rowSum += Float8::Load(&baseTexels[texelIdx * MomentPyramid::NumPlanes]) * tap.Weight;
+            }
+            sum = (sum + rowSum) * taps.InvWeightSum;
+
+            float moments[MomentPyramid::NumPlanes];
+            sum.Store(moments);
+            for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+                level.Data[plane][i] = moments[plane];
+        }
+    });
+}
+
+//=================================================================================================
+// FFT
+//=================================================================================================
+
+// exp(-2 * pi * i * k / n) for the first half of a radix-2 FFT of size n
+static void ComputeTwiddles(uint32 n, std::vector<Complex>& twiddles)
+{
+    twiddles.resize(std::max<uint32>(n / 2, 1));
+    for(uint32 k = 0; k < n / 2; ++k)
+    {
+        const double angle = -2.0 * 3.14159265358979323846 * k / n;
+        twiddles[k] = Complex(float(std::cos(angle)), float(std::sin(angle)));
+    }
+}
+
+// In-place iterative radix-2 FFT, without any scaling
+static void FFT(Complex* data, uint32 n, const std::vector<Complex>& twiddles, bool inverse)
+{
+    for(uint32 i = 1, j = 0; i < n; ++i)
+    {
+        uint32 bit = n >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j)
+            std::swap(data[i], data[j]);
+    }
+
+    for(uint32 length = 2; length <= n; length <<= 1)
+    {
+        const uint32 halfLength = length / 2;
+        const uint32 twiddleStep = n / length;
+        for(uint32 start = 0; start < n; start += length)
+        {
+            for(uint32 k = 0; k < halfLength; ++k)
+            {
+                Complex twiddle = twiddles[k * twiddleStep];
+                if(inverse)
+                    twiddle = std::conj(twiddle);
+
+                const Complex a = data[start + k];
+                const Complex b = Mul(data[start + k + halfLength], twiddle);
+                data[start + k] = a + b;
+                data[start + k + halfLength] = a - b;
+            }
+        }
+    }
+}
+
+// Transforms the rows and then the columns, with the inverse scaled by 1 / (width * height)
+static void FFT2D(std::vector<Complex>& data, uint32 width, uint32 height, bool inverse)
+{
+    std::vector<Complex> twiddles;
+    ComputeTwiddles(width, twiddles);
+    ThreadPool::GlobalPool.ParallelFor(height, [&](uint32 y, uint32 threadIdx)
+    {
+        FFT(&data[uint64(y) * width], width, twiddles, inverse);
+    });
+
+    ComputeTwiddles(height, twiddles);
+    std::vector<std::vector<Complex>> scratch(ThreadPool::GlobalPool.NumThreads());
+    const float scale = inverse ? 1.0f / (float(width) * height) : 1.0f;
+    ThreadPool::GlobalPool.ParallelFor(NumTasks(width, ColumnsPerTask), [&](uint32 taskIdx, uint32 threadIdx)
+    {
+        const uint32 startX = taskIdx * ColumnsPerTask;
+        const uint32 numColumns = std::min(width - startX, ColumnsPerTask);
+        std::vector<Complex>& columns = scratch[threadIdx];
+        columns.resize(uint64(numColumns) * height);
+
+        for(uint32 y = 0; y < height; ++y)
+            for(uint32 c = 0; c < numColumns; ++c)
+                columns[uint64(c) * height + y] = data[uint64(y) * width + startX + c];
+
+        for(uint32 c = 0; c < numColumns; ++c)
+            FFT(&columns[uint64(c) * height], height, twiddles, inverse);
+
+        for(uint32 y = 0; y < height; ++y)
+            for(uint32 c = 0; c < numColumns; ++c)
+                data[uint64(y) * width + startX + c] = columns[uint64(c) * height + y] * scale;
+    });
+}
+
+// Pairs of planes that are transformed together as the real and imaginary parts
+static const uint32 NumSpectra = MomentPyramid::NumPlanes / 2;
+
+static void TransformBaseLevel(const MomentPyramid::Level& level, std::vector<Complex> spectra[NumSpectra])
+{
+    const uint32 numTexels = level.Width * level.Height;
+    for(uint32 i = 0; i < NumSpectra; ++i)
+    {
+        spectra[i].resize(numTexels);
+        const float* re = level.Data[i * 2].data();
+        const float* im = level.Data[i * 2 + 1].data();
+        for(uint32 texelIdx = 0; texelIdx < numTexels; ++texelIdx)
+            spectra[i][texelIdx] = Complex(re[texelIdx], im[texelIdx]);
+
+        FFT2D(spectra[i], level.Width, level.Height, false);
+    }
+}
+
+// Multiplies mip 0 with the spectrum of the kernel, and folds the product down to the size of
+// the level before the inverse transform. Folding the spectrum is the same as keeping every Nth
+// texel of the full-size convolution, since the texels in between alias onto it.
+static void FilterLevelFFT(const std::vector<Complex> spectra[NumSpectra], uint32 baseWidth, uint32 baseHeight,
+                           const LevelFootprint& footprint, const KernelTaps& taps, MomentPyramid::Level& level)
+{
+    const uint32 scaleX = static_cast<uint32>(footprint.ScaleX);
+    const uint32 scaleY = static_cast<uint32>(footprint.ScaleY);
+    const int32 centerX = static_cast<int32>(std::floor(0.5 * footprint.ScaleX));
+    const int32 centerY = static_cast<int32>(std::floor(0.5 * footprint.ScaleY));
+
+    // Texel (x * scaleX, y * scaleY) of the convolution is the footprint of texel (x, y) of the
+    // level, so the taps are flipped and moved so that the center of the footprint is the origin
+    std::vector<Complex> kernel(uint64(baseWidth) * baseHeight, Complex(0.0f, 0.0f));
+    for(uint64 tapIdx = 0; tapIdx < taps.Taps.size(); ++tapIdx)
+    {
+        const KernelTap& tap = taps.Taps[tapIdx];
+        const int32 x = Wrap(-int64(centerX) - tap.X, baseWidth);
+        const int32 y = Wrap(-int64(centerY) - tap.Y, baseHeight);
+        kernel[uint64(y) * baseWidth + x] = Complex(tap.Weight * taps.InvWeightSum, 0.0f);
+    }
+    FFT2D(kernel, baseWidth, baseHeight, false);
+
+    const float foldScale = 1.0f / (float(scaleX) * scaleY);
+    std::vector<Complex> folded(uint64(level.Width) * level.Height);
+    for(uint32 i = 0; i < NumSpectra; ++i)
+    {
+        const std::vector<Complex>& spectrum = spectra[i];
+        ThreadPool::GlobalPool.ParallelFor(level.Height, [&](uint32 y, uint32 threadIdx)
+        {
+            for(uint32 x = 0; x < level.Width; ++x)
+            {
+                Complex sum(0.0f, 0.0f);
+                for(uint32 aliasY = 0; aliasY < scaleY; ++aliasY)
+                {
+                    const uint64 rowStart = uint64(y + aliasY * level.Height) * baseWidth;
+                    for(uint32 aliasX = 0; aliasX < scaleX; ++aliasX)
+                    {
+                        const uint64 idx = rowStart + x + aliasX * level.Width;
+                        sum += Mul(spectrum[idx], kernel[idx]);
+                    }
+                }
+                folded[uint64(y) * level.Width + x] = sum * foldScale;
+            }
+        });
+
+        FFT2D(folded, level.Width, level.Height, true);
+
+        float* re = level.Data[i * 2].data();
+        float* im = level.Data[i * 2 + 1].data();
+        for(uint64 texelIdx = 0; texelIdx < folded.size(); ++texelIdx)
+        {
+            re[texelIdx] = folded[texelIdx].real();
+            im[texelIdx] = folded[texelIdx].imag();
+        }
+    }
+}
+
+//=================================================================================================
+// FootprintFilter
+//=================================================================================================
+
+std::wstring FootprintFilterStats::ToString() const
+{
+    std::wstring text = L"Filtered footprints in " + SampleFramework11::ToString(Seconds * 1000.0) + L"ms using ";
+    text += SampleFramework11::ToString(NumThreads) + L" threads, forward FFT ";
+    text += SampleFramework11::ToString(ForwardFFTSeconds * 1000.0) + L"ms";
+
+    for(uint64 i = 0; i < Levels.size(); ++i)
+    {
+        const FootprintFilterLevelStats& level = Levels[i];
+        text += L"\n  Mip " + SampleFramework11::ToString(i + 1) + L" (" + SampleFramework11::ToString(level.Width);
+        text += L"x" + SampleFramework11::ToString(level.Height) + L"): ";
+        text += SampleFramework11::ToString(level.NumTaps) + L" taps (";
+        text += SampleFramework11::ToString(level.TapsPerTexel) + L" per mip 0 texel), ";
+        text += std::wstring(level.UsedFFT ? L"FFT" : L"direct") + L", ";
+        text += SampleFramework11::ToString(level.Seconds * 1000.0) + L"ms";
+    }
+
+    return text;
+}
+
+FootprintFilter::FootprintFilter()
+{
+}
+
+void FootprintFilter::Filter(MomentPyramid& moments, const FootprintFilterSettings& settings)
+{
+    if(moments.Levels.empty())
+        throw Exception(L"The moment pyramid has to be generated before it can be filtered");
+    if(settings.Radius <= 0.0f)
+        throw Exception(L"The footprint radius has to be greater than 0");
+
+    Timer timer;
+
+    const MomentPyramid::Level& baseLevel = moments.Levels[0];
+    const uint32 baseWidth = baseLevel.Width;
+    const uint32 baseHeight = baseLevel.Height;
+    const bool fftSupported = IsPow2(baseWidth) && IsPow2(baseHeight);
+
+    stats = FootprintFilterStats();
+    stats.NumThreads = ThreadPool::GlobalPool.NumThreads();
+
+    // Both of these are only set up once a level needs them
+    std::vector<float> baseTexels;
+    std::vector<Complex> spectra[NumSpectra];
+
+    for(uint32 mipLevel = 1; mipLevel < moments.Levels.size(); ++mipLevel)
+    {
+        MomentPyramid::Level& level = moments.Levels[mipLevel];
+        const LevelFootprint footprint(baseWidth, baseHeight, mipLevel, level, settings);
+
+        Timer levelTimer;
+        double forwardSeconds = 0.0;
+
+        // Without shared taps these are only for the first texel, which is enough for picking a path
+        KernelTaps taps;
+        taps.Build(settings.Kernel, footprint.Radius, float(0.5 * footprint.ScaleX - std::floor(0.5 * footprint.ScaleX)),
+                   float(0.5 * footprint.ScaleY - std::floor(0.5 * footprint.ScaleY)), baseWidth, baseHeight);
+
+        FootprintFilterLevelStats levelStats;
+        levelStats.Width = level.Width;
+        levelStats.Height = level.Height;
+        levelStats.NumTaps = static_cast<uint32>(taps.Taps.size());
+        levelStats.TapsPerTexel = float(double(levelStats.NumTaps) * level.Width * level.Height / (double(baseWidth) * baseHeight));
+
+        // The FFT path still has to go through every tap once to build the kernel, which is most
+        // of the work of the direct sums for the last few levels
+        const double fftTapsPerTexel = settings.FFTMinTapsPerTexel + double(levelStats.NumTaps) / (double(baseWidth) * baseHeight);
+        levelStats.UsedFFT = fftSupported && footprint.SharedTaps() && levelStats.TapsPerTexel >= fftTapsPerTexel;
+
+        if(levelStats.UsedFFT && spectra[0].empty())
+        {
+            Timer fftTimer;
+            TransformBaseLevel(baseLevel, spectra);
+            fftTimer.Update();
+            stats.ForwardFFTSeconds = fftTimer.ElapsedSecondsD();
+            forwardSeconds = stats.ForwardFFTSeconds;
+        }
+        else if(!levelStats.UsedFFT && baseTexels.empty())
+            InterleaveBaseLevel(baseLevel, baseTexels);
+
+        if(levelStats.UsedFFT)
+            FilterLevelFFT(spectra, baseWidth, baseHeight, footprint, taps, level);
+        else
+            FilterLevelDirect(baseTexels, baseWidth, baseHeight, footprint, settings.Kernel, taps, level);
+        levelTimer.Update();
+
+        levelStats.Seconds = levelTimer.ElapsedSecondsD() - forwardSeconds;
+        stats.Levels.push_back(levelStats);
+    }
+
+    timer.Update();
+    stats.Seconds = timer.ElapsedSecondsD();
+}
+
+//=================================================================================================
+// FootprintFilterBenchmark
+//=================================================================================================
+
+FootprintFilterBenchmark::FootprintFilterBenchmark() : Kernel(FootprintKernelGaussian), ForwardFFTSeconds(0.0),
+                                                       CrossoverTapsPerTexel(0.0f)
+{
+}
+
+void FootprintFilterBenchmark::Run(const MomentPyramid& moments, FootprintKernel kernel, const std::vector<float>& radii)
+{
+    const uint32 baseWidth = moments.Levels[0].Width;
+    const uint32 baseHeight = moments.Levels[0].Height;
+    if(!IsPow2(baseWidth) || !IsPow2(baseHeight))
+        throw Exception(L"The FFT path needs a normal map with power-of-two dimensions");
+
+    Kernel = kernel;
+    ForwardFFTSeconds = 0.0;
+    CrossoverTapsPerTexel = 0.0f;
+    Results.clear();
+
+    FootprintFilter filter;
+    for(uint64 radiusIdx = 0; radiusIdx < radii.size(); ++radiusIdx)
+    {
+        FootprintFilterSettings settings;
+        settings.Kernel = kernel;
+        settings.Radius = radii[radiusIdx];
+
+        MomentPyramid directMoments = moments;
+        settings.FFTMinTapsPerTexel = FLT_MAX;
+        filter.Filter(directMoments, settings);
+        const FootprintFilterStats directStats = filter.Stats();
+
+        MomentPyramid fftMoments = moments;
+        settings.FFTMinTapsPerTexel = 0.0f;
+        filter.Filter(fftMoments, settings);
+        const FootprintFilterStats& fftStats = filter.Stats();
+        ForwardFFTSeconds = std::max(ForwardFFTSeconds, fftStats.ForwardFFTSeconds);
+
+        for(uint32 mipLevel = 1; mipLevel < moments.Levels.size(); ++mipLevel)
+        {
+            Result result;
+            result.Radius = settings.Radius;
+            result.MipLevel = mipLevel;
+            result.NumTaps = directStats.Levels[mipLevel - 1].NumTaps;
+            result.TapsPerTexel = directStats.Levels[mipLevel - 1].TapsPerTexel;
+            result.DirectSeconds = directStats.Levels[mipLevel - 1].Seconds;
+            result.FFTSeconds = fftStats.Levels[mipLevel - 1].Seconds;
+
+            const MomentPyramid::Level& a = directMoments.Levels[mipLevel];
+            const MomentPyramid::Level& b = fftMoments.Levels[mipLevel];
+            for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+            {
+                for(uint64 i = 0; i < a.Data[plane].size(); ++i)
+                {
+                    const float difference = std::abs(a.Data[plane][i] - b.Data[plane][i]) / std::max(std::abs(a.Data[plane][i]), 1.0f);
+                    result.MaxDifference = std::max(result.MaxDifference, difference);
+                }
+            }
+
+            if(result.FFTSeconds < result.DirectSeconds
+               && (CrossoverTapsPerTexel == 0.0f || result.TapsPerTexel < CrossoverTapsPerTexel))
+                CrossoverTapsPerTexel = result.TapsPerTexel;
+
+            Results.push_back(result);
+        }
+    }
+}
+
+std::wstring FootprintFilterBenchmark::ToString() const
+{
+    std::wstring text = std::wstring(FootprintKernelName(Kernel)) + L" footprints, forward FFT of mip 0: ";
+    text += SampleFramework11::ToString(ForwardFFTSeconds * 1000.0) + L"ms";
+
+    for(uint64 i = 0; i < Results.size(); ++i)
+    {
+        const Result& result = Results[i];
+        text += L"\n  Radius " + SampleFramework11::ToString(result.Radius) + L", mip ";
+        text += SampleFramework11::ToString(result.MipLevel) + L": " + SampleFramework11::ToString(result.NumTaps);
+        text += L" taps (" + SampleFramework11::ToString(result.TapsPerTexel) + L" per mip 0 texel), direct ";
+        text += SampleFramework11::ToString(result.DirectSeconds * 1000.0) + L"ms, FFT ";
+        text += SampleFramework11::ToString(result.FFTSeconds * 1000.0) + L"ms, max difference ";
+        text += SampleFramework11::ToString(result.MaxDifference);
+    }
+
+    if(CrossoverTapsPerTexel > 0.0f)
+        text += L"\nThe FFT was faster from " + SampleFramework11::ToString(CrossoverTapsPerTexel) + L" taps per mip 0 texel";
+    else
+        text += L"\nThe FFT was never faster";
+
+    return text;
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "MapBaker.h"
+
+using namespace SampleFramework11;
+
+// Weighting functions for the footprint of a texel. Box and Smoothstep are the same as FilterBox
+// and FilterSmoothstep in GenerateMaps.hlsl. Box has a square footprint, and the rest are radial.
+enum FootprintKernel
+{
+    FootprintKernelBox = 0,
+    FootprintKernelGaussian,        // Truncated at 3 standard deviations
+    FootprintKernelSmoothstep,
+    FootprintKernelCubic,           // Cubic B-spline
+
+    NumFootprintKernels
+};
+
+const wchar* FootprintKernelName(FootprintKernel kernel);
+
+struct FootprintFilterSettings
+{
+    FootprintKernel Kernel;
+    float Radius;               // In texels of the level being filtered, 0.5 with a box is the 2x2 pyramid
+
+    // Levels whose direct sums would take at least this many taps per mip 0 texel are convolved
+    // in the frequency domain instead, see FootprintFilterBenchmark
+    float FFTMinTapsPerTexel;
+
+    FootprintFilterSettings() : Kernel(FootprintKernelGaussian), Radius(1.0f), FFTMinTapsPerTexel(24.0f)
+    {
+    }
+};
+
+struct FootprintFilterLevelStats
+{
+    uint32 Width;
+    uint32 Height;
+    uint32 NumTaps;             // Mip 0 texels weighted by each texel of this level
+    float TapsPerTexel;         // NumTaps for the whole level, divided by the size of mip 0
+    bool UsedFFT;
+    double Seconds;
+
+    FootprintFilterLevelStats() : Width(0), Height(0), NumTaps(0), TapsPerTexel(0.0f), UsedFFT(false), Seconds(0.0)
+    {
+    }
+};
+
+struct FootprintFilterStats
+{
+    double Seconds;
+    double ForwardFFTSeconds;   // Transforming mip 0, which is shared by every level that uses the FFT
+    uint32 NumThreads;
+    std::vector<FootprintFilterLevelStats> Levels;
+
+    FootprintFilterStats() : Seconds(0.0), ForwardFFTSeconds(0.0), NumThreads(1)
+    {
+    }
+
+    std::wstring ToString() const;
+};
+
+// Re-filters the levels of a moment pyramid with a weighted footprint, instead of the 2x2 box
+// filter that builds the pyramid. Every level is filtered straight from mip 0, since the moments
+// are linear in the normals, and the texture wraps at the edges.
+//
+// With a radius that's a fixed number of texels of the level, the number of mip 0 texels under
+// each footprint grows by 4x per level, so the direct sums cost O(radius^2) per mip 0 texel for
+// every level and get expensive for wide kernels. Those levels are convolved in the frequency
+// domain instead: mip 0 is transformed once (two planes per complex FFT), and each level
+// multiplies it with the spectrum of its kernel, folds the result down to the size of the level
+// (which is the same as taking every Nth texel after the inverse transform), and only runs the
+// inverse FFT at the size of the level. The smallest levels stay on the direct sums, since there
+// are too few texels left for the FFT to pay off. The FFT is radix-2, so normal maps that aren't
+// a power of two always use the direct sums.
+class FootprintFilter
+{
+
+public:
+
+    FootprintFilter();
+
+    // Replaces every level past mip 0 with the filtered moments. The pyramid has to be
+    // allocated already, which MapBaker::GenerateMoments takes care of.
+    void Filter(MomentPyramid& moments, const FootprintFilterSettings& settings);
+
+    const FootprintFilterStats& Stats() const { return stats; }
+
+protected:
+
+    FootprintFilterStats stats;
+};
+
+// Times the direct and FFT paths against each other for every level and a range of radii, to
+// find where the FFT starts to pay off, and checks that they give the same results
+struct FootprintFilterBenchmark
+{
+    struct Result
+    {
+        float Radius;
+        uint32 MipLevel;
+        uint32 NumTaps;
+        float TapsPerTexel;
+        double DirectSeconds;
+        double FFTSeconds;          // Not including the shared forward transform
+        float MaxDifference;        // Relative to the magnitude of the moments
+
+        Result() : Radius(0.0f), MipLevel(0), NumTaps(0), TapsPerTexel(0.0f), DirectSeconds(0.0), FFTSeconds(0.0),
+                   MaxDifference(0.0f)
+        {
+        }
+    };
+
+    FootprintKernel Kernel;
+    double ForwardFFTSeconds;
+    float CrossoverTapsPerTexel;    // Lowest cost where the FFT was faster, or 0 if it never was
+    std::vector<Result> Results;
+
+    FootprintFilterBenchmark();
+
+    void Run(const MomentPyramid& moments, FootprintKernel kernel, const std::vector<float>& radii);
+
+    std::wstring ToString() const;
+};
\ No newline at end of file
@@ -12,6 +12,8 @@
 // Includes
 //=================================================================================================
 #include "SharedConstants.h"
+#include "NormalMoments.hlsl"
+#include "MapEncoding.hlsl"
 
 //=================================================================================================
 // Constants
@@ -21,8 +23,8 @@ cbuffer Constants : register(b0)
     float2 TextureSize;
     float2 OutputSize;
     uint MipLevel;
-    float Roughness;
     float ScaleFactor;
+    uint2 OutputOffset;     // Start of the rectangle being updated, OutputSize is its end
 };
 
 //=================================================================================================
@@ -31,12 +33,19 @@ cbuffer Constants : register(b0)
 
 // Inputs
 Texture2D<float4> NormalMap : register(t0);
+Texture2DArray<float4> InputMoments : register(t1);
 
 // Outputs
 RWTexture2DArray<snorm float4> OutputLEANMap : register(u0);
 RWTexture2D<float4> OutputVMFMap : register(u0);
 RWTexture2DArray<float4> OutputVMFArrayMap : register(u0);
 RWTexture2D<unorm float2> OutputRoughnessMap : register(u1);
+RWTexture2DArray<float4> OutputMoments : register(u0);
+RWTexture2D<snorm float2> OutputCompactLEANBMap : register(u0);
+RWTexture2D<unorm float4> OutputCompactLEANCovarianceMap : register(u1);
+RWTexture2D<unorm float4> OutputCompactVMFMap : register(u2);
+RWTexture2DArray<unorm float4> OutputCompactVMFArrayMap : register(u2);
+RWTexture2D<float3> OutputAnisoRoughnessMap : register(u0);
 
 float FilterBox(in float x)
 {
@@ -55,29 +64,48 @@ float3 FetchNormal(uint2 samplePos)
     return normal;
 }
 
-// ================================================================================================
-// Converts a Beckmann roughness parameter to a Blinn-Phong specular power
-// ================================================================================================
-float RoughnessToSpecPower(in float m) {
-    return 2.0f / (m * m) - 2.0f;
+NormalMoments MomentsFromNormal(in float3 N)
+{
+    NormalMoments moments;
+    moments.AvgNormal = N;
+    moments.B = N.xy / N.z;
+    moments.M = float3(moments.B.x * moments.B.x, moments.B.y * moments.B.y, moments.B.x * moments.B.y);
+
+    return moments;
 }
 
-// ================================================================================================
-// Converts a Blinn-Phong specular power to a Beckmann roughness parameter
-// ================================================================================================
-float SpecPowerToRoughness(in float s) {
-    return sqrt(2.0f / (s + 2.0f));
+// Moments are stored in a 2-slice array: (AvgNormal, M.z) and (B, M.xy)
+NormalMoments LoadMoments(in uint2 pos)
+{
+    float4 slice0 = InputMoments[uint3(pos, 0)];
+    float4 slice1 = InputMoments[uint3(pos, 1)];
+
+    NormalMoments moments;
+    moments.AvgNormal = slice0.xyz;
+    moments.B = slice1.xy;
+    moments.M = float3(slice1.zw, slice0.w);
+
+    return moments;
+}
+
+void StoreMoments(in uint2 pos, in NormalMoments moments)
+{
+    OutputMoments[uint3(pos, 0)] = float4(moments.AvgNormal, moments.M.z);
+    OutputMoments[uint3(pos, 1)] = float4(moments.B, moments.M.xy);
 }
 
 // ================================================================================================
-// Computes an optimal set of vMF lobes that represent the NDF of a texel
+// Computes an optimal set of vMF lobes that represent the NDF of a texel. Also outputs the
+// roughness that the vMF lobe adds to the base roughness, and the length of the average normal
+// that's used for Toksvig. Neither depends on the base roughness, so that it can be changed
+// without re-generating the maps.
 // ================================================================================================
-void SolveVMF(float2 centerPos, uint numSamples, out VMF vmfs[NumVMFs], out float vmfRoughness,
-              out float toksvigRoughness)
+void SolveVMF(in NormalMoments moments, out VMF vmfs[NumVMFs], out float lobeRoughness,
+              out float avgNormalLength)
 {
     if(MipLevel == 0)
     {
-        vmfs[0].mu = FetchNormal(uint2(centerPos)).xyz,
+        vmfs[0].mu = moments.AvgNormal;
         vmfs[0].alpha = 1.0f;
         vmfs[0].kappa = 10000.0f;
 
@@ -89,33 +117,15 @@ void SolveVMF(float2 centerPos, uint numSamples, out VMF vmfs[NumVMFs], out floa
             vmfs[i].kappa = 10000.0f;
         }
 
-        vmfRoughness = Roughness;
-        toksvigRoughness = Roughness;
+        lobeRoughness = 0.0f;
+        avgNormalLength = 1.0f;
     }
     else
     {
-        float3 avgNormal = 0.0f;
-
-        float2 topLeft = (-float(numSamples) / 2.0f) + 0.5f;
-
-        for(uint y = 0; y < numSamples; ++y)
-        {
-            for(uint x = 0; x < numSamples; ++x)
-            {
-                float2 offset = topLeft + float2(x, y);
-                float2 samplePos = floor(centerPos + offset) + 0.5f;
-                float3 sampleNormal = FetchNormal(samplePos);
-
-                avgNormal += sampleNormal;
-            }
-        }
-
-        avgNormal /= (numSamples * numSamples);
+        float3 avgNormal = moments.AvgNormal;
 
         float r = length(avgNormal);
-        float kappa = 10000.0f;
-        if(r < 1.0f)
-            kappa = (3 * r - r * r * r) / (1 - r * r);
+        float kappa = VMFKappa(r);
 
         float3 mu = normalize(avgNormal);
 
@@ -131,53 +141,90 @@ void SolveVMF(float2 centerPos, uint numSamples, out VMF vmfs[NumVMFs], out floa
             vmfs[i].kappa = 10000.0f;
         }
 
-        // Pre-compute roughness map values
-        vmfRoughness = sqrt(Roughness * Roughness + (2.0f / kappa));
+        // Pre-compute roughness map values. The final vMF roughness is sqrt(Roughness^2 + 2 / kappa)
+        // (equation 21 in "Frequency Domain Normal Map Filtering"), which is applied in Mesh.hlsl.
+        lobeRoughness = sqrt(2.0f / kappa);
+        avgNormalLength = r;
+    }
+}
 
-        float s = RoughnessToSpecPower(Roughness);
-        float ft = r / lerp(s, 1.0f, r);
-        toksvigRoughness = SpecPowerToRoughness(ft * s);
+//=================================================================================================
+// Builds one level of the moment pyramid. Mip 0 is computed from the normal map, and every
+// other level is a 2x2 box filter of the previous level (which is bound as InputMoments).
+//=================================================================================================
+[numthreads(TGSize_, TGSize_, 1)]
+void GenerateMoments(uint3 GroupID : SV_GroupID, uint3 DispatchThreadID : SV_DispatchThreadID,
+                     uint3 GroupThreadID : SV_GroupThreadID, uint GroupIndex : SV_GroupIndex)
+{
+    uint2 outputPos = OutputOffset + GroupID.xy * uint2(TGSize_, TGSize_) + GroupThreadID.xy;
+
+    [branch]
+    if(outputPos.x < uint(OutputSize.x) && outputPos.y < uint(OutputSize.y))
+    {
+        NormalMoments moments;
+
+        if(MipLevel == 0)
+        {
+            moments = MomentsFromNormal(FetchNormal(outputPos));
+        }
+        else
+        {
+            uint2 maxPos = uint2(TextureSize) - 1;
+            uint2 pos0 = min(outputPos * 2, maxPos);
+            uint2 pos1 = min(outputPos * 2 + 1, maxPos);
+
+            NormalMoments m00 = LoadMoments(uint2(pos0.x, pos0.y));
+            NormalMoments m10 = LoadMoments(uint2(pos1.x, pos0.y));
+            NormalMoments m01 = LoadMoments(uint2(pos0.x, pos1.y));
+            NormalMoments m11 = LoadMoments(uint2(pos1.x, pos1.y));
+
+            moments.AvgNormal = (m00.AvgNormal + m10.AvgNormal + m01.AvgNormal + m11.AvgNormal) * 0.25f;
+            moments.B = (m00.B + m10.B + m01.B + m11.B) * 0.25f;
+            moments.M = (m00.M + m10.M + m01.M + m11.M) * 0.25f;
+        }
+
+        StoreMoments(outputPos, moments);
     }
 }
 
 //=================================================================================================
-// Generates a LEAN map
+// Generates one mip level of the LEAN map from the moment pyramid
 //=================================================================================================
 [numthreads(TGSize_, TGSize_, 1)]
 void GenerateLEANMap(uint3 GroupID : SV_GroupID, uint3 DispatchThreadID : SV_DispatchThreadID,
                       uint3 GroupThreadID : SV_GroupThreadID, uint GroupIndex : SV_GroupIndex)
 {
-    uint2 samplePos = GroupID.xy * uint2(TGSize_, TGSize_) + GroupThreadID.xy;
+    uint2 outputPos = OutputOffset + GroupID.xy * uint2(TGSize_, TGSize_) + GroupThreadID.xy;
 
-    float3 N = FetchNormal(samplePos);
+    [branch]
+    if(outputPos.x < uint(OutputSize.x) && outputPos.y < uint(OutputSize.y))
+    {
+        NormalMoments moments = LoadMoments(outputPos);
 
-    float2 B = N.xy / (ScaleFactor * N.z);
-    float3 M = float3(B.x * B.x, B.y * B.y , B.x * B.y);
-    float cleanM = B.x * B.x + B.y * B.y;
+        float2 B = moments.B / ScaleFactor;
+        float3 M = moments.M / (ScaleFactor * ScaleFactor);
+        float cleanM = M.x + M.y;
 
-    OutputLEANMap[uint3(samplePos, 0)] = float4(B, 0.0f, 1.0f);
-    OutputLEANMap[uint3(samplePos, 1)] = float4(M, cleanM);
+        OutputLEANMap[uint3(outputPos, 0)] = float4(B, 0.0f, 1.0f);
+        OutputLEANMap[uint3(outputPos, 1)] = float4(M, cleanM);
+    }
 }
 
 //=================================================================================================
-// vMF solver for normal map NDF
+// vMF solver for normal map NDF, run on one mip level of the moment pyramid
 //=================================================================================================
 [numthreads(TGSize_, TGSize_, 1)]
 void SolveVMF(uint3 GroupID : SV_GroupID, uint3 DispatchThreadID : SV_DispatchThreadID,
               uint3 GroupThreadID : SV_GroupThreadID, uint GroupIndex : SV_GroupIndex)
 {
-    uint2 outputPos = GroupID.xy * uint2(TGSize_, TGSize_) + GroupThreadID.xy;
+    uint2 outputPos = OutputOffset + GroupID.xy * uint2(TGSize_, TGSize_) + GroupThreadID.xy;
 
     [branch]
     if(outputPos.x < uint(OutputSize.x) && outputPos.y < uint(OutputSize.y))
     {
-        float2 uv = (outputPos + 0.5f) / OutputSize;
-        uint sampleRadius = (1 << MipLevel);
-        float2 samplePos = uv * TextureSize;
-
         VMF vmfs[NumVMFs];
-        float vmfRoughness, toksvigRoughness;
-        SolveVMF(samplePos, sampleRadius, vmfs, vmfRoughness, toksvigRoughness);
+        float lobeRoughness, avgNormalLength;
+        SolveVMF(LoadMoments(outputPos), vmfs, lobeRoughness, avgNormalLength);
 
         #if NumVMFs_ > 1
             [unroll]
@@ -188,6 +235,61 @@ void SolveVMF(uint3 GroupID : SV_GroupID, uint3 DispatchThreadID : SV_DispatchTh
             OutputVMFMap[outputPos] = float4(vmfs[0].mu.xy, 1.0f, 1.0f / vmfs[0].kappa);
         #endif
 
-        OutputRoughnessMap[outputPos] = sqrt(float2(vmfRoughness, toksvigRoughness));
+        OutputRoughnessMap[outputPos] = float2(lobeRoughness, avgNormalLength);
+    }
+}
+
+//=================================================================================================
+// Generates one mip level of the compact LEAN and vMF maps from the moment pyramid
+//=================================================================================================
+[numthreads(TGSize_, TGSize_, 1)]
+void GenerateCompactMaps(uint3 GroupID : SV_GroupID, uint3 DispatchThreadID : SV_DispatchThreadID,
+                         uint3 GroupThreadID : SV_GroupThreadID, uint GroupIndex : SV_GroupIndex)
+{
+    uint2 outputPos = OutputOffset + GroupID.xy * uint2(TGSize_, TGSize_) + GroupThreadID.xy;
+
+    [branch]
+    if(outputPos.x < uint(OutputSize.x) && outputPos.y < uint(OutputSize.y))
+    {
+        NormalMoments moments = LoadMoments(outputPos);
+
+        float2 encodedB;
+        float4 encodedCovariance;
+        EncodeCompactLEAN(moments.B, moments.M, ScaleFactor, encodedB, encodedCovariance);
+        OutputCompactLEANBMap[outputPos] = encodedB;
+        OutputCompactLEANCovarianceMap[outputPos] = encodedCovariance;
+
+        VMF vmfs[NumVMFs];
+        float lobeRoughness, avgNormalLength;
+        SolveVMF(moments, vmfs, lobeRoughness, avgNormalLength);
+
+        #if NumVMFs_ > 1
+            [unroll]
+            for(uint i = 0; i < NumVMFs; ++i)
+                OutputCompactVMFArrayMap[uint3(outputPos, i)] = EncodeCompactVMF(vmfs[i]);
+        #else
+            OutputCompactVMFMap[outputPos] = EncodeCompactVMF(vmfs[0]);
+        #endif
+    }
+}
+
+//=================================================================================================
+// Generates one mip level of the anisotropic roughness map from the moment pyramid
+//=================================================================================================
+[numthreads(TGSize_, TGSize_, 1)]
+void GenerateAnisoRoughnessMap(uint3 GroupID : SV_GroupID, uint3 DispatchThreadID : SV_DispatchThreadID,
+                               uint3 GroupThreadID : SV_GroupThreadID, uint GroupIndex : SV_GroupIndex)
+{
+    uint2 outputPos = OutputOffset + GroupID.xy * uint2(TGSize_, TGSize_) + GroupThreadID.xy;
+
+    [branch]
+    if(outputPos.x < uint(OutputSize.x) && outputPos.y < uint(OutputSize.y))
+    {
+        // A single normal has no spread around itself
+        float3 sigma = 0.0f;
+        if(MipLevel > 0)
+            sigma = MeanNormalCovariance(LoadMoments(outputPos));
+
+        OutputAnisoRoughnessMap[outputPos] = EncodeAnisoRoughness(sigma);
     }
 }
\ No newline at end of file
@@ -0,0 +1,1355 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "Headless.h"
+#include "MapBaker.h"
+#include "MapCache.h"
+#include "MapEncoding.h"
+#include "MapCompression.h"
+#include "MomentSAT.h"
+#include "AnisoRoughness.h"
+#include "VMFMixture.h"
+#include "FootprintFilter.h"
+#include "BatchBaker.h"
+#include "ReferenceRenderer.h"
+#include "BRDFKernels.h"
+#include "Sampling.h"
+#include "TextureSampler.h"
+#include "CameraPresets.h"
+#include "CameraPath.h"
+#include "BenchmarkMatrix.h"
+#include "TemporalShimmer.h"
+#include "ImageMetrics.h"
+#include "AppSettings.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Exceptions.h"
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/FileIO.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/Timer.h"
+#include "SampleFramework11/Random.h"
+#include "SampleFramework11/Model.h"
+#include "SampleFramework11/Camera.h"
+
+#include <shellapi.h>
+
+#pragma comment(lib, "shell32.lib")
+
+using std::wstring;
+
+namespace Headless
+{
+
+// Command-line arguments, split into positional arguments and "-name value" options
+class CommandLine
+{
+
+public:
+
+    CommandLine(const std::vector<wstring>& args)
+    {
+        for(uint64 i = 0; i < args.size(); ++i)
+        {
+            if(args[i].length() > 1 && args[i][0] == L'-' && i + 1 < args.size())
+            {
+                options[args[i].substr(1)] = args[i + 1];
+                ++i;
+            }
+            else
+                positional.push_back(args[i]);
+        }
+    }
+
+    uint64 NumPositional() const { return positional.size(); }
+    const wstring& Positional(uint64 idx) const { return positional[idx]; }
+
+    template<typename T> T Option(const wchar* name, T defaultValue) const
+    {
+        auto it = options.find(name);
+        if(it == options.end())
+            return defaultValue;
+        return Parse<T>(it->second);
+    }
+
+    // String options are returned as-is, since they may contain spaces
+    wstring Option(const wchar* name, const wstring& defaultValue) const
+    {
+        auto it = options.find(name);
+        return it == options.end() ? defaultValue : it->second;
+    }
+
+protected:
+
+    std::vector<wstring> positional;
+    std::map<wstring, wstring> options;
+};
+
+typedef void (*CommandFunction)(const CommandLine& cmdLine);
+
+struct Command
+{
+    const wchar* Name;
+    const wchar* Usage;
+    uint64 NumPositional;
+    CommandFunction Function;
+};
+
+static void Print(const wstring& text)
+{
+    wprintf(L"%s\n", text.c_str());
+    fflush(stdout);
+}
+
+// Parses an enum value from the names that nameFunc gives for [0, count), ignoring case. type
+// names the kind of value for the error message.
+template<typename T, typename NameFunction> static T ParseName(const wstring& name, uint32 count,
+                                                                NameFunction nameFunc, const wchar* type)
+{
+    for(uint32 i = 0; i < count; ++i)
+        if(_wcsicmp(name.c_str(), nameFunc(T(i))) == 0)
+            return T(i);
+
+    throw Exception(L"Unknown " + wstring(type) + L": " + name);
+}
+
+static const wchar* NormalMapName(uint32 normalMap)
+{
+    return NormalMapGUI::Names[normalMap];
+}
+
+static wstring MakeOutputPath(const wstring& outputDir, const wstring& name, const wchar* suffix)
+{
+    CreateDirectoryW(outputDir.c_str(), NULL);
+    return outputDir + L"\\" + name + suffix;
+}
+
+//=================================================================================================
+// Commands
+//=================================================================================================
+
+// Bakes the LEAN/vMF/roughness maps for a normal map on the CPU and writes them as DDS files.
+// If a cache directory is specified the maps are loaded from it when possible, and added to it
+// otherwise. If a BC quality is specified the maps are also block-compressed, which goes through
+// the cache in the same way.
+static void BakeCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const wstring& outputDir = cmdLine.Positional(1);
+
+    BakeSettings settings;
+    settings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.0f));
+    const uint32 numIterations = std::max<uint32>(cmdLine.Option(L"iterations", 1u), 1);
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Print(inputPath + L" (" + ToString(normalMap.Width) + L"x" + ToString(normalMap.Height) + L")");
+
+    const wstring cacheDir = cmdLine.Option(L"cachedir", wstring());
+    MapCache cache;
+    uint64 cacheKey = 0;
+    CachedMaps cachedMaps;
+    bool cacheHit = false;
+    if(cacheDir.length() > 0)
+    {
+        cache.Initialize(cacheDir.c_str());
+        cacheKey = MapCache::ComputeKey(normalMap, settings);
+        cacheHit = cache.Load(cacheKey, cachedMaps);
+    }
+
+    BakedMaps maps;
+    if(cacheHit)
+        cachedMaps.CopyTo(maps);
+    else
+    {
+        MapBaker baker;
+        BakeStats bestStats;
+        for(uint32 i = 0; i < numIterations; ++i)
+        {
+            baker.Bake(normalMap, settings, maps);
+            if(i == 0 || baker.Stats().Seconds < bestStats.Seconds)
+                bestStats = baker.Stats();
+        }
+
+        Print(bestStats.ToString());
+
+        if(cacheDir.length() > 0)
+            cache.Store(cacheKey, maps);
+    }
+
+    const wstring name = GetFileNameWithoutExtension(inputPath.c_str());
+    const wstring qualityName = cmdLine.Option(L"bcquality", wstring());
+    if(qualityName.length() > 0)
+    {
+        const BCQuality quality = ParseName<BCQuality>(qualityName, NumBCQualities, BCQualityName, L"BC quality");
+
+        uint64 compressedKey = 0;
+        CachedCompressedMaps cachedCompressedMaps;
+        bool compressedHit = false;
+        if(cacheDir.length() > 0)
+        {
+            compressedKey = MapCache::ComputeCompressedKey(cacheKey, quality);
+            compressedHit = cache.LoadCompressed(compressedKey, cachedCompressedMaps);
+        }
+
+        CompressedMaps compressedMaps;
+        if(compressedHit)
+            cachedCompressedMaps.CopyTo(compressedMaps);
+        else
+        {
+            MapCompressor compressor;
+            compressor.Compress(maps, quality, compressedMaps);
+            compressor.MeasureError(maps, compressedMaps);
+            Print(compressor.Stats().ToString());
+
+            if(cacheDir.length() > 0)
+                cache.StoreCompressed(compressedKey, compressedMaps);
+        }
+
+        compressedMaps.LEANMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_LEAN_BC.dds").c_str());
+        compressedMaps.VMFDirectionMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_VMFDirection_BC.dds").c_str());
+        compressedMaps.VMFShapeMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_VMFShape_BC.dds").c_str());
+        compressedMaps.RoughnessMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_Roughness_BC.dds").c_str());
+    }
+
+    if(cacheDir.length() > 0)
+        Print(L"Map cache: " + cache.Stats().ToString());
+
+    maps.LEANMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_LEAN.dds").c_str());
+    maps.VMFMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_VMF.dds").c_str());
+    maps.RoughnessMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_Roughness.dds").c_str());
+}
+
+// Bakes the maps tile-by-tile with TiledMapBaker, for normal maps that don't fit in memory.
+// Uncompressed RGBA8 DDS inputs are memory-mapped, while PNG inputs have to be fully decoded.
+static void BakeTiledCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const wstring& outputDir = cmdLine.Positional(1);
+
+    BakeSettings settings;
+    settings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.0f));
+    const uint32 tileSize = cmdLine.Option(L"tilesize", TiledMapBaker::DefaultTileSize);
+
+    MappedNormalMap mappedNormalMap;
+    NormalMapData normalMapData;
+    uint32 width = 0;
+    uint32 height = 0;
+    const uint32* texels = NULL;
+    if(_wcsicmp(GetFileExtension(inputPath.c_str()).c_str(), L"dds") == 0)
+    {
+        mappedNormalMap.Open(inputPath.c_str());
+        width = mappedNormalMap.Width;
+        height = mappedNormalMap.Height;
+        texels = mappedNormalMap.Texels;
+    }
+    else
+    {
+        normalMapData.LoadFromFile(inputPath.c_str());
+        width = normalMapData.Width;
+        height = normalMapData.Height;
+        texels = normalMapData.Texels.data();
+    }
+
+    Print(inputPath + L" (" + ToString(width) + L"x" + ToString(height) + L")");
+
+    const wstring name = GetFileNameWithoutExtension(inputPath.c_str());
+    TiledMapBaker baker;
+    baker.Bake(width, height, texels, settings, tileSize, MakeOutputPath(outputDir, name, L""));
+
+    Print(baker.Stats().ToString());
+    Print(L"Tile size: " + ToString(tileSize) + L", scratch memory: " + ToString(baker.ScratchBytes() / (1024.0 * 1024.0)) + L"MB");
+}
+
+// Compares filtering random footprints with the moment SAT against trilinear filtering of the
+// moment pyramid, in terms of both speed and error
+static void SATBenchCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const uint32 numQueries = std::max<uint32>(cmdLine.Option(L"queries", 1000000u), 1);
+    const uint32 maxFootprint = cmdLine.Option(L"maxfootprint", MomentSAT::DefaultMaxFootprint);
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Print(inputPath + L" (" + ToString(normalMap.Width) + L"x" + ToString(normalMap.Height) + L")");
+
+    MapBaker baker;
+    baker.GenerateMoments(normalMap);
+
+    MomentSATBenchmark benchmark;
+    benchmark.Run(baker.Moments(), numQueries, maxFootprint);
+
+    Print(benchmark.ToString());
+}
+
+// Bakes the full and compact maps for a normal map, writes the compact maps as DDS files, and
+// compares the size and error of both encodings
+static void CompactCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const wstring& outputDir = cmdLine.Positional(1);
+
+    BakeSettings settings;
+    settings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.0f));
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Print(inputPath + L" (" + ToString(normalMap.Width) + L"x" + ToString(normalMap.Height) + L")");
+
+    MapBaker baker;
+    BakedMaps fullMaps;
+    baker.Bake(normalMap, settings, fullMaps);
+
+    CompactMaps compactMaps;
+    baker.ResolveCompactMaps(settings, compactMaps);
+
+    const wstring name = GetFileNameWithoutExtension(inputPath.c_str());
+    compactMaps.LEANBMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_LEANB.dds").c_str());
+    compactMaps.LEANCovarianceMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_LEANCovariance.dds").c_str());
+    compactMaps.VMFMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_VMFCompact.dds").c_str());
+
+    Print(EncodingReport::Measure(baker.Moments(), settings, fullMaps, compactMaps).ToString());
+}
+
+// Bakes the maps for a normal map, and then block-compresses them at every quality level to
+// compare the compression throughput and the error of each level
+static void BCBenchCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const uint32 numIterations = std::max<uint32>(cmdLine.Option(L"iterations", 3u), 1);
+
+    BakeSettings settings;
+    settings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.0f));
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Print(inputPath + L" (" + ToString(normalMap.Width) + L"x" + ToString(normalMap.Height) + L")");
+
+    MapBaker baker;
+    BakedMaps maps;
+    baker.Bake(normalMap, settings, maps);
+
+    CompressionBenchmark benchmark;
+    benchmark.Run(maps, numIterations);
+
+    Print(benchmark.ToString());
+}
+
+// Bakes the LEAN and anisotropic roughness maps for a normal map, and compares the fetch and ALU
+// cost of shading with them
+static void AnisoBenchCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const uint32 numEvaluations = std::max<uint32>(cmdLine.Option(L"evaluations", 1000000u), 1);
+    const float roughness = cmdLine.Option(L"roughness", 0.05f);
+
+    BakeSettings settings;
+    settings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.0f));
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Print(inputPath + L" (" + ToString(normalMap.Width) + L"x" + ToString(normalMap.Height) + L")");
+
+    MapBaker baker;
+    BakedMaps maps;
+    baker.Bake(normalMap, settings, maps);
+
+    BakedTexture anisoRoughnessMap;
+    baker.ResolveAnisoRoughnessMap(anisoRoughnessMap);
+
+    AnisoRoughnessBenchmark benchmark;
+    benchmark.Run(baker.Moments(), settings, maps, anisoRoughnessMap, roughness, numEvaluations);
+
+    Print(benchmark.ToString());
+}
+
+// Fits a mixture of vMF lobes to every texel of a normal map with both a warm and a cold start,
+// reports how quickly each one converges, and writes the warm-started lobes as a DDS file
+static void VMFFitCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const wstring& outputDir = cmdLine.Positional(1);
+
+    VMFFitSettings settings;
+    settings.NumLobes = cmdLine.Option(L"lobes", 2u);
+    settings.MaxIterations = std::max<uint32>(cmdLine.Option(L"maxiterations", settings.MaxIterations), 1);
+    settings.Tolerance = cmdLine.Option(L"tolerance", settings.Tolerance);
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Print(inputPath + L" (" + ToString(normalMap.Width) + L"x" + ToString(normalMap.Height) + L")");
+
+    MapBaker baker;
+    baker.GenerateMoments(normalMap);
+
+    VMFMixtureFitter fitter;
+    BakedTexture vmfMap;
+
+    settings.WarmStart = false;
+    fitter.Fit(baker.Moments(), settings, vmfMap);
+    Print(L"Cold start: " + fitter.Stats().ToString());
+
+    settings.WarmStart = true;
+    fitter.Fit(baker.Moments(), settings, vmfMap);
+    Print(L"Warm start: " + fitter.Stats().ToString());
+
+    const wstring name = GetFileNameWithoutExtension(inputPath.c_str());
+    vmfMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_VMFMixture.dds").c_str());
+}
+
+// Bakes the maps for a normal map, edits random rectangles of it the way a brush stroke would,
+// and compares the time of an incremental rebake with a full bake of the edited map
+static void RebakeBenchCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const uint32 numRects = std::max<uint32>(cmdLine.Option(L"rects", 8u), 1);
+    const uint32 rectSize = std::max<uint32>(cmdLine.Option(L"rectsize", 64u), 1);
+
+    BakeSettings settings;
+    settings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.0f));
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Print(inputPath + L" (" + ToString(normalMap.Width) + L"x" + ToString(normalMap.Height) + L")");
+
+    MapBaker baker;
+    BakedMaps maps;
+    baker.Bake(normalMap, settings, maps);
+
+    // Swapping X and Y changes every texel that isn't symmetric, without making invalid normals
+    std::vector<TexelRect> dirtyRects(numRects);
+    Random random;
+    for(uint32 i = 0; i < numRects; ++i)
+    {
+        const uint32 x = random.NextUInt(normalMap.Width);
+        const uint32 y = random.NextUInt(normalMap.Height);
+        dirtyRects[i] = TexelRect(x, y, x + rectSize, y + rectSize).Clamp(normalMap.Width, normalMap.Height);
+
+        for(uint32 texelY = dirtyRects[i].MinY; texelY < dirtyRects[i].MaxY; ++texelY)
+        {
+            for(uint32 texelX = dirtyRects[i].MinX; texelX < dirtyRects[i].MaxX; ++texelX)
+            {
+                uint32& texel = normalMap.Texels[uint64(texelY) * normalMap.Width + texelX];
+                texel = (texel & 0xFFFF0000) | ((texel & 0xFF) << 8) | ((texel >> 8) & 0xFF);
+            }
+        }
+    }
+
+    baker.Rebake(normalMap, settings, dirtyRects, maps);
+    const BakeStats rebakeStats = baker.Stats();
+
+    MapBaker fullBaker;
+    BakedMaps fullMaps;
+    fullBaker.Bake(normalMap, settings, fullMaps);
+
+    Print(L"Full bake: " + fullBaker.Stats().ToString());
+    Print(L"Rebake of " + ToString(numRects) + L" " + ToString(rectSize) + L"x" + ToString(rectSize) + L" rects: "
+          + rebakeStats.ToString());
+    Print(L"Speedup: " + ToString(fullBaker.Stats().Seconds / std::max(rebakeStats.Seconds, 1e-9)) + L"x");
+    Print(BakeComparison::Compare(maps, fullMaps).ToString());
+}
+
+// Bakes the maps for a normal map with a weighted footprint for every mip level instead of the
+// 2x2 box filter, and writes them as DDS files
+static void FootprintCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const wstring& outputDir = cmdLine.Positional(1);
+
+    BakeSettings settings;
+    settings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.0f));
+
+    FootprintFilterSettings filterSettings;
+    const wstring kernelName = cmdLine.Option(L"kernel", wstring(FootprintKernelName(filterSettings.Kernel)));
+    filterSettings.Kernel = ParseName<FootprintKernel>(kernelName, NumFootprintKernels, FootprintKernelName, L"footprint kernel");
+    filterSettings.Radius = cmdLine.Option(L"radius", filterSettings.Radius);
+    filterSettings.FFTMinTapsPerTexel = cmdLine.Option(L"fftmintaps", filterSettings.FFTMinTapsPerTexel);
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Print(inputPath + L" (" + ToString(normalMap.Width) + L"x" + ToString(normalMap.Height) + L")");
+
+    MapBaker baker;
+    baker.GenerateMoments(normalMap);
+
+    FootprintFilter filter;
+    filter.Filter(baker.Moments(), filterSettings);
+    Print(filter.Stats().ToString());
+
+    BakedMaps maps;
+    baker.ResolveVMFMaps(maps.VMFMap, maps.RoughnessMap);
+    baker.ResolveLEANMap(settings, maps.LEANMap);
+
+    const wstring name = GetFileNameWithoutExtension(inputPath.c_str());
+    maps.LEANMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_LEAN.dds").c_str());
+    maps.VMFMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_VMF.dds").c_str());
+    maps.RoughnessMap.WriteToDDSFile(MakeOutputPath(outputDir, name, L"_Roughness.dds").c_str());
+}
+
+// Times the direct and FFT paths of FootprintFilter against each other for a range of radii
+static void FootprintBenchCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const FootprintKernel kernel = ParseName<FootprintKernel>(cmdLine.Option(L"kernel", wstring(L"Gaussian")),
+                                                              NumFootprintKernels, FootprintKernelName, L"footprint kernel");
+    const float maxRadius = cmdLine.Option(L"maxradius", 4.0f);
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Print(inputPath + L" (" + ToString(normalMap.Width) + L"x" + ToString(normalMap.Height) + L")");
+
+    MapBaker baker;
+    baker.GenerateMoments(normalMap);
+
+    std::vector<float> radii;
+    for(float radius = 0.5f; radius <= maxRadius; radius *= 2.0f)
+        radii.push_back(radius);
+
+    FootprintFilterBenchmark benchmark;
+    benchmark.Run(baker.Moments(), kernel, radii);
+
+    Print(benchmark.ToString());
+}
+
+// Bakes every normal map in a manifest as a pipeline, and prints each map as it completes followed
+// by the throughput and the time spent in each stage. The cache and compression options work the
+// same way as for -bake.
+static void BatchCommand(const CommandLine& cmdLine)
+{
+    BatchManifest manifest;
+    manifest.LoadFromFile(cmdLine.Positional(0).c_str());
+
+    BatchSettings settings;
+    settings.OutputDir = cmdLine.Positional(1);
+    settings.Bake.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.0f));
+    settings.CacheDir = cmdLine.Option(L"cachedir", wstring());
+    settings.NumThreads = cmdLine.Option(L"threads", 0u);
+    settings.QueueDepth = cmdLine.Option(L"queuedepth", 0u);
+
+    const wstring qualityName = cmdLine.Option(L"bcquality", wstring());
+    if(qualityName.length() > 0)
+    {
+        settings.Compress = true;
+        settings.Quality = ParseName<BCQuality>(qualityName, NumBCQualities, BCQualityName, L"BC quality");
+    }
+
+    Print(ToString(manifest.Entries.size()) + L" maps in " + cmdLine.Positional(0));
+
+    const uint64 numMaps = manifest.Entries.size();
+    BatchBaker baker;
+    baker.Run(manifest, settings, [numMaps](const BatchMapResult& result)
+    {
+        wstring text = L"[" + ToString(result.NumCompleted) + L"/" + ToString(numMaps) + L"] " + result.Path;
+        if(result.Failed)
+            text += L": failed, " + result.Error;
+        else
+        {
+            text += L" (" + ToString(result.Width) + L"x" + ToString(result.Height) + L")";
+            if(result.CacheHit)
+                text += L", bake skipped";
+            if(result.CompressedCacheHit)
+                text += L", compression skipped";
+            double seconds = 0.0;
+            for(uint32 i = 0; i < NumBatchStages; ++i)
+                seconds += result.StageSeconds[i];
+            text += L", " + ToString(seconds * 1000.0) + L"ms";
+        }
+        Print(text);
+    });
+
+    Print(baker.Stats().ToString());
+}
+
+// Computes the per-vertex curvature of a tessellated sphere, single-threaded and on the thread
+// pool, and checks it against the exact curvature of 1 / radius
+static void CurvatureBenchCommand(const CommandLine& cmdLine)
+{
+    const float radius = std::max(cmdLine.Option(L"radius", 1.0f), 0.0001f);
+    const uint32 numSegments = std::max<uint32>(cmdLine.Option(L"segments", 1024u), 3);
+    const uint32 numIterations = std::max<uint32>(cmdLine.Option(L"iterations", 4u), 1);
+    const uint32 numRings = std::max<uint32>(numSegments / 2, 2);
+
+    // Position + normal, with the seam and poles duplicated like an exported mesh would have them
+    struct SphereVertex
+    {
+        Float3 Position;
+        Float3 Normal;
+    };
+
+    std::vector<SphereVertex> vertices;
+    vertices.reserve((numRings + 1) * (numSegments + 1));
+    for(uint32 ring = 0; ring <= numRings; ++ring)
+    {
+        const float theta = Pi * ring / numRings;
+        for(uint32 segment = 0; segment <= numSegments; ++segment)
+        {
+            const float phi = Pi2 * segment / numSegments;
+            SphereVertex vertex;
+            vertex.Normal = Float3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            vertex.Position = vertex.Normal * radius;
+            vertices.push_back(vertex);
+        }
+    }
+
+    std::vector<uint32> indices;
+    indices.reserve(numRings * numSegments * 6);
+    for(uint32 ring = 0; ring < numRings; ++ring)
+    {
+        for(uint32 segment = 0; segment < numSegments; ++segment)
+        {
+            const uint32 v0 = ring * (numSegments + 1) + segment;
+            const uint32 v1 = v0 + numSegments + 1;
+            indices.push_back(v0);
+            indices.push_back(v1);
+            indices.push_back(v0 + 1);
+            indices.push_back(v0 + 1);
+            indices.push_back(v1);
+            indices.push_back(v1 + 1);
+        }
+    }
+
+    const uint32 numVertices = static_cast<uint32>(vertices.size());
+    const uint32 numIndices = static_cast<uint32>(indices.size());
+    Print(L"Sphere with " + ToString(numVertices) + L" vertices and " + ToString(numIndices / 3) + L" triangles");
+
+    std::vector<float> curvatures;
+    auto runBenchmark = [&]()
+    {
+        Timer timer;
+        for(uint32 i = 0; i < numIterations; ++i)
+            ComputeVertexCurvature(reinterpret_cast<const uint8*>(vertices.data()), sizeof(SphereVertex), numVertices,
+                                   0, sizeof(Float3), reinterpret_cast<const uint8*>(indices.data()), sizeof(uint32),
+                                   numIndices, curvatures);
+        timer.Update();
+        return timer.DeltaSecondsD() / numIterations;
+    };
+
+    const uint32 numThreads = ThreadPool::GlobalPool.NumThreads();
+    const double threadedSeconds = runBenchmark();
+
+    ThreadPool::GlobalPool.Initialize(1);
+    const double serialSeconds = runBenchmark();
+    ThreadPool::GlobalPool.Initialize(numThreads);
+
+    const float expected = 1.0f / radius;
+    double errorSum = 0.0;
+    float maxError = 0.0f;
+    for(uint32 i = 0; i < numVertices; ++i)
+    {
+        const float error = std::abs(curvatures[i] - expected) / expected;
+        errorSum += error;
+        maxError = std::max(maxError, error);
+    }
+
+    Print(L"Serial: " + ToString(serialSeconds * 1000.0) + L"ms ("
+          + ToString(numVertices / std::max(serialSeconds, 1e-9) / 1000000.0) + L" MVerts/s)");
+    Print(ToString(numThreads) + L" threads: " + ToString(threadedSeconds * 1000.0) + L"ms ("
+          + ToString(numVertices / std::max(threadedSeconds, 1e-9) / 1000000.0) + L" MVerts/s, "
+          + ToString(serialSeconds / std::max(threadedSeconds, 1e-9)) + L"x)");
+    Print(L"Relative error: " + ToString(errorSum / numVertices) + L" avg, " + ToString(maxError) + L" max");
+}
+
+// The ReferenceSettings options shared by the commands that use ReferenceRenderer, except for
+// the shading mode
+static ReferenceSettings ParseReferenceSettings(const CommandLine& cmdLine)
+{
+    ReferenceSettings settings;
+    settings.BRDF = ParseName<SpecularBRDF>(cmdLine.Option(L"brdf", wstring(L"GGX")),
+                                            NumSpecularBRDFs, SpecularBRDFName, L"specular BRDF");
+    settings.GeometricAA = ParseName<GeometricAAMode>(cmdLine.Option(L"geometricaa", wstring(L"None")),
+                                                      NumGeometricAAModes, GeometricAAModeName, L"geometric AA mode");
+    settings.Roughness = cmdLine.Option(L"roughness", 0.05f);
+    settings.EnableDiffuse = cmdLine.Option(L"diffuse", 1u) != 0;
+    settings.EnableSpecular = cmdLine.Option(L"specular", 1u) != 0;
+    settings.VMFDiffuseAA = cmdLine.Option(L"vmfdiffuseaa", 0u) != 0;
+    settings.Supersampling = ParseName<SupersamplingMode>(cmdLine.Option(L"ssaa", wstring(L"None")),
+                                                          NumSupersamplingModes, SupersamplingModeName, L"supersampling mode");
+    settings.SampleRadius = cmdLine.Option(L"sampleradius", settings.SampleRadius);
+    settings.UniformSamples = std::max<uint32>(cmdLine.Option(L"sssamples", settings.UniformSamples), 1);
+    settings.MinSamples = std::max<uint32>(cmdLine.Option(L"minsamples", settings.MinSamples), 1);
+    settings.MaxSamples = std::max<uint32>(cmdLine.Option(L"maxsamples", settings.MaxSamples), settings.MinSamples);
+    settings.TargetError = cmdLine.Option(L"targeterror", settings.TargetError);
+    settings.Sequence = ParseName<SampleSequence>(cmdLine.Option(L"sequence", wstring(L"Sobol")),
+                                                  NumSampleSequences, SampleSequenceName, L"sample sequence");
+    settings.LightingTextureSize = cmdLine.Option(L"lightingsize", settings.LightingTextureSize);
+
+    return settings;
+}
+
+// The same scene as SpecularAA::Initialize
+static void InitReferenceScene(ReferenceScene& scene)
+{
+    Model model;
+    model.GeneratePlaneScene(NULL, Float2(5.0f, 5.0f), Float3(), Quaternion());
+    scene.Initialize(model, Float4x4(XMMatrixRotationY(XM_PI)));
+}
+
+// The camera that the app starts with, or another preset with -camera, which can be moved with
+// -camx/-camy/-camz/-pitch/-yaw
+static void SetReferenceCamera(const CommandLine& cmdLine, FirstPersonCamera& camera)
+{
+    ApplyCameraPreset(ParseName<CameraPreset>(cmdLine.Option(L"camera", wstring(L"Default")),
+                                              NumCameraPresets, CameraPresetName, L"camera preset"), camera);
+
+    const Float3 position = camera.Position();
+    camera.SetPosition(Float3(cmdLine.Option(L"camx", position.x), cmdLine.Option(L"camy", position.y),
+                              cmdLine.Option(L"camz", position.z)));
+    camera.SetXRotation(cmdLine.Option(L"pitch", camera.XRotation()));
+    camera.SetYRotation(cmdLine.Option(L"yaw", camera.YRotation()));
+}
+
+// Renders the plane scene from the app on the CPU with ReferenceRenderer, and writes the result
+// as a float DDS file, or as a PFM file or tiled image (.pfm or .tfi) that's written as the tiles
+// finish. "-half 1" stores the tiled image as half floats. The camera, lights, and settings
+// default to the ones the app starts with. With "-mode all" every shading mode is rendered, and
+// the name of the mode is added to the output path.
+static void RenderCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const wstring& outputPath = cmdLine.Positional(1);
+    const uint32 width = std::max<uint32>(cmdLine.Option(L"width", 1280u), 1);
+    const uint32 height = std::max<uint32>(cmdLine.Option(L"height", 720u), 1);
+    const uint32 numFrames = std::max<uint32>(cmdLine.Option(L"frames", 1u), 1);
+
+    BakeSettings bakeSettings;
+    bakeSettings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.5f));
+
+    ReferenceSettings settings = ParseReferenceSettings(cmdLine);
+
+    const wstring modeName = cmdLine.Option(L"mode", wstring(L"None"));
+    std::vector<ShadingMode> modes;
+    if(_wcsicmp(modeName.c_str(), L"all") == 0)
+    {
+        for(uint32 i = 0; i < NumShadingModes; ++i)
+            modes.push_back(ShadingMode(i));
+    }
+    else
+        modes.push_back(ParseName<ShadingMode>(modeName, NumShadingModes, ShadingModeName, L"shading mode"));
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Timer timer;
+    ReferenceRenderer renderer;
+    renderer.SetNormalMap(normalMap, bakeSettings);
+    timer.Update();
+    Print(L"Baked the maps for " + inputPath + L" in " + ToString(timer.DeltaSecondsD() * 1000.0) + L"ms");
+
+    ReferenceScene scene;
+    InitReferenceScene(scene);
+
+    FirstPersonCamera camera(float(width) / height, Pi_4 * 0.75f, 0.01f, 100.0f);
+    SetReferenceCamera(cmdLine, camera);
+
+    // PFM files and tiled images are written a tile at a time as they're rendered
+    const bool streamed = IsFloatImageFile(outputPath.c_str());
+    const TiledImageFormat tiledFormat = cmdLine.Option(L"half", 0u) != 0 ? TiledImageHalf : TiledImageFloat;
+
+    HDRImage image;
+    if(streamed == false)
+        image.Initialize(width, height);
+
+    for(uint64 modeIdx = 0; modeIdx < modes.size(); ++modeIdx)
+    {
+        settings.Mode = modes[modeIdx];
+
+        wstring path = outputPath;
+        if(modes.size() > 1)
+        {
+            const uint64 extension = path.find_last_of(L'.');
+            const wstring suffix = wstring(L"_") + ShadingModeName(settings.Mode);
+            path = extension == wstring::npos ? path + suffix : path.substr(0, extension) + suffix + path.substr(extension);
+        }
+
+        FloatImageFileWriter writer;
+        if(streamed)
+            writer.Create(path.c_str(), width, height, tiledFormat);
+
+        double totalSeconds = 0.0;
+        for(uint32 frame = 0; frame < numFrames; ++frame)
+        {
+            if(streamed)
+                renderer.Render(scene, camera, settings, width, height, writer);
+            else
+                renderer.Render(scene, camera, settings, image);
+            totalSeconds += renderer.Stats().Seconds;
+        }
+
+        if(streamed)
+            writer.Close();
+        else
+            image.WriteToDDSFile(path.c_str());
+
+        Print(wstring(ShadingModeName(settings.Mode)) + L": " + renderer.Stats().ToString());
+        Print(L"  " + ToString(totalSeconds * 1000.0 / numFrames) + L"ms per frame over " + ToString(numFrames)
+              + L" frames, wrote " + path);
+    }
+}
+
+// Measures how fast uniform supersampling converges with each sample sequence. A reference is
+// rendered with -refsamples^2 Sobol samples under a different scramble, so that it shares no
+// samples with the sequences being measured. Then every sequence is rendered with 1, 4, 16, ...
+// -sssamples^2 samples per pixel. The RMS error of each image is written to a CSV file, with one
+// row per sequence and sample count, ready for plotting.
+static void SamplingBenchCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const wstring& outputPath = cmdLine.Positional(1);
+    const uint32 width = std::max<uint32>(cmdLine.Option(L"width", 320u), 1);
+    const uint32 height = std::max<uint32>(cmdLine.Option(L"height", 180u), 1);
+    const uint32 maxSamples = std::max<uint32>(cmdLine.Option(L"sssamples", 32u), 1);
+    const uint32 refSamples = std::max<uint32>(cmdLine.Option(L"refsamples", maxSamples * 2), 1);
+
+    BakeSettings bakeSettings;
+    bakeSettings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.5f));
+
+    ReferenceSettings settings = ParseReferenceSettings(cmdLine);
+    settings.Mode = ParseName<ShadingMode>(cmdLine.Option(L"mode", wstring(L"None")),
+                                           NumShadingModes, ShadingModeName, L"shading mode");
+    settings.Supersampling = SupersamplingUniform;
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    ReferenceRenderer renderer;
+    renderer.SetNormalMap(normalMap, bakeSettings);
+
+    ReferenceScene scene;
+    InitReferenceScene(scene);
+
+    FirstPersonCamera camera(float(width) / height, Pi_4 * 0.75f, 0.01f, 100.0f);
+    SetReferenceCamera(cmdLine, camera);
+
+    HDRImage reference;
+    reference.Initialize(width, height);
+    settings.Sequence = SampleSequenceSobol;
+    settings.SequenceSeed = 1;
+    settings.UniformSamples = refSamples;
+    renderer.Render(scene, camera, settings, reference);
+    Print(L"Reference: " + renderer.Stats().ToString());
+
+    double referenceSum = 0.0;
+    for(uint64 i = 0; i < reference.Pixels.size(); ++i)
+        referenceSum += reference.Pixels[i].x + reference.Pixels[i].y + reference.Pixels[i].z;
+    const double referenceMean = std::max(referenceSum / (reference.Pixels.size() * 3.0), 1e-9);
+
+    HDRImage image;
+    image.Initialize(width, height);
+    settings.SequenceSeed = 0;
+
+    std::string csv = "sequence,samples,rmse,relative_rmse,ms\n";
+    for(uint32 sequence = 0; sequence < NumSampleSequences; ++sequence)
+    {
+        settings.Sequence = SampleSequence(sequence);
+        for(uint32 numSamples = 1; numSamples <= maxSamples; numSamples *= 2)
+        {
+            settings.UniformSamples = numSamples;
+            renderer.Render(scene, camera, settings, image);
+
+            double errorSum = 0.0;
+            for(uint64 i = 0; i < image.Pixels.size(); ++i)
+            {
+                const Float4& p = image.Pixels[i];
+                const Float4& r = reference.Pixels[i];
+                errorSum += (p.x - r.x) * (p.x - r.x) + (p.y - r.y) * (p.y - r.y) + (p.z - r.z) * (p.z - r.z);
+            }
+
+            const double rmse = std::sqrt(errorSum / (image.Pixels.size() * 3.0));
+            const double ms = renderer.Stats().Seconds * 1000.0;
+            const wstring name = SampleSequenceName(settings.Sequence);
+            Print(name + L", " + ToString(numSamples * numSamples) + L" samples: RMSE " + ToString(rmse)
+                  + L" (" + ToString(rmse / referenceMean) + L" relative), " + ToString(ms) + L"ms");
+
+            csv += std::string(name.begin(), name.end()) + "," + ToAnsiString(numSamples * numSamples) + "," + ToAnsiString(rmse);
+            csv += "," + ToAnsiString(rmse / referenceMean) + "," + ToAnsiString(ms) + "\n";
+        }
+    }
+
+    WriteStringAsFile(outputPath.c_str(), csv);
+    Print(L"Wrote " + outputPath);
+}
+
+// Renders every combination of specular AA mode, BRDF, and supersampling mode from the GUI at
+// each camera preset, for every normal map or just the one picked with -normalmap. The bake time,
+// shading time, and error against a supersampled reference of each combination are written to a
+// CSV file, and the averages of each mode are printed at the end.
+static void BenchMatrixCommand(const CommandLine& cmdLine)
+{
+    const wstring& outputPath = cmdLine.Positional(0);
+
+    SpecularAABenchmarkSettings settings;
+    settings.Shading = ParseReferenceSettings(cmdLine);
+    settings.Bake.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.5f));
+    settings.TextureDir = cmdLine.Option(L"texturedir", settings.TextureDir);
+    if(settings.TextureDir.length() > 0 && settings.TextureDir.back() != L'\\' && settings.TextureDir.back() != L'/')
+        settings.TextureDir += L"\\";
+    settings.Width = std::max<uint32>(cmdLine.Option(L"width", settings.Width), 1);
+    settings.Height = std::max<uint32>(cmdLine.Option(L"height", settings.Height), 1);
+    settings.ShaderSSSamples = std::max<uint32>(cmdLine.Option(L"sssamples", settings.ShaderSSSamples), 1);
+    settings.ReferenceSamples = std::max<uint32>(cmdLine.Option(L"refsamples", settings.ReferenceSamples), 1);
+
+    std::vector<uint32> normalMaps;
+    const wstring normalMapName = cmdLine.Option(L"normalmap", wstring(L"all"));
+    if(_wcsicmp(normalMapName.c_str(), L"all") == 0)
+    {
+        for(uint32 i = 0; i < NormalMapGUI::NumValues; ++i)
+            normalMaps.push_back(i);
+    }
+    else
+        normalMaps.push_back(ParseName<uint32>(normalMapName, NormalMapGUI::NumValues, NormalMapName, L"normal map"));
+
+    ReferenceScene scene;
+    InitReferenceScene(scene);
+
+    Timer timer;
+    SpecularAABenchmark benchmark;
+    for(uint64 i = 0; i < normalMaps.size(); ++i)
+    {
+        benchmark.Run(settings, scene, normalMaps[i]);
+        Print(SpecularAABenchmark::ToString(benchmark.NormalMaps().back()));
+    }
+
+    timer.Update();
+    Print(benchmark.ToString());
+    Print(ToString(benchmark.Results().size()) + L" combinations on " + ToString(ThreadPool::GlobalPool.NumThreads())
+          + L" threads in " + ToString(timer.ElapsedSecondsD()) + L"s");
+
+    WriteStringAsFile(outputPath.c_str(), benchmark.ToCSV());
+    Print(L"Wrote " + outputPath);
+}
+
+// Moves the camera away from a preset for -frames frames at -fps, and renders every frame with
+// each shading mode, ShaderSSAA, texture-space lighting, and a supersampled reference. The
+// temporal variance and flicker score of each one is printed and written to a CSV file. With
+// -mapdir the per-pixel variance, flicker, mean, and temporal error of each one are written there
+// as DDS files. "-refsamples 0" skips the reference and the temporal error. "-path file" follows
+// a camera path recorded in the app instead, leaving out the settings that were recorded with it.
+static void ShimmerCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const wstring& outputPath = cmdLine.Positional(1);
+    const uint32 numFrames = std::max<uint32>(cmdLine.Option(L"frames", 60u), 3);
+    const float fps = std::max(cmdLine.Option(L"fps", 60.0f), 1.0f);
+    const CameraPreset preset = ParseName<CameraPreset>(cmdLine.Option(L"camera", wstring(L"Default")),
+                                                        NumCameraPresets, CameraPresetName, L"camera preset");
+    const CameraMotion motion = ParseName<CameraMotion>(cmdLine.Option(L"motion", wstring(L"Strafe")),
+                                                        NumCameraMotions, CameraMotionName, L"camera motion");
+    const float speed = cmdLine.Option(L"speed", motion == CameraMotionTurn ? 0.1f : 1.25f);
+    const wstring mapDir = cmdLine.Option(L"mapdir", wstring());
+    const wstring pathFile = cmdLine.Option(L"path", wstring());
+
+    TemporalShimmerSettings settings;
+    settings.Shading = ParseReferenceSettings(cmdLine);
+    settings.Width = std::max<uint32>(cmdLine.Option(L"width", settings.Width), 1);
+    settings.Height = std::max<uint32>(cmdLine.Option(L"height", settings.Height), 1);
+    settings.ShaderSSSamples = std::max<uint32>(cmdLine.Option(L"sssamples", settings.ShaderSSSamples), 1);
+    settings.ReferenceSamples = cmdLine.Option(L"refsamples", settings.ReferenceSamples);
+    settings.Exposure = cmdLine.Option(L"exposure", settings.Exposure);
+
+    BakeSettings bakeSettings;
+    bakeSettings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.5f));
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    ReferenceRenderer renderer;
+    renderer.SetNormalMap(normalMap, bakeSettings);
+
+    ReferenceScene scene;
+    InitReferenceScene(scene);
+
+    CameraPath path;
+    if(pathFile.length() > 0)
+    {
+        path.LoadFromFile(pathFile.c_str());
+        if(path.NumFrames() < 3)
+            throw Exception(L"Not enough frames in " + pathFile);
+        Print(pathFile + L", " + ToString(path.NumFrames()) + L" frames at " + ToString(1.0f / path.TimeStep()) + L" fps");
+    }
+    else
+    {
+        path.Generate(preset, motion, speed, numFrames, 1.0f / fps);
+        Print(wstring(CameraMotionName(motion)) + L" from " + CameraPresetName(preset) + L" at " + ToString(speed)
+              + L"/s, " + ToString(numFrames) + L" frames at " + ToString(fps) + L" fps");
+    }
+
+    TemporalShimmerBenchmark benchmark;
+    benchmark.Run(settings, renderer, scene, path);
+    Print(benchmark.ToString());
+    Print(ToString(benchmark.Results().size() * path.NumFrames()) + L" frames on " + ToString(ThreadPool::GlobalPool.NumThreads())
+          + L" threads in " + ToString(benchmark.Seconds()) + L"s");
+
+    WriteStringAsFile(outputPath.c_str(), benchmark.ToCSV());
+    Print(L"Wrote " + outputPath);
+
+    if(mapDir.length() > 0)
+    {
+        for(uint64 i = 0; i < benchmark.Results().size(); ++i)
+        {
+            const TemporalShimmerBenchmark::Result& result = benchmark.Results()[i];
+            const wstring mapPath = MakeOutputPath(mapDir, TemporalShimmerBenchmark::Name(result), L".dds");
+            result.Map.WriteToDDSFile(mapPath.c_str());
+        }
+
+        Print(L"Wrote the variance maps to " + mapDir);
+    }
+}
+
+// The settings that a camera path records, on the CPU
+struct PathSettings
+{
+    ReferenceSettings Shading;
+    uint32 NormalMap;                   // NormalMapGUI::Values
+    float LEANScaleFactor;              // Slider value, the power of 10 of BakeSettings::ScaleFactor
+
+    PathSettings() : NormalMap(NormalMapGUI::Hex), LEANScaleFactor(0.5f)
+    {
+        Shading.UniformSamples = 1;
+    }
+};
+
+static void ApplyPathSetting(const CameraPathSettingChange& change, PathSettings& settings)
+{
+    const uint32 value = static_cast<uint32>(change.Value);
+    ReferenceSettings& shading = settings.Shading;
+    switch(change.Setting)
+    {
+        case CameraPathSettingSpecularAAMode: shading.Mode = ShadingModeFromGUI(value); break;
+        case CameraPathSettingNormalMap: settings.NormalMap = std::min<uint32>(value, NormalMapGUI::NumValues - 1); break;
+        case CameraPathSettingSuperSamplingMode: shading.Supersampling = SupersamplingModeFromGUI(value); break;
+        case CameraPathSettingSpecularBRDF: shading.BRDF = SpecularBRDFFromGUI(value); break;
+        case CameraPathSettingGeometricAAMode: shading.GeometricAA = GeometricAAMode(std::min<uint32>(value, NumGeometricAAModes - 1)); break;
+        case CameraPathSettingRoughness: shading.Roughness = change.Value; break;
+        case CameraPathSettingShaderSSSamples: shading.UniformSamples = std::max<uint32>(value, 1); break;
+        case CameraPathSettingSampleRadius: shading.SampleRadius = change.Value; break;
+        case CameraPathSettingLEANScaleFactor: settings.LEANScaleFactor = change.Value; break;
+        case CameraPathSettingEnableDiffuse: shading.EnableDiffuse = value != 0; break;
+        case CameraPathSettingEnableSpecular: shading.EnableSpecular = value != 0; break;
+        case CameraPathSettingVMFDiffuseAA: shading.VMFDiffuseAA = value != 0; break;
+    }
+}
+
+// Replays a camera path recorded in the app on the CPU, one frame per timestep of the recording,
+// with the settings that were changed on each frame. Every frame is written to the output
+// directory as a DDS file, or with "-format pfm|tfi" as a PFM file or tiled image that's written
+// as its tiles finish. Runs of frames with the same normal map and LEAN scale share one bake,
+// and their frames are rendered in parallel with one frame per task.
+static void RenderPathCommand(const CommandLine& cmdLine)
+{
+    const wstring& pathFile = cmdLine.Positional(0);
+    const wstring& outputDir = cmdLine.Positional(1);
+    const uint32 width = std::max<uint32>(cmdLine.Option(L"width", 640u), 1);
+    const uint32 height = std::max<uint32>(cmdLine.Option(L"height", 360u), 1);
+    const wstring format = cmdLine.Option(L"format", wstring(L"dds"));
+    const TiledImageFormat tiledFormat = cmdLine.Option(L"half", 0u) != 0 ? TiledImageHalf : TiledImageFloat;
+    wstring textureDir = cmdLine.Option(L"texturedir", wstring(L"..\\Content\\Textures\\"));
+    if(textureDir.length() > 0 && textureDir.back() != L'\\' && textureDir.back() != L'/')
+        textureDir += L"\\";
+
+    const wchar* extension = NULL;
+    if(_wcsicmp(format.c_str(), L"dds") == 0)
+        extension = L".dds";
+    else if(_wcsicmp(format.c_str(), L"pfm") == 0)
+        extension = L".pfm";
+    else if(_wcsicmp(format.c_str(), L"tfi") == 0)
+        extension = L".tfi";
+    else
+        throw Exception(L"Unknown image format: " + format);
+
+    CameraPath path;
+    path.LoadFromFile(pathFile.c_str());
+    if(path.NumFrames() == 0)
+        throw Exception(L"No frames in " + pathFile);
+
+    const uint32 firstFrame = std::min(cmdLine.Option(L"first", 0u), path.NumFrames() - 1);
+    const uint32 numFrames = std::min(cmdLine.Option(L"count", path.NumFrames()), path.NumFrames() - firstFrame);
+    Print(pathFile + L", frames " + ToString(firstFrame) + L" to " + ToString(firstFrame + numFrames - 1)
+          + L" at " + ToString(1.0f / path.TimeStep()) + L" fps");
+
+    // The settings of each frame come from the changes of every frame up to it
+    std::vector<PathSettings> frameSettings(numFrames);
+    PathSettings settings;
+    for(uint32 frameIdx = 0; frameIdx < firstFrame + numFrames; ++frameIdx)
+    {
+        const CameraPathFrame& frame = path.Frame(frameIdx);
+        for(uint32 i = 0; i < frame.NumSettingChanges; ++i)
+            ApplyPathSetting(path.SettingChange(frame.FirstSettingChange + i), settings);
+        if(frameIdx >= firstFrame)
+            frameSettings[frameIdx - firstFrame] = settings;
+    }
+
+    ReferenceScene scene;
+    InitReferenceScene(scene);
+
+    Timer timer;
+    uint32 runStart = 0;
+    while(runStart < numFrames)
+    {
+        const PathSettings& runSettings = frameSettings[runStart];
+        uint32 runEnd = runStart + 1;
+        while(runEnd < numFrames && frameSettings[runEnd].NormalMap == runSettings.NormalMap
+              && frameSettings[runEnd].LEANScaleFactor == runSettings.LEANScaleFactor)
+            ++runEnd;
+
+        const wstring normalMapPath = textureDir + NormalMapGUI::Names[runSettings.NormalMap] + L".png";
+        NormalMapData normalMap;
+        normalMap.LoadFromFile(normalMapPath.c_str());
+
+        BakeSettings bakeSettings;
+        bakeSettings.ScaleFactor = std::pow(10.0f, runSettings.LEANScaleFactor);
+
+        ReferenceRenderer renderer;
+        renderer.SetNormalMap(normalMap, bakeSettings);
+
+        std::vector<ReferenceStats> frameStats(runEnd - runStart);
+        ThreadPool::GlobalPool.ParallelFor(runEnd - runStart, [&](uint32 idx, uint32 threadIdx)
+        {
+            const uint32 frameIdx = firstFrame + runStart + idx;
+            FirstPersonCamera camera(float(width) / height, Pi_4 * 0.75f, 0.01f, 100.0f);
+            path.ApplyFrame(frameIdx, camera);
+
+            wchar name[32];
+            swprintf_s(name, L"frame_%05u", frameIdx);
+            const wstring framePath = MakeOutputPath(outputDir, name, extension);
+            const ReferenceSettings& shading = frameSettings[runStart + idx].Shading;
+
+            if(extension == wstring(L".dds"))
+            {
+                HDRImage image;
+                image.Initialize(width, height);
+                renderer.Render(scene, camera, shading, image, frameStats[idx]);
+                image.WriteToDDSFile(framePath.c_str());
+            }
+            else
+            {
+                FloatImageFileWriter writer;
+                writer.Create(framePath.c_str(), width, height, tiledFormat);
+                renderer.Render(scene, camera, shading, width, height, writer, frameStats[idx]);
+                writer.Close();
+            }
+        });
+
+        double renderSeconds = 0.0;
+        for(uint64 i = 0; i < frameStats.size(); ++i)
+            renderSeconds += frameStats[i].Seconds;
+
+        Print(L"Frames " + ToString(firstFrame + runStart) + L" to " + ToString(firstFrame + runEnd - 1) + L" with "
+              + NormalMapGUI::Names[runSettings.NormalMap] + L": " + ToString(renderSeconds * 1000.0 / frameStats.size())
+              + L"ms per frame on one thread");
+
+        runStart = runEnd;
+    }
+
+    timer.Update();
+    Print(ToString(numFrames) + L" frames on " + ToString(ThreadPool::GlobalPool.NumThreads()) + L" threads in "
+          + ToString(timer.ElapsedSecondsD()) + L"s, wrote them to " + outputDir);
+}
+
+// Compares two PNG screenshots, PFM files, or tiled images with ImageMetrics, and optionally
+// writes the delta E and SSIM maps. Float images are tone mapped with -exposure first.
+static void CompareCommand(const CommandLine& cmdLine)
+{
+    const wstring& imagePath = cmdLine.Positional(0);
+    const wstring& referencePath = cmdLine.Positional(1);
+    const wstring errorMapPath = cmdLine.Option(L"errormap", wstring());
+    const wstring ssimMapPath = cmdLine.Option(L"ssimmap", wstring());
+    const float maxError = cmdLine.Option(L"maxerror", 10.0f);
+
+    ImageMetricsSettings settings;
+    settings.SSIMWindow = std::max<uint32>(cmdLine.Option(L"window", settings.SSIMWindow), 1);
+    settings.Exposure = cmdLine.Option(L"exposure", settings.Exposure);
+
+    LDRImage ldrImages[2];
+    HDRImage hdrImages[2];
+    bool isFloat[2] = { false, false };
+    const wstring* paths[2] = { &imagePath, &referencePath };
+    for(uint32 i = 0; i < 2; ++i)
+    {
+        isFloat[i] = IsFloatImageFile(paths[i]->c_str());
+        if(isFloat[i])
+            hdrImages[i].LoadFromFile(paths[i]->c_str());
+        else
+            ldrImages[i].LoadFromFile(paths[i]->c_str());
+    }
+
+    const ImageView image = isFloat[0] ? ImageView(hdrImages[0]) : ImageView(ldrImages[0]);
+    const ImageView reference = isFloat[1] ? ImageView(hdrImages[1]) : ImageView(ldrImages[1]);
+
+    ImageMetrics metrics;
+    metrics.Compute(image, reference, settings);
+    Print(metrics.ToString());
+
+    if(errorMapPath.length() > 0)
+    {
+        metrics.WriteErrorMap(errorMapPath.c_str(), maxError);
+        Print(L"Wrote " + errorMapPath);
+    }
+
+    if(ssimMapPath.length() > 0)
+    {
+        metrics.WriteSSIMMap(ssimMapPath.c_str());
+        Print(L"Wrote " + ssimMapPath);
+    }
+}
+
+// Checks the SIMD texture sampler against ReferenceTexture on the baked maps, and reports how
+// many samples per second each filter takes
+static void SamplerBenchCommand(const CommandLine& cmdLine)
+{
+    const wstring& inputPath = cmdLine.Positional(0);
+    const uint32 numSamples = std::max<uint32>(cmdLine.Option(L"samples", 1000000u), 1);
+    const float tolerance = cmdLine.Option(L"tolerance", 0.001f);
+
+    BakeSettings settings;
+    settings.ScaleFactor = std::pow(10.0f, cmdLine.Option(L"leanscale", 0.0f));
+
+    NormalMapData normalMap;
+    normalMap.LoadFromFile(inputPath.c_str());
+
+    Print(inputPath + L" (" + ToString(normalMap.Width) + L"x" + ToString(normalMap.Height) + L")");
+
+    MapBaker baker;
+    BakedMaps maps;
+    baker.Bake(normalMap, settings, maps);
+
+    TextureSamplerBenchmark benchmark;
+    benchmark.Run(maps, numSamples);
+    Print(benchmark.ToString());
+
+    if(benchmark.Passed(tolerance) == false)
+        throw Exception(L"The SIMD sampler doesn't match ReferenceTexture within a relative error of " + ToString(tolerance));
+}
+
+static void BRDFBenchCommand(const CommandLine& cmdLine)
+{
+    const uint32 numEvaluations = std::max<uint32>(cmdLine.Option(L"evaluations", 1000000u), 1);
+    const uint32 numIterations = std::max<uint32>(cmdLine.Option(L"iterations", 8u), 1);
+    const float tolerance = cmdLine.Option(L"tolerance", 0.001f);
+
+    BRDFKernelBenchmark benchmark;
+    benchmark.Run(numEvaluations, numIterations);
+    Print(benchmark.ToString());
+
+    if(benchmark.Passed(tolerance) == false)
+        throw Exception(L"The BRDF kernels don't match MeshShading within a relative error of " + ToString(tolerance));
+}
+
+static void RandomBenchCommand(const CommandLine& cmdLine)
+{
+    const uint64 numNumbers = std::max<uint32>(cmdLine.Option(L"count", 64u * 1024 * 1024), 1);
+
+    RandomBenchmark benchmark;
+    benchmark.Run(numNumbers);
+    Print(benchmark.ToString());
+
+    if(benchmark.Passed() == false)
+        throw Exception(L"The random number generator isn't deterministic");
+}
+
+static const Command Commands[] =
+{
+    { L"-bake", L"-bake <normalmap.png> <outputdir> [-leanscale s] [-iterations n] [-threads n] [-cachedir dir] [-bcquality fast|normal|high]", 2, BakeCommand },
+    { L"-baketiled", L"-baketiled <normalmap.dds|png> <outputdir> [-leanscale s] [-tilesize n (>= 64)] [-threads n]", 2, BakeTiledCommand },
+    { L"-compact", L"-compact <normalmap.png> <outputdir> [-leanscale s] [-threads n]", 2, CompactCommand },
+    { L"-satbench", L"-satbench <normalmap.png> [-queries n] [-maxfootprint n] [-threads n]", 1, SATBenchCommand },
+    { L"-bcbench", L"-bcbench <normalmap.png> [-leanscale s] [-iterations n] [-threads n]", 1, BCBenchCommand },
+    { L"-anisobench", L"-anisobench <normalmap.png> [-leanscale s] [-roughness m] [-evaluations n] [-threads n]", 1, AnisoBenchCommand },
+    { L"-vmffit", L"-vmffit <normalmap.png> <outputdir> [-lobes n] [-maxiterations n] [-tolerance t] [-threads n]", 2, VMFFitCommand },
+    { L"-footprint", L"-footprint <normalmap.png> <outputdir> [-leanscale s] [-kernel box|gaussian|smoothstep|cubic] [-radius r] [-fftmintaps n] [-threads n]", 2, FootprintCommand },
+    { L"-footprintbench", L"-footprintbench <normalmap.png> [-kernel box|gaussian|smoothstep|cubic] [-maxradius r] [-threads n]", 1, FootprintBenchCommand },
+    { L"-rebakebench", L"-rebakebench <normalmap.png> [-leanscale s] [-rects n] [-rectsize n] [-threads n]", 1, RebakeBenchCommand },
+    { L"-batch", L"-batch <manifest.txt> <outputdir> [-leanscale s] [-threads n] [-cachedir dir] [-bcquality fast|normal|high] [-queuedepth n]", 2, BatchCommand },
+    { L"-curvaturebench", L"-curvaturebench [-radius r] [-segments n] [-iterations n] [-threads n]", 0, CurvatureBenchCommand },
+    { L"-render", L"-render <normalmap.png> <output.dds|pfm|tfi> [-mode name|all] [-brdf ggx|beckmann] [-geometricaa none|vertexcurvature|screenspace] [-roughness m] [-leanscale s] [-diffuse 0|1] [-specular 0|1] [-vmfdiffuseaa 0|1] [-ssaa none|uniform|adaptive|texturespace] [-sequence sobol|r2|whitenoise] [-sssamples n] [-sampleradius r] [-minsamples n] [-maxsamples n] [-targeterror e] [-lightingsize n] [-width n] [-height n] [-frames n] [-camera default|overhead|grazing] [-camx x] [-camy y] [-camz z] [-pitch r] [-yaw r] [-half 0|1] [-threads n]", 2, RenderCommand },
+    { L"-samplingbench", L"-samplingbench <normalmap.png> <output.csv> [-mode name] [-sssamples n] [-refsamples n] [-width n] [-height n] [-camera default|overhead|grazing] [-threads n]", 2, SamplingBenchCommand },
+    { L"-benchmatrix", L"-benchmatrix <output.csv> [-normalmap name|all] [-texturedir dir] [-leanscale s] [-roughness m] [-geometricaa none|vertexcurvature|screenspace] [-sssamples n] [-refsamples n] [-lightingsize n] [-width n] [-height n] [-threads n]", 1, BenchMatrixCommand },
+    { L"-shimmer", L"-shimmer <normalmap.png> <output.csv> [-camera default|overhead|grazing] [-motion strafe|dolly|turn] [-speed s] [-frames n] [-fps n] [-brdf ggx|beckmann] [-geometricaa none|vertexcurvature|screenspace] [-roughness m] [-leanscale s] [-sssamples n] [-refsamples n] [-lightingsize n] [-exposure e] [-width n] [-height n] [-mapdir dir] [-path file.campath] [-threads n]", 2, ShimmerCommand },
+    { L"-renderpath", L"-renderpath <path.campath> <outputdir> [-texturedir dir] [-first n] [-count n] [-width n] [-height n] [-format dds|pfm|tfi] [-half 0|1] [-threads n]", 2, RenderPathCommand },
+    { L"-compare", L"-compare <image.png|pfm|tfi> <reference.png|pfm|tfi> [-exposure e] [-window n] [-errormap output.png] [-maxerror e] [-ssimmap output.png] [-threads n]", 2, CompareCommand },
+    { L"-samplerbench", L"-samplerbench <normalmap.png> [-leanscale s] [-samples n] [-tolerance t] [-threads n]", 1, SamplerBenchCommand },
+    { L"-brdfbench", L"-brdfbench [-evaluations n] [-iterations n] [-tolerance t]", 0, BRDFBenchCommand },
+    { L"-randombench", L"-randombench [-count n] [-threads n]", 0, RandomBenchCommand },
+};
+
+static const uint64 NumCommands = ARRAYSIZE(Commands);
+
+//=================================================================================================
+// Entry point
+//=================================================================================================
+
+bool Run(const wchar* cmdLine, int32& exitCode)
+{
+    exitCode = 0;
+
+    if(cmdLine == NULL || cmdLine[0] == 0)
+        return false;
+
+    int numArgs = 0;
+    wchar** argList = CommandLineToArgvW(cmdLine, &numArgs);
+    if(argList == NULL)
+        return false;
+
+    std::vector<wstring> args(argList, argList + numArgs);
+    LocalFree(argList);
+
+    const Command* command = NULL;
+    for(uint64 i = 0; i < NumCommands && args.size() > 0; ++i)
+        if(args[0] == Commands[i].Name)
+            command = &Commands[i];
+
+    if(command == NULL)
+        return false;
+
+    // Write output to the console that launched us
+    if(AttachConsole(ATTACH_PARENT_PROCESS) == FALSE)
+        AllocConsole();
+    FILE* stream = NULL;
+    _wfreopen_s(&stream, L"CONOUT$", L"w", stdout);
+
+    try
+    {
+        args.erase(args.begin());
+        CommandLine commandLine(args);
+        if(commandLine.NumPositional() < command->NumPositional)
+            throw Exception(L"Usage: " + wstring(command->Usage));
+
+        ThreadPool::GlobalPool.Initialize(commandLine.Option(L"threads", 0u));
+
+        command->Function(commandLine);
+    }
+    catch(const Exception& e)
+    {
+        Print(L"Error: " + e.GetMessage());
+        exitCode = 1;
+    }
+    catch(const std::exception& e)
+    {
+        Print(L"Error: " + AnsiToWString(e.what()));
+        exitCode = 1;
+    }
+
+    // Join the worker threads on the error paths too
+    ThreadPool::GlobalPool.Shutdown();
+
+    return true;
+}
+
+}
\ No newline at end of file
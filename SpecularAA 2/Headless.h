@@ -0,0 +1,23 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+using namespace SampleFramework11;
+
+// Command-line tools that run without creating a window or a D3D device
+namespace Headless
+{
+    // Runs the headless command specified on the command line. Returns false if the command line
+    // doesn't start with a headless command, in which case the app should start normally.
+    bool Run(const wchar* cmdLine, int32& exitCode);
+}
\ No newline at end of file
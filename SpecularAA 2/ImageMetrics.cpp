@@ -0,0 +1,469 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "ImageMetrics.h"
+
+#include "SampleFramework11/SIMD.h"
+#include "SampleFramework11/Exceptions.h"
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/FileIO.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/Timer.h"
+#include "SampleFramework11/LodePNG/lodepng.h"
+
+// Columns of SSIM windows per task
+static const uint32 SSIMBandWidth = 128;
+
+// SSIM constants for a dynamic range of 1
+static const float SSIMC1 = 0.01f * 0.01f;
+static const float SSIMC2 = 0.03f * 0.03f;
+
+//=================================================================================================
+// LDRImage
+//=================================================================================================
+
+void LDRImage::Initialize(uint32 width, uint32 height)
+{
+    Width = width;
+    Height = height;
+    Pixels.resize(uint64(width) * height);
+}
+
+void LDRImage::LoadFromFile(const wchar* filePath)
+{
+    File file(filePath, File::OpenRead);
+    std::vector<uint8> fileData(static_cast<size_t>(file.Size()));
+    file.Read(fileData.size(), fileData.data());
+
+    std::vector<uint8> imageData;
+    uint32 result = lodepng::decode(imageData, Width, Height, fileData.data(), fileData.size(), LCT_RGBA, 8);
+    if(result != 0)
+        throw Exception(AnsiToWString(lodepng_error_text(result)));
+
+    Pixels.resize(uint64(Width) * Height);
+    memcpy(Pixels.data(), imageData.data(), Pixels.size() * sizeof(uint32));
+}
+
+void LDRImage::WriteToFile(const wchar* filePath) const
+{
+    std::vector<uint8> fileData;
+    uint32 result = lodepng::encode(fileData, reinterpret_cast<const uint8*>(Pixels.data()), Width, Height, LCT_RGBA, 8);
+    if(result != 0)
+        throw Exception(AnsiToWString(lodepng_error_text(result)));
+
+    File pngFile(filePath, File::OpenWrite);
+    pngFile.Write(fileData.size(), fileData.data());
+}
+
+//=================================================================================================
+// ImageView
+//=================================================================================================
+
+ImageView::ImageView(const HDRImage& image) : Width(image.Width), Height(image.Height), HDRPixels(image.Pixels.data()),
+                                              LDRPixels(NULL)
+{
+}
+
+ImageView::ImageView(const LDRImage& image) : Width(image.Width), Height(image.Height), HDRPixels(NULL),
+                                              LDRPixels(image.Pixels.data())
+{
+}
+
+ImageView::ImageView(uint32 width, uint32 height, const Float4* pixels) : Width(width), Height(height), HDRPixels(pixels),
+                                                                          LDRPixels(NULL)
+{
+}
+
+//=================================================================================================
+// ImageMetrics
+//=================================================================================================
+
+static Float8 Pow(const Float8& x, float exponent)
+{
+    return Float8::Exp2(Float8::Log2(Float8::Max(x, 1e-10f)) * exponent);
+}
+
+static Float8 SRGBEncode(const Float8& x)
+{
+    return Float8::Select(x <= 0.0031308f, x * 12.92f, Pow(x, 1.0f / 2.4f) * 1.055f - 0.055f);
+}
+
+// Linear values of the 256 sRGB-encoded levels, so that RGBA8 pixels don't need a pow
+struct SRGBDecodeTable
+{
+    float Values[256];
+
+    SRGBDecodeTable()
+    {
+        for(uint32 i = 0; i < 256; ++i)
+        {
+            const float x = i / 255.0f;
+            Values[i] = x <= 0.04045f ? x / 12.92f : std::pow((x + 0.055f) / 1.055f, 2.4f);
+        }
+    }
+};
+
+static const SRGBDecodeTable SRGBDecodeLUT;
+
+static Float8 LabF(const Float8& t)
+{
+    return Float8::Select(t > 0.008856f, Pow(t, 1.0f / 3.0f), t * 7.787f + 16.0f / 116.0f);
+}
+
+// The display-encoded and linear color of 8 pixels
+struct DisplayColor8
+{
+    Float8 Encoded[3];
+    Float8 Linear[3];
+};
+
+// Loads count <= 8 pixels starting at (x, y). The missing lanes are black in both images, so
+// they add nothing to the errors.
+static void LoadPixels(const ImageView& image, uint32 x, uint32 y, uint32 count, float exposure, DisplayColor8& color)
+{
+    const uint64 offset = uint64(y) * image.Width + x;
+    if(image.HDRPixels != NULL)
+    {
+        float channels[3][8] = { };
+        const Float4* src = image.HDRPixels + offset;
+        for(uint32 i = 0; i < count; ++i)
+        {
+            channels[0][i] = src[i].x;
+            channels[1][i] = src[i].y;
+            channels[2][i] = src[i].z;
+        }
+
+        for(uint32 c = 0; c < 3; ++c)
+        {
+            const Float8 exposed = Float8::Max(Float8::Load(channels[c]) * exposure, 0.0f);
+            color.Linear[c] = exposed / (exposed + 1.0f);
+            color.Encoded[c] = SRGBEncode(color.Linear[c]);
+        }
+    }
+    else
+    {
+        uint32 texels[8] = { };
+        memcpy(texels, image.LDRPixels + offset, count * sizeof(uint32));
+
+        Float8 alpha;
+        Float8::UnpackRGBA8(texels, color.Encoded[0], color.Encoded[1], color.Encoded[2], alpha);
+
+        const Int8 bytes = Int8::Load(reinterpret_cast<const int32*>(texels));
+        for(uint32 c = 0; c < 3; ++c)
+        {
+            const Int8 level = (bytes >> int32(c * 8)) & Int8(0xFF);
+            color.Linear[c] = Int8::Gather(SRGBDecodeLUT.Values, level);
+        }
+    }
+}
+
+static void ToLab(const DisplayColor8& color, Float8& L, Float8& a, Float8& b)
+{
+    const Float8& red = color.Linear[0];
+    const Float8& green = color.Linear[1];
+    const Float8& blue = color.Linear[2];
+
+    // Relative to the D65 white point
+    const Float8 fx = LabF((red * 0.4124f + green * 0.3576f + blue * 0.1805f) * (1.0f / 0.95047f));
+    const Float8 fy = LabF(red * 0.2126f + green * 0.7152f + blue * 0.0722f);
+    const Float8 fz = LabF((red * 0.0193f + green * 0.1192f + blue * 0.9505f) * (1.0f / 1.08883f));
+
+    L = fy * 116.0f - 16.0f;
+    a = (fx - fy) * 500.0f;
+    b = (fy - fz) * 200.0f;
+}
+
+// The SSIM sums are taken from luma - 0.5, which keeps more precision in E[x^2] - E[x]^2
+static const float LumaOffset = 0.5f;
+
+static Float8 CenteredLuma(const DisplayColor8& color)
+{
+    return color.Encoded[0] * 0.2126f + color.Encoded[1] * 0.7152f + color.Encoded[2] * 0.0722f - LumaOffset;
+}
+
+ImageMetrics::ImageMetrics() : Width(0), Height(0), MSE(0.0), PSNR(0.0), SSIM(0.0), MeanError(0.0), MaxError(0.0f),
+                               Seconds(0.0), SSIMWidth(0), SSIMHeight(0)
+{
+}
+
+void ImageMetrics::Compute(const ImageView& image, const ImageView& reference, const ImageMetricsSettings& settings)
+{
+    if(image.Width != reference.Width || image.Height != reference.Height)
+        throw Exception(L"The images being compared have different sizes");
+
+    Timer timer;
+
+    Width = image.Width;
+    Height = image.Height;
+    const uint64 numPixels = uint64(Width) * Height;
+    ErrorMap.resize(numPixels);
+    imageLuma.resize(numPixels);
+    referenceLuma.resize(numPixels);
+
+    // Per-pixel errors and luma, one row per task
+    std::vector<double> rowSquaredError(Height);
+    std::vector<double> rowError(Height);
+    std::vector<float> rowMaxError(Height);
+    ThreadPool::GlobalPool.ParallelFor(Height, [&](uint32 y, uint32 threadIdx)
+    {
+        Float8 squaredErrorSum = 0.0f;
+        Float8 errorSum = 0.0f;
+        Float8 maxError = 0.0f;
+        for(uint32 x = 0; x < Width; x += Float8::Width)
+        {
+            const uint32 count = std::min<uint32>(Width - x, Float8::Width);
+
+            DisplayColor8 imageColor;
+            DisplayColor8 referenceColor;
+            LoadPixels(image, x, y, count, settings.Exposure, imageColor);
+            LoadPixels(reference, x, y, count, settings.Exposure, referenceColor);
+
+            for(uint32 c = 0; c < 3; ++c)
+            {
+                const Float8 diff = imageColor.Encoded[c] - referenceColor.Encoded[c];
+                squaredErrorSum += diff * diff;
+            }
+
+            Float8 imageL, imageA, imageB;
+            Float8 referenceL, referenceA, referenceB;
+            ToLab(imageColor, imageL, imageA, imageB);
+            ToLab(referenceColor, referenceL, referenceA, referenceB);
+            const Float8 dL = imageL - referenceL;
+            const Float8 dA = imageA - referenceA;
+            const Float8 dB = imageB - referenceB;
+            const Float8 deltaE = Float8::Sqrt(dL * dL + dA * dA + dB * dB);
+            errorSum += deltaE;
+            maxError = Float8::Max(maxError, deltaE);
+
+            const uint64 offset = uint64(y) * Width + x;
+            float values[8];
+            if(count == Float8::Width)
+            {
+                deltaE.Store(&ErrorMap[offset]);
+                CenteredLuma(imageColor).Store(&imageLuma[offset]);
+                CenteredLuma(referenceColor).Store(&referenceLuma[offset]);
+            }
+            else
+            {
+                deltaE.Store(values);
+                memcpy(&ErrorMap[offset], values, count * sizeof(float));
+                CenteredLuma(imageColor).Store(values);
+                memcpy(&imageLuma[offset], values, count * sizeof(float));
+                CenteredLuma(referenceColor).Store(values);
+                memcpy(&referenceLuma[offset], values, count * sizeof(float));
+            }
+        }
+
+        rowSquaredError[y] = Float8::Sum(squaredErrorSum);
+        rowError[y] = Float8::Sum(errorSum);
+        rowMaxError[y] = 0.0f;
+        for(uint32 i = 0; i < Float8::Width; ++i)
+            rowMaxError[y] = std::max(rowMaxError[y], maxError[i]);
+    });
+
+    double squaredErrorSum = 0.0;
+    double errorSum = 0.0;
+    MaxError = 0.0f;
+    for(uint32 y = 0; y < Height; ++y)
+    {
+        squaredErrorSum += rowSquaredError[y];
+        errorSum += rowError[y];
+        MaxError = std::max(MaxError, rowMaxError[y]);
+    }
+
+    MSE = squaredErrorSum / std::max<uint64>(numPixels * 3, 1);
+    PSNR = 10.0 * std::log10(1.0 / std::max(MSE, 1e-10));
+    MeanError = errorSum / std::max<uint64>(numPixels, 1);
+
+    ComputeSSIM(std::max(std::min(settings.SSIMWindow, std::min(Width, Height)), 1u));
+
+    timer.Update();
+    Seconds = timer.ElapsedSecondsD();
+}
+
+void ImageMetrics::ComputeSSIM(uint32 window)
+{
+    SSIMWidth = Width - window + 1;
+    SSIMHeight = Height - window + 1;
+    SSIMMap.resize(uint64(SSIMWidth) * SSIMHeight);
+
+    enum Sums
+    {
+        SumA = 0,
+        SumB,
+        SumAA,
+        SumBB,
+        SumAB,
+
+        NumSums
+    };
+
+    const float invWindowSize = 1.0f / (window * window);
+    const uint32 numBands = (SSIMWidth + SSIMBandWidth - 1) / SSIMBandWidth;
+    std::vector<double> bandSSIM(numBands);
+    ThreadPool::GlobalPool.ParallelFor(numBands, [&](uint32 bandIdx, uint32 threadIdx)
+    {
+        const uint32 x0 = bandIdx * SSIMBandWidth;
+        const uint32 bandWidth = std::min(SSIMBandWidth, SSIMWidth - x0);
+
+        // The sums of the last window rows, and their running sum down the band
+        std::vector<float> rowSums(uint64(window) * NumSums * SSIMBandWidth);
+        std::vector<float> windowSums(NumSums * SSIMBandWidth, 0.0f);
+        float rowSum[NumSums][8];
+
+        double ssimSum = 0.0;
+        for(uint32 y = 0; y < Height; ++y)
+        {
+            const float* a = &imageLuma[uint64(y) * Width + x0];
+            const float* b = &referenceLuma[uint64(y) * Width + x0];
+            float* ringRow = &rowSums[uint64(y % window) * NumSums * SSIMBandWidth];
+
+            for(uint32 x = 0; x < bandWidth; x += Float8::Width)
+            {
+                const uint32 count = std::min<uint32>(bandWidth - x, Float8::Width);
+                if(count == Float8::Width)
+                {
+                    // The last load ends at x0 + x + 7 + window - 1 <= Width - 1
+                    Float8 sums[NumSums] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+                    for(uint32 k = 0; k < window; ++k)
+                    {
+                        const Float8 valueA = Float8::Load(a + x + k);
+                        const Float8 valueB = Float8::Load(b + x + k);
+                        sums[SumA] += valueA;
+                        sums[SumB] += valueB;
+                        sums[SumAA] += valueA * valueA;
+                        sums[SumBB] += valueB * valueB;
+                        sums[SumAB] += valueA * valueB;
+                    }
+
+                    for(uint32 s = 0; s < NumSums; ++s)
+                        sums[s].Store(rowSum[s]);
+                }
+                else
+                {
+                    for(uint32 i = 0; i < count; ++i)
+                    {
+                        float sums[NumSums] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+                        for(uint32 k = 0; k < window; ++k)
+                        {
+                            const float valueA = a[x + i + k];
+                            const float valueB = b[x + i + k];
+                            sums[SumA] += valueA;
+                            sums[SumB] += valueB;
+                            sums[SumAA] += valueA * valueA;
+                            sums[SumBB] += valueB * valueB;
+                            sums[SumAB] += valueA * valueB;
+                        }
+
+                        for(uint32 s = 0; s < NumSums; ++s)
+                            rowSum[s][i] = sums[s];
+                    }
+                }
+
+                // Add the new row to the running sums, and take away the one that just left the
+                // window, which is in the ring slot that the new one replaces. The lanes past
+                // the end of the band stay at 0.
+                for(uint32 i = count; i < Float8::Width; ++i)
+                    for(uint32 s = 0; s < NumSums; ++s)
+                        rowSum[s][i] = 0.0f;
+
+                for(uint32 s = 0; s < NumSums; ++s)
+                {
+                    float* ringSums = ringRow + s * SSIMBandWidth + x;
+                    float* runningSums = &windowSums[s * SSIMBandWidth + x];
+                    const Float8 newSums = Float8::Load(rowSum[s]);
+                    const Float8 oldSums = y >= window ? Float8::Load(ringSums) : Float8(0.0f);
+                    (Float8::Load(runningSums) + newSums - oldSums).Store(runningSums);
+                    newSums.Store(ringSums);
+                }
+            }
+
+            if(y + 1 < window)
+                continue;
+
+            const uint32 outputY = y + 1 - window;
+            float* ssimRow = &SSIMMap[uint64(outputY) * SSIMWidth + x0];
+            Float8 rowSSIM = 0.0f;
+            for(uint32 x = 0; x < bandWidth; x += Float8::Width)
+            {
+                const uint32 count = std::min<uint32>(bandWidth - x, Float8::Width);
+
+                // windowSums has room for whole Float8s past the end of the band
+                const Float8 meanA = Float8::Load(&windowSums[SumA * SSIMBandWidth + x]) * invWindowSize;
+                const Float8 meanB = Float8::Load(&windowSums[SumB * SSIMBandWidth + x]) * invWindowSize;
+                const Float8 meanAA = Float8::Load(&windowSums[SumAA * SSIMBandWidth + x]) * invWindowSize;
+                const Float8 meanBB = Float8::Load(&windowSums[SumBB * SSIMBandWidth + x]) * invWindowSize;
+                const Float8 meanAB = Float8::Load(&windowSums[SumAB * SSIMBandWidth + x]) * invWindowSize;
+
+                const Float8 varianceA = Float8::Max(meanAA - meanA * meanA, 0.0f);
+                const Float8 varianceB = Float8::Max(meanBB - meanB * meanB, 0.0f);
+                const Float8 covariance = meanAB - meanA * meanB;
+
+                const Float8 lumaA = meanA + LumaOffset;
+                const Float8 lumaB = meanB + LumaOffset;
+                const Float8 numerator = (lumaA * lumaB * 2.0f + SSIMC1) * (covariance * 2.0f + SSIMC2);
+                const Float8 denominator = (lumaA * lumaA + lumaB * lumaB + SSIMC1) * (varianceA + varianceB + SSIMC2);
+                const Float8 ssim = numerator / denominator;
+
+                float values[8];
+                ssim.Store(values);
+                memcpy(ssimRow + x, values, count * sizeof(float));
+                for(uint32 i = count; i < Float8::Width; ++i)
+                    values[i] = 0.0f;
+                rowSSIM += Float8::Load(values);
+            }
+
+            ssimSum += Float8::Sum(rowSSIM);
+        }
+
+        bandSSIM[bandIdx] = ssimSum;
+    });
+
+    double ssimSum = 0.0;
+    for(uint32 i = 0; i < numBands; ++i)
+        ssimSum += bandSSIM[i];
+    SSIM = ssimSum / std::max<uint64>(SSIMMap.size(), 1);
+}
+
+// Writes values * scale as gray, clamped to [0, 1]
+static void WriteGrayscale(const wchar* filePath, uint32 width, uint32 height, const std::vector<float>& values, float scale)
+{
+    LDRImage image;
+    image.Initialize(width, height);
+    for(uint64 i = 0; i < image.Pixels.size(); ++i)
+    {
+        const uint32 gray = uint32(Saturate(values[i] * scale) * 255.0f + 0.5f);
+        image.Pixels[i] = gray | (gray << 8) | (gray << 16) | 0xFF000000;
+    }
+
+    image.WriteToFile(filePath);
+}
+
+void ImageMetrics::WriteErrorMap(const wchar* filePath, float maxError) const
+{
+    WriteGrayscale(filePath, Width, Height, ErrorMap, 1.0f / std::max(maxError, 1e-6f));
+}
+
+void ImageMetrics::WriteSSIMMap(const wchar* filePath) const
+{
+    WriteGrayscale(filePath, SSIMWidth, SSIMHeight, SSIMMap, 1.0f);
+}
+
+std::wstring ImageMetrics::ToString() const
+{
+    std::wstring text = SampleFramework11::ToString(Width) + L"x" + SampleFramework11::ToString(Height);
+    text += L": MSE " + SampleFramework11::ToString(MSE) + L", PSNR " + SampleFramework11::ToString(PSNR);
+    text += L"dB, SSIM " + SampleFramework11::ToString(SSIM) + L", delta E " + SampleFramework11::ToString(MeanError);
+    text += L" mean, " + SampleFramework11::ToString(MaxError) + L" max (";
+    text += SampleFramework11::ToString(Seconds * 1000.0) + L"ms)";
+    return text;
+}
\ No newline at end of file
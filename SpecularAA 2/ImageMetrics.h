@@ -0,0 +1,111 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "ReferenceRenderer.h"
+
+using namespace SampleFramework11;
+
+// RGBA8 image with sRGB-encoded color, like the screenshots that App::SaveScreenshot writes
+struct LDRImage
+{
+    uint32 Width;
+    uint32 Height;
+    std::vector<uint32> Pixels;
+
+    LDRImage() : Width(0), Height(0)
+    {
+    }
+
+    void Initialize(uint32 width, uint32 height);
+
+    void LoadFromFile(const wchar* filePath);
+    void WriteToFile(const wchar* filePath) const;
+};
+
+// One side of a comparison, without a copy of the pixels. Linear HDR pixels are scaled by the
+// exposure and tone mapped with x / (1 + x) per channel before they're encoded to sRGB, and RGBA8
+// pixels are taken as they are.
+struct ImageView
+{
+    uint32 Width;
+    uint32 Height;
+    const Float4* HDRPixels;
+    const uint32* LDRPixels;
+
+    ImageView(const HDRImage& image);
+    ImageView(const LDRImage& image);
+
+    // Tightly packed RGBA32F pixels, like the contents of colorTarget after a readback
+    ImageView(uint32 width, uint32 height, const Float4* pixels);
+};
+
+struct ImageMetricsSettings
+{
+    float Exposure;                     // Applied to HDR pixels before tone mapping
+    uint32 SSIMWindow;                  // Width and height of the SSIM window in pixels
+
+    ImageMetricsSettings() : Exposure(1.0f), SSIMWindow(8)
+    {
+    }
+};
+
+// Compares an image against a reference as they'd be shown on an sRGB display:
+//
+//  - MSE of the sRGB-encoded RGB values, and the PSNR with a peak of 1. The PSNR is capped at
+//    100dB for identical images.
+//  - SSIM of the encoded luma, with a box window of SSIMWindow^2 pixels. The map only has the
+//    windows that fit in the image, so it's SSIMWindow - 1 pixels smaller in each dimension.
+//  - The CIE76 delta E of every pixel, where about 2.3 is just noticeable
+//
+// The per-pixel work is done 8 pixels at a time with Float8, with the rows spread over
+// ThreadPool::GlobalPool. The window sums for SSIM are separable: each row of a window is summed
+// directly, and the rows are kept as running sums down vertical bands of the image, which are
+// processed in parallel. The SSIM statistics are summed in float, which is precise enough
+// for windows of a few hundred pixels.
+class ImageMetrics
+{
+
+public:
+
+    uint32 Width;
+    uint32 Height;
+    double MSE;
+    double PSNR;
+    double SSIM;
+    double MeanError;                   // Mean delta E
+    float MaxError;
+    double Seconds;
+
+    uint32 SSIMWidth;
+    uint32 SSIMHeight;
+    std::vector<float> SSIMMap;
+    std::vector<float> ErrorMap;        // Delta E of every pixel
+
+    ImageMetrics();
+
+    void Compute(const ImageView& image, const ImageView& reference, const ImageMetricsSettings& settings);
+
+    // Grayscale PNGs, with maxError or an SSIM of 1 as white
+    void WriteErrorMap(const wchar* filePath, float maxError) const;
+    void WriteSSIMMap(const wchar* filePath) const;
+
+    std::wstring ToString() const;
+
+protected:
+
+    void ComputeSSIM(uint32 window);
+
+    std::vector<float> imageLuma;
+    std::vector<float> referenceLuma;
+};
\ No newline at end of file
@@ -0,0 +1,1376 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MapBaker.h"
+#include "MapEncoding.h"
+#include "VMFMixture.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Exceptions.h"
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/FileIO.h"
+#include "SampleFramework11/GraphicsTypes.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/SIMD.h"
+#include "SampleFramework11/Timer.h"
+#include "SampleFramework11/LodePNG/lodepng.h"
+
+//=================================================================================================
+// Format conversion helpers
+//=================================================================================================
+
+static float SNorm16ToFloat(int16 x)
+{
+    return std::max(x / 32767.0f, -1.0f);
+}
+
+// Writes 8 texels worth of 4-channel SNORM data, skipping lanes past numTexels
+static void StoreSNorm16x4(const Float8& r, const Float8& g, const Float8& b, const Float8& a,
+                           int16* dst, uint32 numTexels)
+{
+    const Float8 channels[4] = { r, g, b, a };
+
+    int32 values[4][8];
+    for(uint32 c = 0; c < 4; ++c)
+    {
+        Float8 x = Float8::Clamp(channels[c], -1.0f, 1.0f) * 32767.0f;
+        Float8::ToInt(x, values[c]);
+    }
+
+    for(uint32 i = 0; i < numTexels; ++i)
+        for(uint32 c = 0; c < 4; ++c)
+            dst[i * 4 + c] = static_cast<int16>(values[c][i]);
+}
+
+static void StoreHalf4(const Float8& r, const Float8& g, const Float8& b, const Float8& a,
+                       uint16* dst, uint32 numTexels)
+{
+    uint16 values[4][8];
+    Float8::ToHalf(r, values[0]);
+    Float8::ToHalf(g, values[1]);
+    Float8::ToHalf(b, values[2]);
+    Float8::ToHalf(a, values[3]);
+
+    for(uint32 i = 0; i < numTexels; ++i)
+        for(uint32 c = 0; c < 4; ++c)
+            dst[i * 4 + c] = values[c][i];
+}
+
+static void StoreUNorm16x2(const Float8& r, const Float8& g, uint16* dst, uint32 numTexels)
+{
+    int32 values[2][8];
+    Float8::ToInt(Float8::Saturate(r) * 65535.0f, values[0]);
+    Float8::ToInt(Float8::Saturate(g) * 65535.0f, values[1]);
+
+    for(uint32 i = 0; i < numTexels; ++i)
+    {
+        dst[i * 2 + 0] = static_cast<uint16>(values[0][i]);
+        dst[i * 2 + 1] = static_cast<uint16>(values[1][i]);
+    }
+}
+
+static void StoreSNorm16x2(const Float8& r, const Float8& g, int16* dst, uint32 numTexels)
+{
+    int32 values[2][8];
+    Float8::ToInt(Float8::Clamp(r, -1.0f, 1.0f) * 32767.0f, values[0]);
+    Float8::ToInt(Float8::Clamp(g, -1.0f, 1.0f) * 32767.0f, values[1]);
+
+    for(uint32 i = 0; i < numTexels; ++i)
+    {
+        dst[i * 2 + 0] = static_cast<int16>(values[0][i]);
+        dst[i * 2 + 1] = static_cast<int16>(values[1][i]);
+    }
+}
+
+static void StoreUNorm8x4(const Float8& r, const Float8& g, const Float8& b, const Float8& a,
+                          uint32* dst, uint32 numTexels)
+{
+    const Float8 channels[4] = { r, g, b, a };
+
+    int32 values[4][8];
+    for(uint32 c = 0; c < 4; ++c)
+        Float8::ToInt(Float8::Saturate(channels[c]) * 255.0f, values[c]);
+
+    for(uint32 i = 0; i < numTexels; ++i)
+        dst[i] = values[0][i] | (values[1][i] << 8) | (values[2][i] << 16) | (values[3][i] << 24);
+}
+
+static void StoreUNorm10x3A2(const Float8& r, const Float8& g, const Float8& b, const Float8& a,
+                             uint32* dst, uint32 numTexels)
+{
+    int32 values[4][8];
+    Float8::ToInt(Float8::Saturate(r) * 1023.0f, values[0]);
+    Float8::ToInt(Float8::Saturate(g) * 1023.0f, values[1]);
+    Float8::ToInt(Float8::Saturate(b) * 1023.0f, values[2]);
+    Float8::ToInt(Float8::Saturate(a) * 3.0f, values[3]);
+
+    for(uint32 i = 0; i < numTexels; ++i)
+        dst[i] = values[0][i] | (values[1][i] << 10) | (values[2][i] << 20) | (uint32(values[3][i]) << 30);
+}
+
+static void StoreFloat11x2Float10(const Float8& r, const Float8& g, const Float8& b, uint32* dst, uint32 numTexels)
+{
+    float values[3][8];
+    r.Store(values[0]);
+    g.Store(values[1]);
+    b.Store(values[2]);
+
+    for(uint32 i = 0; i < numTexels; ++i)
+    {
+        PackedVector::XMFLOAT3PK packed;
+        PackedVector::XMStoreFloat3PK(&packed, XMVectorSet(values[0][i], values[1][i], values[2][i], 0.0f));
+        dst[i] = packed.v;
+    }
+}
+
+// Loads up to 8 floats, filling the unused lanes with a value that's safe to compute with
+static Float8 LoadPartial(const float* src, uint32 count, float padValue)
+{
+    if(count == Float8::Width)
+        return Float8::Load(src);
+
+    float values[8];
+    for(uint32 i = 0; i < Float8::Width; ++i)
+        values[i] = i < count ? src[i] : padValue;
+    return Float8::Load(values);
+}
+
+static uint32 NumTiles(uint32 size, uint32 tileSize)
+{
+    return (size + tileSize - 1) / tileSize;
+}
+
+//=================================================================================================
+// NormalMapData
+//=================================================================================================
+
+void NormalMapData::LoadFromFile(const wchar* filePath)
+{
+    File file(filePath, File::OpenRead);
+    std::vector<uint8> fileData(static_cast<size_t>(file.Size()));
+    file.Read(fileData.size(), fileData.data());
+
+    std::vector<uint8> imageData;
+    uint32 result = lodepng::decode(imageData, Width, Height, fileData.data(), fileData.size(), LCT_RGBA, 8);
+    if(result != 0)
+        throw Exception(AnsiToWString(lodepng_error_text(result)));
+
+    Texels.resize(Width * Height);
+    memcpy(Texels.data(), imageData.data(), Texels.size() * sizeof(uint32));
+}
+
+//=================================================================================================
+// BakedTexture
+//=================================================================================================
+
+// Minimal DDS header definitions, see DDSTextureLoader.cpp for the full set
+struct DDSPixelFormat
+{
+    uint32 Size;
+    uint32 Flags;
+    uint32 FourCC;
+    uint32 RGBBitCount;
+    uint32 RBitMask;
+    uint32 GBitMask;
+    uint32 BBitMask;
+    uint32 ABitMask;
+};
+
+struct DDSHeader
+{
+    uint32 Size;
+    uint32 Flags;
+    uint32 Height;
+    uint32 Width;
+    uint32 PitchOrLinearSize;
+    uint32 Depth;
+    uint32 MipMapCount;
+    uint32 Reserved1[11];
+    DDSPixelFormat PixelFormat;
+    uint32 Caps;
+    uint32 Caps2;
+    uint32 Caps3;
+    uint32 Caps4;
+    uint32 Reserved2;
+};
+
+struct DDSHeaderDX10
+{
+    DXGI_FORMAT Format;
+    uint32 ResourceDimension;
+    uint32 MiscFlag;
+    uint32 ArraySize;
+    uint32 MiscFlags2;
+};
+
+static const uint32 DDSMagic = 0x20534444;             // "DDS "
+static const uint32 DDSFourCCFlag = 0x00000004;        // DDS_FOURCC
+static const uint32 DDSRGBFlag = 0x00000040;           // DDS_RGB
+
+// Everything that comes before the subresource data in a DDS file with a DX10 header
+struct DDSFileHeader
+{
+    uint32 Magic;
+    DDSHeader Header;
+    DDSHeaderDX10 DX10Header;
+};
+
+static DDSFileHeader MakeDDSFileHeader(uint32 width, uint32 height, DXGI_FORMAT format, uint32 numMipLevels,
+                                       uint32 arraySize, uint32 pitchOrLinearSize)
+{
+    DDSFileHeader fileHeader;
+    ZeroMemory(&fileHeader, sizeof(fileHeader));
+    fileHeader.Magic = DDSMagic;
+
+    DDSHeader& header = fileHeader.Header;
+    header.Size = sizeof(DDSHeader);
+    header.Flags = 0x00001007;                          // DDS_HEADER_FLAGS_TEXTURE
+    if(IsBlockCompressed(format))
+        header.Flags |= 0x00080000;                     // DDS_HEADER_FLAGS_LINEARSIZE
+    else
+        header.Flags |= 0x00000008;                     // DDS_HEADER_FLAGS_PITCH
+    if(numMipLevels > 1)
+        header.Flags |= 0x00020000;                     // DDS_HEADER_FLAGS_MIPMAP
+    header.Height = height;
+    header.Width = width;
+    header.PitchOrLinearSize = pitchOrLinearSize;
+    header.MipMapCount = numMipLevels;
+    header.PixelFormat.Size = sizeof(DDSPixelFormat);
+    header.PixelFormat.Flags = DDSFourCCFlag;
+    header.PixelFormat.FourCC = MAKEFOURCC('D', 'X', '1', '0');
+    header.Caps = 0x00001000;                           // DDS_SURFACE_FLAGS_TEXTURE
+    if(numMipLevels > 1)
+        header.Caps |= 0x00400008;                      // DDS_SURFACE_FLAGS_MIPMAP
+
+    DDSHeaderDX10& dx10Header = fileHeader.DX10Header;
+    dx10Header.Format = format;
+    dx10Header.ResourceDimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+    dx10Header.ArraySize = arraySize;
+
+    return fileHeader;
+}
+
+uint32 BakedTexelSize(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+        case DXGI_FORMAT_R16G16B16A16_SNORM:
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            return 8;
+        case DXGI_FORMAT_R16G16_UNORM:
+        case DXGI_FORMAT_R16G16_SNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+        case DXGI_FORMAT_R11G11B10_FLOAT:
+            return 4;
+        case DXGI_FORMAT_R32G32B32A32_UINT:
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return 16;
+        default:
+            if(IsBlockCompressed(format))
+                return BCBlockSize(format);
+            return 0;
+    }
+}
+
+static uint32 FormatTexelSize(DXGI_FORMAT format)
+{
+    const uint32 texelSize = BakedTexelSize(format);
+    if(texelSize == 0)
+        throw Exception(L"Unsupported baked texture format");
+    return texelSize;
+}
+
+BakedTexture::BakedTexture() :  Width(0),
+                                Height(0),
+                                NumMipLevels(0),
+                                ArraySize(0),
+                                TexelSize(0),
+                                Format(DXGI_FORMAT_UNKNOWN)
+{
+}
+
+void BakedTexture::Initialize(uint32 width, uint32 height, DXGI_FORMAT format, uint32 numMipLevels, uint32 arraySize)
+{
+    Width = width;
+    Height = height;
+    Format = format;
+    NumMipLevels = numMipLevels;
+    ArraySize = arraySize;
+    TexelSize = FormatTexelSize(format);
+
+    Subresources.resize(numMipLevels * arraySize);
+    for(uint32 slice = 0; slice < arraySize; ++slice)
+        for(uint32 mip = 0; mip < numMipLevels; ++mip)
+            Subresources[D3D11CalcSubresource(mip, slice, numMipLevels)].resize(RowPitch(mip) * NumRows(mip));
+}
+
+uint32 BakedTexture::RowPitch(uint32 mipLevel) const
+{
+    if(IsBlockCompressed(Format))
+        return ((MipWidth(mipLevel) + 3) / 4) * TexelSize;
+    return MipWidth(mipLevel) * TexelSize;
+}
+
+uint32 BakedTexture::NumRows(uint32 mipLevel) const
+{
+    if(IsBlockCompressed(Format))
+        return (MipHeight(mipLevel) + 3) / 4;
+    return MipHeight(mipLevel);
+}
+
+uint8* BakedTexture::Data(uint32 mipLevel, uint32 arraySlice)
+{
+    return Subresources[D3D11CalcSubresource(mipLevel, arraySlice, NumMipLevels)].data();
+}
+
+const uint8* BakedTexture::Data(uint32 mipLevel, uint32 arraySlice) const
+{
+    return Subresources[D3D11CalcSubresource(mipLevel, arraySlice, NumMipLevels)].data();
+}
+
+Float4 BakedTexture::Texel(uint32 mipLevel, uint32 arraySlice, uint32 x, uint32 y) const
+{
+    if(IsBlockCompressed(Format))
+    {
+        const uint8* block = Data(mipLevel, arraySlice) + (y / 4) * RowPitch(mipLevel) + (x / 4) * TexelSize;
+        Float4 texels[16];
+        DecompressBCBlock(Format, block, texels);
+        return texels[(y % 4) * 4 + (x % 4)];
+    }
+
+    const uint8* texel = Data(mipLevel, arraySlice) + y * RowPitch(mipLevel) + x * TexelSize;
+
+    if(Format == DXGI_FORMAT_R16G16B16A16_SNORM)
+    {
+        const int16* values = reinterpret_cast<const int16*>(texel);
+        return Float4(SNorm16ToFloat(values[0]), SNorm16ToFloat(values[1]),
+                      SNorm16ToFloat(values[2]), SNorm16ToFloat(values[3]));
+    }
+    else if(Format == DXGI_FORMAT_R16G16B16A16_FLOAT)
+    {
+        const uint16* values = reinterpret_cast<const uint16*>(texel);
+        return Float4(PackedVector::XMConvertHalfToFloat(values[0]), PackedVector::XMConvertHalfToFloat(values[1]),
+                      PackedVector::XMConvertHalfToFloat(values[2]), PackedVector::XMConvertHalfToFloat(values[3]));
+    }
+    else if(Format == DXGI_FORMAT_R16G16_UNORM)
+    {
+        const uint16* values = reinterpret_cast<const uint16*>(texel);
+        return Float4(values[0] / 65535.0f, values[1] / 65535.0f, 0.0f, 1.0f);
+    }
+    else if(Format == DXGI_FORMAT_R16G16_SNORM)
+    {
+        const int16* values = reinterpret_cast<const int16*>(texel);
+        return Float4(SNorm16ToFloat(values[0]), SNorm16ToFloat(values[1]), 0.0f, 1.0f);
+    }
+    else if(Format == DXGI_FORMAT_R8G8B8A8_UNORM)
+    {
+        const uint32 value = *reinterpret_cast<const uint32*>(texel);
+        return Float4((value & 0xFF) / 255.0f, ((value >> 8) & 0xFF) / 255.0f,
+                      ((value >> 16) & 0xFF) / 255.0f, (value >> 24) / 255.0f);
+    }
+    else if(Format == DXGI_FORMAT_R10G10B10A2_UNORM)
+    {
+        const uint32 value = *reinterpret_cast<const uint32*>(texel);
+        return Float4((value & 0x3FF) / 1023.0f, ((value >> 10) & 0x3FF) / 1023.0f,
+                      ((value >> 20) & 0x3FF) / 1023.0f, (value >> 30) / 3.0f);
+    }
+    else if(Format == DXGI_FORMAT_R11G11B10_FLOAT)
+    {
+        XMVECTOR value = PackedVector::XMLoadFloat3PK(reinterpret_cast<const PackedVector::XMFLOAT3PK*>(texel));
+        return Float4(XMVectorGetX(value), XMVectorGetY(value), XMVectorGetZ(value), 1.0f);
+    }
+    else if(Format == DXGI_FORMAT_R32G32B32A32_FLOAT)
+    {
+        return *reinterpret_cast<const Float4*>(texel);
+    }
+    else
+    {
+        const uint32* values = reinterpret_cast<const uint32*>(texel);
+        return Float4(float(values[0]), float(values[1]), float(values[2]), float(values[3]));
+    }
+}
+
+void BakedTexture::ReadFromTexture(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11Texture2D* texture)
+{
+    D3D11_TEXTURE2D_DESC texDesc;
+    texture->GetDesc(&texDesc);
+
+    Initialize(texDesc.Width, texDesc.Height, texDesc.Format, texDesc.MipLevels, texDesc.ArraySize);
+
+    StagingTexture2D stagingTexture;
+    stagingTexture.Initialize(device, Width, Height, Format, NumMipLevels, 1, 0, ArraySize);
+    context->CopyResource(stagingTexture.Texture, texture);
+
+    for(uint32 slice = 0; slice < ArraySize; ++slice)
+    {
+        for(uint32 mip = 0; mip < NumMipLevels; ++mip)
+        {
+            const uint32 subResourceIdx = D3D11CalcSubresource(mip, slice, NumMipLevels);
+
+            uint32 pitch = 0;
+            const uint8* srcData = reinterpret_cast<const uint8*>(stagingTexture.Map(context, subResourceIdx, pitch));
+            uint8* dstData = Data(mip, slice);
+            for(uint32 y = 0; y < NumRows(mip); ++y)
+                memcpy(dstData + y * RowPitch(mip), srcData + y * pitch, RowPitch(mip));
+
+            stagingTexture.Unmap(context, subResourceIdx);
+        }
+    }
+}
+
+ID3D11ShaderResourceViewPtr BakedTexture::CreateSRV(ID3D11Device* device) const
+{
+    D3D11_TEXTURE2D_DESC desc;
+    desc.Width = Width;
+    desc.Height = Height;
+    desc.MipLevels = NumMipLevels;
+    desc.ArraySize = ArraySize;
+    desc.Format = Format;
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Usage = D3D11_USAGE_IMMUTABLE;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    desc.CPUAccessFlags = 0;
+    desc.MiscFlags = 0;
+
+    std::vector<D3D11_SUBRESOURCE_DATA> initData(Subresources.size());
+    for(uint32 i = 0; i < Subresources.size(); ++i)
+    {
+        initData[i].pSysMem = Subresources[i].data();
+        initData[i].SysMemPitch = RowPitch(i % NumMipLevels);
+        initData[i].SysMemSlicePitch = 0;
+    }
+
+    ID3D11Texture2DPtr texture;
+    DXCall(device->CreateTexture2D(&desc, initData.data(), &texture));
+
+    ID3D11ShaderResourceViewPtr srv;
+    DXCall(device->CreateShaderResourceView(texture, NULL, &srv));
+    return srv;
+}
+
+void BakedTexture::WriteToDDSFile(const wchar* filePath) const
+{
+    File file(filePath, File::OpenWrite);
+    const uint32 pitchOrLinearSize = IsBlockCompressed(Format) ? RowPitch(0) * NumRows(0) : RowPitch(0);
+    file.Write(MakeDDSFileHeader(Width, Height, Format, NumMipLevels, ArraySize, pitchOrLinearSize));
+
+    // Subresources are already in the same slice-major order as the DDS file
+    for(uint64 i = 0; i < Subresources.size(); ++i)
+        file.Write(Subresources[i].size(), Subresources[i].data());
+}
+
+//=================================================================================================
+// BakeStats
+//=================================================================================================
+
+double BakeStats::TexelsPerSecond() const
+{
+    return Seconds > 0.0 ? TexelsProcessed / Seconds : 0.0;
+}
+
+double BakeStats::TexelsPerSecondPerCore() const
+{
+    return TexelsPerSecond() / std::max<uint32>(NumThreads, 1);
+}
+
+std::wstring BakeStats::ToString() const
+{
+    std::wstring text = L"Baked " + SampleFramework11::ToString(TexelsProcessed) + L" texels in ";
+    text += SampleFramework11::ToString(Seconds * 1000.0) + L"ms using ";
+    text += SampleFramework11::ToString(NumThreads) + L" threads (";
+    text += SampleFramework11::ToString(TexelsPerSecondPerCore() / 1000000.0) + L" MTexels/s per core)";
+    return text;
+}
+
+//=================================================================================================
+// BakeComparison
+//=================================================================================================
+
+bool BakeComparison::WithinTolerance() const
+{
+    return MaxLEANError <= LEANMapTolerance && MaxVMFError <= VMFMapTolerance
+           && MaxRoughnessError <= RoughnessMapTolerance;
+}
+
+std::wstring BakeComparison::ToString() const
+{
+    std::wstring text = L"Max error - LEAN: " + SampleFramework11::ToString(MaxLEANError);
+    text += L", VMF: " + SampleFramework11::ToString(MaxVMFError);
+    text += L", Roughness: " + SampleFramework11::ToString(MaxRoughnessError);
+    text += WithinTolerance() ? L" (within tolerance)" : L" (EXCEEDS TOLERANCE)";
+    return text;
+}
+
+float BakeComparison::Compare(const BakedTexture& a, const BakedTexture& b)
+{
+    if(a.Width != b.Width || a.Height != b.Height || a.NumMipLevels != b.NumMipLevels
+       || a.ArraySize != b.ArraySize || a.Format != b.Format)
+        throw Exception(L"Can't compare baked textures with mismatched dimensions or formats");
+
+    float maxError = 0.0f;
+    for(uint32 slice = 0; slice < a.ArraySize; ++slice)
+    {
+        for(uint32 mip = 0; mip < a.NumMipLevels; ++mip)
+        {
+            for(uint32 y = 0; y < a.MipHeight(mip); ++y)
+            {
+                for(uint32 x = 0; x < a.MipWidth(mip); ++x)
+                {
+                    Float4 diff = a.Texel(mip, slice, x, y) - b.Texel(mip, slice, x, y);
+                    maxError = std::max(maxError, std::abs(diff.x));
+                    maxError = std::max(maxError, std::abs(diff.y));
+                    maxError = std::max(maxError, std::abs(diff.z));
+                    maxError = std::max(maxError, std::abs(diff.w));
+                }
+            }
+        }
+    }
+
+    return maxError;
+}
+
+float BakeComparison::CompareRelative(const BakedTexture& a, const BakedTexture& b)
+{
+    if(a.Width != b.Width || a.Height != b.Height || a.NumMipLevels != b.NumMipLevels
+       || a.ArraySize != b.ArraySize || a.Format != b.Format)
+        throw Exception(L"Can't compare baked textures with mismatched dimensions or formats");
+
+    // Values below this are compared absolutely, since they're swamped by the base roughness
+    const float minValue = 1.0f / 1024.0f;
+
+    float maxError = 0.0f;
+    for(uint32 slice = 0; slice < a.ArraySize; ++slice)
+    {
+        for(uint32 mip = 0; mip < a.NumMipLevels; ++mip)
+        {
+            for(uint32 y = 0; y < a.MipHeight(mip); ++y)
+            {
+                for(uint32 x = 0; x < a.MipWidth(mip); ++x)
+                {
+                    const Float4 texelA = a.Texel(mip, slice, x, y);
+                    const Float4 texelB = b.Texel(mip, slice, x, y);
+                    const float valuesA[4] = { texelA.x, texelA.y, texelA.z, texelA.w };
+                    const float valuesB[4] = { texelB.x, texelB.y, texelB.z, texelB.w };
+                    for(uint32 c = 0; c < 4; ++c)
+                    {
+                        const float scale = std::max(std::max(std::abs(valuesA[c]), std::abs(valuesB[c])), minValue);
+                        maxError = std::max(maxError, std::abs(valuesA[c] - valuesB[c]) / scale);
+                    }
+                }
+            }
+        }
+    }
+
+    return maxError;
+}
+
+BakeComparison BakeComparison::Compare(const BakedMaps& a, const BakedMaps& b)
+{
+    BakeComparison comparison;
+    comparison.MaxLEANError = Compare(a.LEANMap, b.LEANMap);
+    comparison.MaxVMFError = Compare(a.VMFMap, b.VMFMap);
+    comparison.MaxRoughnessError = Compare(a.RoughnessMap, b.RoughnessMap);
+    return comparison;
+}
+
+//=================================================================================================
+// Baking kernels
+//=================================================================================================
+
+static TexelRect FullRect(const MomentPyramid::Level& level)
+{
+    return TexelRect(0, 0, level.Width, level.Height);
+}
+
+// Splits a rectangle of a mip level into tiles, and calls func(x, y, count) on the thread pool for
+// every run of up to 8 texels within a row of a tile
+template<typename T> static void ForEachTexelRun(const TexelRect& rect, uint32 tileSize, const T& func)
+{
+    const uint32 numTilesX = NumTiles(rect.Width(), tileSize);
+    const uint32 numTilesY = NumTiles(rect.Height(), tileSize);
+    ThreadPool::GlobalPool.ParallelFor(numTilesX * numTilesY, [&](uint32 tileIdx, uint32 threadIdx)
+    {
+        const uint32 tileStartX = rect.MinX + (tileIdx % numTilesX) * tileSize;
+        const uint32 tileStartY = rect.MinY + (tileIdx / numTilesX) * tileSize;
+        const uint32 tileEndX = std::min(tileStartX + tileSize, rect.MaxX);
+        const uint32 tileEndY = std::min(tileStartY + tileSize, rect.MaxY);
+
+        for(uint32 y = tileStartY; y < tileEndY; ++y)
+            for(uint32 x = tileStartX; x < tileEndX; x += Float8::Width)
+                func(x, y, std::min(tileEndX - x, Float8::Width));
+    });
+}
+
+template<typename T> static void ForEachTexelRun(uint32 width, uint32 height, uint32 tileSize, const T& func)
+{
+    ForEachTexelRun(TexelRect(0, 0, width, height), tileSize, func);
+}
+
+// Destination for one mip level of a baked texture. Data points at the first texel of the region
+// being written, which can be a sub-rectangle of the mip level.
+struct TexelTarget
+{
+    uint8* Data;
+    uint64 RowPitch;
+    uint32 TexelSize;
+
+    template<typename T> T* Texel(uint32 x, uint32 y) const
+    {
+        return reinterpret_cast<T*>(Data + y * RowPitch + uint64(x) * TexelSize);
+    }
+};
+
+template<typename TextureType> static TexelTarget MakeTarget(TextureType& texture, uint32 mipLevel, uint32 arraySlice,
+                                                             uint32 x = 0, uint32 y = 0)
+{
+    TexelTarget target;
+    target.RowPitch = texture.RowPitch(mipLevel);
+    target.TexelSize = texture.TexelSize;
+    target.Data = texture.Data(mipLevel, arraySlice) + y * target.RowPitch + uint64(x) * target.TexelSize;
+    return target;
+}
+
+// Converts the RGBA8 texels into normalized normals (same as FetchNormal), and computes the
+// first level of the moment pyramid from them. srcPitch is the number of texels between rows.
+static void ComputeBaseMoments(const uint32* srcTexels, uint64 srcPitch, MomentPyramid::Level& level,
+                               const TexelRect& rect)
+{
+    ForEachTexelRun(rect, MapBaker::TileSize, [&](uint32 x, uint32 y, uint32 count)
+    {
+        const uint32 idx = y * level.Width + x;
+
+        uint32 texels[8] = { 0 };
+        memcpy(texels, srcTexels + y * srcPitch + x, count * sizeof(uint32));
+
+        Float8 r, g, b, a;
+        Float8::UnpackRGBA8(texels, r, g, b, a);
+
+        Float8 nx = r * 2.0f - 1.0f;
+        Float8 ny = g * 2.0f - 1.0f;
+        Float8 nz = b * 2.0f - 1.0f;
+        Float8 len = Float8::Sqrt(nx * nx + ny * ny + nz * nz);
+        nx /= len;
+        ny /= len;
+        nz /= len;
+
+        Float8 bx = nx / nz;
+        Float8 by = ny / nz;
+
+        const Float8 values[MomentPyramid::NumPlanes] = { nx, ny, nz, bx, by, bx * bx, by * by, bx * by };
+        for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+        {
+            float tmp[8];
+            values[plane].Store(tmp);
+            memcpy(&level.Data[plane][idx], tmp, count * sizeof(float));
+        }
+    });
+}
+
+// 2x2 box filter of the previous level, with the same clamping and summation order as
+// the GenerateMoments kernel. Only the texels of dst within rect are written.
+static void ReduceMoments(const MomentPyramid::Level& src, MomentPyramid::Level& dst, const TexelRect& rect)
+{
+    const uint32 numRowTasks = NumTiles(rect.Height(), MapBaker::TileSize);
+    ThreadPool::GlobalPool.ParallelFor(numRowTasks, [&](uint32 taskIdx, uint32 threadIdx)
+    {
+        const uint32 startY = rect.MinY + taskIdx * MapBaker::TileSize;
+        const uint32 endY = std::min(startY + MapBaker::TileSize, rect.MaxY);
+        for(uint32 y = startY; y < endY; ++y)
+        {
+            const uint32 row0 = std::min(y * 2, src.Height - 1) * src.Width;
+            const uint32 row1 = std::min(y * 2 + 1, src.Height - 1) * src.Width;
+
+            for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+            {
+                const float* srcData = src.Data[plane].data();
+                float* dstData = &dst.Data[plane][y * dst.Width];
+                for(uint32 x = rect.MinX; x < rect.MaxX; ++x)
+                {
+                    const uint32 x0 = std::min(x * 2, src.Width - 1);
+                    const uint32 x1 = std::min(x * 2 + 1, src.Width - 1);
+                    dstData[x] = (srcData[row0 + x0] + srcData[row0 + x1] + srcData[row1 + x0] + srcData[row1 + x1]) * 0.25f;
+                }
+            }
+        }
+    });
+}
+
+// CPU version of the SolveVMF kernel for one level of the moment pyramid
+static void ResolveVMFLevel(const MomentPyramid::Level& level, bool baseLevel, const TexelTarget vmfTargets[NumVMFs],
+                            const TexelTarget& roughnessTarget, const TexelRect& rect)
+{
+    ForEachTexelRun(rect, MapBaker::TileSize, [&](uint32 x, uint32 y, uint32 count)
+    {
+        const uint32 idx = y * level.Width + x;
+        uint16* vmfData = vmfTargets[0].Texel<uint16>(x, y);
+        uint16* roughnessData = roughnessTarget.Texel<uint16>(x, y);
+
+        Float8 avgX = LoadPartial(&level.Data[MomentPyramid::AvgNormalX][idx], count, 0.0f);
+        Float8 avgY = LoadPartial(&level.Data[MomentPyramid::AvgNormalY][idx], count, 0.0f);
+        Float8 avgZ = LoadPartial(&level.Data[MomentPyramid::AvgNormalZ][idx], count, 1.0f);
+
+        if(baseLevel)
+        {
+            StoreHalf4(avgX, avgY, 1.0f, 1.0f / MaxKappa, vmfData, count);
+            StoreUNorm16x2(0.0f, 1.0f, roughnessData, count);
+        }
+        else
+        {
+            Float8 r = Float8::Sqrt(avgX * avgX + avgY * avgY + avgZ * avgZ);
+            Float8 kappa = Float8::Select(r < 1.0f, (r * 3.0f - r * r * r) / (1.0f - r * r), MaxKappa);
+
+            Float8 muX = avgX / r;
+            Float8 muY = avgY / r;
+            StoreHalf4(muX, muY, 1.0f, 1.0f / kappa, vmfData, count);
+
+            // Roughness added by the vMF lobe and the average normal length, the base roughness
+            // is applied in Mesh.hlsl
+            StoreUNorm16x2(Float8::Sqrt(2.0f / kappa), r, roughnessData, count);
+        }
+
+        // The extra lobes are always empty
+        for(uint32 slice = 1; slice < NumVMFs; ++slice)
+            StoreHalf4(0.0f, 0.0f, 0.0f, 1.0f / MaxKappa, vmfTargets[slice].Texel<uint16>(x, y), count);
+    });
+}
+
+// CPU version of the GenerateLEANMap kernel for one level of the moment pyramid
+static void ResolveLEANLevel(const MomentPyramid::Level& level, float scaleFactor, const TexelTarget& bTarget,
+                             const TexelTarget& mTarget, const TexelRect& rect)
+{
+    const float scaleFactorSq = scaleFactor * scaleFactor;
+
+    ForEachTexelRun(rect, MapBaker::TileSize, [&](uint32 x, uint32 y, uint32 count)
+    {
+        const uint32 idx = y * level.Width + x;
+
+        Float8 bx = LoadPartial(&level.Data[MomentPyramid::BX][idx], count, 0.0f) / scaleFactor;
+        Float8 by = LoadPartial(&level.Data[MomentPyramid::BY][idx], count, 0.0f) / scaleFactor;
+        Float8 mxx = LoadPartial(&level.Data[MomentPyramid::MXX][idx], count, 0.0f) / scaleFactorSq;
+        Float8 myy = LoadPartial(&level.Data[MomentPyramid::MYY][idx], count, 0.0f) / scaleFactorSq;
+        Float8 mxy = LoadPartial(&level.Data[MomentPyramid::MXY][idx], count, 0.0f) / scaleFactorSq;
+
+        StoreSNorm16x4(bx, by, 0.0f, 1.0f, bTarget.Texel<int16>(x, y), count);
+        StoreSNorm16x4(mxx, myy, mxy, mxx + myy, mTarget.Texel<int16>(x, y), count);
+    });
+}
+
+// CPU version of the GenerateCompactMaps kernel for one level of the moment pyramid
+static void ResolveCompactLevel(const MomentPyramid::Level& level, bool baseLevel, float scaleFactor,
+                                const TexelTarget& bTarget, const TexelTarget& covarianceTarget,
+                                const TexelTarget vmfTargets[NumVMFs])
+{
+    ForEachTexelRun(level.Width, level.Height, MapBaker::TileSize, [&](uint32 x, uint32 y, uint32 count)
+    {
+        const uint32 idx = y * level.Width + x;
+
+        // LEAN B and covariance
+        Float8 bx = LoadPartial(&level.Data[MomentPyramid::BX][idx], count, 0.0f);
+        Float8 by = LoadPartial(&level.Data[MomentPyramid::BY][idx], count, 0.0f);
+        Float8 mxx = LoadPartial(&level.Data[MomentPyramid::MXX][idx], count, 0.0f);
+        Float8 myy = LoadPartial(&level.Data[MomentPyramid::MYY][idx], count, 0.0f);
+        Float8 mxy = LoadPartial(&level.Data[MomentPyramid::MXY][idx], count, 0.0f);
+
+        Float8 sigmaXX = Float8::Max(mxx - bx * bx, 0.0f);
+        Float8 sigmaYY = Float8::Max(myy - by * by, 0.0f);
+        Float8 sigmaXY = mxy - bx * by;
+
+        Float8 varianceProduct = sigmaXX * sigmaYY;
+        Float8 correlation = Float8::Clamp(sigmaXY / Float8::Sqrt(varianceProduct), -1.0f, 1.0f);
+        correlation = Float8::Select(varianceProduct > 0.0f, correlation, 0.0f);
+
+        StoreSNorm16x2(bx / scaleFactor, by / scaleFactor, bTarget.Texel<int16>(x, y), count);
+        StoreUNorm8x4(EncodeLogVariance(sigmaXX), EncodeLogVariance(sigmaYY), correlation * 0.5f + 0.5f, 1.0f,
+                      covarianceTarget.Texel<uint32>(x, y), count);
+
+        // vMF lobe, the same as ResolveVMFLevel
+        Float8 avgX = LoadPartial(&level.Data[MomentPyramid::AvgNormalX][idx], count, 0.0f);
+        Float8 avgY = LoadPartial(&level.Data[MomentPyramid::AvgNormalY][idx], count, 0.0f);
+        Float8 avgZ = LoadPartial(&level.Data[MomentPyramid::AvgNormalZ][idx], count, 1.0f);
+
+        Float8 muX = avgX;
+        Float8 muY = avgY;
+        Float8 kappa = MaxKappa;
+        if(baseLevel == false)
+        {
+            Float8 r = Float8::Sqrt(avgX * avgX + avgY * avgY + avgZ * avgZ);
+            kappa = Float8::Select(r < 1.0f, (r * 3.0f - r * r * r) / (1.0f - r * r), MaxKappa);
+            muX = avgX / r;
+            muY = avgY / r;
+        }
+
+        StoreUNorm10x3A2(muX * 0.5f + 0.5f, muY * 0.5f + 0.5f, EncodeLogKappa(kappa), 1.0f,
+                         vmfTargets[0].Texel<uint32>(x, y), count);
+
+        // The extra lobes are always empty
+        for(uint32 slice = 1; slice < NumVMFs; ++slice)
+            StoreUNorm10x3A2(0.5f, 0.5f, EncodeLogKappa(MaxKappa), 0.0f, vmfTargets[slice].Texel<uint32>(x, y), count);
+    });
+}
+
+// CPU version of the GenerateAnisoRoughnessMap kernel for one level of the moment pyramid. This
+// is MeanNormalCovariance from NormalMoments.hlsl followed by EncodeAnisoRoughness.
+static void ResolveAnisoRoughnessLevel(const MomentPyramid::Level& level, bool baseLevel, const TexelTarget& target)
+{
+    ForEachTexelRun(level.Width, level.Height, MapBaker::TileSize, [&](uint32 x, uint32 y, uint32 count)
+    {
+        uint32* dst = target.Texel<uint32>(x, y);
+
+        // A single normal has no spread around itself
+        if(baseLevel)
+        {
+            StoreFloat11x2Float10(0.0f, 0.0f, 0.0f, dst, count);
+            return;
+        }
+
+        const uint32 idx = y * level.Width + x;
+        Float8 avgX = LoadPartial(&level.Data[MomentPyramid::AvgNormalX][idx], count, 0.0f);
+        Float8 avgY = LoadPartial(&level.Data[MomentPyramid::AvgNormalY][idx], count, 0.0f);
+        Float8 avgZ = LoadPartial(&level.Data[MomentPyramid::AvgNormalZ][idx], count, 1.0f);
+        Float8 bx = LoadPartial(&level.Data[MomentPyramid::BX][idx], count, 0.0f);
+        Float8 by = LoadPartial(&level.Data[MomentPyramid::BY][idx], count, 0.0f);
+        Float8 mxx = LoadPartial(&level.Data[MomentPyramid::MXX][idx], count, 0.0f);
+        Float8 myy = LoadPartial(&level.Data[MomentPyramid::MYY][idx], count, 0.0f);
+        Float8 mxy = LoadPartial(&level.Data[MomentPyramid::MXY][idx], count, 0.0f);
+
+        avgZ = Float8::Max(avgZ, 0.0001f);
+        Float8 offsetX = bx - avgX / avgZ;
+        Float8 offsetY = by - avgY / avgZ;
+
+        Float8 sigmaXX = mxx - bx * bx + offsetX * offsetX;
+        Float8 sigmaYY = myy - by * by + offsetY * offsetY;
+        Float8 sigmaXY = mxy - bx * by + offsetX * offsetY;
+
+        StoreFloat11x2Float10(Float8::Max(sigmaXX, 0.0f), Float8::Max(sigmaYY, 0.0f),
+                              Float8::Max((sigmaXX + sigmaYY) * 0.5f + sigmaXY, 0.0f), dst, count);
+    });
+}
+
+static uint64 TotalTexels(uint32 width, uint32 height, uint32 numMipLevels)
+{
+    uint64 total = 0;
+    for(uint32 mip = 0; mip < numMipLevels; ++mip)
+        total += uint64(std::max<uint32>(width >> mip, 1)) * std::max<uint32>(height >> mip, 1);
+    return total;
+}
+
+//=================================================================================================
+// TexelRect
+//=================================================================================================
+
+TexelRect TexelRect::Clamp(uint32 width, uint32 height) const
+{
+    return TexelRect(std::min(MinX, width), std::min(MinY, height), std::min(MaxX, width), std::min(MaxY, height));
+}
+
+TexelRect TexelRect::Union(const TexelRect& other) const
+{
+    return TexelRect(std::min(MinX, other.MinX), std::min(MinY, other.MinY),
+                     std::max(MaxX, other.MaxX), std::max(MaxY, other.MaxY));
+}
+
+TexelRect TexelRect::ParentRect(uint32 parentWidth, uint32 parentHeight) const
+{
+    // Each parent texel is a 2x2 box filter of its children, so a parent is dirty if any of its
+    // children are. Rounding the max up picks up the parents that straddle the edge of the rect.
+    return TexelRect(MinX / 2, MinY / 2, (MaxX + 1) / 2, (MaxY + 1) / 2).Clamp(parentWidth, parentHeight);
+}
+
+//=================================================================================================
+// DirtyRegion
+//=================================================================================================
+
+// Replaces overlapping rectangles with their union until none of them overlap
+static void MergeRects(std::vector<TexelRect>& rects)
+{
+    bool merged = true;
+    while(merged)
+    {
+        merged = false;
+        for(uint64 i = 0; i < rects.size() && !merged; ++i)
+        {
+            for(uint64 j = i + 1; j < rects.size(); ++j)
+            {
+                if(rects[i].Overlaps(rects[j]))
+                {
+                    rects[i] = rects[i].Union(rects[j]);
+                    rects.erase(rects.begin() + j);
+                    merged = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void DirtyRegion::Build(uint32 width, uint32 height, uint32 numMipLevels, const std::vector<TexelRect>& dirtyRects)
+{
+    Levels.clear();
+    Levels.resize(numMipLevels);
+    if(numMipLevels == 0)
+        return;
+
+    for(uint64 i = 0; i < dirtyRects.size(); ++i)
+    {
+        TexelRect rect = dirtyRects[i].Clamp(width, height);
+        if(rect.Empty() == false)
+            Levels[0].push_back(rect);
+    }
+    MergeRects(Levels[0]);
+
+    for(uint32 mip = 1; mip < numMipLevels; ++mip)
+    {
+        const uint32 mipWidth = std::max<uint32>(width >> mip, 1);
+        const uint32 mipHeight = std::max<uint32>(height >> mip, 1);
+        const std::vector<TexelRect>& childRects = Levels[mip - 1];
+        for(uint64 i = 0; i < childRects.size(); ++i)
+        {
+            TexelRect rect = childRects[i].ParentRect(mipWidth, mipHeight);
+            if(rect.Empty() == false)
+                Levels[mip].push_back(rect);
+        }
+        MergeRects(Levels[mip]);
+    }
+}
+
+uint64 DirtyRegion::NumTexels() const
+{
+    uint64 total = 0;
+    for(uint64 mip = 0; mip < Levels.size(); ++mip)
+        for(uint64 i = 0; i < Levels[mip].size(); ++i)
+            total += Levels[mip][i].Area();
+    return total;
+}
+
+//=================================================================================================
+// MomentPyramid
+//=================================================================================================
+
+void MomentPyramid::Level::Resize(uint32 width, uint32 height)
+{
+    Width = width;
+    Height = height;
+    for(uint32 plane = 0; plane < NumPlanes; ++plane)
+        Data[plane].resize(width * height);
+}
+
+uint64 MomentPyramid::Level::CapacityBytes() const
+{
+    uint64 bytes = 0;
+    for(uint32 plane = 0; plane < NumPlanes; ++plane)
+        bytes += Data[plane].capacity() * sizeof(float);
+    return bytes;
+}
+
+//=================================================================================================
+// MapBaker
+//=================================================================================================
+
+MapBaker::MapBaker() : vmfFitter(new VMFMixtureFitter())
+{
+}
+
+MapBaker::~MapBaker()
+{
+}
+
+void MapBaker::Bake(const NormalMapData& normalMap, const BakeSettings& settings, BakedMaps& maps)
+{
+    Timer timer;
+
+    GenerateMoments(normalMap);
+    ResolveVMFMaps(maps.VMFMap, maps.RoughnessMap);
+    ResolveLEANMap(settings, maps.LEANMap);
+
+    timer.Update();
+
+    stats.Seconds = timer.ElapsedSecondsD();
+    stats.NumThreads = ThreadPool::GlobalPool.NumThreads();
+    stats.TexelsProcessed = TotalTexels(normalMap.Width, normalMap.Height, static_cast<uint32>(moments.Levels.size()));
+}
+
+void MapBaker::Rebake(const NormalMapData& normalMap, const BakeSettings& settings,
+                      const std::vector<TexelRect>& dirtyRects, BakedMaps& maps)
+{
+    const uint32 numMipLevels = static_cast<uint32>(moments.Levels.size());
+    if(numMipLevels == 0 || moments.Levels[0].Width != normalMap.Width || moments.Levels[0].Height != normalMap.Height)
+        throw Exception(L"The moment pyramid doesn't match the normal map, the maps need a full bake first");
+    if(maps.LEANMap.Width != normalMap.Width || maps.LEANMap.Height != normalMap.Height
+       || maps.VMFMap.Width != normalMap.Width || maps.VMFMap.Height != normalMap.Height
+       || maps.RoughnessMap.Width != normalMap.Width || maps.RoughnessMap.Height != normalMap.Height)
+        throw Exception(L"The baked maps don't match the normal map, the maps need a full bake first");
+
+    Timer timer;
+
+    DirtyRegion region;
+    region.Build(normalMap.Width, normalMap.Height, numMipLevels, dirtyRects);
+
+    for(uint32 mipLevel = 0; mipLevel < numMipLevels; ++mipLevel)
+    {
+        MomentPyramid::Level& level = moments.Levels[mipLevel];
+        const std::vector<TexelRect>& rects = region.Levels[mipLevel];
+
+        TexelTarget vmfTargets[NumVMFs];
+        for(uint32 slice = 0; slice < NumVMFs; ++slice)
+            vmfTargets[slice] = MakeTarget(maps.VMFMap, mipLevel, slice);
+
+        for(uint64 i = 0; i < rects.size(); ++i)
+        {
+            UpdateMomentRect(normalMap, mipLevel, rects[i]);
+
+            ResolveVMFLevel(level, mipLevel == 0, vmfTargets, MakeTarget(maps.RoughnessMap, mipLevel, 0), rects[i]);
+            ResolveLEANLevel(level, settings.ScaleFactor, MakeTarget(maps.LEANMap, mipLevel, 0),
+                             MakeTarget(maps.LEANMap, mipLevel, 1), rects[i]);
+        }
+    }
+
+    if(NumVMFs > 1 && region.NumTexels() > 0)
+    {
+        VMFFitSettings fitSettings;
+        fitSettings.NumLobes = NumVMFs;
+
+        // The fitter only has lobes to refit from if the last fit was for this pyramid
+        if(vmfFitter->CanRefit(moments, fitSettings))
+            vmfFitter->Refit(moments, fitSettings, region, maps.VMFMap);
+        else
+            vmfFitter->Fit(moments, fitSettings, maps.VMFMap);
+    }
+
+    timer.Update();
+
+    stats.Seconds = timer.ElapsedSecondsD();
+    stats.NumThreads = ThreadPool::GlobalPool.NumThreads();
+    stats.TexelsProcessed = region.NumTexels();
+}
+
+void MapBaker::GenerateMoments(const NormalMapData& normalMap)
+{
+    const uint32 numMipLevels = NumMipLevels(normalMap.Width, normalMap.Height);
+    moments.Levels.resize(numMipLevels);
+    for(uint32 mip = 0; mip < numMipLevels; ++mip)
+        moments.Levels[mip].Resize(std::max<uint32>(normalMap.Width >> mip, 1), std::max<uint32>(normalMap.Height >> mip, 1));
+
+    ComputeBaseMoments(normalMap.Texels.data(), normalMap.Width, moments.Levels[0], FullRect(moments.Levels[0]));
+    for(uint32 mip = 1; mip < numMipLevels; ++mip)
+        ReduceMoments(moments.Levels[mip - 1], moments.Levels[mip], FullRect(moments.Levels[mip]));
+
+    // The kept lobes were fit from the old pyramid
+    vmfFitter->ReleaseLevels();
+}
+
+void MapBaker::UpdateMoments(const NormalMapData& normalMap, const DirtyRegion& region)
+{
+    const uint32 numMipLevels = static_cast<uint32>(moments.Levels.size());
+    if(numMipLevels == 0 || moments.Levels[0].Width != normalMap.Width || moments.Levels[0].Height != normalMap.Height)
+        throw Exception(L"The moment pyramid doesn't match the normal map, the maps need a full bake first");
+    if(region.Levels.size() != numMipLevels)
+        throw Exception(L"The dirty region doesn't match the moment pyramid");
+
+    for(uint32 mipLevel = 0; mipLevel < numMipLevels; ++mipLevel)
+        for(uint64 i = 0; i < region.Levels[mipLevel].size(); ++i)
+            UpdateMomentRect(normalMap, mipLevel, region.Levels[mipLevel][i]);
+}
+
+void MapBaker::UpdateMomentRect(const NormalMapData& normalMap, uint32 mipLevel, const TexelRect& rect)
+{
+    if(mipLevel == 0)
+        ComputeBaseMoments(normalMap.Texels.data(), normalMap.Width, moments.Levels[0], rect);
+    else
+        ReduceMoments(moments.Levels[mipLevel - 1], moments.Levels[mipLevel], rect);
+}
+
+void MapBaker::ResolveVMFMaps(BakedTexture& vmfMap, BakedTexture& roughnessMap)
+{
+    const uint32 numMipLevels = static_cast<uint32>(moments.Levels.size());
+    const uint32 width = moments.Levels[0].Width;
+    const uint32 height = moments.Levels[0].Height;
+    vmfMap.Initialize(width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, numMipLevels, NumVMFs);
+    roughnessMap.Initialize(width, height, DXGI_FORMAT_R16G16_UNORM, numMipLevels, 1);
+
+    for(uint32 mipLevel = 0; mipLevel < numMipLevels; ++mipLevel)
+    {
+        TexelTarget vmfTargets[NumVMFs];
+        for(uint32 slice = 0; slice < NumVMFs; ++slice)
+            vmfTargets[slice] = MakeTarget(vmfMap, mipLevel, slice);
+
+        ResolveVMFLevel(moments.Levels[mipLevel], mipLevel == 0, vmfTargets, MakeTarget(roughnessMap, mipLevel, 0),
+                        FullRect(moments.Levels[mipLevel]));
+    }
+
+    // SolveVMF only fits a single lobe, so the extra lobes come from the EM fitter
+    if(NumVMFs > 1)
+    {
+        VMFFitSettings fitSettings;
+        fitSettings.NumLobes = NumVMFs;
+
+        vmfFitter->Fit(moments, fitSettings, vmfMap);
+    }
+}
+
+void MapBaker::ResolveLEANMap(const BakeSettings& settings, BakedTexture& leanMap) const
+{
+    const uint32 numMipLevels = static_cast<uint32>(moments.Levels.size());
+    leanMap.Initialize(moments.Levels[0].Width, moments.Levels[0].Height, DXGI_FORMAT_R16G16B16A16_SNORM, numMipLevels, 2);
+
+    for(uint32 mipLevel = 0; mipLevel < numMipLevels; ++mipLevel)
+        ResolveLEANLevel(moments.Levels[mipLevel], settings.ScaleFactor, MakeTarget(leanMap, mipLevel, 0),
+                         MakeTarget(leanMap, mipLevel, 1), FullRect(moments.Levels[mipLevel]));
+}
+
+void MapBaker::ResolveCompactMaps(const BakeSettings& settings, CompactMaps& maps) const
+{
+    const uint32 numMipLevels = static_cast<uint32>(moments.Levels.size());
+    const uint32 width = moments.Levels[0].Width;
+    const uint32 height = moments.Levels[0].Height;
+    maps.LEANBMap.Initialize(width, height, DXGI_FORMAT_R16G16_SNORM, numMipLevels, 1);
+    maps.LEANCovarianceMap.Initialize(width, height, DXGI_FORMAT_R8G8B8A8_UNORM, numMipLevels, 1);
+    maps.VMFMap.Initialize(width, height, DXGI_FORMAT_R10G10B10A2_UNORM, numMipLevels, NumVMFs);
+
+    for(uint32 mipLevel = 0; mipLevel < numMipLevels; ++mipLevel)
+    {
+        TexelTarget vmfTargets[NumVMFs];
+        for(uint32 slice = 0; slice < NumVMFs; ++slice)
+            vmfTargets[slice] = MakeTarget(maps.VMFMap, mipLevel, slice);
+
+        ResolveCompactLevel(moments.Levels[mipLevel], mipLevel == 0, settings.ScaleFactor, MakeTarget(maps.LEANBMap, mipLevel, 0),
+                            MakeTarget(maps.LEANCovarianceMap, mipLevel, 0), vmfTargets);
+    }
+}
+
+void MapBaker::ResolveAnisoRoughnessMap(BakedTexture& anisoRoughnessMap) const
+{
+    const uint32 numMipLevels = static_cast<uint32>(moments.Levels.size());
+    anisoRoughnessMap.Initialize(moments.Levels[0].Width, moments.Levels[0].Height, DXGI_FORMAT_R11G11B10_FLOAT,
+                                 numMipLevels, 1);
+
+    for(uint32 mipLevel = 0; mipLevel < numMipLevels; ++mipLevel)
+        ResolveAnisoRoughnessLevel(moments.Levels[mipLevel], mipLevel == 0, MakeTarget(anisoRoughnessMap, mipLevel, 0));
+}
+
+//=================================================================================================
+// MappedNormalMap
+//=================================================================================================
+
+void MappedNormalMap::Open(const wchar* filePath)
+{
+    File.OpenRead(filePath);
+    const MemoryMappedFile& file = File;
+
+    const uint64 headerSize = sizeof(uint32) + sizeof(DDSHeader);
+    if(file.Size() < headerSize || *reinterpret_cast<const uint32*>(file.Data()) != DDSMagic)
+        throw Exception(std::wstring(filePath) + L" is not a DDS file");
+
+    const DDSHeader& header = *reinterpret_cast<const DDSHeader*>(file.Data() + sizeof(uint32));
+    const DDSPixelFormat& pixelFormat = header.PixelFormat;
+    uint64 dataOffset = headerSize;
+
+    bool isRGBA8 = false;
+    if((pixelFormat.Flags & DDSFourCCFlag) && pixelFormat.FourCC == MAKEFOURCC('D', 'X', '1', '0'))
+    {
+        const DDSHeaderDX10& dx10Header = *reinterpret_cast<const DDSHeaderDX10*>(file.Data() + headerSize);
+        dataOffset += sizeof(DDSHeaderDX10);
+        isRGBA8 = file.Size() >= dataOffset && dx10Header.Format == DXGI_FORMAT_R8G8B8A8_UNORM;
+    }
+    else
+    {
+        isRGBA8 = (pixelFormat.Flags & DDSRGBFlag) && pixelFormat.RGBBitCount == 32 && pixelFormat.RBitMask == 0x000000FF
+                  && pixelFormat.GBitMask == 0x0000FF00 && pixelFormat.BBitMask == 0x00FF0000;
+    }
+
+    if(isRGBA8 == false)
+        throw Exception(std::wstring(filePath) + L" must be an uncompressed R8G8B8A8_UNORM DDS file");
+
+    Width = header.Width;
+    Height = header.Height;
+    if(file.Size() < dataOffset + uint64(Width) * Height * sizeof(uint32))
+        throw Exception(std::wstring(filePath) + L" is truncated");
+
+    Texels = reinterpret_cast<const uint32*>(file.Data() + dataOffset);
+}
+
+//=================================================================================================
+// MappedTexture
+//=================================================================================================
+
+MappedTexture::MappedTexture() :    Width(0),
+                                    Height(0),
+                                    NumMipLevels(0),
+                                    ArraySize(0),
+                                    TexelSize(0),
+                                    Format(DXGI_FORMAT_UNKNOWN)
+{
+}
+
+void MappedTexture::Create(const wchar* filePath, uint32 width, uint32 height, DXGI_FORMAT format,
+                           uint32 numMipLevels, uint32 arraySize)
+{
+    Width = width;
+    Height = height;
+    Format = format;
+    NumMipLevels = numMipLevels;
+    ArraySize = arraySize;
+    TexelSize = FormatTexelSize(format);
+
+    // Subresources are stored slice-major, the same as BakedTexture::WriteToDDSFile
+    uint64 offset = sizeof(DDSFileHeader);
+    SubresourceOffsets.resize(numMipLevels * arraySize);
+    for(uint32 slice = 0; slice < arraySize; ++slice)
+    {
+        for(uint32 mip = 0; mip < numMipLevels; ++mip)
+        {
+            SubresourceOffsets[D3D11CalcSubresource(mip, slice, numMipLevels)] = offset;
+            offset += uint64(RowPitch(mip)) * MipHeight(mip);
+        }
+    }
+
+    File.Create(filePath, offset);
+
+    const DDSFileHeader fileHeader = MakeDDSFileHeader(Width, Height, Format, NumMipLevels, ArraySize, RowPitch(0));
+    memcpy(File.Data(), &fileHeader, sizeof(fileHeader));
+}
+
+uint8* MappedTexture::Data(uint32 mipLevel, uint32 arraySlice)
+{
+    return File.Data() + SubresourceOffsets[D3D11CalcSubresource(mipLevel, arraySlice, NumMipLevels)];
+}
+
+//=================================================================================================
+// TiledMapBaker
+//=================================================================================================
+
+TiledMapBaker::TiledMapBaker() : scratchBytes(0)
+{
+}
+
+void TiledMapBaker::Bake(uint32 width, uint32 height, const uint32* texels, const BakeSettings& settings,
+                         uint32 tileSize, const std::wstring& outputPrefix)
+{
+    if(tileSize == 0 || (tileSize & (tileSize - 1)) != 0)
+        throw Exception(L"The tile size must be a power of two");
+    if(tileSize < MinTileSize)
+        throw Exception(L"The tile size must be at least " + ToString(uint32(MinTileSize)));
+
+    // The extra lobes come from VMFMixtureFitter, which fits the whole moment pyramid at once.
+    // Refuse to bake rather than write single-lobe maps that don't match MapBaker.
+    if(NumVMFs > 1)
+        throw Exception(L"The tiled baker only supports a single vMF lobe");
+
+    Timer timer;
+
+    const uint32 numMipLevels = NumMipLevels(width, height);
+
+    MappedTexture leanMap;
+    MappedTexture vmfMap;
+    MappedTexture roughnessMap;
+    leanMap.Create((outputPrefix + L"_LEAN.dds").c_str(), width, height, DXGI_FORMAT_R16G16B16A16_SNORM, numMipLevels, 2);
+    vmfMap.Create((outputPrefix + L"_VMF.dds").c_str(), width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, numMipLevels, NumVMFs);
+    roughnessMap.Create((outputPrefix + L"_Roughness.dds").c_str(), width, height, DXGI_FORMAT_R16G16_UNORM, numMipLevels, 1);
+
+    // Resolves one level of a moment pyramid into the outputs, at the given position in the mip level
+    auto resolveLevel = [&](const MomentPyramid::Level& level, uint32 mipLevel, uint32 x, uint32 y)
+    {
+        TexelTarget vmfTargets[NumVMFs];
+        for(uint32 slice = 0; slice < NumVMFs; ++slice)
+            vmfTargets[slice] = MakeTarget(vmfMap, mipLevel, slice, x, y);
+
+        ResolveVMFLevel(level, mipLevel == 0, vmfTargets, MakeTarget(roughnessMap, mipLevel, 0, x, y), FullRect(level));
+        ResolveLEANLevel(level, settings.ScaleFactor, MakeTarget(leanMap, mipLevel, 0, x, y),
+                         MakeTarget(leanMap, mipLevel, 1, x, y), FullRect(level));
+    };
+
+    // Every tile reduces down to a single texel, unless the whole texture has fewer mips than a tile
+    const uint32 numTileLevels = std::min(NumMipLevels(tileSize, tileSize), numMipLevels);
+    const uint32 topTileLevel = numTileLevels - 1;
+
+    // The levels past the top of the tiles are built from the tile tops, which are small enough
+    // to keep in memory
+    MomentPyramid coarseMoments;
+    coarseMoments.Levels.resize(numMipLevels - topTileLevel);
+    for(uint32 i = 0; i < coarseMoments.Levels.size(); ++i)
+        coarseMoments.Levels[i].Resize(std::max<uint32>(width >> (topTileLevel + i), 1),
+                                       std::max<uint32>(height >> (topTileLevel + i), 1));
+
+    const uint32 numTilesX = NumTiles(width, tileSize);
+    const uint32 numTilesY = NumTiles(height, tileSize);
+    std::vector<MomentPyramid> threadMoments(ThreadPool::GlobalPool.NumThreads());
+
+    ThreadPool::GlobalPool.ParallelFor(numTilesX * numTilesY, [&](uint32 tileIdx, uint32 threadIdx)
+    {
+        const uint32 tileX = tileIdx % numTilesX;
+        const uint32 tileY = tileIdx / numTilesX;
+
+        MomentPyramid& tileMoments = threadMoments[threadIdx];
+        tileMoments.Levels.resize(numTileLevels);
+
+        // Since each level is a 2x2 box filter of the previous one, a power-of-two tile only ever
+        // reads its own texels. Clamping only happens at the edges of the texture, which are also
+        // the edges of a tile, so the tile's moments match the full pyramid exactly.
+        for(uint32 mip = 0; mip < numTileLevels; ++mip)
+        {
+            const uint32 mipWidth = std::max<uint32>(width >> mip, 1);
+            const uint32 mipHeight = std::max<uint32>(height >> mip, 1);
+            const uint32 startX = (tileX * tileSize) >> mip;
+            const uint32 startY = (tileY * tileSize) >> mip;
+
+            // Partial tiles on the right and bottom edges can run out of texels before the top level
+            if(startX >= mipWidth || startY >= mipHeight)
+                return;
+
+            const uint32 endX = std::min(((tileX + 1) * tileSize) >> mip, mipWidth);
+            const uint32 endY = std::min(((tileY + 1) * tileSize) >> mip, mipHeight);
+
+            MomentPyramid::Level& level = tileMoments.Levels[mip];
+            level.Resize(endX - startX, endY - startY);
+
+            if(mip == 0)
+                ComputeBaseMoments(texels + uint64(startY) * width + startX, width, level, FullRect(level));
+            else
+                ReduceMoments(tileMoments.Levels[mip - 1], level, FullRect(level));
+
+            resolveLevel(level, mip, startX, startY);
+        }
+
+        const MomentPyramid::Level& topLevel = tileMoments.Levels[topTileLevel];
+        MomentPyramid::Level& coarseLevel = coarseMoments.Levels[0];
+        const uint32 startX = (tileX * tileSize) >> topTileLevel;
+        const uint32 startY = (tileY * tileSize) >> topTileLevel;
+        for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+            for(uint32 y = 0; y < topLevel.Height; ++y)
+                memcpy(&coarseLevel.Data[plane][(startY + y) * coarseLevel.Width + startX],
+                       &topLevel.Data[plane][y * topLevel.Width], topLevel.Width * sizeof(float));
+    });
+
+    for(uint32 i = 1; i < coarseMoments.Levels.size(); ++i)
+    {
+        ReduceMoments(coarseMoments.Levels[i - 1], coarseMoments.Levels[i], FullRect(coarseMoments.Levels[i]));
+        resolveLevel(coarseMoments.Levels[i], topTileLevel + i, 0, 0);
+    }
+
+    leanMap.File.Flush();
+    vmfMap.File.Flush();
+    roughnessMap.File.Flush();
+
+    timer.Update();
+
+    stats.Seconds = timer.ElapsedSecondsD();
+    stats.NumThreads = ThreadPool::GlobalPool.NumThreads();
+    stats.TexelsProcessed = TotalTexels(width, height, numMipLevels);
+
+    scratchBytes = 0;
+    for(uint64 i = 0; i < threadMoments.size(); ++i)
+        for(uint64 mip = 0; mip < threadMoments[i].Levels.size(); ++mip)
+            scratchBytes += threadMoments[i].Levels[mip].CapacityBytes();
+    for(uint64 i = 0; i < coarseMoments.Levels.size(); ++i)
+        scratchBytes += coarseMoments.Levels[i].CapacityBytes();
+}
\ No newline at end of file
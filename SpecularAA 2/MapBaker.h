@@ -0,0 +1,352 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/Math.h"
+#include "SampleFramework11/FileIO.h"
+#include "SampleFramework11/InterfacePointers.h"
+#include "SampleFramework11/BlockCompression.h"
+
+using namespace SampleFramework11;
+
+// Maximum per-channel differences between the CPU baker and the GenerateMaps.hlsl kernels.
+// These cover differences in summation order and float -> SNORM/FLOAT16/UNORM rounding.
+static const float LEANMapTolerance = 2.0f / 32767.0f;
+static const float VMFMapTolerance = 1.0f / 1024.0f;
+static const float RoughnessMapTolerance = 1.0f / 1024.0f;
+
+// Relative tolerance for the anisotropic roughness map, which is 2 ULPs of the 10-bit float
+// channel since the hardware is allowed to round float -> R11G11B10 conversions differently
+static const float AnisoRoughnessMapTolerance = 2.0f / 32.0f;
+
+// Decoded RGBA8 normal map, used as the input to the CPU baker
+struct NormalMapData
+{
+    uint32 Width;
+    uint32 Height;
+    std::vector<uint32> Texels;
+
+    NormalMapData() : Width(0), Height(0)
+    {
+    }
+
+    void LoadFromFile(const wchar* filePath);
+};
+
+// RGBA8 normal map stored in an uncompressed DDS file. The file is memory-mapped, so only the
+// parts of the map that are being baked need to be resident.
+struct MappedNormalMap
+{
+    uint32 Width;
+    uint32 Height;
+    const uint32* Texels;
+    MemoryMappedFile File;
+
+    MappedNormalMap() : Width(0), Height(0), Texels(NULL)
+    {
+    }
+
+    void Open(const wchar* filePath);
+};
+
+// Texture data stored as tightly-packed subresources, in the same order and format that
+// D3D11 uses for texture initialization. For block-compressed formats TexelSize is the size of a
+// 4x4 block, and each row holds a row of blocks.
+struct BakedTexture
+{
+    uint32 Width;
+    uint32 Height;
+    uint32 NumMipLevels;
+    uint32 ArraySize;
+    uint32 TexelSize;
+    DXGI_FORMAT Format;
+    std::vector<std::vector<uint8>> Subresources;
+
+    BakedTexture();
+
+    void Initialize(uint32 width, uint32 height, DXGI_FORMAT format, uint32 numMipLevels, uint32 arraySize);
+
+    uint32 MipWidth(uint32 mipLevel) const { return std::max<uint32>(Width >> mipLevel, 1); }
+    uint32 MipHeight(uint32 mipLevel) const { return std::max<uint32>(Height >> mipLevel, 1); }
+    uint32 RowPitch(uint32 mipLevel) const;
+    uint32 NumRows(uint32 mipLevel) const;
+
+    uint8* Data(uint32 mipLevel, uint32 arraySlice);
+    const uint8* Data(uint32 mipLevel, uint32 arraySlice) const;
+
+    // Decodes a single texel to floats
+    Float4 Texel(uint32 mipLevel, uint32 arraySlice, uint32 x, uint32 y) const;
+
+    // Copies the contents of a GPU texture with a matching format and size
+    void ReadFromTexture(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11Texture2D* texture);
+
+    // Creates an immutable texture initialized with the contents, and returns a view of it
+    ID3D11ShaderResourceViewPtr CreateSRV(ID3D11Device* device) const;
+
+    void WriteToDDSFile(const wchar* filePath) const;
+};
+
+// Size of a texel (or a 4x4 block for block-compressed formats) in a baked texture, or 0 if the
+// format isn't one that BakedTexture supports
+uint32 BakedTexelSize(DXGI_FORMAT format);
+
+// None of the maps depend on the base roughness, it's applied when shading
+struct BakeSettings
+{
+    float ScaleFactor;      // Final LEAN scale factor, not the slider exponent
+
+    BakeSettings() : ScaleFactor(1.0f)
+    {
+    }
+};
+
+struct BakeStats
+{
+    double Seconds;
+    uint64 TexelsProcessed;     // Output texels summed over the full mip chain
+    uint32 NumThreads;
+
+    BakeStats() : Seconds(0.0), TexelsProcessed(0), NumThreads(1)
+    {
+    }
+
+    double TexelsPerSecond() const;
+    double TexelsPerSecondPerCore() const;
+    std::wstring ToString() const;
+};
+
+// The same set of maps generated by MeshRenderer::GenerateMaps and MeshRenderer::GenerateLEANMap
+struct BakedMaps
+{
+    BakedTexture LEANMap;
+    BakedTexture VMFMap;
+    BakedTexture RoughnessMap;
+};
+
+// Compact encodings of the LEAN and vMF maps, see MapEncoding.h
+struct CompactMaps;
+class VMFMixtureFitter;
+
+// Largest per-channel error between two sets of maps, for validating against the GPU bake
+struct BakeComparison
+{
+    float MaxLEANError;
+    float MaxVMFError;
+    float MaxRoughnessError;
+
+    BakeComparison() : MaxLEANError(0.0f), MaxVMFError(0.0f), MaxRoughnessError(0.0f)
+    {
+    }
+
+    bool WithinTolerance() const;
+    std::wstring ToString() const;
+
+    static float Compare(const BakedTexture& a, const BakedTexture& b);
+
+    // Largest per-channel error relative to the larger of the two values, for float formats
+    static float CompareRelative(const BakedTexture& a, const BakedTexture& b);
+    static BakeComparison Compare(const BakedMaps& a, const BakedMaps& b);
+};
+
+// Rectangle of texels within one mip level, where MaxX and MaxY are exclusive
+struct TexelRect
+{
+    uint32 MinX;
+    uint32 MinY;
+    uint32 MaxX;
+    uint32 MaxY;
+
+    TexelRect() : MinX(0), MinY(0), MaxX(0), MaxY(0)
+    {
+    }
+
+    TexelRect(uint32 minX, uint32 minY, uint32 maxX, uint32 maxY) : MinX(minX), MinY(minY), MaxX(maxX), MaxY(maxY)
+    {
+    }
+
+    uint32 Width() const { return MaxX > MinX ? MaxX - MinX : 0; }
+    uint32 Height() const { return MaxY > MinY ? MaxY - MinY : 0; }
+    uint64 Area() const { return uint64(Width()) * Height(); }
+    bool Empty() const { return Width() == 0 || Height() == 0; }
+
+    bool Overlaps(const TexelRect& other) const
+    {
+        return MinX < other.MaxX && other.MinX < MaxX && MinY < other.MaxY && other.MinY < MaxY;
+    }
+
+    TexelRect Clamp(uint32 width, uint32 height) const;
+    TexelRect Union(const TexelRect& other) const;
+
+    // The texels of the next mip level that are computed from this rectangle, which includes the
+    // texels that only partially overlap it
+    TexelRect ParentRect(uint32 parentWidth, uint32 parentHeight) const;
+};
+
+// Dirty rectangles for every level of a mip chain, propagated up from the rectangles that were
+// modified on mip 0. Rectangles that overlap are merged, so that no texel is updated twice.
+struct DirtyRegion
+{
+    std::vector<std::vector<TexelRect>> Levels;
+
+    void Build(uint32 width, uint32 height, uint32 numMipLevels, const std::vector<TexelRect>& dirtyRects);
+
+    uint64 NumTexels() const;
+};
+
+// Averages of the normals within each texel's footprint, matching NormalMoments in
+// GenerateMaps.hlsl. Level 0 is computed from the normal map, and every other level is a
+// 2x2 box filter of the level above it.
+struct MomentPyramid
+{
+    enum Planes
+    {
+        AvgNormalX = 0,
+        AvgNormalY,
+        AvgNormalZ,
+        BX,
+        BY,
+        MXX,
+        MYY,
+        MXY,
+
+        NumPlanes
+    };
+
+    struct Level
+    {
+        uint32 Width;
+        uint32 Height;
+        std::vector<float> Data[NumPlanes];
+
+        void Resize(uint32 width, uint32 height);
+        uint64 CapacityBytes() const;
+    };
+
+    std::vector<Level> Levels;
+};
+
+// Multithreaded CPU implementation of the GenerateMaps.hlsl kernels. The moment pyramid is built
+// once, and then the maps for every mip level are resolved from it. Texels are processed 8 at a
+// time with AVX2, and each mip level is split into tiles that are distributed across
+// ThreadPool::GlobalPool.
+class MapBaker
+{
+
+public:
+
+    static const uint32 TileSize = 64;
+
+    MapBaker();
+    ~MapBaker();
+
+    // Generates the moment pyramid and resolves all maps from it
+    void Bake(const NormalMapData& normalMap, const BakeSettings& settings, BakedMaps& maps);
+
+    // Updates the moment pyramid and maps after the texels covered by dirtyRects have changed in
+    // the normal map, without touching the rest of the texels. The maps have to come from a
+    // previous Bake of the same normal map. With more than one vMF lobe only the tiles that cover
+    // the dirty texels are re-fit, from the lobes that the last fit kept.
+    void Rebake(const NormalMapData& normalMap, const BakeSettings& settings, const std::vector<TexelRect>& dirtyRects,
+                BakedMaps& maps);
+
+    // The individual steps of Bake, for when only some of the settings have changed
+    void GenerateMoments(const NormalMapData& normalMap);
+    void ResolveVMFMaps(BakedTexture& vmfMap, BakedTexture& roughnessMap);
+
+    // Updates the moment pyramid for the texels of a DirtyRegion, for callers that resolve or
+    // re-fit the maps themselves
+    void UpdateMoments(const NormalMapData& normalMap, const DirtyRegion& region);
+    void ResolveLEANMap(const BakeSettings& settings, BakedTexture& leanMap) const;
+
+    // Resolves the compact LEAN and vMF maps, matching the GenerateCompactMaps kernel
+    void ResolveCompactMaps(const BakeSettings& settings, CompactMaps& maps) const;
+
+    // Resolves the anisotropic roughness map, matching the GenerateAnisoRoughnessMap kernel
+    void ResolveAnisoRoughnessMap(BakedTexture& anisoRoughnessMap) const;
+
+    const MomentPyramid& Moments() const { return moments; }
+    const BakeStats& Stats() const { return stats; }
+
+    // For stages that re-filter the pyramid between GenerateMoments and the resolves, see FootprintFilter
+    MomentPyramid& Moments() { return moments; }
+
+protected:
+
+    void UpdateMomentRect(const NormalMapData& normalMap, uint32 mipLevel, const TexelRect& rect);
+
+    MomentPyramid moments;
+    BakeStats stats;
+
+    // Keeps the lobes of the last vMF mixture fit for Rebake
+    std::unique_ptr<VMFMixtureFitter> vmfFitter;
+};
+
+// A baked texture that's written straight into a memory-mapped DDS file, with the same layout
+// as BakedTexture::WriteToDDSFile
+struct MappedTexture
+{
+    uint32 Width;
+    uint32 Height;
+    uint32 NumMipLevels;
+    uint32 ArraySize;
+    uint32 TexelSize;
+    DXGI_FORMAT Format;
+    MemoryMappedFile File;
+    std::vector<uint64> SubresourceOffsets;
+
+    MappedTexture();
+
+    void Create(const wchar* filePath, uint32 width, uint32 height, DXGI_FORMAT format,
+                uint32 numMipLevels, uint32 arraySize);
+
+    uint32 MipWidth(uint32 mipLevel) const { return std::max<uint32>(Width >> mipLevel, 1); }
+    uint32 MipHeight(uint32 mipLevel) const { return std::max<uint32>(Height >> mipLevel, 1); }
+    uint32 RowPitch(uint32 mipLevel) const { return MipWidth(mipLevel) * TexelSize; }
+
+    uint8* Data(uint32 mipLevel, uint32 arraySlice);
+};
+
+// Out-of-core version of MapBaker, for normal maps that are too large to bake in memory. Mip 0
+// is split into power-of-two tiles, and each tile builds its own moment pyramid down to a single
+// texel and resolves every level straight into memory-mapped DDS files. The remaining levels are
+// built from the tops of the tiles. Tiles are processed concurrently on ThreadPool::GlobalPool
+// with per-thread scratch memory, so memory use depends on the tile size and not the map size.
+class TiledMapBaker
+{
+
+public:
+
+    static const uint32 DefaultTileSize = 512;
+
+    // Each tile reduces by log2(tileSize) levels, and the levels past that are kept in memory for
+    // the whole map, so small tiles would bring back the full-resolution pyramid
+    static const uint32 MinTileSize = MapBaker::TileSize;
+
+    TiledMapBaker();
+
+    // Writes <outputPrefix>_LEAN.dds, <outputPrefix>_VMF.dds and <outputPrefix>_Roughness.dds. The
+    // tile size has to be a power of two, and at least MinTileSize. Only a single vMF lobe is
+    // supported, since the lobes of a mixture are fit over the whole moment pyramid.
+    void Bake(uint32 width, uint32 height, const uint32* texels, const BakeSettings& settings,
+              uint32 tileSize, const std::wstring& outputPrefix);
+
+    const BakeStats& Stats() const { return stats; }
+
+    // Peak scratch memory used by the last bake, not counting the memory-mapped files
+    uint64 ScratchBytes() const { return scratchBytes; }
+
+protected:
+
+    BakeStats stats;
+    uint64 scratchBytes;
+};
\ No newline at end of file
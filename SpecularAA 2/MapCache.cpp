@@ -0,0 +1,408 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MapCache.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Exceptions.h"
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/MurmurHash.h"
+
+// Bump this whenever the file layout or the bake itself changes, so that old entries are ignored
+static const uint32 CacheVersion = 2;
+static const uint32 CacheMagic = MAKEFOURCC('S', 'A', 'A', 'C');
+static const uint64 SubresourceAlignment = 64;
+
+// File layout: header, texture headers, subresource headers, then the aligned subresource data
+struct CacheFileHeader
+{
+    uint32 Magic;
+    uint32 Version;
+    uint64 Key;
+    uint32 NumTextures;
+    uint32 NumSubresources;
+};
+
+struct CacheTextureHeader
+{
+    uint32 Width;
+    uint32 Height;
+    uint32 NumMipLevels;
+    uint32 ArraySize;
+    uint32 Format;
+    uint32 Padding;
+};
+
+struct CacheSubresourceHeader
+{
+    uint64 Offset;
+    uint32 RowPitch;
+    uint32 NumRows;
+};
+
+static uint64 AlignOffset(uint64 offset)
+{
+    return (offset + SubresourceAlignment - 1) & ~(SubresourceAlignment - 1);
+}
+
+// MurmurHash64 takes an int length, so anything bigger than a chunk is hashed one chunk at a time
+// and then the chunk hashes are hashed together
+static uint64 HashData(const void* data, uint64 size)
+{
+    static const uint64 ChunkSize = 1024 * 1024 * 1024;
+    if(size <= ChunkSize)
+        return MurmurHash64(data, static_cast<int>(size));
+
+    const uint8* bytes = reinterpret_cast<const uint8*>(data);
+    std::vector<uint64> chunkHashes;
+    for(uint64 offset = 0; offset < size; offset += ChunkSize)
+    {
+        const uint64 chunkSize = std::min(ChunkSize, size - offset);
+        chunkHashes.push_back(MurmurHash64(bytes + offset, static_cast<int>(chunkSize)));
+    }
+
+    return MurmurHash64(chunkHashes.data(), static_cast<int>(chunkHashes.size() * sizeof(uint64)));
+}
+
+//=================================================================================================
+// CachedTexture
+//=================================================================================================
+
+CachedTexture::CachedTexture() :    Width(0),
+                                    Height(0),
+                                    NumMipLevels(0),
+                                    ArraySize(0),
+                                    Format(DXGI_FORMAT_UNKNOWN)
+{
+}
+
+void CachedTexture::Upload(ID3D11DeviceContext* context, ID3D11Texture2D* texture) const
+{
+    D3D11_TEXTURE2D_DESC texDesc;
+    texture->GetDesc(&texDesc);
+    if(texDesc.Width != Width || texDesc.Height != Height || texDesc.MipLevels != NumMipLevels
+       || texDesc.ArraySize != ArraySize || texDesc.Format != Format)
+        throw Exception(L"Cached texture doesn't match the dimensions or format of the destination texture");
+
+    for(uint32 i = 0; i < Subresources.size(); ++i)
+    {
+        const Subresource& subresource = Subresources[i];
+        context->UpdateSubresource(texture, i, NULL, subresource.Data, subresource.RowPitch,
+                                   subresource.RowPitch * subresource.NumRows);
+    }
+}
+
+void CachedTexture::CopyTo(BakedTexture& texture) const
+{
+    texture.Initialize(Width, Height, Format, NumMipLevels, ArraySize);
+
+    for(uint32 i = 0; i < Subresources.size(); ++i)
+    {
+        const uint64 size = uint64(Subresources[i].RowPitch) * Subresources[i].NumRows;
+        if(texture.Subresources[i].size() != size)
+            throw Exception(L"Cached texture has an unexpected subresource size");
+        memcpy(texture.Subresources[i].data(), Subresources[i].Data, size);
+    }
+}
+
+void CachedMaps::CopyTo(BakedMaps& maps) const
+{
+    LEANMap.CopyTo(maps.LEANMap);
+    VMFMap.CopyTo(maps.VMFMap);
+    RoughnessMap.CopyTo(maps.RoughnessMap);
+}
+
+void CachedCompressedMaps::CopyTo(CompressedMaps& maps) const
+{
+    LEANMap.CopyTo(maps.LEANMap);
+    VMFDirectionMap.CopyTo(maps.VMFDirectionMap);
+    VMFShapeMap.CopyTo(maps.VMFShapeMap);
+    RoughnessMap.CopyTo(maps.RoughnessMap);
+}
+
+//=================================================================================================
+// MapCacheStats
+//=================================================================================================
+
+std::wstring MapCacheStats::ToString() const
+{
+    std::wstring text = SampleFramework11::ToString(Hits) + L" hits, ";
+    text += SampleFramework11::ToString(Misses) + L" misses, ";
+    text += SampleFramework11::ToString(BytesRead / (1024.0 * 1024.0)) + L"MB read, ";
+    text += SampleFramework11::ToString(BytesWritten / (1024.0 * 1024.0)) + L"MB written";
+    return text;
+}
+
+//=================================================================================================
+// MapCache
+//=================================================================================================
+
+MapCache::MapCache() : hits(0), misses(0), bytesRead(0), bytesWritten(0), nextTempFile(0)
+{
+}
+
+void MapCache::Initialize(const wchar* cacheDir_)
+{
+    cacheDir = cacheDir_;
+    if(cacheDir.length() > 0 && cacheDir.back() != L'\\')
+        cacheDir += L'\\';
+
+    if(DirectoryExists(cacheDir.c_str()) == false)
+        Win32Call(CreateDirectory(cacheDir.c_str(), NULL));
+}
+
+uint64 MapCache::ComputeKey(const NormalMapData& normalMap, const BakeSettings& settings)
+{
+    struct KeyData
+    {
+        uint64 TexelHash;
+        uint32 Width;
+        uint32 Height;
+        float ScaleFactor;
+        uint32 NumVMFs;
+        uint32 Version;
+    };
+
+    KeyData keyData;
+    ZeroMemory(&keyData, sizeof(keyData));
+    keyData.TexelHash = HashData(normalMap.Texels.data(), uint64(normalMap.Texels.size()) * sizeof(uint32));
+    keyData.Width = normalMap.Width;
+    keyData.Height = normalMap.Height;
+    keyData.ScaleFactor = settings.ScaleFactor;
+    keyData.NumVMFs = NumVMFs;
+    keyData.Version = CacheVersion;
+
+    return MurmurHash64(&keyData, sizeof(keyData));
+}
+
+std::wstring MapCache::EntryPath(uint64 key) const
+{
+    wchar name[32];
+    swprintf_s(name, L"%016llx.bin", key);
+    return cacheDir + name;
+}
+
+// Reads the texture and subresource headers for one texture, and checks that everything is in bounds
+// and that every subresource has the pitch and row count that its format and size call for
+static bool ReadCachedTexture(const MemoryMappedFile& file, const CacheTextureHeader& texHeader,
+                              const CacheSubresourceHeader* subresourceHeaders, uint32& subresourceIdx,
+                              uint32 numSubresources, CachedTexture& texture)
+{
+    texture.Width = texHeader.Width;
+    texture.Height = texHeader.Height;
+    texture.NumMipLevels = texHeader.NumMipLevels;
+    texture.ArraySize = texHeader.ArraySize;
+    texture.Format = static_cast<DXGI_FORMAT>(texHeader.Format);
+
+    const uint32 texelSize = BakedTexelSize(texture.Format);
+    if(texelSize == 0 || texture.Width == 0 || texture.Height == 0 || texture.ArraySize == 0)
+        return false;
+
+    uint32 maxMipLevels = 1;
+    while((std::max(texture.Width, texture.Height) >> maxMipLevels) > 0)
+        ++maxMipLevels;
+    if(texture.NumMipLevels == 0 || texture.NumMipLevels > maxMipLevels)
+        return false;
+
+    const uint64 count = uint64(texture.NumMipLevels) * texture.ArraySize;
+    if(count > numSubresources - subresourceIdx)
+        return false;
+
+    const bool blockCompressed = IsBlockCompressed(texture.Format);
+
+    texture.Subresources.resize(static_cast<size_t>(count));
+    for(uint32 i = 0; i < count; ++i)
+    {
+        const CacheSubresourceHeader& header = subresourceHeaders[subresourceIdx++];
+
+        const uint32 mipLevel = i % texture.NumMipLevels;
+        uint64 mipWidth = std::max<uint32>(texture.Width >> mipLevel, 1);
+        uint64 mipHeight = std::max<uint32>(texture.Height >> mipLevel, 1);
+        if(blockCompressed)
+        {
+            mipWidth = (mipWidth + 3) / 4;
+            mipHeight = (mipHeight + 3) / 4;
+        }
+
+        if(header.RowPitch != mipWidth * texelSize || header.NumRows != mipHeight)
+            return false;
+
+        const uint64 size = uint64(header.RowPitch) * header.NumRows;
+        if(header.Offset > file.Size() || size > file.Size() - header.Offset)
+            return false;
+
+        texture.Subresources[i].Data = file.Data() + header.Offset;
+        texture.Subresources[i].RowPitch = header.RowPitch;
+        texture.Subresources[i].NumRows = header.NumRows;
+    }
+
+    return true;
+}
+
+bool MapCache::LoadEntry(uint64 key, MemoryMappedFile& file, CachedTexture* const* textures, uint32 numTextures)
+{
+    const std::wstring path = EntryPath(key);
+    if(FileExists(path.c_str()) == false)
+    {
+        ++misses;
+        return false;
+    }
+
+    file.OpenRead(path.c_str());
+
+    bool valid = file.Size() >= sizeof(CacheFileHeader);
+
+    const CacheFileHeader* header = reinterpret_cast<const CacheFileHeader*>(file.Data());
+    uint64 headersSize = 0;
+    if(valid)
+    {
+        valid = header->Magic == CacheMagic && header->Version == CacheVersion && header->Key == key
+                && header->NumTextures == numTextures;
+        headersSize = sizeof(CacheFileHeader) + header->NumTextures * sizeof(CacheTextureHeader)
+                      + uint64(header->NumSubresources) * sizeof(CacheSubresourceHeader);
+        valid = valid && file.Size() >= headersSize;
+    }
+
+    if(valid)
+    {
+        const CacheTextureHeader* texHeaders = reinterpret_cast<const CacheTextureHeader*>(header + 1);
+        const CacheSubresourceHeader* subresourceHeaders = reinterpret_cast<const CacheSubresourceHeader*>(texHeaders + numTextures);
+
+        uint32 subresourceIdx = 0;
+        for(uint32 i = 0; i < numTextures && valid; ++i)
+            valid = ReadCachedTexture(file, texHeaders[i], subresourceHeaders, subresourceIdx,
+                                      header->NumSubresources, *textures[i]);
+    }
+
+    // Treat corrupt or truncated entries as a miss, they'll be overwritten by the next Store
+    if(valid == false)
+    {
+        file.Close();
+        ++misses;
+        return false;
+    }
+
+    ++hits;
+    bytesRead += file.Size();
+
+    return true;
+}
+
+void MapCache::StoreEntry(uint64 key, const BakedTexture* const* textures, uint32 numTextures)
+{
+    uint32 numSubresources = 0;
+    for(uint32 i = 0; i < numTextures; ++i)
+        numSubresources += textures[i]->NumMipLevels * textures[i]->ArraySize;
+
+    uint64 fileSize = sizeof(CacheFileHeader) + numTextures * sizeof(CacheTextureHeader)
+                      + numSubresources * sizeof(CacheSubresourceHeader);
+    for(uint32 i = 0; i < numTextures; ++i)
+        for(uint64 j = 0; j < textures[i]->Subresources.size(); ++j)
+            fileSize = AlignOffset(fileSize) + textures[i]->Subresources[j].size();
+
+    // Write to a temporary file and then rename it, so that readers never see a partial entry
+    const std::wstring path = EntryPath(key);
+    const std::wstring tempPath = path + L"." + ToString(GetCurrentProcessId()) + L"_" + ToString(nextTempFile++) + L".tmp";
+
+    {
+        MemoryMappedFile file;
+        file.Create(tempPath.c_str(), fileSize);
+        uint8* fileData = file.Data();
+
+        CacheFileHeader* header = reinterpret_cast<CacheFileHeader*>(fileData);
+        header->Magic = CacheMagic;
+        header->Version = CacheVersion;
+        header->Key = key;
+        header->NumTextures = numTextures;
+        header->NumSubresources = numSubresources;
+
+        CacheTextureHeader* texHeaders = reinterpret_cast<CacheTextureHeader*>(header + 1);
+        CacheSubresourceHeader* subresourceHeaders = reinterpret_cast<CacheSubresourceHeader*>(texHeaders + numTextures);
+        uint64 offset = reinterpret_cast<uint8*>(subresourceHeaders + numSubresources) - fileData;
+
+        for(uint32 i = 0; i < numTextures; ++i)
+        {
+            const BakedTexture& texture = *textures[i];
+            texHeaders[i].Width = texture.Width;
+            texHeaders[i].Height = texture.Height;
+            texHeaders[i].NumMipLevels = texture.NumMipLevels;
+            texHeaders[i].ArraySize = texture.ArraySize;
+            texHeaders[i].Format = texture.Format;
+            texHeaders[i].Padding = 0;
+
+            for(uint32 j = 0; j < texture.Subresources.size(); ++j)
+            {
+                const uint32 mipLevel = j % texture.NumMipLevels;
+                offset = AlignOffset(offset);
+                subresourceHeaders->Offset = offset;
+                subresourceHeaders->RowPitch = texture.RowPitch(mipLevel);
+                subresourceHeaders->NumRows = texture.NumRows(mipLevel);
+                ++subresourceHeaders;
+
+                memcpy(fileData + offset, texture.Subresources[j].data(), texture.Subresources[j].size());
+                offset += texture.Subresources[j].size();
+            }
+        }
+
+        file.Flush();
+    }
+
+    // The rename fails if the existing entry is currently mapped, in which case it's still valid
+    // and there's nothing to replace
+    if(MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) == FALSE)
+    {
+        DeleteFile(tempPath.c_str());
+        return;
+    }
+
+    bytesWritten += fileSize;
+}
+
+bool MapCache::Load(uint64 key, CachedMaps& maps)
+{
+    CachedTexture* textures[] = { &maps.LEANMap, &maps.VMFMap, &maps.RoughnessMap };
+    return LoadEntry(key, maps.File, textures, ARRAYSIZE(textures));
+}
+
+void MapCache::Store(uint64 key, const BakedMaps& maps)
+{
+    const BakedTexture* textures[] = { &maps.LEANMap, &maps.VMFMap, &maps.RoughnessMap };
+    StoreEntry(key, textures, ARRAYSIZE(textures));
+}
+
+uint64 MapCache::ComputeCompressedKey(uint64 bakeKey, BCQuality quality)
+{
+    const uint64 keyData[2] = { bakeKey, uint64(quality) };
+    return MurmurHash64(keyData, sizeof(keyData));
+}
+
+bool MapCache::LoadCompressed(uint64 key, CachedCompressedMaps& maps)
+{
+    CachedTexture* textures[] = { &maps.LEANMap, &maps.VMFDirectionMap, &maps.VMFShapeMap, &maps.RoughnessMap };
+    return LoadEntry(key, maps.File, textures, ARRAYSIZE(textures));
+}
+
+void MapCache::StoreCompressed(uint64 key, const CompressedMaps& maps)
+{
+    const BakedTexture* textures[] = { &maps.LEANMap, &maps.VMFDirectionMap, &maps.VMFShapeMap, &maps.RoughnessMap };
+    StoreEntry(key, textures, ARRAYSIZE(textures));
+}
+
+MapCacheStats MapCache::Stats() const
+{
+    MapCacheStats stats;
+    stats.Hits = hits;
+    stats.Misses = misses;
+    stats.BytesRead = bytesRead;
+    stats.BytesWritten = bytesWritten;
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/FileIO.h"
+
+#include "MapBaker.h"
+#include "MapCompression.h"
+
+using namespace SampleFramework11;
+
+// A texture stored in a cache file. The subresources point directly into the file mapping.
+struct CachedTexture
+{
+    struct Subresource
+    {
+        const uint8* Data;
+        uint32 RowPitch;
+        uint32 NumRows;
+    };
+
+    uint32 Width;
+    uint32 Height;
+    uint32 NumMipLevels;
+    uint32 ArraySize;
+    DXGI_FORMAT Format;
+    std::vector<Subresource> Subresources;
+
+    CachedTexture();
+
+    // Uploads every subresource to a texture with matching dimensions and format
+    void Upload(ID3D11DeviceContext* context, ID3D11Texture2D* texture) const;
+
+    void CopyTo(BakedTexture& texture) const;
+};
+
+// A set of maps loaded from the cache, which stay valid for as long as the file stays mapped
+struct CachedMaps
+{
+    MemoryMappedFile File;
+    CachedTexture LEANMap;
+    CachedTexture VMFMap;
+    CachedTexture RoughnessMap;
+
+    void CopyTo(BakedMaps& maps) const;
+};
+
+// Block-compressed maps loaded from the cache
+struct CachedCompressedMaps
+{
+    MemoryMappedFile File;
+    CachedTexture LEANMap;
+    CachedTexture VMFDirectionMap;
+    CachedTexture VMFShapeMap;
+    CachedTexture RoughnessMap;
+
+    void CopyTo(CompressedMaps& maps) const;
+};
+
+struct MapCacheStats
+{
+    uint64 Hits;
+    uint64 Misses;
+    uint64 BytesRead;
+    uint64 BytesWritten;
+
+    MapCacheStats() : Hits(0), Misses(0), BytesRead(0), BytesWritten(0)
+    {
+    }
+
+    std::wstring ToString() const;
+};
+
+// Persistent on-disk cache of baked maps. Entries are keyed by a hash of the normal map texels
+// and every setting that affects the bake, so they never need to be invalidated.
+class MapCache
+{
+
+public:
+
+    MapCache();
+
+    void Initialize(const wchar* cacheDir);
+
+    static uint64 ComputeKey(const NormalMapData& normalMap, const BakeSettings& settings);
+
+    // Maps the cache entry for the key, and returns false if there isn't one
+    bool Load(uint64 key, CachedMaps& maps);
+
+    void Store(uint64 key, const BakedMaps& maps);
+
+    // Compressed maps are stored in their own entries, keyed by the key of the bake that they
+    // were compressed from and the compression quality
+    static uint64 ComputeCompressedKey(uint64 bakeKey, BCQuality quality);
+
+    bool LoadCompressed(uint64 key, CachedCompressedMaps& maps);
+
+    void StoreCompressed(uint64 key, const CompressedMaps& maps);
+
+    MapCacheStats Stats() const;
+
+protected:
+
+    std::wstring EntryPath(uint64 key) const;
+
+    bool LoadEntry(uint64 key, MemoryMappedFile& file, CachedTexture* const* textures, uint32 numTextures);
+    void StoreEntry(uint64 key, const BakedTexture* const* textures, uint32 numTextures);
+
+    std::wstring cacheDir;
+
+    // Counters are atomic so that the cache can be shared by multiple baking threads
+    std::atomic<uint64> hits;
+    std::atomic<uint64> misses;
+    std::atomic<uint64> bytesRead;
+    std::atomic<uint64> bytesWritten;
+    std::atomic<uint64> nextTempFile;
+};
\ No newline at end of file
@@ -0,0 +1,301 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MapCompression.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/SIMD.h"
+#include "SampleFramework11/Timer.h"
+
+static const DXGI_FORMAT LEANFormat = DXGI_FORMAT_BC6H_SF16;
+static const DXGI_FORMAT VMFDirectionFormat = DXGI_FORMAT_BC5_SNORM;
+static const DXGI_FORMAT VMFShapeFormat = NumVMFs > 1 ? DXGI_FORMAT_BC5_UNORM : DXGI_FORMAT_BC4_UNORM;
+static const DXGI_FORMAT RoughnessFormat = DXGI_FORMAT_BC5_UNORM;
+
+static uint64 TextureTexels(const BakedTexture& texture)
+{
+    uint64 texels = 0;
+    for(uint32 mip = 0; mip < texture.NumMipLevels; ++mip)
+        texels += uint64(texture.MipWidth(mip)) * texture.MipHeight(mip);
+    return texels * texture.ArraySize;
+}
+
+// Largest absolute difference of the first numChannels channels
+static float MaxChannelError(const Float4& a, const Float4& b, uint32 numChannels)
+{
+    const float diffs[4] = { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+
+    float maxError = 0.0f;
+    for(uint32 c = 0; c < numChannels; ++c)
+        maxError = std::max(maxError, std::abs(diffs[c]));
+    return maxError;
+}
+
+// Compresses every subresource of a full map, after converting each row of texels with
+// convertRow(src, mipLevel, arraySlice, y, dstRow)
+template<typename T> static void CompressTexture(const BakedTexture& src, DXGI_FORMAT format, BCQuality quality,
+                                                 BakedTexture& dst, T convertRow)
+{
+    dst.Initialize(src.Width, src.Height, format, src.NumMipLevels, src.ArraySize);
+
+    std::vector<Float4> texels(uint64(src.Width) * src.Height);
+    for(uint32 slice = 0; slice < src.ArraySize; ++slice)
+    {
+        for(uint32 mip = 0; mip < src.NumMipLevels; ++mip)
+        {
+            const uint32 width = src.MipWidth(mip);
+            ThreadPool::GlobalPool.ParallelFor(src.MipHeight(mip), [&](uint32 y, uint32 threadIdx)
+            {
+                convertRow(src, mip, slice, y, &texels[uint64(y) * width]);
+            });
+
+            CompressBC(format, quality, width, src.MipHeight(mip), texels.data(), dst.Data(mip, slice));
+        }
+    }
+}
+
+// Calls measure(x, y, decoded, threadIdx) for every texel of a compressed subresource, with the
+// rows of blocks split across ThreadPool::GlobalPool
+template<typename T> static void ForEachDecodedTexel(const BakedTexture& texture, uint32 mipLevel, uint32 arraySlice,
+                                                     T measure)
+{
+    const uint32 width = texture.MipWidth(mipLevel);
+    const uint32 height = texture.MipHeight(mipLevel);
+    const uint32 blocksWide = (width + 3) / 4;
+    const uint8* data = texture.Data(mipLevel, arraySlice);
+
+    ThreadPool::GlobalPool.ParallelFor(texture.NumRows(mipLevel), [&](uint32 blockY, uint32 threadIdx)
+    {
+        for(uint32 blockX = 0; blockX < blocksWide; ++blockX)
+        {
+            Float4 decoded[16];
+            DecompressBCBlock(texture.Format, data + blockY * texture.RowPitch(mipLevel) + blockX * texture.TexelSize, decoded);
+
+            for(uint32 i = 0; i < 16; ++i)
+            {
+                const uint32 x = blockX * 4 + (i % 4);
+                const uint32 y = blockY * 4 + (i / 4);
+                if(x < width && y < height)
+                    measure(x, y, decoded[i], threadIdx);
+            }
+        }
+    });
+}
+
+//=================================================================================================
+// CompressionStats
+//=================================================================================================
+
+CompressionStats::CompressionStats() :  Seconds(0.0),
+                                        TexelsProcessed(0),
+                                        UncompressedBytes(0),
+                                        CompressedBytes(0),
+                                        NumThreads(1),
+                                        Quality(BCQualityNormal)
+{
+}
+
+double CompressionStats::MegabytesPerSecond() const
+{
+    return Seconds > 0.0 ? UncompressedBytes / (Seconds * 1024.0 * 1024.0) : 0.0;
+}
+
+double CompressionStats::Ratio() const
+{
+    return CompressedBytes > 0 ? double(UncompressedBytes) / CompressedBytes : 0.0;
+}
+
+std::wstring CompressionStats::ToString() const
+{
+    std::wstring text = std::wstring(BCQualityName(Quality)) + L": compressed ";
+    text += SampleFramework11::ToString(UncompressedBytes / (1024.0 * 1024.0)) + L"MB to ";
+    text += SampleFramework11::ToString(CompressedBytes / (1024.0 * 1024.0)) + L"MB (";
+    text += SampleFramework11::ToString(Ratio()) + L":1) in ";
+    text += SampleFramework11::ToString(Seconds * 1000.0) + L"ms using ";
+    text += SampleFramework11::ToString(NumThreads) + L" threads (";
+    text += SampleFramework11::ToString(MegabytesPerSecond()) + L" MB/s, ";
+    text += SampleFramework11::ToString(Seconds > 0.0 ? TexelsProcessed / (Seconds * 1000000.0) : 0.0) + L" MTexels/s)\n";
+    text += L"  LEAN error: " + LEANError.ToString() + L"\n";
+    text += L"  vMF direction error (degrees): " + VMFAngle.ToString() + L"\n";
+    text += L"  vMF kappa relative error: " + VMFKappa.ToString() + L"\n";
+    text += L"  Roughness error: " + RoughnessError.ToString();
+    return text;
+}
+
+//=================================================================================================
+// MapCompressor
+//=================================================================================================
+
+MapCompressor::MapCompressor()
+{
+}
+
+void MapCompressor::Compress(const BakedMaps& maps, BCQuality quality, CompressedMaps& compressed)
+{
+    Timer timer;
+
+    // LEAN and roughness texels are compressed as-is
+    auto copyRow = [](const BakedTexture& src, uint32 mip, uint32 slice, uint32 y, Float4* dstRow)
+    {
+        for(uint32 x = 0; x < src.MipWidth(mip); ++x)
+            dstRow[x] = src.Texel(mip, slice, x, y);
+    };
+
+    CompressTexture(maps.LEANMap, LEANFormat, quality, compressed.LEANMap, copyRow);
+    CompressTexture(maps.RoughnessMap, RoughnessFormat, quality, compressed.RoughnessMap, copyRow);
+
+    CompressTexture(maps.VMFMap, VMFDirectionFormat, quality, compressed.VMFDirectionMap,
+                    [](const BakedTexture& src, uint32 mip, uint32 slice, uint32 y, Float4* dstRow)
+    {
+        for(uint32 x = 0; x < src.MipWidth(mip); ++x)
+        {
+            const Float4 vmf = src.Texel(mip, slice, x, y);
+            dstRow[x] = Float4(vmf.x, vmf.y, 0.0f, 1.0f);
+        }
+    });
+
+    // The full vMF map stores 1 / kappa, which is log-encoded 8 texels at a time
+    CompressTexture(maps.VMFMap, VMFShapeFormat, quality, compressed.VMFShapeMap,
+                    [](const BakedTexture& src, uint32 mip, uint32 slice, uint32 y, Float4* dstRow)
+    {
+        const uint32 width = src.MipWidth(mip);
+        for(uint32 startX = 0; startX < width; startX += Float8::Width)
+        {
+            const uint32 count = std::min(width - startX, Float8::Width);
+
+            float kappas[Float8::Width];
+            float alphas[Float8::Width];
+            for(uint32 i = 0; i < Float8::Width; ++i)
+            {
+                const Float4 vmf = src.Texel(mip, slice, startX + std::min(i, count - 1), y);
+                kappas[i] = 1.0f / std::max(vmf.w, FLT_MIN);
+                alphas[i] = vmf.z;
+            }
+
+            float encoded[Float8::Width];
+            EncodeLogKappa(Float8::Load(kappas)).Store(encoded);
+
+            for(uint32 i = 0; i < count; ++i)
+                dstRow[startX + i] = Float4(encoded[i], alphas[i], 0.0f, 1.0f);
+        }
+    });
+
+    timer.Update();
+
+    stats = CompressionStats();
+    stats.Seconds = timer.ElapsedSecondsD();
+    stats.NumThreads = ThreadPool::GlobalPool.NumThreads();
+    stats.Quality = quality;
+    stats.TexelsProcessed = TextureTexels(maps.LEANMap) + TextureTexels(maps.RoughnessMap) + TextureTexels(maps.VMFMap) * 2;
+    stats.UncompressedBytes = TextureBytes(maps.LEANMap) + TextureBytes(maps.VMFMap) + TextureBytes(maps.RoughnessMap);
+    stats.CompressedBytes = TextureBytes(compressed.LEANMap) + TextureBytes(compressed.VMFDirectionMap)
+                            + TextureBytes(compressed.VMFShapeMap) + TextureBytes(compressed.RoughnessMap);
+}
+
+void MapCompressor::MeasureError(const BakedMaps& maps, const CompressedMaps& compressed)
+{
+    // Each thread accumulates its own stats, which are combined at the end
+    std::vector<CompressionStats> threadStats(ThreadPool::GlobalPool.NumThreads());
+
+    for(uint32 mip = 0; mip < maps.LEANMap.NumMipLevels; ++mip)
+    {
+        for(uint32 slice = 0; slice < maps.LEANMap.ArraySize; ++slice)
+        {
+            ForEachDecodedTexel(compressed.LEANMap, mip, slice, [&](uint32 x, uint32 y, const Float4& decoded, uint32 threadIdx)
+            {
+                const Float4 reference = maps.LEANMap.Texel(mip, slice, x, y);
+                threadStats[threadIdx].LEANError.Add(MaxChannelError(decoded, reference, 3));
+            });
+        }
+
+        ForEachDecodedTexel(compressed.RoughnessMap, mip, 0, [&](uint32 x, uint32 y, const Float4& decoded, uint32 threadIdx)
+        {
+            const Float4 reference = maps.RoughnessMap.Texel(mip, 0, x, y);
+            threadStats[threadIdx].RoughnessError.Add(MaxChannelError(decoded, reference, 2));
+        });
+
+        for(uint32 slice = 0; slice < maps.VMFMap.ArraySize; ++slice)
+        {
+            ForEachDecodedTexel(compressed.VMFDirectionMap, mip, slice, [&](uint32 x, uint32 y, const Float4& decoded, uint32 threadIdx)
+            {
+                // The lobe is undefined when the normals cancel out completely
+                const Float4 reference = maps.VMFMap.Texel(mip, slice, x, y);
+                if(reference.w >= FLT_MAX)
+                    return;
+
+                const float cosAngle = Clamp(Float3::Dot(DecodeMu(decoded.x, decoded.y), DecodeMu(reference.x, reference.y)), -1.0f, 1.0f);
+                threadStats[threadIdx].VMFAngle.Add(std::acos(cosAngle) * 180.0 / Pi);
+            });
+
+            ForEachDecodedTexel(compressed.VMFShapeMap, mip, slice, [&](uint32 x, uint32 y, const Float4& decoded, uint32 threadIdx)
+            {
+                const Float4 reference = maps.VMFMap.Texel(mip, slice, x, y);
+                if(reference.w >= FLT_MAX)
+                    return;
+
+                // Lobes sharper than the top of the log range are indistinguishable when shading
+                const float referenceKappa = std::min(1.0f / std::max(reference.w, FLT_MIN), DecodeLogKappa(1.0f));
+                threadStats[threadIdx].VMFKappa.Add(std::abs(DecodeLogKappa(decoded.x) - referenceKappa) / referenceKappa);
+            });
+        }
+    }
+
+    for(uint64 t = 0; t < threadStats.size(); ++t)
+    {
+        stats.LEANError.Add(threadStats[t].LEANError);
+        stats.VMFAngle.Add(threadStats[t].VMFAngle);
+        stats.VMFKappa.Add(threadStats[t].VMFKappa);
+        stats.RoughnessError.Add(threadStats[t].RoughnessError);
+    }
+}
+
+//=================================================================================================
+// CompressionBenchmark
+//=================================================================================================
+
+void CompressionBenchmark::Run(const BakedMaps& maps, uint32 numIterations)
+{
+    MapCompressor compressor;
+    CompressedMaps compressed;
+
+    for(uint32 quality = 0; quality < NumBCQualities; ++quality)
+    {
+        CompressionStats& result = Results[quality];
+        for(uint32 i = 0; i < numIterations; ++i)
+        {
+            compressor.Compress(maps, BCQuality(quality), compressed);
+            if(i == 0 || compressor.Stats().Seconds < result.Seconds)
+                result = compressor.Stats();
+        }
+
+        compressor.MeasureError(maps, compressed);
+        result.LEANError = compressor.Stats().LEANError;
+        result.VMFAngle = compressor.Stats().VMFAngle;
+        result.VMFKappa = compressor.Stats().VMFKappa;
+        result.RoughnessError = compressor.Stats().RoughnessError;
+    }
+}
+
+std::wstring CompressionBenchmark::ToString() const
+{
+    std::wstring text;
+    for(uint32 i = 0; i < NumBCQualities; ++i)
+    {
+        text += Results[i].ToString();
+        if(i + 1 < NumBCQualities)
+            text += L"\n";
+    }
+
+    return text;
+}
\ No newline at end of file
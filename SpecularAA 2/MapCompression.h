@@ -0,0 +1,90 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/BlockCompression.h"
+
+#include "MapBaker.h"
+#include "MapEncoding.h"
+
+using namespace SampleFramework11;
+
+// Block-compressed versions of the baked maps. The vMF map is split in two, so that the
+// direction can be stored as signed BC5 and kappa can be log-encoded like in the compact vMF map.
+//
+//   LEAN map (BC6H_SF16):              the same 2 slices as the full LEAN map, M.x + M.y is
+//                                      recomputed when shading
+//   vMF direction map (BC5_SNORM):     mu.xy, one slice per lobe
+//   vMF shape map (BC4_UNORM):         log-encoded kappa, one slice per lobe. Uses BC5_UNORM
+//                                      with alpha in the second channel when NumVMFs > 1.
+//   Roughness map (BC5_UNORM):         lobe roughness, average normal length
+struct CompressedMaps
+{
+    BakedTexture LEANMap;
+    BakedTexture VMFDirectionMap;
+    BakedTexture VMFShapeMap;
+    BakedTexture RoughnessMap;
+};
+
+struct CompressionStats
+{
+    double Seconds;
+    uint64 TexelsProcessed;         // Texels summed over every map, slice and mip level
+    uint64 UncompressedBytes;       // Size of the full maps
+    uint64 CompressedBytes;
+    uint32 NumThreads;
+    BCQuality Quality;
+
+    ErrorStats LEANError;           // Largest absolute channel error of each LEAN texel
+    ErrorStats VMFAngle;            // Angle between the lobe directions in degrees
+    ErrorStats VMFKappa;            // Relative error of kappa
+    ErrorStats RoughnessError;      // Largest absolute channel error of each roughness texel
+
+    CompressionStats();
+
+    double MegabytesPerSecond() const;  // Of uncompressed input
+    double Ratio() const;
+    std::wstring ToString() const;
+};
+
+// Compresses the baked maps on the CPU, with every map, slice and mip level split into rows of
+// blocks that are distributed across ThreadPool::GlobalPool
+class MapCompressor
+{
+
+public:
+
+    MapCompressor();
+
+    void Compress(const BakedMaps& maps, BCQuality quality, CompressedMaps& compressed);
+
+    // Decodes the compressed maps, and adds the error relative to the full maps to the stats
+    void MeasureError(const BakedMaps& maps, const CompressedMaps& compressed);
+
+    const CompressionStats& Stats() const { return stats; }
+
+protected:
+
+    CompressionStats stats;
+};
+
+// Compresses the maps at every quality level, and reports the best time of several runs along
+// with the error of each level
+struct CompressionBenchmark
+{
+    CompressionStats Results[NumBCQualities];
+
+    void Run(const BakedMaps& maps, uint32 numIterations);
+
+    std::wstring ToString() const;
+};
\ No newline at end of file
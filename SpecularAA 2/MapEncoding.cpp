@@ -0,0 +1,262 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MapEncoding.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/ThreadPool.h"
+
+// Covariance errors are relative to the norm of the covariance plus this, since variances that
+// are much smaller are swamped by the base roughness when shading
+static const double CovarianceErrorFloor = 1.0 / 1024.0;
+
+//=================================================================================================
+// Encoders and decoders
+//=================================================================================================
+
+Float8 EncodeLogVariance(const Float8& variance)
+{
+    const float minVariance = std::exp2(CompactVarianceLog2Min);
+    const float invLogRange = 1.0f / (CompactVarianceLog2Max - CompactVarianceLog2Min);
+
+    Float8 linear = Float8::Max(variance, 0.0f) / (minVariance * 255.0f);
+    Float8 t = Float8::Saturate((Float8::Log2(Float8::Max(variance, minVariance)) - CompactVarianceLog2Min) * invLogRange);
+    Float8 logEncoded = (t * 254.0f + 1.0f) / 255.0f;
+    return Float8::Select(variance <= minVariance, linear, logEncoded);
+}
+
+Float8 EncodeLogKappa(const Float8& kappa)
+{
+    const float invLogRange = 1.0f / (CompactKappaLog2Max - CompactKappaLog2Min);
+    return Float8::Saturate((Float8::Log2(kappa) - CompactKappaLog2Min) * invLogRange);
+}
+
+float DecodeLogVariance(float encoded)
+{
+    const float code = encoded * 255.0f;
+    if(code <= 1.0f)
+        return code * std::exp2(CompactVarianceLog2Min);
+
+    const float t = (code - 1.0f) / 254.0f;
+    return std::exp2(CompactVarianceLog2Min + t * (CompactVarianceLog2Max - CompactVarianceLog2Min));
+}
+
+float DecodeLogKappa(float encoded)
+{
+    return std::exp2(CompactKappaLog2Min + encoded * (CompactKappaLog2Max - CompactKappaLog2Min));
+}
+
+Float3 DecodeMu(float x, float y)
+{
+    return Float3::Normalize(Float3(x, y, std::sqrt(Saturate(1.0f - (x * x + y * y)))));
+}
+
+uint64 TextureBytes(const BakedTexture& texture)
+{
+    uint64 bytes = 0;
+    for(uint64 i = 0; i < texture.Subresources.size(); ++i)
+        bytes += texture.Subresources[i].size();
+    return bytes;
+}
+
+//=================================================================================================
+// ErrorStats
+//=================================================================================================
+
+void ErrorStats::Add(double error)
+{
+    SumSquared += error * error;
+    Max = std::max(Max, error);
+    ++Count;
+}
+
+void ErrorStats::Add(const ErrorStats& other)
+{
+    SumSquared += other.SumSquared;
+    Max = std::max(Max, other.Max);
+    Count += other.Count;
+}
+
+double ErrorStats::RMS() const
+{
+    return Count > 0 ? std::sqrt(SumSquared / Count) : 0.0;
+}
+
+std::wstring ErrorStats::ToString() const
+{
+    return L"RMS " + SampleFramework11::ToString(RMS()) + L", max " + SampleFramework11::ToString(Max);
+}
+
+//=================================================================================================
+// EncodingReport
+//=================================================================================================
+
+// Covariance and vMF lobe, decoded from either set of maps or computed from the moments
+struct DecodedTexel
+{
+    Float2 B;
+    Float3 Sigma;
+    Float3 Mu;
+    float Kappa;
+};
+
+static DecodedTexel ReferenceTexel(const MomentPyramid::Level& level, bool baseLevel, uint32 idx)
+{
+    DecodedTexel texel;
+    texel.B = Float2(level.Data[MomentPyramid::BX][idx], level.Data[MomentPyramid::BY][idx]);
+    texel.Sigma.x = std::max(level.Data[MomentPyramid::MXX][idx] - texel.B.x * texel.B.x, 0.0f);
+    texel.Sigma.y = std::max(level.Data[MomentPyramid::MYY][idx] - texel.B.y * texel.B.y, 0.0f);
+    texel.Sigma.z = level.Data[MomentPyramid::MXY][idx] - texel.B.x * texel.B.y;
+
+    const Float3 avgNormal(level.Data[MomentPyramid::AvgNormalX][idx], level.Data[MomentPyramid::AvgNormalY][idx],
+                           level.Data[MomentPyramid::AvgNormalZ][idx]);
+    const float r = Float3::Length(avgNormal);
+    texel.Mu = Float3::Normalize(avgNormal);
+    texel.Kappa = (baseLevel || r >= 1.0f) ? MaxKappa : (3.0f * r - r * r * r) / (1.0f - r * r);
+
+    return texel;
+}
+
+static DecodedTexel DecodeFullTexel(const BakedMaps& maps, uint32 mipLevel, uint32 x, uint32 y, float scaleFactor)
+{
+    const Float4 leanB = maps.LEANMap.Texel(mipLevel, 0, x, y);
+    const Float4 leanM = maps.LEANMap.Texel(mipLevel, 1, x, y);
+    const Float4 vmf = maps.VMFMap.Texel(mipLevel, 0, x, y);
+
+    DecodedTexel texel;
+    texel.B = Float2(leanB.x, leanB.y) * scaleFactor;
+    texel.Sigma = Float3(leanM.x, leanM.y, leanM.z) * (scaleFactor * scaleFactor);
+    texel.Sigma -= Float3(texel.B.x * texel.B.x, texel.B.y * texel.B.y, texel.B.x * texel.B.y);
+    texel.Mu = DecodeMu(vmf.x, vmf.y);
+    texel.Kappa = 1.0f / vmf.w;
+
+    return texel;
+}
+
+static DecodedTexel DecodeCompactTexel(const CompactMaps& maps, uint32 mipLevel, uint32 x, uint32 y, float scaleFactor)
+{
+    const Float4 leanB = maps.LEANBMap.Texel(mipLevel, 0, x, y);
+    const Float4 covariance = maps.LEANCovarianceMap.Texel(mipLevel, 0, x, y);
+    const Float4 vmf = maps.VMFMap.Texel(mipLevel, 0, x, y);
+
+    DecodedTexel texel;
+    texel.B = Float2(leanB.x, leanB.y) * scaleFactor;
+    texel.Sigma.x = DecodeLogVariance(covariance.x);
+    texel.Sigma.y = DecodeLogVariance(covariance.y);
+    texel.Sigma.z = (covariance.z * 2.0f - 1.0f) * std::sqrt(texel.Sigma.x * texel.Sigma.y);
+    texel.Mu = DecodeMu(vmf.x * 2.0f - 1.0f, vmf.y * 2.0f - 1.0f);
+    texel.Kappa = DecodeLogKappa(vmf.z);
+
+    return texel;
+}
+
+static double CovarianceNorm(const Float3& sigma)
+{
+    return std::sqrt(double(sigma.x) * sigma.x + double(sigma.y) * sigma.y + 2.0 * sigma.z * sigma.z);
+}
+
+EncodingReport::EncodingReport()
+{
+    for(uint32 i = 0; i < NumEncodings; ++i)
+    {
+        MapBytes[i] = 0;
+        LEANFetchBytes[i] = 0;
+        VMFFetchBytes[i] = 0;
+    }
+}
+
+EncodingReport EncodingReport::Measure(const MomentPyramid& moments, const BakeSettings& settings,
+                                       const BakedMaps& fullMaps, const CompactMaps& compactMaps)
+{
+    // Each thread accumulates its own stats, which are combined at the end
+    std::vector<EncodingReport> threadReports(ThreadPool::GlobalPool.NumThreads());
+
+    for(uint32 mipLevel = 0; mipLevel < moments.Levels.size(); ++mipLevel)
+    {
+        const MomentPyramid::Level& level = moments.Levels[mipLevel];
+        ThreadPool::GlobalPool.ParallelFor(level.Height, [&](uint32 y, uint32 threadIdx)
+        {
+            EncodingReport& report = threadReports[threadIdx];
+            for(uint32 x = 0; x < level.Width; ++x)
+            {
+                const DecodedTexel reference = ReferenceTexel(level, mipLevel == 0, y * level.Width + x);
+                const DecodedTexel decoded[NumEncodings] =
+                {
+                    DecodeFullTexel(fullMaps, mipLevel, x, y, settings.ScaleFactor),
+                    DecodeCompactTexel(compactMaps, mipLevel, x, y, settings.ScaleFactor),
+                };
+
+                const double covarianceNorm = CovarianceNorm(reference.Sigma) + CovarianceErrorFloor;
+                for(uint32 i = 0; i < NumEncodings; ++i)
+                {
+                    report.LEANB[i].Add(Float2::Length(decoded[i].B - reference.B));
+                    report.LEANCovariance[i].Add(CovarianceNorm(decoded[i].Sigma - reference.Sigma) / covarianceNorm);
+
+                    // The lobe is undefined when the normals cancel out completely
+                    if(reference.Kappa <= 0.0f)
+                        continue;
+
+                    const float cosAngle = Clamp(Float3::Dot(decoded[i].Mu, reference.Mu), -1.0f, 1.0f);
+                    report.VMFAngle[i].Add(std::acos(cosAngle) * 180.0 / Pi);
+                    report.VMFKappa[i].Add(std::abs(decoded[i].Kappa - reference.Kappa) / reference.Kappa);
+                }
+            }
+        });
+    }
+
+    EncodingReport report;
+    for(uint64 t = 0; t < threadReports.size(); ++t)
+    {
+        for(uint32 i = 0; i < NumEncodings; ++i)
+        {
+            report.LEANB[i].Add(threadReports[t].LEANB[i]);
+            report.LEANCovariance[i].Add(threadReports[t].LEANCovariance[i]);
+            report.VMFAngle[i].Add(threadReports[t].VMFAngle[i]);
+            report.VMFKappa[i].Add(threadReports[t].VMFKappa[i]);
+        }
+    }
+
+    report.MapBytes[Full] = TextureBytes(fullMaps.LEANMap) + TextureBytes(fullMaps.VMFMap);
+    report.MapBytes[Compact] = TextureBytes(compactMaps.LEANBMap) + TextureBytes(compactMaps.LEANCovarianceMap)
+                               + TextureBytes(compactMaps.VMFMap);
+
+    // The full LEAN map is fetched once per slice, and a single full vMF lobe is fetched twice
+    // (once with each sampler)
+    report.LEANFetchBytes[Full] = fullMaps.LEANMap.TexelSize * fullMaps.LEANMap.ArraySize;
+    report.LEANFetchBytes[Compact] = compactMaps.LEANBMap.TexelSize + compactMaps.LEANCovarianceMap.TexelSize;
+    report.VMFFetchBytes[Full] = fullMaps.VMFMap.TexelSize * (NumVMFs > 1 ? NumVMFs : 2);
+    report.VMFFetchBytes[Compact] = compactMaps.VMFMap.TexelSize * NumVMFs;
+
+    return report;
+}
+
+std::wstring EncodingReport::ToString() const
+{
+    static const wchar* Names[NumEncodings] = { L"Full", L"Compact" };
+
+    std::wstring text;
+    for(uint32 i = 0; i < NumEncodings; ++i)
+    {
+        text += std::wstring(Names[i]) + L": " + SampleFramework11::ToString(MapBytes[i] / (1024.0 * 1024.0)) + L"MB, ";
+        text += SampleFramework11::ToString(LEANFetchBytes[i]) + L" LEAN bytes/pixel, ";
+        text += SampleFramework11::ToString(VMFFetchBytes[i]) + L" vMF bytes/pixel\n";
+        text += L"  LEAN B error: " + LEANB[i].ToString() + L"\n";
+        text += L"  LEAN covariance relative error: " + LEANCovariance[i].ToString() + L"\n";
+        text += L"  vMF direction error (degrees): " + VMFAngle[i].ToString() + L"\n";
+        text += L"  vMF kappa relative error: " + VMFKappa[i].ToString();
+        if(i + 1 < NumEncodings)
+            text += L"\n";
+    }
+
+    return text;
+}
\ No newline at end of file
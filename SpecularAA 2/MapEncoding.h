@@ -0,0 +1,90 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/SIMD.h"
+
+#include "MapBaker.h"
+
+using namespace SampleFramework11;
+
+// Compact versions of the LEAN and vMF maps, which need half the memory and fetch bandwidth of
+// the full maps. See MapEncoding.hlsl for the layouts.
+struct CompactMaps
+{
+    BakedTexture LEANBMap;              // R16G16_SNORM
+    BakedTexture LEANCovarianceMap;     // R8G8B8A8_UNORM
+    BakedTexture VMFMap;                // R10G10B10A2_UNORM, one slice per lobe
+};
+
+// kappa value used by SolveVMF for a lobe that represents a single normal
+const float MaxKappa = 10000.0f;
+
+// Reconstructs a lobe direction from its XY, the same way as Mesh.hlsl
+Float3 DecodeMu(float x, float y);
+
+// Size of every subresource of a baked texture
+uint64 TextureBytes(const BakedTexture& texture);
+
+// CPU versions of the log encodings in MapEncoding.hlsl. The encoders work on 8 texels at a time
+// for MapBaker, while the decoders are only used for measuring the error.
+Float8 EncodeLogVariance(const Float8& variance);
+Float8 EncodeLogKappa(const Float8& kappa);
+float DecodeLogVariance(float encoded);
+float DecodeLogKappa(float encoded);
+
+// RMS and maximum of a set of errors
+struct ErrorStats
+{
+    double SumSquared;
+    double Max;
+    uint64 Count;
+
+    ErrorStats() : SumSquared(0.0), Max(0.0), Count(0)
+    {
+    }
+
+    void Add(double error);
+    void Add(const ErrorStats& other);
+    double RMS() const;
+    std::wstring ToString() const;
+};
+
+// Measures how much the full and compact encodings lose relative to the floating-point moment
+// pyramid that they're both resolved from, along with their sizes
+struct EncodingReport
+{
+    enum Encodings
+    {
+        Full = 0,
+        Compact,
+
+        NumEncodings
+    };
+
+    ErrorStats LEANB[NumEncodings];             // Absolute error of B, with the scale factor applied
+    ErrorStats LEANCovariance[NumEncodings];    // Error of the covariance matrix, relative to its norm
+    ErrorStats VMFAngle[NumEncodings];          // Angle between the lobe directions in degrees
+    ErrorStats VMFKappa[NumEncodings];          // Relative error of kappa
+
+    uint64 MapBytes[NumEncodings];              // LEAN and vMF maps, all mip levels
+    uint32 LEANFetchBytes[NumEncodings];        // Bytes fetched per pixel when shading
+    uint32 VMFFetchBytes[NumEncodings];
+
+    EncodingReport();
+
+    static EncodingReport Measure(const MomentPyramid& moments, const BakeSettings& settings,
+                                  const BakedMaps& fullMaps, const CompactMaps& compactMaps);
+
+    std::wstring ToString() const;
+};
\ No newline at end of file
@@ -0,0 +1,130 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+// Compact encodings of the LEAN and vMF maps, which use half the memory and fetch bandwidth of
+// the full maps:
+//
+//   LEAN B map (R16G16_SNORM):             B / ScaleFactor
+//   LEAN covariance map (R8G8B8A8_UNORM):  log-encoded Sigma.xx, log-encoded Sigma.yy,
+//                                          correlation coefficient, unused
+//   vMF map (R10G10B10A2_UNORM):           mu.xy, log-encoded kappa, alpha
+//
+// The anisotropic roughness map (R11G11B10_FLOAT) stores the slope covariance about the average
+// normal instead, which replaces both LEAN maps when the normal comes from the normal map:
+//
+//   Sigma.xx, Sigma.yy, variance along the (1, 1) diagonal
+//
+// The covariance is stored instead of the second moments since it has a much smaller range, and
+// the second moments are reconstructed from it and B when shading. MapEncoding.cpp has the
+// matching CPU encoders and decoders.
+
+// ================================================================================================
+// Log encoding for a variance, in an 8-bit UNORM channel. Variances below the minimum of the
+// log range are stored linearly in the first code, so that 0 is exact and filtering between 0
+// and small variances stays continuous.
+// ================================================================================================
+float EncodeLogVariance(in float variance)
+{
+    const float minVariance = exp2(CompactVarianceLog2Min);
+    if(variance <= minVariance)
+        return max(variance, 0.0f) / (minVariance * 255.0f);
+
+    float t = (log2(variance) - CompactVarianceLog2Min) / (CompactVarianceLog2Max - CompactVarianceLog2Min);
+    return (1.0f + saturate(t) * 254.0f) / 255.0f;
+}
+
+float DecodeLogVariance(in float encoded)
+{
+    float code = encoded * 255.0f;
+    if(code <= 1.0f)
+        return code * exp2(CompactVarianceLog2Min);
+
+    float t = (code - 1.0f) / 254.0f;
+    return exp2(CompactVarianceLog2Min + t * (CompactVarianceLog2Max - CompactVarianceLog2Min));
+}
+
+// ================================================================================================
+// Log encoding for a vMF concentration parameter
+// ================================================================================================
+float EncodeLogKappa(in float kappa)
+{
+    return saturate((log2(kappa) - CompactKappaLog2Min) / (CompactKappaLog2Max - CompactKappaLog2Min));
+}
+
+float DecodeLogKappa(in float encoded)
+{
+    return exp2(CompactKappaLog2Min + encoded * (CompactKappaLog2Max - CompactKappaLog2Min));
+}
+
+// ================================================================================================
+// Encodes the LEAN moments (without the scale factor applied) into the compact B and covariance
+// maps
+// ================================================================================================
+void EncodeCompactLEAN(in float2 B, in float3 M, in float scaleFactor, out float2 encodedB,
+                       out float4 encodedCovariance)
+{
+    float3 sigma = M - float3(B * B, B.x * B.y);
+    sigma.xy = max(sigma.xy, 0.0f);
+
+    float varianceProduct = sigma.x * sigma.y;
+    float correlation = varianceProduct > 0.0f ? clamp(sigma.z * rsqrt(varianceProduct), -1.0f, 1.0f) : 0.0f;
+
+    encodedB = B / scaleFactor;
+    encodedCovariance = float4(EncodeLogVariance(sigma.x), EncodeLogVariance(sigma.y),
+                               correlation * 0.5f + 0.5f, 1.0f);
+}
+
+// ================================================================================================
+// Decodes filtered samples of the compact LEAN maps into the same B and M that are stored in
+// the full LEAN map
+// ================================================================================================
+void DecodeCompactLEAN(in float2 encodedB, in float4 encodedCovariance, in float scaleFactor,
+                       out float2 leanB, out float4 leanM)
+{
+    float2 variance = float2(DecodeLogVariance(encodedCovariance.x), DecodeLogVariance(encodedCovariance.y));
+    float correlation = encodedCovariance.z * 2.0f - 1.0f;
+    float3 sigma = float3(variance, correlation * sqrt(variance.x * variance.y));
+
+    leanB = encodedB;
+    leanM.xyz = sigma / (scaleFactor * scaleFactor) + float3(leanB * leanB, leanB.x * leanB.y);
+    leanM.w = leanM.x + leanM.y;
+}
+
+// ================================================================================================
+// Encodes a vMF lobe for the compact vMF map
+// ================================================================================================
+float4 EncodeCompactVMF(in VMF vmf)
+{
+    return float4(vmf.mu.xy * 0.5f + 0.5f, EncodeLogKappa(vmf.kappa), vmf.alpha);
+}
+
+// ================================================================================================
+// Decodes a filtered sample of the compact vMF map into the layout of the full vMF map:
+// (mu.xy, alpha, 1 / kappa)
+// ================================================================================================
+float4 DecodeCompactVMF(in float4 encoded)
+{
+    return float4(encoded.xy * 2.0f - 1.0f, encoded.w, 1.0f / DecodeLogKappa(encoded.z));
+}
+
+// ================================================================================================
+// Encodes a covariance from MeanNormalCovariance for the anisotropic roughness map. The float
+// formats are unsigned, so Sigma.xy is replaced by the variance along the diagonal. That keeps
+// every channel linear in the covariance, so that the map can be filtered.
+// ================================================================================================
+float3 EncodeAnisoRoughness(in float3 sigma)
+{
+    return max(float3(sigma.xy, 0.5f * (sigma.x + sigma.y) + sigma.z), 0.0f);
+}
+
+float3 DecodeAnisoRoughness(in float3 encoded)
+{
+    return float3(encoded.xy, encoded.z - 0.5f * (encoded.x + encoded.y));
+}
\ No newline at end of file
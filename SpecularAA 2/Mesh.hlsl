@@ -13,6 +13,9 @@
 //=================================================================================================
 #include "SharedConstants.h"
 #include "SampleFramework11\\Shaders\\SH.hlsl"
+#include "NormalMoments.hlsl"
+#include "MapEncoding.hlsl"
+#include "Sampling.hlsl"
 
 //=================================================================================================
 // Constants
@@ -38,6 +41,8 @@ static const uint NumCascades = 4;
     #define UsePrecomputedVMF_ 1
 #elif ShaderAAMode_ == 6
     #define UsePrecomputedToksvig_ 1
+#elif ShaderAAMode_ == 7
+    #define UseAnisoRoughness_ 1
 #endif
 
 //=================================================================================================
@@ -48,6 +53,7 @@ cbuffer VSConstants : register(b0)
     float4x4 World;
 	float4x4 View;
     float4x4 WorldViewProjection;
+    float PixelFootprintScale;
 }
 
 cbuffer PSConstants : register(b0)
@@ -63,6 +69,12 @@ cbuffer PSConstants : register(b0)
     bool EnableDiffuse;
     bool EnableSpecular;
     bool VMFDiffuseAA;
+    bool UseMomentSAT;
+    uint2 MomentSATSize;
+    float MomentSATMaxFootprint;
+    float4 MomentSATInvScales[2];
+    bool UseCompactMaps;
+    bool UseCompressedMaps;
 }
 
 //=================================================================================================
@@ -77,9 +89,40 @@ Texture2DArray<float4> LEANMap : register(t1);
     Texture2D<float4> VMFMap : register(t2);
 #endif
 
+// x = roughness added by the vMF lobe, y = length of the average normal
 Texture2D<float2> RoughnessMap : register(t3);
 
-StructuredBuffer<float2> SampleOffsets : register(t4);
+// t4 held the random sample offsets before they were generated in the shader, see Sampling.hlsl
+
+// Summed-area tables of the normal moments, see MomentSAT.h
+Texture2DArray<uint4> MomentSAT : register(t5);
+
+// Compact versions of the LEAN and vMF maps, see MapEncoding.hlsl
+Texture2D<float2> CompactLEANBMap : register(t6);
+Texture2D<float4> CompactLEANCovarianceMap : register(t7);
+
+#if NumVMFs > 1
+    Texture2DArray<float4> CompactVMFMap : register(t8);
+#else
+    Texture2D<float4> CompactVMFMap : register(t8);
+#endif
+
+// Block-compressed versions of the maps, see MapCompression.h. The vMF map is split into mu.xy
+// and log-encoded kappa (plus alpha when there's more than one lobe).
+Texture2DArray<float4> CompressedLEANMap : register(t9);
+
+#if NumVMFs > 1
+    Texture2DArray<float2> CompressedVMFDirectionMap : register(t10);
+    Texture2DArray<float2> CompressedVMFShapeMap : register(t11);
+#else
+    Texture2D<float2> CompressedVMFDirectionMap : register(t10);
+    Texture2D<float> CompressedVMFShapeMap : register(t11);
+#endif
+
+Texture2D<float2> CompressedRoughnessMap : register(t12);
+
+// Encoded slope covariance about the average normal, see MapEncoding.hlsl
+Texture2D<float3> AnisoRoughnessMap : register(t13);
 
 Texture2D LightingMap : register(t0);
 
@@ -97,6 +140,7 @@ struct VSInput
     float2 TexCoord 		: TEXCOORD0;
 	float3 TangentOS 		: TANGENT;
 	float3 BitangentOS		: BITANGENT;
+    float Curvature         : CURVATURE;
 };
 
 struct VSOutput
@@ -111,6 +155,7 @@ struct VSOutput
 	float3 TangentWS 		: TANGENTWS;
 	float3 BitangentWS 		: BITANGENTWS;
     float DepthVS			: DEPTHVS;
+    float CurvatureVariance : CURVATUREVARIANCE;
 
     float3 PositionWS 		: POSITIONWS;
 	float2 TexCoord 		: TEXCOORD;
@@ -123,6 +168,7 @@ struct PSInput
     float3 TangentWS 		: TANGENTWS;
 	float3 BitangentWS 		: BITANGENTWS;
     float DepthVS			: DEPTHVS;
+    float CurvatureVariance : CURVATUREVARIANCE;
 
     #if ShaderSupersampling_
         nointerpolation float2 TexCoord0 		: TEXCOORD0;
@@ -166,6 +212,14 @@ VSOutput VS(in VSInput input, in uint VertexID : SV_VertexID)
 	output.TangentWS = normalize(mul(input.TangentOS, (float3x3)World));
 	output.BitangentWS = normalize(mul(input.BitangentOS, (float3x3)World));
 
+    // Turn the precomputed curvature into the variance of the normal over the pixel footprint,
+    // which is the width of a pixel at this depth. Across a footprint of width w the normal turns
+    // by about curvature * w in both directions, so this matches the screen-space estimate of
+    // 0.25 * (|ddx(n)|^2 + |ddy(n)|^2) without needing any derivatives.
+    float worldScale = length(mul(float3(1.0f, 0.0f, 0.0f), (float3x3)World));
+    float footprintCurvature = input.Curvature / worldScale * output.DepthVS * PixelFootprintScale;
+    output.CurvatureVariance = 0.5f * footprintCurvature * footprintCurvature;
+
     // Pass along the texture coordinate
     output.TexCoord = input.TexCoord;
 
@@ -198,6 +252,7 @@ void GS(in triangle VSOutput input[3], inout TriangleStream<PSInput> TriStream)
         output.TangentWS = input[i].TangentWS;
         output.BitangentWS = input[i].BitangentWS;
         output.DepthVS = input[i].DepthVS;
+        output.CurvatureVariance = input[i].CurvatureVariance;
 
         // Output barycentric coordinates for each vert, so that we can do manual interpolation
         // in the pixel shader
@@ -551,6 +606,82 @@ float3 CalcPointLightLEAN(in float3 normal, in float3 lightColor, in float3 diff
                             roughness, positionWS, leanB, leanM, worldToTangent) * attenuation;
 }
 
+#elif UseAnisoRoughness_
+
+// ================================================================================================
+// Calculates lighting for a directional light using an anisotropic Beckmann or GGX distribution,
+// centered on the filtered normal from the normal map. meanSlope is the slope of that normal, and
+// sigma is the covariance of the slopes around it from the anisotropic roughness map.
+// ================================================================================================
+float3 CalcLightingAniso(in float3 normal, in float3 lightDir, in float3 lightColor,
+                         in float3 diffuseAlbedo, in float3 specularAlbedo, in float roughness,
+                         in float3 positionWS, in float2 meanSlope, in float3 sigma,
+                         in float3x3 worldToTangent)
+{
+    float3 lighting = 0.0f;
+
+    float nDotL = saturate(dot(normal, lightDir));
+    if(nDotL > 0.0f)
+    {
+        float3 view = normalize(CameraPosWS - positionWS);
+        float3 h = normalize(view + lightDir);
+        float nDotV = max(dot(normal, view), 0.0001f);
+
+        float3 ht = normalize(mul(h, worldToTangent));
+
+        // Add the base roughness to the filtered covariance. This is the alpha^2 matrix for GGX,
+        // and twice the slope covariance for Beckmann.
+        float m2 = roughness * roughness;
+        float3 A = 2.0f * sigma + float3(m2, m2, 0.0f);
+        float det = A.x * A.y - A.z * A.z;
+
+        float specular = 0.0f;
+        if(ht.z > 0.0f && det > 0.0f)
+        {
+            float2 s = ht.xy / ht.z - meanSlope;
+            float e = (s.x * s.x * A.y + s.y * s.y * A.x - 2.0f * s.x * s.y * A.z) / det;
+            float nDotH2 = ht.z * ht.z;
+            float norm = Pi * sqrt(det) * nDotH2 * nDotH2;
+
+            // The geometry term changes slowly with roughness, so it uses the average of the
+            // variances along x and y instead of projecting A onto l and v
+            float a2 = 0.5f * (A.x + A.y);
+
+            #if UseGGX_
+                float d = 1.0f / (norm * (1.0f + e) * (1.0f + e));
+                specular = d * GGX_V1(a2, nDotL) * GGX_V1(a2, nDotV);
+            #else
+                float d = exp(-e) / norm;
+                float a = sqrt(a2);
+                float g = Beckmann_G1(a, nDotL) * Beckmann_G1(a, nDotV);
+                specular = d * g * (1.0f / (4.0f * nDotL * nDotV));
+            #endif
+        }
+
+        float3 fresnel = Fresnel(specularAlbedo, h, lightDir);
+
+        lighting = (diffuseAlbedo * InvPi + specular * fresnel) * nDotL * lightColor;
+    }
+
+    return max(lighting, 0.0f);
+}
+
+// ================================================================================================
+// Calculates lighting for a point light using an anisotropic Beckmann or GGX distribution
+// ================================================================================================
+float3 CalcPointLightAniso(in float3 normal, in float3 lightColor, in float3 diffuseAlbedo,
+                           in float3 specularAlbedo, in float roughness, in float3 positionWS,
+                           in float3 lightPos, in float lightFalloff, in float2 meanSlope, in float3 sigma,
+                           in float3x3 worldToTangent)
+{
+	float3 pixelToLight = lightPos - positionWS;
+	float lightDist = length(pixelToLight);
+	float3 lightDir = pixelToLight / lightDist;
+	float attenuation = 1.0f / pow(lightDist, lightFalloff);
+	return CalcLightingAniso(normal, lightDir, lightColor, diffuseAlbedo, specularAlbedo,
+                             roughness, positionWS, meanSlope, sigma, worldToTangent) * attenuation;
+}
+
 #endif
 
 // ================================================================================================
@@ -596,14 +727,69 @@ float4 PS(in PSInput input) : SV_Target0
 	float3x3 tangentToWorld = float3x3(tangentWS, binormalWS, normalWS);
     float3x3 worldToTangent = transpose(tangentToWorld);
 
+    // Widen the base roughness by the variance of the geometric normal over the pixel, using the
+    // clamped kernel from "Stable Geometric Specular Antialiasing with Projected-Space NDF Filtering"
+    float baseRoughness = Roughness;
+    #if GeometricAAMode_ == 1
+        float normalVariance = input.CurvatureVariance;
+    #elif GeometricAAMode_ == 2
+        float3 vtxNormalDX = ddx(vtxNormal);
+        float3 vtxNormalDY = ddy(vtxNormal);
+        float normalVariance = 0.25f * (dot(vtxNormalDX, vtxNormalDX) + dot(vtxNormalDY, vtxNormalDY));
+    #endif
+
+    #if GeometricAAMode_ > 0
+        baseRoughness = sqrt(baseRoughness * baseRoughness + min(2.0f * normalVariance, 0.18f));
+    #endif
+
 	float3 diffuseAlbedo = EnableDiffuse ? 0.5f : 0.0f;
 
 	float SpecularAlbedo = EnableSpecular ? 0.05f : 0.0f;
 
+    // Average the moments over the pixel footprint using the summed-area tables, which are used
+    // in place of the prefiltered mips when the footprint is small enough
+    NormalMoments satMoments;
+    const bool useMomentSAT = UseMomentSAT && QueryMomentSAT(MomentSAT, MomentSATInvScales, MomentSATSize,
+                                                             MomentSATMaxFootprint, uv, ddx(uv), ddy(uv),
+                                                             satMoments);
+    const float satNormalLength = max(length(satMoments.AvgNormal), 0.0001f);
+
     #if UseLEAN_
-        // unpack B and M
-        float2 leanB = LEANMap.Sample(AnisoSampler, float3(uv, 0.0f)).xy;
-        float4 leanM = LEANMap.Sample(AnisoSampler, float3(uv, 1.0f)).xyzw;
+        float2 leanB;
+        float4 leanM;
+
+        [branch]
+        if(UseCompressedMaps)
+        {
+            // BC6H has no alpha channel, so M.x + M.y is recomputed
+            leanB = CompressedLEANMap.Sample(AnisoSampler, float3(uv, 0.0f)).xy;
+            leanM.xyz = CompressedLEANMap.Sample(AnisoSampler, float3(uv, 1.0f)).xyz;
+            leanM.w = leanM.x + leanM.y;
+        }
+        else if(UseCompactMaps)
+        {
+            DecodeCompactLEAN(CompactLEANBMap.Sample(AnisoSampler, uv), CompactLEANCovarianceMap.Sample(AnisoSampler, uv),
+                              ScaleFactor, leanB, leanM);
+        }
+        else
+        {
+            // unpack B and M
+            leanB = LEANMap.Sample(AnisoSampler, float3(uv, 0.0f)).xy;
+            leanM = LEANMap.Sample(AnisoSampler, float3(uv, 1.0f)).xyzw;
+        }
+
+        if(useMomentSAT)
+        {
+            leanB = satMoments.B / ScaleFactor;
+            leanM.xyz = satMoments.M / (ScaleFactor * ScaleFactor);
+            leanM.w = leanM.x + leanM.y;
+        }
+    #endif
+
+    #if UseAnisoRoughness_
+        float3 anisoSigma = DecodeAnisoRoughness(AnisoRoughnessMap.Sample(AnisoSampler, uv));
+        if(useMomentSAT)
+            anisoSigma = MeanNormalCovariance(satMoments);
     #endif
 
     #if UseVMF_
@@ -612,13 +798,43 @@ float4 PS(in PSInput input) : SV_Target0
         [unroll]
         for(uint v = 0; v < NumVMFs; ++v)
         {
-            #if NumVMFs > 1
-                float4 vmfSample = VMFMap.Sample(AnisoSampler, float3(uv, v));
-            #else
-                float4 vmfSample = VMFMap.Sample(AnisoSampler, uv);
-
-                vmfSample.zw = VMFMap.Sample(LinearSampler, uv).zw;
-            #endif
+            float4 vmfSample;
+
+            [branch]
+            if(UseCompressedMaps)
+            {
+                #if NumVMFs > 1
+                    float2 shape = CompressedVMFShapeMap.Sample(AnisoSampler, float3(uv, v));
+                    vmfSample = float4(CompressedVMFDirectionMap.Sample(AnisoSampler, float3(uv, v)), shape.y,
+                                       1.0f / DecodeLogKappa(shape.x));
+                #else
+                    vmfSample = float4(CompressedVMFDirectionMap.Sample(AnisoSampler, uv), 1.0f,
+                                       1.0f / DecodeLogKappa(CompressedVMFShapeMap.Sample(LinearSampler, uv)));
+                #endif
+            }
+            else if(UseCompactMaps)
+            {
+                #if NumVMFs > 1
+                    vmfSample = DecodeCompactVMF(CompactVMFMap.Sample(AnisoSampler, float3(uv, v)));
+                #else
+                    vmfSample = DecodeCompactVMF(CompactVMFMap.Sample(AnisoSampler, uv));
+                #endif
+            }
+            else
+            {
+                #if NumVMFs > 1
+                    vmfSample = VMFMap.Sample(AnisoSampler, float3(uv, v));
+                #else
+                    vmfSample = VMFMap.Sample(AnisoSampler, uv);
+
+                    vmfSample.zw = VMFMap.Sample(LinearSampler, uv).zw;
+                #endif
+            }
+
+            // The tables only give us a single lobe
+            if(useMomentSAT)
+                vmfSample = float4(satMoments.AvgNormal.xy / satNormalLength, v == 0 ? 1.0f : 0.0f,
+                                   1.0f / VMFKappa(satNormalLength));
 
             vmfs[v].mu.xy = vmfSample.xy;
             vmfs[v].mu.z = sqrt(saturate(1.0f - (vmfSample.x * vmfSample.x + vmfSample.y * vmfSample.y)));
@@ -648,8 +864,8 @@ float4 PS(in PSInput input) : SV_Target0
         #if ShaderSupersampling_
             // Compute a randomized sample position based on the pixel center, and interpolate the UV's
             // and position to that point
-            const uint idxOffset = uint(input.PositionSS.y) * RenderTargetSize.x + uint(input.PositionSS.x);
-            const float2 sampleOffset = SampleOffsets[(i + idxOffset) % NumSampleOffsets] * SampleRadius;
+            const uint pixelSeed = PixelSeed(uint2(input.PositionSS.xy), 0);
+            const float2 sampleOffset = SampleDiscOffset(SobolSample(i, pixelSeed)) * SampleRadius;
             const float3 sampleBarycentrics = input.Barycentrics + sampleOffset.x * barycentricsDX
                                                                  + sampleOffset.y * barycentricsDY;
             uv = InterpolateUV(input, sampleBarycentrics);
@@ -694,15 +910,29 @@ float4 PS(in PSInput input) : SV_Target0
             [unroll]
             for(uint i = 0; i < NumPointLights; ++i)
                 sampleLighting += CalcPointLightVMF(vmfs, PointLightColors[i], diffuseAlbedo, SpecularAlbedo,
-                                                    Roughness, positionWS, PointLightPositions[i], PointLightFalloff);
+                                                    baseRoughness, positionWS, PointLightPositions[i], PointLightFalloff);
         #elif UseLEAN_
             [unroll]
             for(uint i = 0; i < NumPointLights; ++i)
                 sampleLighting += CalcPointLightLEAN(normalWS, PointLightColors[i], diffuseAlbedo, SpecularAlbedo,
-                                                     Roughness, positionWS, PointLightPositions[i], PointLightFalloff,
+                                                     baseRoughness, positionWS, PointLightPositions[i], PointLightFalloff,
                                                      leanB, leanM, worldToTangent);
+        #elif UseAnisoRoughness_
+            // The covariance is relative to the filtered normal, so no other maps are needed
+            float2 meanSlope = normalTS.xy / normalTS.z;
+            if(useMomentSAT)
+            {
+                meanSlope = satMoments.AvgNormal.xy / satMoments.AvgNormal.z;
+                normalWS = normalize(mul(satMoments.AvgNormal, tangentToWorld));
+            }
+
+            [unroll]
+            for(uint i = 0; i < NumPointLights; ++i)
+                sampleLighting += CalcPointLightAniso(normalWS, PointLightColors[i], diffuseAlbedo, SpecularAlbedo,
+                                                      baseRoughness, positionWS, PointLightPositions[i], PointLightFalloff,
+                                                      meanSlope, anisoSigma, worldToTangent);
         #else
-            float roughness = Roughness;
+            float roughness = baseRoughness;
 
             #if UseToksvig_
                 float s = RoughnessToSpecPower(roughness);
@@ -710,11 +940,22 @@ float4 PS(in PSInput input) : SV_Target0
                 ft = max(ft, 0.01f);
                 roughness = SpecPowerToRoughness(ft * s);
             #elif UsePrecomputedVMF_
-                roughness = RoughnessMap.Sample(LinearSampler, uv).x;
-                roughness *= roughness;
+                // Combine the base roughness with the roughness from the vMF lobe
+                // (equation 21 in "Frequency Domain Normal Map Filtering")
+                float lobeRoughness = UseCompressedMaps ? CompressedRoughnessMap.Sample(LinearSampler, uv).x
+                                                        : RoughnessMap.Sample(LinearSampler, uv).x;
+                if(useMomentSAT)
+                    lobeRoughness = sqrt(2.0f / VMFKappa(satNormalLength));
+                roughness = min(sqrt(roughness * roughness + lobeRoughness * lobeRoughness), 1.0f);
             #elif UsePrecomputedToksvig_
-                roughness = RoughnessMap.Sample(LinearSampler, uv).y;
-                roughness *= roughness;
+                float avgNormalLength = UseCompressedMaps ? CompressedRoughnessMap.Sample(LinearSampler, uv).y
+                                                          : RoughnessMap.Sample(LinearSampler, uv).y;
+                if(useMomentSAT)
+                    avgNormalLength = satNormalLength;
+                float s = RoughnessToSpecPower(roughness);
+                float ft = avgNormalLength / lerp(s, 1.0f, avgNormalLength);
+                ft = max(ft, 0.01f);
+                roughness = SpecPowerToRoughness(ft * s);
             #endif
 
             [unroll]
@@ -29,8 +29,50 @@ static const float Bias = 0.005f;
 
 const uint32 TGSize = 16;
 
-MeshRenderer::MeshRenderer()
+// Creates a UAV for a single mip level of a texture, covering all of its array slices
+static ID3D11UnorderedAccessViewPtr CreateMipUAV(ID3D11Device* device, const RenderTarget2D& target, uint32 mipLevel)
 {
+    D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
+    uavDesc.Format = target.Format;
+    if(target.ArraySize > 1)
+    {
+        uavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2DARRAY;
+        uavDesc.Texture2DArray.MipSlice = mipLevel;
+        uavDesc.Texture2DArray.FirstArraySlice = 0;
+        uavDesc.Texture2DArray.ArraySize = target.ArraySize;
+    }
+    else
+    {
+        uavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+        uavDesc.Texture2D.MipSlice = mipLevel;
+    }
+
+    ID3D11UnorderedAccessViewPtr uav;
+    DXCall(device->CreateUnorderedAccessView(target.Texture, &uavDesc, &uav));
+    return uav;
+}
+
+// Creates an SRV for a single mip level of a texture array
+static ID3D11ShaderResourceViewPtr CreateMipSRV(ID3D11Device* device, const RenderTarget2D& target, uint32 mipLevel)
+{
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+    srvDesc.Format = target.Format;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+    srvDesc.Texture2DArray.MostDetailedMip = mipLevel;
+    srvDesc.Texture2DArray.MipLevels = 1;
+    srvDesc.Texture2DArray.FirstArraySlice = 0;
+    srvDesc.Texture2DArray.ArraySize = target.ArraySize;
+
+    ID3D11ShaderResourceViewPtr srv;
+    DXCall(device->CreateShaderResourceView(target.Texture, &srvDesc, &srv));
+    return srv;
+}
+
+MeshRenderer::MeshRenderer() : vmfFitValid(false), momentsValid(false), keepMoments(false), momentSATValid(false),
+                               compactMapsValid(false), compressedMapsValid(false), anisoRoughnessMapValid(false)
+{
+    for(uint32 i = 0; i < GeometricAAModeGUI::NumValues; ++i)
+        geometricAATimings[i] = 0.0f;
 }
 
 // Loads resources
@@ -72,16 +114,21 @@ void MeshRenderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context
         {
             for(uint32 specularBRDF = 0; specularBRDF < SpecularBRDFGUI::NumValues; ++specularBRDF)
             {
-                if(shaderAA > 0 && shaderSS > 0)
-                    continue;
-
-                opts.Reset();
-                opts.Add("ShaderSS_", shaderSS);
-                opts.Add("ShaderAAMode_", shaderAA);
-                opts.Add("UseGGX_", specularBRDF == SpecularBRDFGUI::GGX);
-                opts.Add("UseBeckmann_", specularBRDF == SpecularBRDFGUI::Beckmann);
-
-                meshPS[shaderSS][shaderAA][specularBRDF].Attach(CompilePSFromFile(device, L"Mesh.hlsl", "PS", "ps_5_0", opts.Defines()));
+                for(uint32 geometricAA = 0; geometricAA < GeometricAAModeGUI::NumValues; ++geometricAA)
+                {
+                    if((shaderAA > 0 || geometricAA > 0) && shaderSS > 0)
+                        continue;
+
+                    opts.Reset();
+                    opts.Add("ShaderSS_", shaderSS);
+                    opts.Add("ShaderAAMode_", shaderAA);
+                    opts.Add("UseGGX_", specularBRDF == SpecularBRDFGUI::GGX);
+                    opts.Add("UseBeckmann_", specularBRDF == SpecularBRDFGUI::Beckmann);
+                    opts.Add("GeometricAAMode_", geometricAA);
+
+                    meshPS[shaderSS][shaderAA][specularBRDF][geometricAA].Attach(CompilePSFromFile(device, L"Mesh.hlsl", "PS",
+                                                                                                   "ps_5_0", opts.Defines()));
+                }
             }
         }
     }
@@ -109,8 +156,11 @@ void MeshRenderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context
     opts.Reset();
     opts.Add("TGSize_", 16);
 
+    generateMoments.Attach(CompileCSFromFile(device, L"GenerateMaps.hlsl", "GenerateMoments", "cs_5_0", opts.Defines()));
     generateLEANMap.Attach(CompileCSFromFile(device, L"GenerateMaps.hlsl", "GenerateLEANMap", "cs_5_0", opts.Defines()));
     generateVMFMap.Attach(CompileCSFromFile(device, L"GenerateMaps.hlsl", "SolveVMF", "cs_5_0", opts.Defines()));
+    generateCompactMaps.Attach(CompileCSFromFile(device, L"GenerateMaps.hlsl", "GenerateCompactMaps", "cs_5_0", opts.Defines()));
+    generateAnisoRoughnessMap.Attach(CompileCSFromFile(device, L"GenerateMaps.hlsl", "GenerateAnisoRoughnessMap", "cs_5_0", opts.Defines()));
 
     for(uint64 i = 0; i < NormalMapGUI::NumValues; ++i)
     {
@@ -118,26 +168,18 @@ void MeshRenderer::Initialize(ID3D11Device* device, ID3D11DeviceContext* context
         path += NormalMapGUI::Names[i];
         path += L".png";
         normalMaps[i] = LoadTexture(device, path.c_str());
+        normalMapPaths[i] = path;
+        normalMapData[i].LoadFromFile(path.c_str());
     }
 
-    std::vector<Float2> sampleOffsets(NumSampleOffsets);
-
-    srand(0);
-    for(uint64 i = 0; i < NumSampleOffsets; ++i)
-    {
-        float theta = RandFloat() * Pi2;
-        float r = RandFloat() * 0.5f;
-        sampleOffsets[i].x = std::cos(theta) * r;
-        sampleOffsets[i].y = std::sin(theta) * r;
-    }
-
-    sampleOffsetsBuffer.Initialize(device, 8, NumSampleOffsets, FALSE, FALSE, FALSE, sampleOffsets.data());
+    mapCache.Initialize(L"MapCache");
 
     csConstants.Initialize(device);
+    csConstants.Data.OutputOffsetX = 0;
+    csConstants.Data.OutputOffsetY = 0;
 
     CreateMaps();
-    GenerateMaps(context);
-    GenerateLEANMap(context);
+    LoadMaps(context);
 }
 
 void MeshRenderer::CreateMaps()
@@ -149,114 +191,715 @@ void MeshRenderer::CreateMaps()
     D3D11_TEXTURE2D_DESC texDesc;
     normalMapTexture->GetDesc(&texDesc);
 
+    // The moment pyramid is only created when a map has to be resolved from it
+    ReleaseMoments();
+
     // Init the LEAN map
-    leanMap.Initialize(device, texDesc.Width, texDesc.Height, DXGI_FORMAT_R16G16B16A16_SNORM, texDesc.MipLevels, 1, 0, true, true, 2);
+    leanMap.Initialize(device, texDesc.Width, texDesc.Height, DXGI_FORMAT_R16G16B16A16_SNORM, texDesc.MipLevels, 1, 0, false, true, 2);
 
     // Generate the vMF map
     vmfMap.Initialize(device, texDesc.Width, texDesc.Height, DXGI_FORMAT_R16G16B16A16_FLOAT, texDesc.MipLevels, 1, 0, false, true, NumVMFs);
 
+    // The compact maps are created the first time that they're used
+    compactLEANBMap = RenderTarget2D();
+    compactLEANCovarianceMap = RenderTarget2D();
+    compactVMFMap = RenderTarget2D();
+    compactLEANBMipUAVs.clear();
+    compactLEANCovarianceMipUAVs.clear();
+    compactVMFMipUAVs.clear();
+
+    // The anisotropic roughness map is created the first time that it's used
+    anisoRoughnessMap = RenderTarget2D();
+    anisoRoughnessMipUAVs.clear();
+
     uint32 lightTexW = std::max<uint32>(texDesc.Width * 2, 1024);
     uint32 lightTexH = std::max<uint32>(texDesc.Height * 2, 1024);
     lightingTexture.Initialize(device, lightTexW, lightTexH, DXGI_FORMAT_R16G16B16A16_FLOAT,
         0, 1, 0, true, false, 1, false);
 
-    roughnessMap.Initialize(device, texDesc.Width, texDesc.Height, DXGI_FORMAT_R8G8_UNORM, texDesc.MipLevels, 1, 0, false, true);
+    roughnessMap.Initialize(device, texDesc.Width, texDesc.Height, DXGI_FORMAT_R16G16_UNORM, texDesc.MipLevels, 1, 0, false, true);
+
+    // Per-mip views, used for reading the previous level while writing the next one
+    leanMipUAVs.resize(texDesc.MipLevels);
+    vmfMipUAVs.resize(texDesc.MipLevels);
+    roughnessMipUAVs.resize(texDesc.MipLevels);
+    for(uint32 mipLevel = 0; mipLevel < texDesc.MipLevels; ++mipLevel)
+    {
+        leanMipUAVs[mipLevel] = CreateMipUAV(device, leanMap, mipLevel);
+        vmfMipUAVs[mipLevel] = CreateMipUAV(device, vmfMap, mipLevel);
+        roughnessMipUAVs[mipLevel] = CreateMipUAV(device, roughnessMap, mipLevel);
+    }
+
+    momentSATValid = false;
+    compactMapsValid = false;
+    compressedMapsValid = false;
+    anisoRoughnessMapValid = false;
+}
+
+// Creates the moment pyramid for the current normal map, stored as 2 array slices. At 32 bits
+// per channel this is bigger than all of the resolved maps put together, which is why it's
+// released again once they've been resolved.
+void MeshRenderer::CreateMomentMap()
+{
+    momentMap.Initialize(device, leanMap.Width, leanMap.Height, DXGI_FORMAT_R32G32B32A32_FLOAT, leanMap.NumMipLevels, 1, 0, false, true, 2);
+
+    momentMipSRVs.resize(momentMap.NumMipLevels);
+    momentMipUAVs.resize(momentMap.NumMipLevels);
+    for(uint32 mipLevel = 0; mipLevel < momentMap.NumMipLevels; ++mipLevel)
+    {
+        momentMipSRVs[mipLevel] = CreateMipSRV(device, momentMap, mipLevel);
+        momentMipUAVs[mipLevel] = CreateMipUAV(device, momentMap, mipLevel);
+    }
 }
 
+void MeshRenderer::ReleaseMoments()
+{
+    momentMipSRVs.clear();
+    momentMipUAVs.clear();
+    momentMap = RenderTarget2D();
+    momentsValid = false;
+    keepMoments = false;
+
+    // The fitted lobes are only kept for refitting edits, the same as the moments
+    vmfFitter.ReleaseLevels();
+    fittedVMFMap = BakedTexture();
+    vmfFitValid = false;
+}
 
-void MeshRenderer::GenerateMaps(ID3D11DeviceContext* context)
+BakeSettings MeshRenderer::CurrentBakeSettings() const
+{
+    BakeSettings settings;
+    settings.ScaleFactor = std::pow(10.0f, AppSettings::LEANScaleFactor);
+    return settings;
+}
+
+// Uploads the maps for the current normal map from the cache, or generates them and adds them
+// to the cache if they're not there
+void MeshRenderer::LoadMaps(ID3D11DeviceContext* context)
 {
+    PIXEvent event(L"Load Maps");
+
+    const uint64 cacheKey = MapCache::ComputeKey(normalMapData[AppSettings::NormalMap], CurrentBakeSettings());
+
+    CachedMaps cachedMaps;
+    if(mapCache.Load(cacheKey, cachedMaps))
+    {
+        cachedMaps.LEANMap.Upload(context, leanMap.Texture);
+        cachedMaps.VMFMap.Upload(context, vmfMap.Texture);
+        cachedMaps.RoughnessMap.Upload(context, roughnessMap.Texture);
+        return;
+    }
+
+    GenerateMoments(context);
+    GenerateMaps(context);
+    GenerateLEANMap(context);
+
+    BakedMaps bakedMaps;
+    bakedMaps.LEANMap.ReadFromTexture(device, context, leanMap.Texture);
+    bakedMaps.VMFMap.ReadFromTexture(device, context, vmfMap.Texture);
+    bakedMaps.RoughnessMap.ReadFromTexture(device, context, roughnessMap.Texture);
+    mapCache.Store(cacheKey, bakedMaps);
+}
+
+void MeshRenderer::GenerateMoments(ID3D11DeviceContext* context)
+{
+    PIXEvent event(L"Generate Moments");
+
     ID3D11ShaderResourceView* normalMap = normalMaps[AppSettings::NormalMap];
-    ID3D11Texture2DPtr normalMapTexture;
-    normalMap->GetResource(reinterpret_cast<ID3D11Resource**>(&normalMapTexture));
 
-    D3D11_TEXTURE2D_DESC texDesc;
-    normalMapTexture->GetDesc(&texDesc);
+    if(momentMap.Texture == NULL)
+        CreateMomentMap();
 
-    csConstants.Data.TextureSizeX = static_cast<float>(texDesc.Width);
-    csConstants.Data.TextureSizeY = static_cast<float>(texDesc.Height);
-    csConstants.Data.OutputSizeX = static_cast<float>(texDesc.Width);
-    csConstants.Data.OutputSizeY = static_cast<float>(texDesc.Height);
     csConstants.Data.MipLevel = 0;
-    csConstants.Data.Roughness = AppSettings::Roughness;
     csConstants.Data.ScaleFactor = std::pow(10.0f, AppSettings::LEANScaleFactor);
-    csConstants.ApplyChanges(context);
     csConstants.SetCS(context, 0);
 
-    SetCSInputs(context, normalMap);
+    SetCSShader(context, generateMoments);
 
-    uint32 width = texDesc.Width;
-    uint32 height = texDesc.Height;
-    for(uint32 mipLevel = 0; mipLevel < texDesc.MipLevels; ++mipLevel)
+    // Each level after the first is a 2x2 reduction of the previous one
+    uint32 inputWidth = momentMap.Width;
+    uint32 inputHeight = momentMap.Height;
+    for(uint32 mipLevel = 0; mipLevel < momentMap.NumMipLevels; ++mipLevel)
     {
-        ID3D11UnorderedAccessViewPtr vmfUAV = vmfMap.UAView;
-        ID3D11UnorderedAccessViewPtr roughnessUAV = roughnessMap.UAView;
+        const uint32 width = std::max<uint32>(momentMap.Width >> mipLevel, 1);
+        const uint32 height = std::max<uint32>(momentMap.Height >> mipLevel, 1);
+
+        csConstants.Data.TextureSizeX = static_cast<float>(inputWidth);
+        csConstants.Data.TextureSizeY = static_cast<float>(inputHeight);
+        csConstants.Data.OutputSizeX = static_cast<float>(width);
+        csConstants.Data.OutputSizeY = static_cast<float>(height);
+        csConstants.Data.MipLevel = mipLevel;
+        csConstants.ApplyChanges(context);
+
+        // Bind the output first, so that the previous level isn't still bound as a UAV
+        SetCSOutputs(context, momentMipUAVs[mipLevel]);
+        SetCSInputs(context, normalMap, mipLevel > 0 ? momentMipSRVs[mipLevel - 1] : NULL);
+        context->Dispatch(DispatchSize(TGSize, width), DispatchSize(TGSize, height), 1);
+
+        inputWidth = width;
+        inputHeight = height;
+    }
+
+    ClearCSOutputs(context);
+    ClearCSInputs(context);
+
+    momentsValid = true;
+}
+
+
+void MeshRenderer::GenerateMaps(ID3D11DeviceContext* context)
+{
+    PIXEvent event(L"Generate VMF Maps");
 
-        if(mipLevel > 0)
+    // The moment pyramid isn't generated when the maps come from the cache
+    if(!momentsValid)
+        GenerateMoments(context);
+
+    csConstants.Data.TextureSizeX = static_cast<float>(momentMap.Width);
+    csConstants.Data.TextureSizeY = static_cast<float>(momentMap.Height);
+    csConstants.Data.ScaleFactor = std::pow(10.0f, AppSettings::LEANScaleFactor);
+    csConstants.SetCS(context, 0);
+
+    SetCSShader(context, generateVMFMap);
+
+    for(uint32 mipLevel = 0; mipLevel < momentMap.NumMipLevels; ++mipLevel)
+    {
+        const uint32 width = std::max<uint32>(momentMap.Width >> mipLevel, 1);
+        const uint32 height = std::max<uint32>(momentMap.Height >> mipLevel, 1);
+
+        csConstants.Data.MipLevel = mipLevel;
+        csConstants.Data.OutputSizeX = static_cast<float>(width);
+        csConstants.Data.OutputSizeY = static_cast<float>(height);
+        csConstants.ApplyChanges(context);
+
+        SetCSOutputs(context, vmfMipUAVs[mipLevel], roughnessMipUAVs[mipLevel]);
+        SetCSInputs(context, NULL, momentMipSRVs[mipLevel]);
+        context->Dispatch(DispatchSize(TGSize, width), DispatchSize(TGSize, height), 1);
+    }
+
+    ClearCSOutputs(context);
+    ClearCSInputs(context);
+
+    // SolveVMF only fits a single lobe, so the lobes are fit with EM on the CPU and replace the
+    // ones in the vMF map. The roughness map still comes from the kernel.
+    if(NumVMFs > 1)
+        FitVMFMixture(context);
+}
+
+// Fits the vMF lobes for the current normal map on the CPU, and uploads them to the vMF map
+void MeshRenderer::FitVMFMixture(ID3D11DeviceContext* context)
+{
+    mapBaker.GenerateMoments(normalMapData[AppSettings::NormalMap]);
+
+    VMFFitSettings fitSettings;
+    fitSettings.NumLobes = NumVMFs;
+
+    vmfFitter.Fit(mapBaker.Moments(), fitSettings, fittedVMFMap);
+    DebugPrint(vmfFitter.Stats().ToString());
+
+    for(uint32 slice = 0; slice < fittedVMFMap.ArraySize; ++slice)
+    {
+        for(uint32 mipLevel = 0; mipLevel < fittedVMFMap.NumMipLevels; ++mipLevel)
         {
-            D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc;
-            uavDesc.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
-            uavDesc.Texture2D.MipSlice = mipLevel;
-            uavDesc.Format = vmfMap.Format;
-            DXCall(device->CreateUnorderedAccessView(vmfMap.Texture, &uavDesc, &vmfUAV));
-
-            uavDesc.Format = roughnessMap.Format;
-            DXCall(device->CreateUnorderedAccessView(roughnessMap.Texture, &uavDesc, &roughnessUAV));
+            const uint32 subresource = D3D11CalcSubresource(mipLevel, slice, fittedVMFMap.NumMipLevels);
+            context->UpdateSubresource(vmfMap.Texture, subresource, NULL, fittedVMFMap.Data(mipLevel, slice),
+                                       fittedVMFMap.RowPitch(mipLevel), 0);
         }
+    }
+
+    vmfFitValid = true;
+}
+
+// Re-fits the vMF lobes that depend on the edited texels from the lobes kept by the last fit, and
+// only uploads the dirty texels of each level
+void MeshRenderer::RefitVMFMixture(ID3D11DeviceContext* context, const DirtyRegion& region)
+{
+    VMFFitSettings fitSettings;
+    fitSettings.NumLobes = NumVMFs;
+
+    if(!vmfFitValid || !vmfFitter.CanRefit(mapBaker.Moments(), fitSettings))
+    {
+        FitVMFMixture(context);
+        return;
+    }
+
+    mapBaker.UpdateMoments(normalMapData[AppSettings::NormalMap], region);
+    vmfFitter.Refit(mapBaker.Moments(), fitSettings, region, fittedVMFMap);
+    DebugPrint(vmfFitter.Stats().ToString());
+
+    for(uint32 slice = 0; slice < fittedVMFMap.ArraySize; ++slice)
+    {
+        for(uint32 mipLevel = 0; mipLevel < fittedVMFMap.NumMipLevels; ++mipLevel)
+        {
+            const uint32 subresource = D3D11CalcSubresource(mipLevel, slice, fittedVMFMap.NumMipLevels);
+            const uint32 rowPitch = fittedVMFMap.RowPitch(mipLevel);
+            const std::vector<TexelRect>& rects = region.Levels[mipLevel];
+            for(uint64 i = 0; i < rects.size(); ++i)
+            {
+                const TexelRect& rect = rects[i];
+                D3D11_BOX box = { rect.MinX, rect.MinY, 0, rect.MaxX, rect.MaxY, 1 };
+                const uint8* src = fittedVMFMap.Data(mipLevel, slice) + uint64(rect.MinY) * rowPitch
+                                   + uint64(rect.MinX) * fittedVMFMap.TexelSize;
+                context->UpdateSubresource(vmfMap.Texture, subresource, &box, src, rowPitch, 0);
+            }
+        }
+    }
+}
+
+void MeshRenderer::GenerateLEANMap(ID3D11DeviceContext* context)
+{
+    PIXEvent event(L"Generate LEAN Map");
+
+    if(!momentsValid)
+        GenerateMoments(context);
+
+    csConstants.Data.TextureSizeX = static_cast<float>(momentMap.Width);
+    csConstants.Data.TextureSizeY = static_cast<float>(momentMap.Height);
+    csConstants.Data.ScaleFactor = std::pow(10.0f, AppSettings::LEANScaleFactor);
+    csConstants.SetCS(context, 0);
+
+    SetCSShader(context, generateLEANMap);
+
+    for(uint32 mipLevel = 0; mipLevel < momentMap.NumMipLevels; ++mipLevel)
+    {
+        const uint32 width = std::max<uint32>(momentMap.Width >> mipLevel, 1);
+        const uint32 height = std::max<uint32>(momentMap.Height >> mipLevel, 1);
 
         csConstants.Data.MipLevel = mipLevel;
         csConstants.Data.OutputSizeX = static_cast<float>(width);
         csConstants.Data.OutputSizeY = static_cast<float>(height);
         csConstants.ApplyChanges(context);
 
-        SetCSShader(context, generateVMFMap);
-        SetCSOutputs(context, vmfUAV, roughnessUAV);
+        SetCSOutputs(context, leanMipUAVs[mipLevel]);
+        SetCSInputs(context, NULL, momentMipSRVs[mipLevel]);
         context->Dispatch(DispatchSize(TGSize, width), DispatchSize(TGSize, height), 1);
+    }
 
-        width = std::max<uint32>(width / 2, 1);
-        height = std::max<uint32>(height / 2, 1);
+    ClearCSOutputs(context);
+    ClearCSInputs(context);
+}
+
+// Resolves the compact LEAN and vMF maps from the moment pyramid
+void MeshRenderer::GenerateCompactMaps(ID3D11DeviceContext* context)
+{
+    PIXEvent event(L"Generate Compact Maps");
+
+    // Init the compact LEAN and vMF maps, see MapEncoding.hlsl for the layouts
+    if(compactLEANBMap.Texture == NULL)
+    {
+        const uint32 width = leanMap.Width;
+        const uint32 height = leanMap.Height;
+        const uint32 numMipLevels = leanMap.NumMipLevels;
+        compactLEANBMap.Initialize(device, width, height, DXGI_FORMAT_R16G16_SNORM, numMipLevels, 1, 0, false, true);
+        compactLEANCovarianceMap.Initialize(device, width, height, DXGI_FORMAT_R8G8B8A8_UNORM, numMipLevels, 1, 0, false, true);
+        compactVMFMap.Initialize(device, width, height, DXGI_FORMAT_R10G10B10A2_UNORM, numMipLevels, 1, 0, false, true, NumVMFs);
+
+        compactLEANBMipUAVs.resize(numMipLevels);
+        compactLEANCovarianceMipUAVs.resize(numMipLevels);
+        compactVMFMipUAVs.resize(numMipLevels);
+        for(uint32 mipLevel = 0; mipLevel < numMipLevels; ++mipLevel)
+        {
+            compactLEANBMipUAVs[mipLevel] = CreateMipUAV(device, compactLEANBMap, mipLevel);
+            compactLEANCovarianceMipUAVs[mipLevel] = CreateMipUAV(device, compactLEANCovarianceMap, mipLevel);
+            compactVMFMipUAVs[mipLevel] = CreateMipUAV(device, compactVMFMap, mipLevel);
+        }
+    }
+
+    if(!momentsValid)
+        GenerateMoments(context);
+
+    csConstants.Data.TextureSizeX = static_cast<float>(momentMap.Width);
+    csConstants.Data.TextureSizeY = static_cast<float>(momentMap.Height);
+    csConstants.Data.ScaleFactor = std::pow(10.0f, AppSettings::LEANScaleFactor);
+    csConstants.SetCS(context, 0);
+
+    SetCSShader(context, generateCompactMaps);
+
+    for(uint32 mipLevel = 0; mipLevel < momentMap.NumMipLevels; ++mipLevel)
+    {
+        const uint32 width = std::max<uint32>(momentMap.Width >> mipLevel, 1);
+        const uint32 height = std::max<uint32>(momentMap.Height >> mipLevel, 1);
+
+        csConstants.Data.MipLevel = mipLevel;
+        csConstants.Data.OutputSizeX = static_cast<float>(width);
+        csConstants.Data.OutputSizeY = static_cast<float>(height);
+        csConstants.ApplyChanges(context);
+
+        SetCSOutputs(context, compactLEANBMipUAVs[mipLevel], compactLEANCovarianceMipUAVs[mipLevel], compactVMFMipUAVs[mipLevel]);
+        SetCSInputs(context, NULL, momentMipSRVs[mipLevel]);
+        context->Dispatch(DispatchSize(TGSize, width), DispatchSize(TGSize, height), 1);
     }
 
     ClearCSOutputs(context);
     ClearCSInputs(context);
+
+    compactMapsValid = true;
 }
 
-void MeshRenderer::GenerateLEANMap(ID3D11DeviceContext* context)
+// Resolves the anisotropic roughness map from the moment pyramid. It doesn't depend on the LEAN
+// scale factor, so it only needs to be re-generated when the normal map changes.
+void MeshRenderer::GenerateAnisoRoughnessMap(ID3D11DeviceContext* context)
 {
-    PIXEvent event(L"Generate LEAN Map");
+    PIXEvent event(L"Generate Anisotropic Roughness Map");
 
-    ID3D11ShaderResourceView* normalMap = normalMaps[AppSettings::NormalMap];
+    if(anisoRoughnessMap.Texture == NULL)
+    {
+        anisoRoughnessMap.Initialize(device, leanMap.Width, leanMap.Height, DXGI_FORMAT_R11G11B10_FLOAT, leanMap.NumMipLevels, 1, 0, false, true);
+
+        anisoRoughnessMipUAVs.resize(anisoRoughnessMap.NumMipLevels);
+        for(uint32 mipLevel = 0; mipLevel < anisoRoughnessMap.NumMipLevels; ++mipLevel)
+            anisoRoughnessMipUAVs[mipLevel] = CreateMipUAV(device, anisoRoughnessMap, mipLevel);
+    }
+
+    if(!momentsValid)
+        GenerateMoments(context);
+
+    csConstants.Data.TextureSizeX = static_cast<float>(momentMap.Width);
+    csConstants.Data.TextureSizeY = static_cast<float>(momentMap.Height);
+    csConstants.SetCS(context, 0);
+
+    SetCSShader(context, generateAnisoRoughnessMap);
+
+    for(uint32 mipLevel = 0; mipLevel < momentMap.NumMipLevels; ++mipLevel)
+    {
+        const uint32 width = std::max<uint32>(momentMap.Width >> mipLevel, 1);
+        const uint32 height = std::max<uint32>(momentMap.Height >> mipLevel, 1);
+
+        csConstants.Data.MipLevel = mipLevel;
+        csConstants.Data.OutputSizeX = static_cast<float>(width);
+        csConstants.Data.OutputSizeY = static_cast<float>(height);
+        csConstants.ApplyChanges(context);
+
+        SetCSOutputs(context, anisoRoughnessMipUAVs[mipLevel]);
+        SetCSInputs(context, NULL, momentMipSRVs[mipLevel]);
+        context->Dispatch(DispatchSize(TGSize, width), DispatchSize(TGSize, height), 1);
+    }
+
+    ClearCSOutputs(context);
+    ClearCSInputs(context);
+
+    anisoRoughnessMapValid = true;
+}
+
+// Runs the currently bound kernel over each rectangle of a mip level. The constants besides the
+// output rectangle have to be set up already.
+void MeshRenderer::DispatchRects(ID3D11DeviceContext* context, const std::vector<TexelRect>& rects)
+{
+    for(uint64 i = 0; i < rects.size(); ++i)
+    {
+        const TexelRect& rect = rects[i];
+        csConstants.Data.OutputOffsetX = rect.MinX;
+        csConstants.Data.OutputOffsetY = rect.MinY;
+        csConstants.Data.OutputSizeX = static_cast<float>(rect.MaxX);
+        csConstants.Data.OutputSizeY = static_cast<float>(rect.MaxY);
+        csConstants.ApplyChanges(context);
+
+        context->Dispatch(DispatchSize(TGSize, rect.Width()), DispatchSize(TGSize, rect.Height()), 1);
+    }
+}
+
+void MeshRenderer::UpdateNormalMap(ID3D11DeviceContext* context, const NormalMapData& editedMap,
+                                   const std::vector<TexelRect>& dirtyRects)
+{
+    PIXEvent event(L"Update Normal Map");
+
+    NormalMapData& normalMap = normalMapData[AppSettings::NormalMap];
+    if(editedMap.Width != normalMap.Width || editedMap.Height != normalMap.Height)
+        throw Exception(L"The edited normal map has to be the same size as the current one");
+
+    DirtyRegion region;
+    region.Build(normalMap.Width, normalMap.Height, leanMap.NumMipLevels, dirtyRects);
+    const std::vector<TexelRect>& baseRects = region.Levels[0];
+    if(baseRects.empty())
+        return;
+
+    // Copy the edited texels into both the CPU copy and the normal map texture
     ID3D11Texture2DPtr normalMapTexture;
-    normalMap->GetResource(reinterpret_cast<ID3D11Resource**>(&normalMapTexture));
+    normalMaps[AppSettings::NormalMap]->GetResource(reinterpret_cast<ID3D11Resource**>(&normalMapTexture));
+
+    for(uint64 i = 0; i < baseRects.size(); ++i)
+    {
+        const TexelRect& rect = baseRects[i];
+        for(uint32 y = rect.MinY; y < rect.MaxY; ++y)
+        {
+            const uint64 offset = uint64(y) * normalMap.Width + rect.MinX;
+            memcpy(&normalMap.Texels[offset], &editedMap.Texels[offset], rect.Width() * sizeof(uint32));
+        }
+
+        D3D11_BOX box = { rect.MinX, rect.MinY, 0, rect.MaxX, rect.MaxY, 1 };
+        const uint64 offset = uint64(rect.MinY) * normalMap.Width + rect.MinX;
+        context->UpdateSubresource(normalMapTexture, 0, &box, &normalMap.Texels[offset], normalMap.Width * sizeof(uint32), 0);
+    }
 
+    // The mips of the normal map are only used for rendering, and D3D11 can only re-generate all of them
     D3D11_TEXTURE2D_DESC texDesc;
     normalMapTexture->GetDesc(&texDesc);
+    if(texDesc.MipLevels > 1 && (texDesc.MiscFlags & D3D11_RESOURCE_MISC_GENERATE_MIPS))
+        context->GenerateMips(normalMaps[AppSettings::NormalMap]);
+
+    // Edits tend to come one after another, so the moment pyramid is kept from here on instead
+    // of being released once the maps have been resolved
+    keepMoments = true;
+
+    // The maps from the cache don't come with a moment pyramid, so everything has to be generated once
+    if(!momentsValid)
+    {
+        GenerateMoments(context);
+        GenerateMaps(context);
+        GenerateLEANMap(context);
+        compactMapsValid = false;
+        anisoRoughnessMapValid = false;
+        momentSATValid = false;
+        compressedMapsValid = false;
+        return;
+    }
 
-    csConstants.Data.TextureSizeX = static_cast<float>(texDesc.Width);
-    csConstants.Data.TextureSizeY = static_cast<float>(texDesc.Height);
-    csConstants.Data.OutputSizeX = static_cast<float>(texDesc.Width);
-    csConstants.Data.OutputSizeY = static_cast<float>(texDesc.Height);
-    csConstants.Data.MipLevel = 0;
-    csConstants.Data.Roughness = AppSettings::Roughness;
     csConstants.Data.ScaleFactor = std::pow(10.0f, AppSettings::LEANScaleFactor);
-    csConstants.ApplyChanges(context);
     csConstants.SetCS(context, 0);
 
-    SetCSInputs(context, normalMap);
+    {
+        PIXEvent momentsEvent(L"Update Moments");
 
-    SetCSShader(context, generateLEANMap);
-    SetCSOutputs(context, leanMap.UAView);
-    context->Dispatch(DispatchSize(TGSize, texDesc.Width), DispatchSize(TGSize, texDesc.Height), 1);
+        SetCSShader(context, generateMoments);
 
-    ClearCSOutputs(context);
-    ClearCSInputs(context);
+        uint32 inputWidth = momentMap.Width;
+        uint32 inputHeight = momentMap.Height;
+        for(uint32 mipLevel = 0; mipLevel < momentMap.NumMipLevels; ++mipLevel)
+        {
+            csConstants.Data.TextureSizeX = static_cast<float>(inputWidth);
+            csConstants.Data.TextureSizeY = static_cast<float>(inputHeight);
+            csConstants.Data.MipLevel = mipLevel;
+
+            SetCSOutputs(context, momentMipUAVs[mipLevel]);
+            SetCSInputs(context, normalMaps[AppSettings::NormalMap], mipLevel > 0 ? momentMipSRVs[mipLevel - 1] : NULL);
+            DispatchRects(context, region.Levels[mipLevel]);
+
+            inputWidth = std::max<uint32>(momentMap.Width >> mipLevel, 1);
+            inputHeight = std::max<uint32>(momentMap.Height >> mipLevel, 1);
+        }
+
+        ClearCSOutputs(context);
+        ClearCSInputs(context);
+    }
+
+    // Every resolve kernel reads a single texel of the moment pyramid, so they use the same rectangles
+    csConstants.Data.TextureSizeX = static_cast<float>(momentMap.Width);
+    csConstants.Data.TextureSizeY = static_cast<float>(momentMap.Height);
+
+    {
+        PIXEvent mapsEvent(L"Update Maps");
+
+        for(uint32 mipLevel = 0; mipLevel < momentMap.NumMipLevels; ++mipLevel)
+        {
+            csConstants.Data.MipLevel = mipLevel;
+
+            SetCSShader(context, generateVMFMap);
+            SetCSOutputs(context, vmfMipUAVs[mipLevel], roughnessMipUAVs[mipLevel]);
+            SetCSInputs(context, NULL, momentMipSRVs[mipLevel]);
+            DispatchRects(context, region.Levels[mipLevel]);
+
+            SetCSShader(context, generateLEANMap);
+            SetCSOutputs(context, leanMipUAVs[mipLevel]);
+            DispatchRects(context, region.Levels[mipLevel]);
 
-    context->GenerateMips(leanMap.SRView);
+            if(compactMapsValid)
+            {
+                SetCSShader(context, generateCompactMaps);
+                SetCSOutputs(context, compactLEANBMipUAVs[mipLevel], compactLEANCovarianceMipUAVs[mipLevel], compactVMFMipUAVs[mipLevel]);
+                DispatchRects(context, region.Levels[mipLevel]);
+            }
+
+            if(anisoRoughnessMapValid)
+            {
+                SetCSShader(context, generateAnisoRoughnessMap);
+                SetCSOutputs(context, anisoRoughnessMipUAVs[mipLevel]);
+                DispatchRects(context, region.Levels[mipLevel]);
+            }
+        }
+
+        ClearCSOutputs(context);
+        ClearCSInputs(context);
+    }
+
+    csConstants.Data.OutputOffsetX = 0;
+    csConstants.Data.OutputOffsetY = 0;
+
+    if(NumVMFs > 1)
+        RefitVMFMixture(context, region);
+
+    // The SAT and the compressed maps are built from the whole map on the CPU, so they're
+    // re-generated the next time they're used
+    momentSATValid = false;
+    compressedMapsValid = false;
+}
+
+// Compresses the current maps to BC formats on the CPU, or loads them from the cache if they've
+// already been compressed
+void MeshRenderer::GenerateCompressedMaps(ID3D11DeviceContext* context)
+{
+    PIXEvent event(L"Generate Compressed Maps");
+
+    const uint64 bakeKey = MapCache::ComputeKey(normalMapData[AppSettings::NormalMap], CurrentBakeSettings());
+    const uint64 cacheKey = MapCache::ComputeCompressedKey(bakeKey, CompressedMapQuality);
+
+    CompressedMaps compressedMaps;
+    CachedCompressedMaps cachedMaps;
+    if(mapCache.LoadCompressed(cacheKey, cachedMaps))
+        cachedMaps.CopyTo(compressedMaps);
+    else
+    {
+        BakedMaps bakedMaps;
+        bakedMaps.LEANMap.ReadFromTexture(device, context, leanMap.Texture);
+        bakedMaps.VMFMap.ReadFromTexture(device, context, vmfMap.Texture);
+        bakedMaps.RoughnessMap.ReadFromTexture(device, context, roughnessMap.Texture);
+
+        MapCompressor compressor;
+        compressor.Compress(bakedMaps, CompressedMapQuality, compressedMaps);
+        mapCache.StoreCompressed(cacheKey, compressedMaps);
+    }
+
+    compressedLEANMap = compressedMaps.LEANMap.CreateSRV(device);
+    compressedVMFDirectionMap = compressedMaps.VMFDirectionMap.CreateSRV(device);
+    compressedVMFShapeMap = compressedMaps.VMFShapeMap.CreateSRV(device);
+    compressedRoughnessMap = compressedMaps.RoughnessMap.CreateSRV(device);
+
+    compressedMapsValid = true;
+}
+
+// Builds the summed-area tables of the moments on the CPU, and uploads them to a 2-slice texture
+void MeshRenderer::GenerateMomentSAT(ID3D11DeviceContext* context)
+{
+    PIXEvent event(L"Generate Moment SAT");
+
+    mapBaker.GenerateMoments(normalMapData[AppSettings::NormalMap]);
+    momentSAT.Build(mapBaker.Moments().Levels[0]);
+
+    BakedTexture packedSAT;
+    momentSAT.Pack(packedSAT);
+    momentSAT.ReleaseTables();
+
+    momentSATTexture.Initialize(device, packedSAT.Width, packedSAT.Height, packedSAT.Format, 1, 1, 0, false, false, 2);
+    for(uint32 slice = 0; slice < packedSAT.ArraySize; ++slice)
+        context->UpdateSubresource(momentSATTexture.Texture, D3D11CalcSubresource(0, slice, 1), NULL, packedSAT.Data(0, slice),
+                                   packedSAT.RowPitch(0), packedSAT.RowPitch(0) * packedSAT.Height);
+
+    momentSATValid = true;
+}
+
+void MeshRenderer::ValidateCPUBake(ID3D11DeviceContext* context)
+{
+    BakedMaps cpuMaps;
+    mapBaker.Bake(normalMapData[AppSettings::NormalMap], CurrentBakeSettings(), cpuMaps);
+
+    BakedMaps gpuMaps;
+    gpuMaps.LEANMap.ReadFromTexture(device, context, leanMap.Texture);
+    gpuMaps.VMFMap.ReadFromTexture(device, context, vmfMap.Texture);
+    gpuMaps.RoughnessMap.ReadFromTexture(device, context, roughnessMap.Texture);
+
+    BakeComparison comparison = BakeComparison::Compare(cpuMaps, gpuMaps);
+    DebugPrint(L"CPU bake of " + normalMapPaths[AppSettings::NormalMap]);
+    DebugPrint(mapBaker.Stats().ToString());
+    DebugPrint(comparison.ToString());
+
+    if(!anisoRoughnessMapValid)
+        GenerateAnisoRoughnessMap(context);
+
+    BakedTexture cpuAnisoMap;
+    mapBaker.ResolveAnisoRoughnessMap(cpuAnisoMap);
+
+    BakedTexture gpuAnisoMap;
+    gpuAnisoMap.ReadFromTexture(device, context, anisoRoughnessMap.Texture);
+
+    const float anisoError = BakeComparison::CompareRelative(cpuAnisoMap, gpuAnisoMap);
+    DebugPrint(L"Max relative error - Anisotropic roughness: " + ToString(anisoError)
+               + (anisoError <= AnisoRoughnessMapTolerance ? L" (within tolerance)" : L" (EXCEEDS TOLERANCE)"));
 }
 
 // Renders all meshes in the model, with shadows
 void MeshRenderer::Render(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
                           const Uint2& renderTargetSize)
+{
+    RenderMeshes(context, camera, world, renderTargetSize, AppSettings::GeometricAAMode);
+}
+
+void MeshRenderer::BenchmarkGeometricAA(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
+                                        const Uint2& renderTargetSize)
+{
+    PIXEvent event(L"Geometric AA Benchmark");
+
+    const uint32 NumIterations = 32;
+
+    D3D11_QUERY_DESC desc;
+    desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+    desc.MiscFlags = 0;
+    ID3D11QueryPtr disjointQuery;
+    DXCall(device->CreateQuery(&desc, &disjointQuery));
+
+    desc.Query = D3D11_QUERY_TIMESTAMP;
+    std::vector<ID3D11QueryPtr> startQueries(NumIterations);
+    std::vector<ID3D11QueryPtr> endQueries(NumIterations);
+    for(uint32 i = 0; i < NumIterations; ++i)
+    {
+        DXCall(device->CreateQuery(&desc, &startQueries[i]));
+        DXCall(device->CreateQuery(&desc, &endQueries[i]));
+    }
+
+    // The depth buffer is cleared before every pass, so that the pixels aren't rejected by
+    // the depth test after the first one. The clears are outside of the timestamps.
+    ID3D11RenderTargetView* rtv = NULL;
+    ID3D11DepthStencilView* dsv = NULL;
+    context->OMGetRenderTargets(1, &rtv, &dsv);
+
+    // Run the current mode last, so that it's what ends up in the render target
+    for(uint32 i = 1; i <= GeometricAAModeGUI::NumValues; ++i)
+    {
+        const uint32 mode = (AppSettings::GeometricAAMode + i) % GeometricAAModeGUI::NumValues;
+
+        // Warm up with one pass that isn't timed
+        if(dsv != NULL)
+            context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH|D3D11_CLEAR_STENCIL, 1.0f, 0);
+        RenderMeshes(context, camera, world, renderTargetSize, mode);
+
+        context->Begin(disjointQuery);
+        for(uint32 iteration = 0; iteration < NumIterations; ++iteration)
+        {
+            if(dsv != NULL)
+                context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH|D3D11_CLEAR_STENCIL, 1.0f, 0);
+
+            context->End(startQueries[iteration]);
+            RenderMeshes(context, camera, world, renderTargetSize, mode);
+            context->End(endQueries[iteration]);
+        }
+        context->End(disjointQuery);
+
+        D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
+        while(context->GetData(disjointQuery, &disjointData, sizeof(disjointData), 0) != S_OK);
+
+        uint64 totalTicks = 0;
+        for(uint32 iteration = 0; iteration < NumIterations; ++iteration)
+        {
+            uint64 startTime = 0;
+            uint64 endTime = 0;
+            while(context->GetData(startQueries[iteration], &startTime, sizeof(startTime), 0) != S_OK);
+            while(context->GetData(endQueries[iteration], &endTime, sizeof(endTime), 0) != S_OK);
+            totalTicks += endTime - startTime;
+        }
+
+        if(disjointData.Disjoint == false)
+        {
+            const double ticks = double(totalTicks) / NumIterations;
+            geometricAATimings[mode] = static_cast<float>(ticks / double(disjointData.Frequency) * 1000.0);
+        }
+    }
+
+    if(rtv != NULL)
+        rtv->Release();
+    if(dsv != NULL)
+        dsv->Release();
+}
+
+void MeshRenderer::RenderMeshes(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
+                                const Uint2& renderTargetSize, uint32 geometricAAMode)
 {
     ID3D11RenderTargetView* prevRTV[1] = { NULL };
     ID3D11DepthStencilView* prevDSV = NULL;
@@ -291,6 +934,28 @@ void MeshRenderer::Render(ID3D11DeviceContext* context, const Camera& camera, co
 
     PIXEvent event(L"Mesh Rendering");
 
+    // The SAT is only kept while it's turned on
+    if(AppSettings::UseMomentSAT && !momentSATValid)
+        GenerateMomentSAT(context);
+    else if(!AppSettings::UseMomentSAT && momentSATTexture.Texture != NULL)
+    {
+        momentSATTexture = RenderTarget2D();
+        momentSATValid = false;
+    }
+
+    if(AppSettings::CompactMaps && !compactMapsValid)
+        GenerateCompactMaps(context);
+
+    if(AppSettings::CompressedMaps && !compressedMapsValid)
+        GenerateCompressedMaps(context);
+
+    if(AppSettings::SpecularAAMode == SpecularAAModeGUI::AnisotropicRoughness && !anisoRoughnessMapValid)
+        GenerateAnisoRoughnessMap(context);
+
+    // Everything that's resolved from the moment pyramid is done by now
+    if(momentsValid && !keepMoments)
+        ReleaseMoments();
+
     ID3D11SamplerState* sampStates[3] = {
         samplerStates.Anisotropic(),
         samplerStates.ShadowMap(),
@@ -302,6 +967,7 @@ void MeshRenderer::Render(ID3D11DeviceContext* context, const Camera& camera, co
     meshVSConstants.Data.World = Float4x4::Transpose(world);
     meshVSConstants.Data.View = Float4x4::Transpose(camera.ViewMatrix());
     meshVSConstants.Data.WorldViewProjection = Float4x4::Transpose(world * camera.ViewProjectionMatrix());
+    meshVSConstants.Data.PixelFootprintScale = 2.0f / (camera.ProjectionMatrix()._22 * renderTargetSize.y);
     meshVSConstants.ApplyChanges(context);
     meshVSConstants.SetVS(context, 0);
 
@@ -314,12 +980,22 @@ void MeshRenderer::Render(ID3D11DeviceContext* context, const Camera& camera, co
     meshPSConstants.Data.EnableDiffuse = AppSettings::EnableDiffuse;
     meshPSConstants.Data.EnableSpecular = AppSettings::EnableSpecular;
     meshPSConstants.Data.VMFDiffuseAA = AppSettings::VMFDiffuseAA;
+    meshPSConstants.Data.UseMomentSAT = AppSettings::UseMomentSAT && momentSATValid;
+    meshPSConstants.Data.MomentSATSize = Uint2(momentSAT.Width, momentSAT.Height);
+    meshPSConstants.Data.MomentSATMaxFootprint = static_cast<float>(momentSAT.MaxFootprint);
+    meshPSConstants.Data.MomentSATInvScales[0] = momentSAT.PackedInvScales(0);
+    meshPSConstants.Data.MomentSATInvScales[1] = momentSAT.PackedInvScales(1);
+    meshPSConstants.Data.UseCompactMaps = AppSettings::CompactMaps && compactMapsValid;
+    meshPSConstants.Data.UseCompressedMaps = AppSettings::CompressedMaps && compressedMapsValid;
     meshPSConstants.ApplyChanges(context);
     meshPSConstants.SetPS(context, 0);
 
     uint32 specAAMode = AppSettings::SpecularAAMode;
     if(AppSettings::SuperSamplingMode > 0)
+    {
         specAAMode = 0;
+        geometricAAMode = 0;
+    }
 
     uint32 shaderSSAA = AppSettings::SuperSamplingMode == SuperSamplingModeGUI::ShaderSSAA;
 
@@ -328,7 +1004,7 @@ void MeshRenderer::Render(ID3D11DeviceContext* context, const Camera& camera, co
     context->HSSetShader(NULL, NULL, 0);
     context->GSSetShader(meshGS[shaderSSAA], NULL, 0);
     context->VSSetShader(meshVS[AppSettings::SuperSamplingMode], NULL, 0);
-    context->PSSetShader(meshPS[AppSettings::SuperSamplingMode][specAAMode][AppSettings::SpecularBRDF], NULL, 0);
+    context->PSSetShader(meshPS[AppSettings::SuperSamplingMode][specAAMode][AppSettings::SpecularBRDF][geometricAAMode], NULL, 0);
 
     // Draw all meshes
     for(uint32 meshIdx = 0; meshIdx < model->Meshes().size(); ++meshIdx)
@@ -353,22 +1029,31 @@ void MeshRenderer::Render(ID3D11DeviceContext* context, const Camera& camera, co
             const MeshMaterial& material = model->Materials()[part.MaterialIdx];
 
             // Set the textures
-            ID3D11ShaderResourceView* psTextures[5] =
+            ID3D11ShaderResourceView* psTextures[14] =
             {                
                 normalMaps[AppSettings::NormalMap],
                 leanMap.SRView,
                 vmfMap.SRView,
                 roughnessMap.SRView,
-                sampleOffsetsBuffer.SRView,
+                NULL,                           // The SSAA sample offsets are generated in the shader
+                momentSATTexture.SRView,
+                compactLEANBMap.SRView,
+                compactLEANCovarianceMap.SRView,
+                compactVMFMap.SRView,
+                compressedLEANMap,
+                compressedVMFDirectionMap,
+                compressedVMFShapeMap,
+                compressedRoughnessMap,
+                anisoRoughnessMap.SRView,
             };
-            context->PSSetShaderResources(0, 5, psTextures);
+            context->PSSetShaderResources(0, 14, psTextures);
 
             context->DrawIndexed(part.IndexCount, part.IndexStart, 0);
         }
     }
 
-    ID3D11ShaderResourceView* nullSRVs[5] = { NULL };
-    context->PSSetShaderResources(0, 5, nullSRVs);
+    ID3D11ShaderResourceView* nullSRVs[14] = { NULL };
+    context->PSSetShaderResources(0, 14, nullSRVs);
 
     if(AppSettings::SuperSamplingMode == SuperSamplingModeGUI::TextureSpaceLighting)
     {
@@ -19,6 +19,11 @@
 #include "SampleFramework11/Math.h"
 
 #include "AppSettings.h"
+#include "MapBaker.h"
+#include "MapCache.h"
+#include "MapCompression.h"
+#include "MomentSAT.h"
+#include "VMFMixture.h"
 
 using namespace SampleFramework11;
 
@@ -48,12 +53,52 @@ public:
     void Render(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
         const Uint2& renderTargetSize);
     void CreateMaps();
+    void LoadMaps(ID3D11DeviceContext* context);
+    void GenerateMoments(ID3D11DeviceContext* context);
     void GenerateMaps(ID3D11DeviceContext* context);
     void GenerateLEANMap(ID3D11DeviceContext* context);
+    void GenerateMomentSAT(ID3D11DeviceContext* context);
+    void GenerateCompactMaps(ID3D11DeviceContext* context);
+    void GenerateCompressedMaps(ID3D11DeviceContext* context);
+    void GenerateAnisoRoughnessMap(ID3D11DeviceContext* context);
+
+    // Replaces the texels of the current normal map covered by dirtyRects with the ones from
+    // editedMap, and only re-generates the moments and maps for the texels that depend on them
+    void UpdateNormalMap(ID3D11DeviceContext* context, const NormalMapData& editedMap,
+                         const std::vector<TexelRect>& dirtyRects);
+
+    // Called when the LEAN scale factor changes, since the compact maps are stored without it and
+    // the compressed maps are compressed from the full maps
+    void InvalidateCompactMaps() { compactMapsValid = false; }
+    void InvalidateCompressedMaps() { compressedMapsValid = false; }
+
+    // Bakes the current maps on the CPU, and compares them with the GPU results
+    void ValidateCPUBake(ID3D11DeviceContext* context);
+
+    MapCacheStats CacheStats() const { return mapCache.Stats(); }
+
+    // Times the mesh pass with every geometric AA mode on the GPU, by drawing it repeatedly
+    // between timestamp queries and waiting on the results. Has to be called with the main
+    // render targets bound, and leaves them with the pass drawn using the current settings.
+    void BenchmarkGeometricAA(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
+                              const Uint2& renderTargetSize);
+
+    // Average GPU time of the mesh pass in milliseconds, or 0 if the benchmark hasn't been run
+    float GeometricAATiming(uint32 mode) const { return geometricAATimings[mode]; }
 
 protected:
 
     static const UINT NumCascades = 4;
+    static const BCQuality CompressedMapQuality = BCQualityNormal;
+
+    void CreateMomentMap();
+    void ReleaseMoments();
+    BakeSettings CurrentBakeSettings() const;
+    void FitVMFMixture(ID3D11DeviceContext* context);
+    void RefitVMFMixture(ID3D11DeviceContext* context, const DirtyRegion& region);
+    void DispatchRects(ID3D11DeviceContext* context, const std::vector<TexelRect>& rects);
+    void RenderMeshes(ID3D11DeviceContext* context, const Camera& camera, const Float4x4& world,
+                      const Uint2& renderTargetSize, uint32 geometricAAMode);
 
     ID3D11DevicePtr device;
 
@@ -69,7 +114,8 @@ protected:
     ID3D10BlobPtr compiledMeshVS;
     ID3D11VertexShaderPtr meshVS[SuperSamplingModeGUI::NumValues];
     ID3D11GeometryShaderPtr meshGS[2];
-    ID3D11PixelShaderPtr meshPS[SuperSamplingModeGUI::NumValues][SpecularAAModeGUI::NumValues][SpecularBRDFGUI::NumValues];
+    ID3D11PixelShaderPtr meshPS[SuperSamplingModeGUI::NumValues][SpecularAAModeGUI::NumValues][SpecularBRDFGUI::NumValues]
+                               [GeometricAAModeGUI::NumValues];
 
     std::vector<ID3D11InputLayoutPtr> meshDepthInputLayouts;
     ID3D11VertexShaderPtr meshDepthVS;
@@ -80,24 +126,66 @@ protected:
     ID3D11PixelShaderPtr meshTLPS;
     ID3D10BlobPtr compiledMeshTLVS;
 
+    ID3D11ComputeShaderPtr generateMoments;
     ID3D11ComputeShaderPtr generateLEANMap;
     ID3D11ComputeShaderPtr generateVMFMap;
+    ID3D11ComputeShaderPtr generateCompactMaps;
+    ID3D11ComputeShaderPtr generateAnisoRoughnessMap;
 
     ID3D11ShaderResourceViewPtr normalMaps[NormalMapGUI::NumValues];
+    std::wstring normalMapPaths[NormalMapGUI::NumValues];
+    NormalMapData normalMapData[NormalMapGUI::NumValues];
+    MapBaker mapBaker;
+    VMFMixtureFitter vmfFitter;
+    BakedTexture fittedVMFMap;
+    bool vmfFitValid;           // The lobes from the last fit are kept along with the moments, for refitting edits
+    MapCache mapCache;
     RenderTarget2D leanMap;
     RenderTarget2D vmfMap;
     RenderTarget2D roughnessMap;
-
-    StructuredBuffer sampleOffsetsBuffer;
+    RenderTarget2D momentMap;
+    bool momentsValid;
+    bool keepMoments;           // Set by UpdateNormalMap, so that the next edit can be incremental
+
+    MomentSAT momentSAT;
+    RenderTarget2D momentSATTexture;
+    bool momentSATValid;
+
+    RenderTarget2D compactLEANBMap;
+    RenderTarget2D compactLEANCovarianceMap;
+    RenderTarget2D compactVMFMap;
+    bool compactMapsValid;
+
+    ID3D11ShaderResourceViewPtr compressedLEANMap;
+    ID3D11ShaderResourceViewPtr compressedVMFDirectionMap;
+    ID3D11ShaderResourceViewPtr compressedVMFShapeMap;
+    ID3D11ShaderResourceViewPtr compressedRoughnessMap;
+    bool compressedMapsValid;
+
+    RenderTarget2D anisoRoughnessMap;
+    bool anisoRoughnessMapValid;
+
+    std::vector<ID3D11ShaderResourceViewPtr> momentMipSRVs;
+    std::vector<ID3D11UnorderedAccessViewPtr> momentMipUAVs;
+    std::vector<ID3D11UnorderedAccessViewPtr> leanMipUAVs;
+    std::vector<ID3D11UnorderedAccessViewPtr> vmfMipUAVs;
+    std::vector<ID3D11UnorderedAccessViewPtr> roughnessMipUAVs;
+    std::vector<ID3D11UnorderedAccessViewPtr> compactLEANBMipUAVs;
+    std::vector<ID3D11UnorderedAccessViewPtr> compactLEANCovarianceMipUAVs;
+    std::vector<ID3D11UnorderedAccessViewPtr> compactVMFMipUAVs;
+    std::vector<ID3D11UnorderedAccessViewPtr> anisoRoughnessMipUAVs;
 
     RenderTarget2D lightingTexture;
 
+    float geometricAATimings[GeometricAAModeGUI::NumValues];
+
     // Constant buffers
     struct MeshVSConstants
     {
         Float4Align Float4x4 World;
         Float4Align Float4x4 View;
         Float4Align Float4x4 WorldViewProjection;
+        float PixelFootprintScale;
     };
 
     struct MeshPSConstants
@@ -113,6 +201,12 @@ protected:
         bool32 EnableDiffuse;
         bool32 EnableSpecular;
         bool32 VMFDiffuseAA;
+        bool32 UseMomentSAT;
+        Uint2 MomentSATSize;
+        float MomentSATMaxFootprint;
+        Float4Align Float4 MomentSATInvScales[2];
+        bool32 UseCompactMaps;
+        bool32 UseCompressedMaps;
     };
 
     struct CSConstants
@@ -122,8 +216,9 @@ protected:
         float OutputSizeX;
         float OutputSizeY;
         uint32 MipLevel;
-        float Roughness;
         float ScaleFactor;
+        uint32 OutputOffsetX;
+        uint32 OutputOffsetY;
     };
 
     ConstantBuffer<MeshVSConstants> meshVSConstants;
@@ -0,0 +1,390 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MeshShading.h"
+#include "SharedConstants.h"
+
+//=================================================================================================
+// Names
+//=================================================================================================
+
+const wchar* ShadingModeName(ShadingMode mode)
+{
+    static const wchar* Names[NumShadingModes] = { L"None", L"VMF", L"LEAN", L"CLEAN", L"Toksvig",
+                                                   L"PrecomputedVMF", L"PrecomputedToksvig", L"AnisoRoughness" };
+    return Names[mode];
+}
+
+const wchar* SpecularBRDFName(SpecularBRDF brdf)
+{
+    static const wchar* Names[NumSpecularBRDFs] = { L"Beckmann", L"GGX" };
+    return Names[brdf];
+}
+
+const wchar* GeometricAAModeName(GeometricAAMode mode)
+{
+    static const wchar* Names[NumGeometricAAModes] = { L"None", L"VertexCurvature", L"ScreenSpace" };
+    return Names[mode];
+}
+
+//=================================================================================================
+// Lighting
+//=================================================================================================
+
+// PointLightColors/PointLightPositions/PointLightFalloff from PS()
+static const ShadingPointLight PointLights[NumShadingPointLights] =
+{
+    { Float3(0.0f, 2.5f, 0.0f), Float3(0.5f * 15.0f), 2.0f },
+    { Float3(0.0f, 0.5f, 2.5f), Float3(0.5f * 15.0f), 2.0f },
+};
+
+const ShadingPointLight& GetShadingPointLight(uint32 lightIdx)
+{
+    Assert_(lightIdx < NumShadingPointLights);
+    return PointLights[lightIdx];
+}
+
+Float3 ShadingFrame::ToWorld(const Float3& v) const
+{
+    return Tangent * v.x + Bitangent * v.y + Normal * v.z;
+}
+
+Float3 ShadingFrame::ToTangent(const Float3& v) const
+{
+    return Float3(Float3::Dot(v, Tangent), Float3::Dot(v, Bitangent), Float3::Dot(v, Normal));
+}
+
+static Float3 Max0(const Float3& v)
+{
+    return Float3(std::max(v.x, 0.0f), std::max(v.y, 0.0f), std::max(v.z, 0.0f));
+}
+
+Float3 Fresnel(const Float3& specAlbedo, const Float3& h, const Float3& l)
+{
+    float lDotH = Saturate(Float3::Dot(l, h));
+    Float3 fresnel = specAlbedo + (Float3(1.0f) - specAlbedo) * std::pow(1.0f - lDotH, 5.0f);
+
+    // Disable specular entirely if the albedo is set to 0.0
+    if(specAlbedo.x + specAlbedo.y + specAlbedo.z <= 0.0f)
+        fresnel = Float3(0.0f);
+
+    return fresnel;
+}
+
+float Beckmann_G1(float m, float nDotX)
+{
+    float nDotX2 = nDotX * nDotX;
+    float tanTheta = std::sqrt((1 - nDotX2) / nDotX2);
+    float a = 1.0f / (m * tanTheta);
+    float a2 = a * a;
+
+    float g = 1.0f;
+    if(a < 1.6f)
+        g *= (3.535f * a + 2.181f * a2) / (1.0f + 2.276f * a + 2.577f * a2);
+
+    return g;
+}
+
+float Beckmann_Specular(float m, const Float3& n, const Float3& h, const Float3& v, const Float3& l)
+{
+    float nDotH = std::max(Float3::Dot(n, h), 0.0001f);
+    float nDotL = Saturate(Float3::Dot(n, l));
+    float nDotV = std::max(Float3::Dot(n, v), 0.0001f);
+
+    float nDotH2 = nDotH * nDotH;
+    float nDotH4 = nDotH2 * nDotH2;
+    float m2 = m * m;
+
+    // Calculate the distribution term
+    float tanTheta2 = (1 - nDotH2) / nDotH2;
+    float expTerm = std::exp(-tanTheta2 / m2);
+    float d = expTerm / (Pi * m2 * nDotH4);
+
+    // Calculate the matching geometric term
+    float g1i = Beckmann_G1(m, nDotL);
+    float g1o = Beckmann_G1(m, nDotV);
+    float g = g1i * g1o;
+
+    return d * g * (1.0f / (4.0f * nDotL * nDotV));
+}
+
+float GGX_V1(float m2, float nDotX)
+{
+    return 1.0f / (nDotX + std::sqrt(m2 + (1 - m2) * nDotX * nDotX));
+}
+
+float GGX_Specular(float m, const Float3& n, const Float3& h, const Float3& v, const Float3& l)
+{
+    float nDotH = Saturate(Float3::Dot(n, h));
+    float nDotL = Saturate(Float3::Dot(n, l));
+    float nDotV = Saturate(Float3::Dot(n, v));
+
+    float m2 = m * m;
+
+    // Calculate the distribution term
+    float x = nDotH * nDotH * (m2 - 1) + 1;
+    float d = m2 / (Pi * x * x);
+
+    // Calculate the matching visibility term
+    float v1i = GGX_V1(m2, nDotL);
+    float v1o = GGX_V1(m2, nDotV);
+    float vis = v1i * v1o;
+
+    return d * vis;
+}
+
+float RoughnessToSpecPower(float m)
+{
+    return 2.0f / (m * m) - 2.0f;
+}
+
+float SpecPowerToRoughness(float s)
+{
+    return std::sqrt(2.0f / (s + 2.0f));
+}
+
+float VMFKappa(float r)
+{
+    return r < 1.0f ? (3 * r - r * r * r) / (1 - r * r) : 10000.0f;
+}
+
+// Direction to the light and the attenuation, shared by all of the CalcPointLight variants
+static float PointLightDir(const ShadingPointLight& light, const Float3& positionWS, Float3& lightDir)
+{
+    Float3 pixelToLight = light.Position - positionWS;
+    float lightDist = pixelToLight.Length();
+    lightDir = pixelToLight / lightDist;
+    return 1.0f / std::pow(lightDist, light.Falloff);
+}
+
+static Float3 CalcLighting(const ShadingConstants& constants, const Float3& normal, const Float3& lightDir,
+                           const Float3& lightColor, const Float3& diffuseAlbedo, const Float3& specularAlbedo,
+                           float roughness, const Float3& positionWS)
+{
+    Float3 lighting = 0.0f;
+    float nDotL = Saturate(Float3::Dot(normal, lightDir));
+    if(nDotL > 0.0f)
+    {
+        Float3 view = Float3::Normalize(constants.CameraPosWS - positionWS);
+        Float3 h = Float3::Normalize(view + lightDir);
+
+        float specular = 0.0f;
+        if(constants.BRDF == SpecularBRDFGGX)
+            specular = GGX_Specular(roughness, normal, h, view, lightDir);
+        else
+            specular = Beckmann_Specular(roughness, normal, h, view, lightDir);
+
+        Float3 fresnel = Fresnel(specularAlbedo, h, lightDir);
+
+        lighting = (diffuseAlbedo * InvPi + fresnel * specular) * nDotL * lightColor;
+    }
+
+    return Max0(lighting);
+}
+
+Float3 CalcPointLight(const ShadingConstants& constants, const Float3& normal, const ShadingPointLight& light,
+                      const Float3& diffuseAlbedo, const Float3& specularAlbedo, float roughness,
+                      const Float3& positionWS)
+{
+    Float3 lightDir;
+    float attenuation = PointLightDir(light, positionWS, lightDir);
+    return CalcLighting(constants, normal, lightDir, light.Color, diffuseAlbedo, specularAlbedo,
+                        roughness, positionWS) * attenuation;
+}
+
+// SH9 basis from ProjectOntoSH9 in SH.hlsl
+static void SH9Basis(const Float3& n, float basis[9])
+{
+    basis[0] = 0.282095f;
+    basis[1] = 0.488603f * n.y;
+    basis[2] = 0.488603f * n.z;
+    basis[3] = 0.488603f * n.x;
+    basis[4] = 1.092548f * n.x * n.y;
+    basis[5] = 1.092548f * n.y * n.z;
+    basis[6] = 0.315392f * (3.0f * n.z * n.z - 1.0f);
+    basis[7] = 1.092548f * n.x * n.z;
+    basis[8] = 0.546274f * (n.x * n.x - n.y * n.y);
+}
+
+static float VMFSHCoefficient(float kappa, float l)
+{
+    return std::exp(-(l * l) / (2.0f * kappa));
+}
+
+Float3 CalcPointLightVMF(const ShadingConstants& constants, const Float3& mu, float kappa, float alpha,
+                         const ShadingPointLight& light, const Float3& diffuseAlbedo, const Float3& specularAlbedo,
+                         float roughness, const Float3& positionWS)
+{
+    Float3 lightDir;
+    float attenuation = PointLightDir(light, positionWS, lightDir);
+
+    Float3 normal = mu;
+
+    // Calculate a new roughness value
+    // (equation 21 in "Frequency Domain Normal Map Filtering")
+    float lobeRoughness = std::sqrt(roughness * roughness + (2.0f / kappa));
+    Float3 lighting = CalcLighting(constants, normal, lightDir, light.Color, Float3(0.0f),
+                                   specularAlbedo, lobeRoughness, positionWS) * alpha;
+
+    if(constants.VMFDiffuseAA)
+    {
+        // ProjectOntoSH9 with the vMF coefficients, dotted with EvalSH9Cosine's projection
+        const float ndfA[3] = { VMFSHCoefficient(kappa, 0), VMFSHCoefficient(kappa, 1), VMFSHCoefficient(kappa, 2) };
+        const float cosineA[3] = { 1.0f, 2.0f / 3.0f, 0.25f };
+        static const uint32 Bands[9] = { 0, 1, 1, 1, 2, 2, 2, 2, 2 };
+
+        float lightBasis[9];
+        float normalBasis[9];
+        SH9Basis(lightDir, lightBasis);
+        SH9Basis(normal, normalBasis);
+
+        float sum = 0.0f;
+        for(uint32 i = 0; i < 9; ++i)
+            sum += lightBasis[i] * ndfA[Bands[i]] * normalBasis[i] * cosineA[Bands[i]];
+
+        lighting = lighting + light.Color * diffuseAlbedo * sum;
+    }
+    else
+    {
+        lighting = lighting + diffuseAlbedo * light.Color * (Saturate(Float3::Dot(normal, lightDir)) * InvPi);
+    }
+
+    return lighting * attenuation;
+}
+
+Float3 CalcPointLightLEAN(const ShadingConstants& constants, const Float3& normal, const ShadingPointLight& light,
+                          const Float3& diffuseAlbedo, const Float3& specularAlbedo, float roughness,
+                          const Float3& positionWS, const Float2& leanB, const Float4& leanM,
+                          const ShadingFrame& frame, bool clean)
+{
+    Float3 lightDir;
+    float attenuation = PointLightDir(light, positionWS, lightDir);
+
+    Float3 lighting = 0.0f;
+    float nDotL = Saturate(Float3::Dot(normal, lightDir));
+    if(nDotL > 0.0f)
+    {
+        Float3 diffuse = light.Color * nDotL;
+        Float3 view = Float3::Normalize(constants.CameraPosWS - positionWS);
+
+        float s = RoughnessToSpecPower(roughness);
+        float invS = 1.0f / s;
+
+        Float3 ht = Float3::Normalize(frame.ToTangent(Float3::Normalize(view + lightDir)));
+
+        const float scale = constants.ScaleFactor;
+        float d = 0.0f;
+        if(clean)
+        {
+            // CLEAN mapping
+            Float2 B = Float2(leanB.x * scale, leanB.y * scale);
+            float M = leanM.w * scale * scale;
+
+            Float2 h = Float2(ht.x / ht.z, ht.y / ht.z);
+
+            float variance = M - (B.x * B.x + B.y * B.y);
+            variance += invS;
+
+            float e = ((h.x - B.x) * (h.x - B.x)) + ((h.y - B.y) * (h.y - B.y));
+            if(ht.z > 0.0f && variance > 0.0f)
+                d = std::exp(-0.5f * e / variance) / (variance * Pi * 2);
+        }
+        else
+        {
+            // LEAN mapping
+            Float2 B = Float2(leanB.x * scale, leanB.y * scale);
+            Float3 M = Float3(leanM.x, leanM.y, leanM.z) * (scale * scale);
+            M.x += invS;
+            M.y += invS;
+
+            Float3 sigma = M - Float3(B.x * B.x, B.y * B.y, B.x * B.y);
+            float det = sigma.x * sigma.y - sigma.z * sigma.z;
+
+            Float2 h = Float2(ht.x / ht.z - B.x, ht.y / ht.z - B.y);
+            float e = (h.x * h.x * sigma.y + h.y * h.y * sigma.x - 2 * h.x * h.y * sigma.z);
+            if(ht.z > 0.0f && det > 0.0f)
+                d = std::exp(-0.5f * e / det) / (std::sqrt(det) * Pi * 2);
+        }
+
+        // -- geometric term
+        float m = roughness;
+        float nDotV = std::max(Float3::Dot(normal, view), 0.0001f);
+
+        float g1i = Beckmann_G1(m, nDotL);
+        float g1o = Beckmann_G1(m, nDotV);
+        float g = g1i * g1o;
+
+        float specular = d * g * (1.0f / (4.0f * nDotL * nDotV));
+
+        Float3 fresnel = Fresnel(specularAlbedo, Float3::Normalize(view + lightDir), lightDir);
+
+        lighting = diffuse * diffuseAlbedo * InvPi + fresnel * diffuse * specular;
+    }
+
+    return Max0(lighting) * attenuation;
+}
+
+Float3 CalcPointLightAniso(const ShadingConstants& constants, const Float3& normal, const ShadingPointLight& light,
+                           const Float3& diffuseAlbedo, const Float3& specularAlbedo, float roughness,
+                           const Float3& positionWS, const Float2& meanSlope, const Float3& sigma,
+                           const ShadingFrame& frame)
+{
+    Float3 lightDir;
+    float attenuation = PointLightDir(light, positionWS, lightDir);
+
+    Float3 lighting = 0.0f;
+    float nDotL = Saturate(Float3::Dot(normal, lightDir));
+    if(nDotL > 0.0f)
+    {
+        Float3 view = Float3::Normalize(constants.CameraPosWS - positionWS);
+        Float3 h = Float3::Normalize(view + lightDir);
+        float nDotV = std::max(Float3::Dot(normal, view), 0.0001f);
+
+        Float3 ht = Float3::Normalize(frame.ToTangent(h));
+
+        // Add the base roughness to the filtered covariance. This is the alpha^2 matrix for GGX,
+        // and twice the slope covariance for Beckmann.
+        float m2 = roughness * roughness;
+        Float3 A = sigma * 2.0f + Float3(m2, m2, 0.0f);
+        float det = A.x * A.y - A.z * A.z;
+
+        float specular = 0.0f;
+        if(ht.z > 0.0f && det > 0.0f)
+        {
+            Float2 s = Float2(ht.x / ht.z - meanSlope.x, ht.y / ht.z - meanSlope.y);
+            float e = (s.x * s.x * A.y + s.y * s.y * A.x - 2.0f * s.x * s.y * A.z) / det;
+            float nDotH2 = ht.z * ht.z;
+            float norm = Pi * std::sqrt(det) * nDotH2 * nDotH2;
+
+            float a2 = 0.5f * (A.x + A.y);
+
+            if(constants.BRDF == SpecularBRDFGGX)
+            {
+                float d = 1.0f / (norm * (1.0f + e) * (1.0f + e));
+                specular = d * GGX_V1(a2, nDotL) * GGX_V1(a2, nDotV);
+            }
+            else
+            {
+                float d = std::exp(-e) / norm;
+                float a = std::sqrt(a2);
+                float g = Beckmann_G1(a, nDotL) * Beckmann_G1(a, nDotV);
+                specular = d * g * (1.0f / (4.0f * nDotL * nDotV));
+            }
+        }
+
+        Float3 fresnel = Fresnel(specularAlbedo, h, lightDir);
+
+        lighting = (diffuseAlbedo * InvPi + fresnel * specular) * nDotL * light.Color;
+    }
+
+    return Max0(lighting) * attenuation;
+}
\ No newline at end of file
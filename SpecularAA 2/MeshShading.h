@@ -0,0 +1,128 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/Math.h"
+
+using namespace SampleFramework11;
+
+// C++ versions of the lighting functions in Mesh.hlsl, so that the shading modes can be
+// evaluated without D3D11. They follow the HLSL line by line, including the clamps and the
+// order of operations, and should be kept in sync with it.
+
+// The ShaderAAMode_ permutations of Mesh.hlsl, in the same order as SpecularAAModeGUI
+enum ShadingMode
+{
+    ShadingModeDisabled = 0,
+    ShadingModeVMF,
+    ShadingModeLEAN,
+    ShadingModeCLEAN,
+    ShadingModeToksvig,
+    ShadingModePrecomputedVMF,
+    ShadingModePrecomputedToksvig,
+    ShadingModeAnisoRoughness,
+
+    NumShadingModes
+};
+
+const wchar* ShadingModeName(ShadingMode mode);
+
+// The same order as SpecularBRDFGUI
+enum SpecularBRDF
+{
+    SpecularBRDFBeckmann = 0,
+    SpecularBRDFGGX,
+
+    NumSpecularBRDFs
+};
+
+const wchar* SpecularBRDFName(SpecularBRDF brdf);
+
+// The GeometricAAMode_ permutations of Mesh.hlsl, in the same order as GeometricAAModeGUI
+enum GeometricAAMode
+{
+    GeometricAADisabled = 0,
+    GeometricAAVertexCurvature,
+    GeometricAAScreenSpace,
+
+    NumGeometricAAModes
+};
+
+const wchar* GeometricAAModeName(GeometricAAMode mode);
+
+// The parts of PSConstants that the lighting functions read
+struct ShadingConstants
+{
+    Float3 CameraPosWS;
+    float ScaleFactor;          // Final LEAN scale factor
+    SpecularBRDF BRDF;
+    bool VMFDiffuseAA;
+
+    ShadingConstants() : ScaleFactor(1.0f), BRDF(SpecularBRDFGGX), VMFDiffuseAA(false)
+    {
+    }
+};
+
+// The point lights that PS() loops over
+struct ShadingPointLight
+{
+    Float3 Position;
+    Float3 Color;
+    float Falloff;
+};
+
+static const uint32 NumShadingPointLights = 2;
+
+const ShadingPointLight& GetShadingPointLight(uint32 lightIdx);
+
+// tangentToWorld from PS(), whose rows are the frame vectors
+struct ShadingFrame
+{
+    Float3 Tangent;
+    Float3 Bitangent;
+    Float3 Normal;
+
+    // mul(v, tangentToWorld)
+    Float3 ToWorld(const Float3& v) const;
+
+    // mul(v, worldToTangent)
+    Float3 ToTangent(const Float3& v) const;
+};
+
+Float3 Fresnel(const Float3& specAlbedo, const Float3& h, const Float3& l);
+float Beckmann_G1(float m, float nDotX);
+float Beckmann_Specular(float m, const Float3& n, const Float3& h, const Float3& v, const Float3& l);
+float GGX_V1(float m2, float nDotX);
+float GGX_Specular(float m, const Float3& n, const Float3& h, const Float3& v, const Float3& l);
+float RoughnessToSpecPower(float m);
+float SpecPowerToRoughness(float s);
+float VMFKappa(float r);
+
+Float3 CalcPointLight(const ShadingConstants& constants, const Float3& normal, const ShadingPointLight& light,
+                      const Float3& diffuseAlbedo, const Float3& specularAlbedo, float roughness,
+                      const Float3& positionWS);
+
+// Single vMF lobe, since NumVMFs is 1
+Float3 CalcPointLightVMF(const ShadingConstants& constants, const Float3& mu, float kappa, float alpha,
+                         const ShadingPointLight& light, const Float3& diffuseAlbedo, const Float3& specularAlbedo,
+                         float roughness, const Float3& positionWS);
+
+Float3 CalcPointLightLEAN(const ShadingConstants& constants, const Float3& normal, const ShadingPointLight& light,
+                          const Float3& diffuseAlbedo, const Float3& specularAlbedo, float roughness,
+                          const Float3& positionWS, const Float2& leanB, const Float4& leanM,
+                          const ShadingFrame& frame, bool clean);
+
+Float3 CalcPointLightAniso(const ShadingConstants& constants, const Float3& normal, const ShadingPointLight& light,
+                           const Float3& diffuseAlbedo, const Float3& specularAlbedo, float roughness,
+                           const Float3& positionWS, const Float2& meanSlope, const Float3& sigma,
+                           const ShadingFrame& frame);
\ No newline at end of file
@@ -0,0 +1,357 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MomentSAT.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/Timer.h"
+#include "SampleFramework11/Random.h"
+
+// Number of rows or columns handled by each task of the prefix sums
+static const uint32 RowsPerTask = 64;
+static const uint32 ColumnsPerTask = 256;
+
+// Planes stored in each channel of the packed texture, see LoadMoments in GenerateMaps.hlsl
+static const uint32 PackedPlanes[2][4] =
+{
+    { MomentPyramid::AvgNormalX, MomentPyramid::AvgNormalY, MomentPyramid::AvgNormalZ, MomentPyramid::MXY },
+    { MomentPyramid::BX, MomentPyramid::BY, MomentPyramid::MXX, MomentPyramid::MYY },
+};
+
+static uint32 NumTasks(uint32 count, uint32 countPerTask)
+{
+    return (count + countPerTask - 1) / countPerTask;
+}
+
+//=================================================================================================
+// MomentSAT
+//=================================================================================================
+
+MomentSAT::MomentSAT() : Width(0), Height(0), MaxFootprint(0)
+{
+    for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+        InvScales[plane] = 1.0f;
+}
+
+void MomentSAT::Build(const MomentPyramid::Level& level, uint32 maxFootprint)
+{
+    Width = level.Width;
+    Height = level.Height;
+    MaxFootprint = Clamp(maxFootprint, 1u, MaxAnisotropicFootprint);
+
+    const uint32 numPlanes = MomentPyramid::NumPlanes;
+    const uint32 pitch = Width + 1;
+    const uint32 numRowTasks = NumTasks(Height, RowsPerTask);
+    const uint32 numColumnTasks = NumTasks(pitch, ColumnsPerTask);
+
+    // The largest magnitude in each plane determines its fixed-point scale
+    std::vector<float> taskMaxValues(numPlanes * numRowTasks, 0.0f);
+    ThreadPool::GlobalPool.ParallelFor(numPlanes * numRowTasks, [&](uint32 taskIdx, uint32 threadIdx)
+    {
+        const uint32 plane = taskIdx / numRowTasks;
+        const uint32 startY = (taskIdx % numRowTasks) * RowsPerTask;
+        const uint32 endY = std::min(startY + RowsPerTask, Height);
+
+        float maxValue = 0.0f;
+        const float* srcData = level.Data[plane].data();
+        for(uint32 i = startY * Width; i < endY * Width; ++i)
+            maxValue = std::max(maxValue, std::abs(srcData[i]));
+        taskMaxValues[taskIdx] = maxValue;
+    });
+
+    float scales[MomentPyramid::NumPlanes];
+    for(uint32 plane = 0; plane < numPlanes; ++plane)
+    {
+        float maxValue = 0.0f;
+        for(uint32 i = 0; i < numRowTasks; ++i)
+            maxValue = std::max(maxValue, taskMaxValues[plane * numRowTasks + i]);
+
+        // Leave a bit of headroom for rounding
+        scales[plane] = maxValue > 0.0f ? float(1 << 30) / (maxValue * MaxFootprint) : 1.0f;
+        InvScales[plane] = 1.0f / scales[plane];
+
+        Data[plane].resize(pitch * (Height + 1));
+        std::fill(Data[plane].begin(), Data[plane].begin() + pitch, 0);
+    }
+
+    // Prefix sum of each row, which converts to fixed point along the way
+    ThreadPool::GlobalPool.ParallelFor(numPlanes * numRowTasks, [&](uint32 taskIdx, uint32 threadIdx)
+    {
+        const uint32 plane = taskIdx / numRowTasks;
+        const uint32 startY = (taskIdx % numRowTasks) * RowsPerTask;
+        const uint32 endY = std::min(startY + RowsPerTask, Height);
+        const float scale = scales[plane];
+
+        for(uint32 y = startY; y < endY; ++y)
+        {
+            const float* srcRow = &level.Data[plane][y * Width];
+            uint32* dstRow = &Data[plane][(y + 1) * pitch];
+
+            uint32 sum = 0;
+            dstRow[0] = 0;
+            for(uint32 x = 0; x < Width; ++x)
+            {
+                sum += static_cast<uint32>(static_cast<int32>(std::floor(srcRow[x] * scale + 0.5f)));
+                dstRow[x + 1] = sum;
+            }
+        }
+    });
+
+    // Prefix sum of each column, done a row at a time over a range of columns
+    ThreadPool::GlobalPool.ParallelFor(numPlanes * numColumnTasks, [&](uint32 taskIdx, uint32 threadIdx)
+    {
+        const uint32 plane = taskIdx / numColumnTasks;
+        const uint32 startX = (taskIdx % numColumnTasks) * ColumnsPerTask;
+        const uint32 endX = std::min(startX + ColumnsPerTask, pitch);
+
+        uint32* data = Data[plane].data();
+        for(uint32 y = 2; y <= Height; ++y)
+        {
+            const uint32* prevRow = data + (y - 1) * pitch;
+            uint32* row = data + y * pitch;
+            for(uint32 x = startX; x < endX; ++x)
+                row[x] += prevRow[x];
+        }
+    });
+}
+
+void MomentSAT::ReleaseTables()
+{
+    for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+        std::vector<uint32>().swap(Data[plane]);
+}
+
+void MomentSAT::Query(uint32 minX, uint32 minY, uint32 maxX, uint32 maxY, float moments[MomentPyramid::NumPlanes]) const
+{
+    const uint32 pitch = Width + 1;
+    const uint32 idx00 = minY * pitch + minX;
+    const uint32 idx10 = minY * pitch + maxX;
+    const uint32 idx01 = maxY * pitch + minX;
+    const uint32 idx11 = maxY * pitch + maxX;
+    const float invArea = 1.0f / ((maxX - minX) * (maxY - minY));
+
+    for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+    {
+        const uint32* data = Data[plane].data();
+        const uint32 sum = data[idx11] - data[idx01] - data[idx10] + data[idx00];
+        moments[plane] = static_cast<int32>(sum) * InvScales[plane] * invArea;
+    }
+}
+
+void MomentSAT::Pack(BakedTexture& texture) const
+{
+    const uint32 pitch = Width + 1;
+    texture.Initialize(pitch, Height + 1, DXGI_FORMAT_R32G32B32A32_UINT, 1, 2);
+
+    for(uint32 slice = 0; slice < 2; ++slice)
+    {
+        uint32* dstData = reinterpret_cast<uint32*>(texture.Data(0, slice));
+        ThreadPool::GlobalPool.ParallelFor(NumTasks(Height + 1, RowsPerTask), [&](uint32 taskIdx, uint32 threadIdx)
+        {
+            const uint32 startIdx = taskIdx * RowsPerTask * pitch;
+            const uint32 endIdx = std::min(startIdx + RowsPerTask * pitch, pitch * (Height + 1));
+            for(uint32 i = startIdx; i < endIdx; ++i)
+                for(uint32 c = 0; c < 4; ++c)
+                    dstData[i * 4 + c] = Data[PackedPlanes[slice][c]][i];
+        });
+    }
+}
+
+Float4 MomentSAT::PackedInvScales(uint32 arraySlice) const
+{
+    const uint32* planes = PackedPlanes[arraySlice];
+    return Float4(InvScales[planes[0]], InvScales[planes[1]], InvScales[planes[2]], InvScales[planes[3]]);
+}
+
+//=================================================================================================
+// MomentSATBenchmark
+//=================================================================================================
+
+// Bilinear sample of a level of the moment pyramid at a normalized texture coordinate
+static void SampleLevel(const MomentPyramid::Level& level, float u, float v, float moments[MomentPyramid::NumPlanes])
+{
+    const float x = Clamp(u * level.Width - 0.5f, 0.0f, level.Width - 1.0f);
+    const float y = Clamp(v * level.Height - 0.5f, 0.0f, level.Height - 1.0f);
+    const uint32 x0 = static_cast<uint32>(x);
+    const uint32 y0 = static_cast<uint32>(y);
+    const uint32 x1 = std::min(x0 + 1, level.Width - 1);
+    const uint32 y1 = std::min(y0 + 1, level.Height - 1);
+    const float fx = x - x0;
+    const float fy = y - y0;
+
+    for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+    {
+        const float* data = level.Data[plane].data();
+        const float top = Lerp(data[y0 * level.Width + x0], data[y0 * level.Width + x1], fx);
+        const float bottom = Lerp(data[y1 * level.Width + x0], data[y1 * level.Width + x1], fx);
+        moments[plane] = Lerp(top, bottom, fy);
+    }
+}
+
+// Trilinear sample of the moment pyramid, with the LOD chosen from the longest side of the
+// footprint the same way that the hardware does for isotropic filtering
+static void SampleMips(const MomentPyramid& pyramid, float u, float v, float footprintSize,
+                       float moments[MomentPyramid::NumPlanes])
+{
+    const float maxLOD = static_cast<float>(pyramid.Levels.size() - 1);
+    const float lod = Clamp(std::log2(std::max(footprintSize, 1.0f)), 0.0f, maxLOD);
+    const uint32 mip0 = static_cast<uint32>(lod);
+    const uint32 mip1 = std::min(mip0 + 1, static_cast<uint32>(maxLOD));
+    const float lodFrac = lod - mip0;
+
+    float moments1[MomentPyramid::NumPlanes];
+    SampleLevel(pyramid.Levels[mip0], u, v, moments);
+    SampleLevel(pyramid.Levels[mip1], u, v, moments1);
+    for(uint32 plane = 0; plane < MomentPyramid::NumPlanes; ++plane)
+        moments[plane] = Lerp(moments[plane], moments1[plane], lodFrac);
+}
+
+static float AvgNormalLength(const float* moments)
+{
+    return std::sqrt(moments[MomentPyramid::AvgNormalX] * moments[MomentPyramid::AvgNormalX]
+                     + moments[MomentPyramid::AvgNormalY] * moments[MomentPyramid::AvgNormalY]
+                     + moments[MomentPyramid::AvgNormalZ] * moments[MomentPyramid::AvgNormalZ]);
+}
+
+static float LEANVariance(const float* moments)
+{
+    return moments[MomentPyramid::MXX] - moments[MomentPyramid::BX] * moments[MomentPyramid::BX]
+           + moments[MomentPyramid::MYY] - moments[MomentPyramid::BY] * moments[MomentPyramid::BY];
+}
+
+MomentSATBenchmark::MomentSATBenchmark() :  NumQueries(0),
+                                            BuildSeconds(0.0),
+                                            SATQueryNanoseconds(0.0),
+                                            MipQueryNanoseconds(0.0),
+                                            SATLengthError(0.0),
+                                            SATVarianceError(0.0),
+                                            MipLengthError(0.0),
+                                            MipVarianceError(0.0)
+{
+}
+
+void MomentSATBenchmark::Run(const MomentPyramid& moments, uint32 numQueries, uint32 maxFootprint)
+{
+    const MomentPyramid::Level& baseLevel = moments.Levels[0];
+    const uint32 numPlanes = MomentPyramid::NumPlanes;
+    NumQueries = numQueries;
+
+    Timer timer;
+
+    MomentSAT sat;
+    sat.Build(baseLevel, maxFootprint);
+
+    timer.Update();
+    BuildSeconds = timer.DeltaSecondsD();
+
+    // Random rectangles that fit within the texture, and within the SAT's footprint limit
+    struct Footprint
+    {
+        uint32 MinX;
+        uint32 MinY;
+        uint32 MaxX;
+        uint32 MaxY;
+    };
+
+    Random random;
+    const uint32 maxSide = std::max(static_cast<uint32>(std::sqrt(float(sat.MaxFootprint))), 1u);
+    std::vector<Footprint> footprints(numQueries);
+    for(uint32 i = 0; i < numQueries; ++i)
+    {
+        const uint32 width = std::min(1 + random.NextUInt(maxSide), baseLevel.Width);
+        const uint32 height = std::min(1 + random.NextUInt(maxSide), baseLevel.Height);
+        footprints[i].MinX = random.NextUInt(baseLevel.Width - width + 1);
+        footprints[i].MinY = random.NextUInt(baseLevel.Height - height + 1);
+        footprints[i].MaxX = footprints[i].MinX + width;
+        footprints[i].MaxY = footprints[i].MinY + height;
+    }
+
+    std::vector<float> satResults(numQueries * numPlanes);
+    std::vector<float> mipResults(numQueries * numPlanes);
+
+    timer.Update();
+
+    for(uint32 i = 0; i < numQueries; ++i)
+    {
+        const Footprint& fp = footprints[i];
+        sat.Query(fp.MinX, fp.MinY, fp.MaxX, fp.MaxY, &satResults[i * numPlanes]);
+    }
+
+    timer.Update();
+    SATQueryNanoseconds = timer.DeltaSecondsD() * 1000000000.0 / std::max(numQueries, 1u);
+
+    for(uint32 i = 0; i < numQueries; ++i)
+    {
+        const Footprint& fp = footprints[i];
+        const float u = (fp.MinX + fp.MaxX) * 0.5f / baseLevel.Width;
+        const float v = (fp.MinY + fp.MaxY) * 0.5f / baseLevel.Height;
+        const float footprintSize = static_cast<float>(std::max(fp.MaxX - fp.MinX, fp.MaxY - fp.MinY));
+        SampleMips(moments, u, v, footprintSize, &mipResults[i * numPlanes]);
+    }
+
+    timer.Update();
+    MipQueryNanoseconds = timer.DeltaSecondsD() * 1000000000.0 / std::max(numQueries, 1u);
+
+    // Compare against a brute-force average of each footprint
+    std::vector<double> sqErrors(numQueries * 4);
+    ThreadPool::GlobalPool.ParallelFor(numQueries, [&](uint32 queryIdx, uint32 threadIdx)
+    {
+        const Footprint& fp = footprints[queryIdx];
+
+        double sums[MomentPyramid::NumPlanes] = { 0.0 };
+        for(uint32 y = fp.MinY; y < fp.MaxY; ++y)
+            for(uint32 x = fp.MinX; x < fp.MaxX; ++x)
+                for(uint32 plane = 0; plane < numPlanes; ++plane)
+                    sums[plane] += baseLevel.Data[plane][y * baseLevel.Width + x];
+
+        float reference[MomentPyramid::NumPlanes];
+        const double area = double(fp.MaxX - fp.MinX) * (fp.MaxY - fp.MinY);
+        for(uint32 plane = 0; plane < numPlanes; ++plane)
+            reference[plane] = static_cast<float>(sums[plane] / area);
+
+        const float* satResult = &satResults[queryIdx * numPlanes];
+        const float* mipResult = &mipResults[queryIdx * numPlanes];
+        const double errors[4] =
+        {
+            AvgNormalLength(satResult) - AvgNormalLength(reference),
+            LEANVariance(satResult) - LEANVariance(reference),
+            AvgNormalLength(mipResult) - AvgNormalLength(reference),
+            LEANVariance(mipResult) - LEANVariance(reference),
+        };
+
+        for(uint32 i = 0; i < 4; ++i)
+            sqErrors[queryIdx * 4 + i] = errors[i] * errors[i];
+    });
+
+    double sums[4] = { 0.0 };
+    for(uint32 i = 0; i < numQueries; ++i)
+        for(uint32 j = 0; j < 4; ++j)
+            sums[j] += sqErrors[i * 4 + j];
+
+    const double invNumQueries = 1.0 / std::max(numQueries, 1u);
+    SATLengthError = std::sqrt(sums[0] * invNumQueries);
+    SATVarianceError = std::sqrt(sums[1] * invNumQueries);
+    MipLengthError = std::sqrt(sums[2] * invNumQueries);
+    MipVarianceError = std::sqrt(sums[3] * invNumQueries);
+}
+
+std::wstring MomentSATBenchmark::ToString() const
+{
+    std::wstring text = L"SAT build: " + SampleFramework11::ToString(BuildSeconds * 1000.0) + L"ms\n";
+    text += L"Queries: " + SampleFramework11::ToString(NumQueries) + L"\n";
+    text += L"SAT: " + SampleFramework11::ToString(SATQueryNanoseconds) + L"ns/query, RMS error r = ";
+    text += SampleFramework11::ToString(SATLengthError) + L", variance = " + SampleFramework11::ToString(SATVarianceError) + L"\n";
+    text += L"Mips: " + SampleFramework11::ToString(MipQueryNanoseconds) + L"ns/query, RMS error r = ";
+    text += SampleFramework11::ToString(MipLengthError) + L", variance = " + SampleFramework11::ToString(MipVarianceError);
+    return text;
+}
\ No newline at end of file
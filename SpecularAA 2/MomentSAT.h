@@ -0,0 +1,80 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "MapBaker.h"
+
+using namespace SampleFramework11;
+
+// Summed-area tables of the normal moments, which give the average moments over any rectangle
+// of texels with 4 fetches per plane. The values are stored as 32-bit fixed point, and the sums
+// are allowed to wrap around: the sum over a rectangle is still exact as long as it fits in
+// 31 bits. The fixed-point scale for each plane is chosen so that rectangles of up to
+// MaxFootprint texels can't overflow, so a smaller MaxFootprint gives more precision. Larger
+// footprints are left to the mip chain.
+struct MomentSAT
+{
+    // The rectangle around a pixel footprint with the hardware's maximum anisotropy, at the mip
+    // level where its minor axis covers one texel
+    static const uint32 MaxAnisotropy = 16;
+    static const uint32 MaxAnisotropicFootprint = MaxAnisotropy * MaxAnisotropy;
+    static const uint32 DefaultMaxFootprint = MaxAnisotropicFootprint;
+
+    uint32 Width;               // Size of the source level, the tables have an extra row and column of zeros
+    uint32 Height;
+    uint32 MaxFootprint;
+    float InvScales[MomentPyramid::NumPlanes];
+    std::vector<uint32> Data[MomentPyramid::NumPlanes];
+
+    MomentSAT();
+
+    // Builds the tables from a level of the moment pyramid, using a parallel prefix sum of the
+    // rows followed by a parallel prefix sum of the columns. maxFootprint is clamped to
+    // MaxAnisotropicFootprint.
+    void Build(const MomentPyramid::Level& level, uint32 maxFootprint = DefaultMaxFootprint);
+
+    // Frees the tables once they've been packed, keeping the size and scales
+    void ReleaseTables();
+
+    // Averages the moments over the texels in [minX, maxX) x [minY, maxY)
+    void Query(uint32 minX, uint32 minY, uint32 maxX, uint32 maxY, float moments[MomentPyramid::NumPlanes]) const;
+
+    // Packs the tables into a 2-slice R32G32B32A32_UINT texture, with the same layout as the
+    // moment pyramid: (AvgNormal, M.z) and (B, M.xy)
+    void Pack(BakedTexture& texture) const;
+
+    // Inverse scales for each channel of the packed texture
+    Float4 PackedInvScales(uint32 arraySlice) const;
+};
+
+// Compares filtering random rectangular footprints using the SAT against trilinear filtering
+// of the moment pyramid, using a brute-force average of the footprint as the reference
+struct MomentSATBenchmark
+{
+    uint32 NumQueries;
+    double BuildSeconds;
+    double SATQueryNanoseconds;
+    double MipQueryNanoseconds;
+
+    // RMS errors of the vMF "r" term and of the LEAN variance (trace of the covariance)
+    double SATLengthError;
+    double SATVarianceError;
+    double MipLengthError;
+    double MipVarianceError;
+
+    MomentSATBenchmark();
+
+    void Run(const MomentPyramid& moments, uint32 numQueries, uint32 maxFootprint);
+
+    std::wstring ToString() const;
+};
\ No newline at end of file
@@ -0,0 +1,107 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+// ================================================================================================
+// Averages of the normals within a texel footprint. Every term is linear in its inputs, so each
+// mip level can be computed from a 2x2 block of the level above it.
+// ================================================================================================
+struct NormalMoments
+{
+    float3 AvgNormal;           // Average of the normalized normals, its length is the vMF "r" term
+    float2 B;                   // LEAN first moments, without the scale factor applied
+    float3 M;                   // LEAN second moments, without the scale factor applied
+};
+
+// ================================================================================================
+// Computes the vMF concentration from the length of the average normal, the same as SolveVMF
+// ================================================================================================
+float VMFKappa(in float r)
+{
+    return r < 1.0f ? (3 * r - r * r * r) / (1 - r * r) : 10000.0f;
+}
+
+// ================================================================================================
+// Covariance of the slopes about the slope of the average normal, instead of about the mean
+// slope B like LEAN. A filtered normal map gives the average normal, so this is the roughness
+// that the footprint adds around it. Returns (xx, yy, xy).
+// ================================================================================================
+float3 MeanNormalCovariance(in NormalMoments moments)
+{
+    float2 meanSlope = moments.AvgNormal.xy / max(moments.AvgNormal.z, 0.0001f);
+    float2 offset = moments.B - meanSlope;
+    float3 sigma = moments.M - float3(moments.B * moments.B, moments.B.x * moments.B.y);
+    return sigma + float3(offset * offset, offset.x * offset.y);
+}
+
+// ================================================================================================
+// Returns the sum of a rectangle of texels from a moment SAT, where minPos and maxPos are both
+// within [0, textureSize]. The tables wrap around on overflow, so the difference is exact as long
+// as the sum itself fits in 31 bits.
+// ================================================================================================
+uint4 MomentSATRectSum(in Texture2DArray<uint4> momentSAT, in uint slice, in uint2 minPos, in uint2 maxPos)
+{
+    return momentSAT[uint3(maxPos.x, maxPos.y, slice)] - momentSAT[uint3(minPos.x, maxPos.y, slice)]
+           - momentSAT[uint3(maxPos.x, minPos.y, slice)] + momentSAT[uint3(minPos.x, minPos.y, slice)];
+}
+
+// ================================================================================================
+// Averages the moments over the rectangle that bounds a pixel footprint, using the summed-area
+// tables built by MomentSAT. The footprint wraps around the edges of the texture. Returns false
+// if the footprint covers more than maxFootprint texels, since the fixed-point sums would overflow.
+// ================================================================================================
+bool QueryMomentSAT(in Texture2DArray<uint4> momentSAT, in float4 invScales[2], in uint2 textureSize,
+                    in float maxFootprint, in float2 uv, in float2 uvDX, in float2 uvDY,
+                    out NormalMoments moments)
+{
+    moments = (NormalMoments)0;
+
+    float2 size = float2(textureSize);
+    float2 extent = clamp(round(abs(uvDX * size) + abs(uvDY * size)), 1.0f, size);
+    if(extent.x * extent.y > maxFootprint)
+        return false;
+
+    // Split the wrapped footprint into up to two spans along each axis
+    uint2 footprint = uint2(extent);
+    int2 minPos = int2(floor(uv * size - extent * 0.5f + 0.5f));
+    uint2 start = uint2((minPos % int2(textureSize) + int2(textureSize)) % int2(textureSize));
+    uint2 end = min(start + footprint, textureSize);
+    uint2 wrappedEnd = start + footprint - end;
+
+    uint4 sums[2];
+
+    [unroll]
+    for(uint slice = 0; slice < 2; ++slice)
+    {
+        sums[slice] = MomentSATRectSum(momentSAT, slice, start, end);
+
+        [branch]
+        if(wrappedEnd.x > 0)
+            sums[slice] += MomentSATRectSum(momentSAT, slice, uint2(0, start.y), uint2(wrappedEnd.x, end.y));
+
+        [branch]
+        if(wrappedEnd.y > 0)
+            sums[slice] += MomentSATRectSum(momentSAT, slice, uint2(start.x, 0), uint2(end.x, wrappedEnd.y));
+
+        [branch]
+        if(wrappedEnd.x > 0 && wrappedEnd.y > 0)
+            sums[slice] += MomentSATRectSum(momentSAT, slice, 0, wrappedEnd);
+    }
+
+    // Same layout as the moment pyramid: (AvgNormal, M.z) and (B, M.xy)
+    float invArea = 1.0f / (extent.x * extent.y);
+    float4 slice0 = float4(asint(sums[0])) * invScales[0] * invArea;
+    float4 slice1 = float4(asint(sums[1])) * invScales[1] * invArea;
+
+    moments.AvgNormal = slice0.xyz;
+    moments.B = slice1.xy;
+    moments.M = float3(slice1.zw, slice0.w);
+
+    return true;
+}
\ No newline at end of file
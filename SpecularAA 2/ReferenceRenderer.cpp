@@ -0,0 +1,1123 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "ReferenceRenderer.h"
+#include "AnisoRoughness.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Exceptions.h"
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/Timer.h"
+
+// Most triangles in a BVH leaf
+static const uint32 MaxLeafTriangles = 4;
+
+// Deepest BVH that can be traversed, which a median split won't get near
+static const uint32 MaxTraversalDepth = 64;
+
+static float Axis(const Float3& v, uint32 axis)
+{
+    return (&v.x)[axis];
+}
+
+static Float3 Min(const Float3& a, const Float3& b)
+{
+    return Float3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+}
+
+static Float3 Max(const Float3& a, const Float3& b)
+{
+    return Float3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+}
+
+// Below this the adaptive error target is absolute instead of relative, so that dark pixels don't
+// take every sample trying to resolve noise that can't be seen
+static const float AdaptiveMinLuminance = 0.01f;
+
+static Float4 Lerp4(const Float4& a, const Float4& b, float t)
+{
+    return Float4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+}
+
+// FilterCubic from Mesh.hlsl
+static float FilterCubic(float x, float B, float C)
+{
+    // Rescale from [-2, 2] range to [-SampleRadius, SampleRadius]
+    x *= 2.0f;
+
+    float y = 0.0f;
+    const float x2 = x * x;
+    const float x3 = x * x * x;
+    if(x < 1)
+        y = (12 - 9 * B - 6 * C) * x3 + (-18 + 12 * B + 6 * C) * x2 + (6 - 2 * B);
+    else if(x <= 2)
+        y = (-B - 6 * C) * x3 + (6 * B + 30 * C) * x2 + (-12 * B - 48 * C) * x + (8 * B + 24 * C);
+
+    return y / 6.0f;
+}
+
+static float Luminance(const Float3& color)
+{
+    return color.x * 0.2126f + color.y * 0.7152f + color.z * 0.0722f;
+}
+
+// Whether every sample of a pixel is shaded, which is when ShaderSSAA samples the top mip level
+static bool ShadesSamples(SupersamplingMode mode)
+{
+    return mode == SupersamplingUniform || mode == SupersamplingAdaptive;
+}
+
+const wchar* SupersamplingModeName(SupersamplingMode mode)
+{
+    static const wchar* Names[NumSupersamplingModes] = { L"None", L"Uniform", L"Adaptive", L"TextureSpace" };
+    return Names[mode];
+}
+
+//=================================================================================================
+// HDRImage
+//=================================================================================================
+
+void HDRImage::Initialize(uint32 width, uint32 height)
+{
+    Width = width;
+    Height = height;
+    Pixels.resize(uint64(width) * height);
+}
+
+void HDRImage::WriteToDDSFile(const wchar* filePath) const
+{
+    BakedTexture texture;
+    texture.Initialize(Width, Height, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 1);
+    memcpy(texture.Data(0, 0), Pixels.data(), Pixels.size() * sizeof(Float4));
+    texture.WriteToDDSFile(filePath);
+}
+
+void HDRImage::WriteToFloatImageFile(const wchar* filePath, TiledImageFormat tiledFormat) const
+{
+    FloatImageFileWriter writer;
+    writer.Create(filePath, Width, Height, tiledFormat);
+    writer.WriteRect(0, 0, Width, Height, Pixels.data(), Width);
+    writer.Close();
+}
+
+void HDRImage::LoadFromFile(const wchar* filePath)
+{
+    LoadFloatImage(filePath, Width, Height, Pixels);
+}
+
+//=================================================================================================
+// ReferenceTexture
+//=================================================================================================
+
+ReferenceTexture::ReferenceTexture() : width(0), height(0)
+{
+}
+
+void ReferenceTexture::Initialize(const BakedTexture& texture, uint32 arraySlice)
+{
+    width = texture.Width;
+    height = texture.Height;
+    mips.resize(texture.NumMipLevels);
+
+    for(uint32 mipLevel = 0; mipLevel < texture.NumMipLevels; ++mipLevel)
+    {
+        const uint32 mipWidth = texture.MipWidth(mipLevel);
+        const uint32 mipHeight = texture.MipHeight(mipLevel);
+        std::vector<Float4>& mip = mips[mipLevel];
+        mip.resize(uint64(mipWidth) * mipHeight);
+
+        ThreadPool::GlobalPool.ParallelFor(mipHeight, [&](uint32 y, uint32 threadIdx)
+        {
+            for(uint32 x = 0; x < mipWidth; ++x)
+                mip[y * mipWidth + x] = texture.Texel(mipLevel, arraySlice, x, y);
+        });
+    }
+}
+
+void ReferenceTexture::Initialize(const NormalMapData& normalMap)
+{
+    std::vector<Float4> texels(uint64(normalMap.Width) * normalMap.Height);
+    for(uint64 i = 0; i < texels.size(); ++i)
+    {
+        const uint32 texel = normalMap.Texels[i];
+        texels[i] = Float4((texel & 0xFF) / 255.0f, ((texel >> 8) & 0xFF) / 255.0f,
+                           ((texel >> 16) & 0xFF) / 255.0f, (texel >> 24) / 255.0f);
+    }
+
+    Initialize(normalMap.Width, normalMap.Height, texels);
+}
+
+void ReferenceTexture::Initialize(uint32 width_, uint32 height_, std::vector<Float4>& texels)
+{
+    width = width_;
+    height = height_;
+
+    uint32 numMipLevels = 1;
+    while((std::max(width, height) >> numMipLevels) > 0)
+        ++numMipLevels;
+    mips.resize(numMipLevels);
+    mips[0].swap(texels);
+
+    GenerateMips();
+}
+
+void ReferenceTexture::GenerateMips()
+{
+    const uint32 numMipLevels = NumMipLevels();
+    for(uint32 mipLevel = 1; mipLevel < numMipLevels; ++mipLevel)
+    {
+        const uint32 srcWidth = std::max<uint32>(width >> (mipLevel - 1), 1);
+        const uint32 srcHeight = std::max<uint32>(height >> (mipLevel - 1), 1);
+        const uint32 mipWidth = std::max<uint32>(width >> mipLevel, 1);
+        const uint32 mipHeight = std::max<uint32>(height >> mipLevel, 1);
+        const std::vector<Float4>& src = mips[mipLevel - 1];
+        std::vector<Float4>& mip = mips[mipLevel];
+        mip.resize(uint64(mipWidth) * mipHeight);
+
+        for(uint32 y = 0; y < mipHeight; ++y)
+        {
+            const uint32 y0 = std::min(y * 2, srcHeight - 1);
+            const uint32 y1 = std::min(y * 2 + 1, srcHeight - 1);
+            for(uint32 x = 0; x < mipWidth; ++x)
+            {
+                const uint32 x0 = std::min(x * 2, srcWidth - 1);
+                const uint32 x1 = std::min(x * 2 + 1, srcWidth - 1);
+                const Float4 sum = src[y0 * srcWidth + x0] + src[y0 * srcWidth + x1] +
+                                   src[y1 * srcWidth + x0] + src[y1 * srcWidth + x1];
+                mip[y * mipWidth + x] = sum * 0.25f;
+            }
+        }
+    }
+}
+
+Float4 ReferenceTexture::Texel(uint32 mipLevel, int32 x, int32 y) const
+{
+    const int32 mipWidth = int32(std::max<uint32>(width >> mipLevel, 1));
+    const int32 mipHeight = int32(std::max<uint32>(height >> mipLevel, 1));
+    x %= mipWidth;
+    y %= mipHeight;
+    if(x < 0)
+        x += mipWidth;
+    if(y < 0)
+        y += mipHeight;
+    return mips[mipLevel][y * mipWidth + x];
+}
+
+Float4 ReferenceTexture::SampleBilinear(const Float2& uv, uint32 mipLevel) const
+{
+    const float mipWidth = float(std::max<uint32>(width >> mipLevel, 1));
+    const float mipHeight = float(std::max<uint32>(height >> mipLevel, 1));
+    const float fx = uv.x * mipWidth - 0.5f;
+    const float fy = uv.y * mipHeight - 0.5f;
+    const float x0 = std::floor(fx);
+    const float y0 = std::floor(fy);
+    const float tx = fx - x0;
+    const float ty = fy - y0;
+
+    // Keep the texel coordinates small before wrapping, for UVs far outside of [0, 1]
+    const int32 ix = int32(x0 - std::floor(x0 / mipWidth) * mipWidth);
+    const int32 iy = int32(y0 - std::floor(y0 / mipHeight) * mipHeight);
+
+    const Float4 top = Lerp4(Texel(mipLevel, ix, iy), Texel(mipLevel, ix + 1, iy), tx);
+    const Float4 bottom = Lerp4(Texel(mipLevel, ix, iy + 1), Texel(mipLevel, ix + 1, iy + 1), tx);
+    return Lerp4(top, bottom, ty);
+}
+
+Float4 ReferenceTexture::SampleLevel(const Float2& uv, float lod) const
+{
+    const uint32 lastMip = NumMipLevels() - 1;
+    lod = Clamp(lod, 0.0f, float(lastMip));
+    const uint32 mip0 = uint32(lod);
+    const float t = lod - mip0;
+    if(mip0 == lastMip || t == 0.0f)
+        return SampleBilinear(uv, mip0);
+
+    return Lerp4(SampleBilinear(uv, mip0), SampleBilinear(uv, mip0 + 1), t);
+}
+
+Float4 ReferenceTexture::SampleTrilinear(const Float2& uv, const Float2& uvDX, const Float2& uvDY) const
+{
+    const Float2 dx = Float2(uvDX.x * width, uvDX.y * height);
+    const Float2 dy = Float2(uvDY.x * width, uvDY.y * height);
+    const float rho = std::max(Float2::Length(dx), Float2::Length(dy));
+    const float lod = rho > 0.0f ? std::log2(rho) : 0.0f;
+    return SampleLevel(uv, lod);
+}
+
+Float4 ReferenceTexture::SampleAniso(const Float2& uv, const Float2& uvDX, const Float2& uvDY) const
+{
+    const Float2 dx = Float2(uvDX.x * width, uvDX.y * height);
+    const Float2 dy = Float2(uvDY.x * width, uvDY.y * height);
+    const float lengthX = Float2::Length(dx);
+    const float lengthY = Float2::Length(dy);
+    const float major = std::max(lengthX, lengthY);
+    const float minor = std::min(lengthX, lengthY);
+    if(major <= 0.0f)
+        return SampleLevel(uv, 0.0f);
+
+    const float ratio = minor > 0.0f ? major / minor : float(MaxAnisotropy);
+    const uint32 numTaps = std::min(uint32(std::ceil(ratio - 0.001f)), MaxAnisotropy);
+    const float lod = std::log2(major / numTaps);
+    if(numTaps <= 1)
+        return SampleLevel(uv, lod);
+
+    // Spread the taps evenly along the major axis of the footprint
+    const Float2& axis = lengthX >= lengthY ? uvDX : uvDY;
+    Float4 sum = 0.0f;
+    for(uint32 i = 0; i < numTaps; ++i)
+    {
+        const float offset = (i + 0.5f) / numTaps - 0.5f;
+        sum += SampleLevel(Float2(uv.x + axis.x * offset, uv.y + axis.y * offset), lod);
+    }
+
+    return sum / float(numTaps);
+}
+
+//=================================================================================================
+// ReferenceScene
+//=================================================================================================
+
+ReferenceScene::ReferenceScene()
+{
+}
+
+void ReferenceScene::Initialize(const Model& model, const Float4x4& world)
+{
+    vertices.clear();
+    triangles.clear();
+    nodes.clear();
+
+    // Curvature is in object space, so it's scaled the same way as the vertex shader does
+    const float worldScale = Float3::TransformDirection(Float3(1.0f, 0.0f, 0.0f), world).Length();
+
+    for(uint64 meshIdx = 0; meshIdx < model.Meshes().size(); ++meshIdx)
+    {
+        const Mesh& mesh = model.Meshes()[meshIdx];
+
+        uint32 posOffset = 0xFFFFFFFF;
+        uint32 nmlOffset = 0xFFFFFFFF;
+        uint32 tcOffset = 0xFFFFFFFF;
+        uint32 tanOffset = 0xFFFFFFFF;
+        uint32 bitanOffset = 0xFFFFFFFF;
+        uint32 curvatureOffset = 0xFFFFFFFF;
+        for(uint32 i = 0; i < mesh.NumInputElements(); ++i)
+        {
+            const D3D11_INPUT_ELEMENT_DESC& element = mesh.InputElements()[i];
+            const std::string semantic = element.SemanticName;
+            if(semantic == "POSITION")
+                posOffset = element.AlignedByteOffset;
+            else if(semantic == "NORMAL")
+                nmlOffset = element.AlignedByteOffset;
+            else if(semantic == "TEXCOORD" && element.SemanticIndex == 0)
+                tcOffset = element.AlignedByteOffset;
+            else if(semantic == "TANGENT")
+                tanOffset = element.AlignedByteOffset;
+            else if(semantic == "BITANGENT")
+                bitanOffset = element.AlignedByteOffset;
+            else if(semantic == "CURVATURE")
+                curvatureOffset = element.AlignedByteOffset;
+        }
+
+        if(posOffset == 0xFFFFFFFF || nmlOffset == 0xFFFFFFFF || tcOffset == 0xFFFFFFFF)
+            throw Exception(L"Can't render a mesh without positions, normals, and texcoords");
+
+        const uint32 baseVertex = uint32(vertices.size());
+        vertices.resize(baseVertex + mesh.NumVertices());
+
+        const uint32 stride = mesh.VertexStride();
+        for(uint32 i = 0; i < mesh.NumVertices(); ++i)
+        {
+            const uint8* src = mesh.Vertices() + i * stride;
+            Vertex& vtx = vertices[baseVertex + i];
+
+            vtx.Position = Float3::Transform(*reinterpret_cast<const Float3*>(src + posOffset), world);
+            vtx.Normal = Float3::Normalize(Float3::TransformDirection(*reinterpret_cast<const Float3*>(src + nmlOffset), world));
+            vtx.TexCoord = *reinterpret_cast<const Float2*>(src + tcOffset);
+
+            if(tanOffset != 0xFFFFFFFF && bitanOffset != 0xFFFFFFFF)
+            {
+                vtx.Tangent = Float3::Normalize(Float3::TransformDirection(*reinterpret_cast<const Float3*>(src + tanOffset), world));
+                vtx.Bitangent = Float3::Normalize(Float3::TransformDirection(*reinterpret_cast<const Float3*>(src + bitanOffset), world));
+            }
+            else
+            {
+                vtx.Tangent = Float3::Normalize(Float3::Perpendicular(vtx.Normal));
+                vtx.Bitangent = Float3::Cross(vtx.Normal, vtx.Tangent);
+            }
+
+            vtx.Curvature = 0.0f;
+            if(curvatureOffset != 0xFFFFFFFF)
+                vtx.Curvature = *reinterpret_cast<const float*>(src + curvatureOffset) / worldScale;
+        }
+
+        const uint32 indexSize = mesh.IndexSize();
+        const uint32 numTriangles = mesh.NumIndices() / 3;
+        for(uint32 triIdx = 0; triIdx < numTriangles; ++triIdx)
+        {
+            Triangle tri;
+            for(uint32 i = 0; i < 3; ++i)
+            {
+                const uint8* index = mesh.Indices() + (triIdx * 3 + i) * indexSize;
+                const uint32 vtxIdx = indexSize == 4 ? *reinterpret_cast<const uint32*>(index)
+                                                     : *reinterpret_cast<const uint16*>(index);
+                tri.Indices[i] = baseVertex + vtxIdx;
+            }
+
+            const Float3& p0 = vertices[tri.Indices[0]].Position;
+            tri.P0 = p0;
+            tri.E1 = vertices[tri.Indices[1]].Position - p0;
+            tri.E2 = vertices[tri.Indices[2]].Position - p0;
+            tri.Normal = Float3::Cross(tri.E1, tri.E2);
+            triangles.push_back(tri);
+        }
+    }
+
+    if(triangles.size() == 0)
+        return;
+
+    std::vector<Float3> centroids(triangles.size());
+    std::vector<uint32> order(triangles.size());
+    for(uint64 i = 0; i < triangles.size(); ++i)
+    {
+        const Triangle& tri = triangles[i];
+        centroids[i] = tri.P0 + (tri.E1 + tri.E2) * (1.0f / 3.0f);
+        order[i] = uint32(i);
+    }
+
+    nodes.reserve(triangles.size() * 2 / MaxLeafTriangles + 1);
+    BuildNode(0, uint32(triangles.size()), centroids, order);
+
+    // Store the triangles in the order that the leaves reference them
+    std::vector<Triangle> sortedTriangles(triangles.size());
+    for(uint64 i = 0; i < order.size(); ++i)
+        sortedTriangles[i] = triangles[order[i]];
+    triangles.swap(sortedTriangles);
+}
+
+uint32 ReferenceScene::BuildNode(uint32 start, uint32 end, const std::vector<Float3>& centroids,
+                                 std::vector<uint32>& order)
+{
+    const uint32 nodeIdx = uint32(nodes.size());
+    nodes.push_back(Node());
+
+    Float3 boundsMin = FLT_MAX;
+    Float3 boundsMax = -FLT_MAX;
+    Float3 centroidMin = FLT_MAX;
+    Float3 centroidMax = -FLT_MAX;
+    for(uint32 i = start; i < end; ++i)
+    {
+        const Triangle& tri = triangles[order[i]];
+        const Float3 p1 = tri.P0 + tri.E1;
+        const Float3 p2 = tri.P0 + tri.E2;
+        boundsMin = Min(boundsMin, Min(tri.P0, Min(p1, p2)));
+        boundsMax = Max(boundsMax, Max(tri.P0, Max(p1, p2)));
+        centroidMin = Min(centroidMin, centroids[order[i]]);
+        centroidMax = Max(centroidMax, centroids[order[i]]);
+    }
+
+    nodes[nodeIdx].Min = boundsMin;
+    nodes[nodeIdx].Max = boundsMax;
+
+    if(end - start <= MaxLeafTriangles)
+    {
+        nodes[nodeIdx].Offset = start;
+        nodes[nodeIdx].NumTriangles = end - start;
+        return nodeIdx;
+    }
+
+    const Float3 extents = centroidMax - centroidMin;
+    uint32 axis = 0;
+    if(extents.y > extents.x)
+        axis = 1;
+    if(extents.z > Axis(extents, axis))
+        axis = 2;
+
+    const uint32 mid = (start + end) / 2;
+    std::nth_element(order.begin() + start, order.begin() + mid, order.begin() + end, [&](uint32 a, uint32 b)
+    {
+        return Axis(centroids[a], axis) < Axis(centroids[b], axis);
+    });
+
+    BuildNode(start, mid, centroids, order);
+    const uint32 secondChild = BuildNode(mid, end, centroids, order);
+
+    nodes[nodeIdx].Offset = secondChild;
+    nodes[nodeIdx].NumTriangles = 0;
+    return nodeIdx;
+}
+
+bool ReferenceScene::Intersect(const Float3& origin, const Float3& dir, float maxT, Hit& hit) const
+{
+    if(nodes.size() == 0)
+        return false;
+
+    const Float3 invDir = Float3(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+
+    bool found = false;
+    float closestT = maxT;
+
+    uint32 stack[MaxTraversalDepth];
+    uint32 stackSize = 0;
+    uint32 nodeIdx = 0;
+    while(true)
+    {
+        const Node& node = nodes[nodeIdx];
+
+        // Slab test against the bounds of the node
+        const Float3 t0 = (node.Min - origin) * invDir;
+        const Float3 t1 = (node.Max - origin) * invDir;
+        const Float3 tNear = Min(t0, t1);
+        const Float3 tFar = Max(t0, t1);
+        const float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, closestT));
+
+        if(enter <= exit)
+        {
+            if(node.NumTriangles == 0)
+            {
+                Assert_(stackSize < MaxTraversalDepth);
+                stack[stackSize++] = node.Offset;
+                ++nodeIdx;
+                continue;
+            }
+
+            // Moller-Trumbore
+            for(uint32 triIdx = node.Offset; triIdx < node.Offset + node.NumTriangles; ++triIdx)
+            {
+                const Triangle& tri = triangles[triIdx];
+                const Float3 p = Float3::Cross(dir, tri.E2);
+                const float det = Float3::Dot(tri.E1, p);
+                if(std::abs(det) < 1e-20f)
+                    continue;
+
+                const float invDet = 1.0f / det;
+                const Float3 s = origin - tri.P0;
+                const float u = Float3::Dot(s, p) * invDet;
+                if(u < 0.0f || u > 1.0f)
+                    continue;
+
+                const Float3 q = Float3::Cross(s, tri.E1);
+                const float v = Float3::Dot(dir, q) * invDet;
+                if(v < 0.0f || u + v > 1.0f)
+                    continue;
+
+                const float t = Float3::Dot(tri.E2, q) * invDet;
+                if(t > 0.0f && t < closestT)
+                {
+                    closestT = t;
+                    hit.Triangle = triIdx;
+                    hit.T = t;
+                    hit.U = u;
+                    hit.V = v;
+                    found = true;
+                }
+            }
+        }
+
+        if(stackSize == 0)
+            break;
+        nodeIdx = stack[--stackSize];
+    }
+
+    return found;
+}
+
+//=================================================================================================
+// ReferenceStats
+//=================================================================================================
+
+double ReferenceStats::PixelsPerSecond() const
+{
+    return Seconds > 0.0 ? NumPixels / Seconds : 0.0;
+}
+
+double ReferenceStats::SamplesPerPixel() const
+{
+    return NumPixels > 0 ? double(NumSamples) / NumPixels : 0.0;
+}
+
+std::wstring ReferenceStats::ToString() const
+{
+    std::wstring text = L"Rendered " + SampleFramework11::ToString(NumPixels) + L" pixels (";
+    text += SampleFramework11::ToString(NumHits) + L" hits) in ";
+    text += SampleFramework11::ToString(Seconds * 1000.0) + L"ms using ";
+    text += SampleFramework11::ToString(NumThreads) + L" threads (";
+    text += SampleFramework11::ToString(PixelsPerSecond() / 1000000.0) + L" MPixels/s)";
+    if(NumSamples > 0)
+    {
+        text += L", " + SampleFramework11::ToString(SamplesPerPixel()) + L" samples/pixel (";
+        text += SampleFramework11::ToString(MaxPixelSamples) + L" max)";
+    }
+    return text;
+}
+
+//=================================================================================================
+// ReferenceRenderer
+//=================================================================================================
+
+// Everything that stays the same over a frame
+struct ReferenceRenderer::FrameConstants
+{
+    ReferenceSettings Settings;
+    ShadingConstants Shading;
+    const ReferenceTexture* LightingTexture;    // Only used for the screen pass of texture-space lighting
+    Float4x4 View;
+    float PixelFootprintScale;
+    uint32 Width;
+    uint32 Height;
+
+    // The near and far plane points of the ray through the center of pixel (0, 0), and how much
+    // they move per pixel. Both are linear in screen space for a perspective or ortho projection.
+    Float3 Near;
+    Float3 NearDX;
+    Float3 NearDY;
+    Float3 Far;
+    Float3 FarDX;
+    Float3 FarDY;
+};
+
+struct ReferenceRenderer::TileStats
+{
+    uint64 NumHits;
+    uint64 NumSamples;
+    uint32 MaxPixelSamples;
+
+    TileStats() : NumHits(0), NumSamples(0), MaxPixelSamples(0)
+    {
+    }
+};
+
+ReferenceRenderer::ReferenceRenderer() : scaleFactor(1.0f)
+{
+}
+
+void ReferenceRenderer::SetNormalMap(const NormalMapData& normalMapData, const BakeSettings& settings)
+{
+    MapBaker baker;
+    BakedMaps maps;
+    baker.Bake(normalMapData, settings, maps);
+
+    BakedTexture anisoRoughness;
+    baker.ResolveAnisoRoughnessMap(anisoRoughness);
+
+    SetNormalMap(normalMapData, settings, maps, anisoRoughness);
+}
+
+void ReferenceRenderer::SetNormalMap(const NormalMapData& normalMapData, const BakeSettings& settings,
+                                     const BakedMaps& maps, const BakedTexture& anisoRoughness)
+{
+    scaleFactor = settings.ScaleFactor;
+    normalMap.Initialize(normalMapData);
+    leanBMap.Initialize(maps.LEANMap, 0);
+    leanMMap.Initialize(maps.LEANMap, 1);
+    vmfMap.Initialize(maps.VMFMap, 0);
+    roughnessMap.Initialize(maps.RoughnessMap, 0);
+    anisoRoughnessMap.Initialize(anisoRoughness, 0);
+}
+
+void ReferenceRenderer::Render(const ReferenceScene& scene, const Camera& camera, const ReferenceSettings& settings,
+                               HDRImage& image)
+{
+    Render(scene, camera, settings, image, stats);
+}
+
+void ReferenceRenderer::Render(const ReferenceScene& scene, const Camera& camera, const ReferenceSettings& settings,
+                               HDRImage& image, ReferenceStats& renderStats) const
+{
+    RenderTiles(scene, camera, settings, image.Width, image.Height, &image, NULL, renderStats);
+}
+
+void ReferenceRenderer::Render(const ReferenceScene& scene, const Camera& camera, const ReferenceSettings& settings,
+                               uint32 width, uint32 height, FloatImageWriter& writer)
+{
+    Render(scene, camera, settings, width, height, writer, stats);
+}
+
+void ReferenceRenderer::Render(const ReferenceScene& scene, const Camera& camera, const ReferenceSettings& settings,
+                               uint32 width, uint32 height, FloatImageWriter& writer, ReferenceStats& renderStats) const
+{
+    RenderTiles(scene, camera, settings, width, height, NULL, &writer, renderStats);
+}
+
+// Renders into the image if there is one, and otherwise into one tile per thread that goes to the
+// writer once it's done
+void ReferenceRenderer::RenderTiles(const ReferenceScene& scene, const Camera& camera, const ReferenceSettings& settings,
+                                    uint32 width, uint32 height, HDRImage* image, FloatImageWriter* writer,
+                                    ReferenceStats& renderStats) const
+{
+    if(normalMap.NumMipLevels() == 0)
+        throw Exception(L"A normal map has to be set before rendering");
+
+    Timer timer;
+
+    renderStats = ReferenceStats();
+    renderStats.NumThreads = ThreadPool::InTask() ? 1 : ThreadPool::GlobalPool.NumThreads();
+
+    FrameConstants frame;
+    frame.Settings = settings;
+    frame.LightingTexture = NULL;
+    frame.Shading.CameraPosWS = camera.Position();
+    frame.Shading.ScaleFactor = scaleFactor;
+    frame.Shading.BRDF = settings.BRDF;
+    frame.Shading.VMFDiffuseAA = settings.VMFDiffuseAA;
+    frame.View = camera.ViewMatrix();
+    frame.PixelFootprintScale = 2.0f / (camera.ProjectionMatrix()._22 * height);
+    frame.Width = width;
+    frame.Height = height;
+
+    const Float4x4 invViewProj = Float4x4::Invert(camera.ViewProjectionMatrix());
+    auto unproject = [&](float x, float y, float z)
+    {
+        const float ndcX = (x + 0.5f) / width * 2.0f - 1.0f;
+        const float ndcY = 1.0f - (y + 0.5f) / height * 2.0f;
+        return Float3::Transform(Float3(ndcX, ndcY, z), invViewProj);
+    };
+
+    frame.Near = unproject(0.0f, 0.0f, 0.0f);
+    frame.NearDX = unproject(1.0f, 0.0f, 0.0f) - frame.Near;
+    frame.NearDY = unproject(0.0f, 1.0f, 0.0f) - frame.Near;
+    frame.Far = unproject(0.0f, 0.0f, 1.0f);
+    frame.FarDX = unproject(1.0f, 0.0f, 1.0f) - frame.Far;
+    frame.FarDY = unproject(0.0f, 1.0f, 1.0f) - frame.Far;
+
+    const uint32 numTilesX = (width + TileSize - 1) / TileSize;
+    const uint32 numTilesY = (height + TileSize - 1) / TileSize;
+
+    std::vector<TileStats> threadStats(ThreadPool::GlobalPool.NumThreads());
+
+    ReferenceTexture lightingTexture;
+    if(settings.Supersampling == SupersamplingTextureSpace)
+    {
+        ShadeLightingTexture(scene, frame, lightingTexture, threadStats);
+        frame.LightingTexture = &lightingTexture;
+    }
+
+    std::vector<Float4> threadTiles(image != NULL ? 0 : threadStats.size() * TileSize * TileSize);
+
+    ThreadPool::GlobalPool.ParallelFor(numTilesX * numTilesY, [&](uint32 tileIdx, uint32 threadIdx)
+    {
+        const uint32 tileX = tileIdx % numTilesX;
+        const uint32 tileY = tileIdx / numTilesX;
+        if(image != NULL)
+        {
+            Float4* pixels = &image->Pixel(tileX * TileSize, tileY * TileSize);
+            RenderTile(scene, frame, tileX, tileY, pixels, image->Width, threadStats[threadIdx]);
+            return;
+        }
+
+        Float4* pixels = &threadTiles[threadIdx * TileSize * TileSize];
+        RenderTile(scene, frame, tileX, tileY, pixels, TileSize, threadStats[threadIdx]);
+
+        const uint32 tileWidth = std::min(TileSize, width - tileX * TileSize);
+        const uint32 tileHeight = std::min(TileSize, height - tileY * TileSize);
+        writer->WriteRect(tileX * TileSize, tileY * TileSize, tileWidth, tileHeight, pixels, TileSize);
+    });
+
+    renderStats.NumPixels = uint64(width) * height;
+    for(uint64 i = 0; i < threadStats.size(); ++i)
+    {
+        renderStats.NumHits += threadStats[i].NumHits;
+        renderStats.NumSamples += threadStats[i].NumSamples;
+        renderStats.MaxPixelSamples = std::max(renderStats.MaxPixelSamples, threadStats[i].MaxPixelSamples);
+    }
+
+    timer.Update();
+    renderStats.Seconds = timer.ElapsedSecondsD();
+}
+
+// The ray through the point (x, y) in pixel coordinates, relative to the center of pixel (0, 0).
+// The direction isn't normalized, so the far plane is at t = 1.
+ReferenceRenderer::Ray ReferenceRenderer::MakeRay(const FrameConstants& frame, float x, float y)
+{
+    Ray ray;
+    ray.Origin = frame.Near + frame.NearDX * x + frame.NearDY * y;
+    ray.Dir = frame.Far + frame.FarDX * x + frame.FarDY * y - ray.Origin;
+    return ray;
+}
+
+// The pixels start at the top left of the tile
+void ReferenceRenderer::RenderTile(const ReferenceScene& scene, const FrameConstants& frame, uint32 tileX,
+                                   uint32 tileY, Float4* pixels, uint32 pitch, TileStats& tileStats) const
+{
+    const uint32 startX = tileX * TileSize;
+    const uint32 startY = tileY * TileSize;
+    const uint32 endX = std::min(startX + TileSize, frame.Width);
+    const uint32 endY = std::min(startY + TileSize, frame.Height);
+
+    for(uint32 y = startY; y < endY; ++y)
+    {
+        Float4* row = pixels + (y - startY) * pitch;
+        for(uint32 x = startX; x < endX; ++x)
+        {
+            if(ShadesSamples(frame.Settings.Supersampling))
+            {
+                row[x - startX] = SupersamplePixel(scene, frame, x, y, tileStats);
+                continue;
+            }
+
+            const Ray ray = MakeRay(frame, float(x), float(y));
+            ReferenceScene::Hit hit;
+            if(scene.Intersect(ray.Origin, ray.Dir, 1.0f, hit))
+            {
+                const Float3 color = ShadePixel(scene, frame, hit, ray, MakeRay(frame, x + 1.0f, float(y)),
+                                                MakeRay(frame, float(x), y + 1.0f));
+                row[x - startX] = Float4(color, 1.0f);
+                ++tileStats.NumHits;
+            }
+            else
+                row[x - startX] = Float4(0.0f, 0.0f, 0.0f, 0.0f);
+        }
+    }
+}
+
+Float4 ReferenceRenderer::SupersamplePixel(const ReferenceScene& scene, const FrameConstants& frame, uint32 x,
+                                           uint32 y, TileStats& tileStats) const
+{
+    const ReferenceSettings& settings = frame.Settings;
+    const bool adaptive = settings.Supersampling == SupersamplingAdaptive;
+    const uint32 numSamples = adaptive ? std::max(settings.MaxSamples, 1u)
+                                       : std::max(settings.UniformSamples * settings.UniformSamples, 1u);
+    const uint32 minSamples = std::min(std::max(settings.MinSamples, 1u), numSamples);
+    const PixelSampler sampler(settings.Sequence, x, y, frame.Width, settings.SequenceSeed);
+
+    // The filtered color and coverage, and the sums needed for the variance of the weighted mean
+    // of the luminance: sum(w^2 * (L - mean)^2) = sum(w^2 * L^2) - 2 * mean * sum(w^2 * L) + mean^2 * sum(w^2)
+    Float3 colorSum = 0.0f;
+    double weightSum = 0.0;
+    double coverageSum = 0.0;
+    double lumSum = 0.0;
+    double weight2Sum = 0.0;
+    double weight2LumSum = 0.0;
+    double weight2Lum2Sum = 0.0;
+    bool anyHit = false;
+
+    uint32 sampleIdx = 0;
+    while(sampleIdx < numSamples)
+    {
+        const Float2 sampleOffset = sampler.Offset(sampleIdx) * settings.SampleRadius;
+        const float sampleDist = Float2::Length(sampleOffset) / (settings.SampleRadius / 2.0f);
+        const float filterWeight = numSamples > 1 ? FilterCubic(sampleDist, 1.0f, 0.0f) : 1.0f;
+        ++sampleIdx;
+
+        const float sampleX = x + sampleOffset.x;
+        const float sampleY = y + sampleOffset.y;
+        const Ray ray = MakeRay(frame, sampleX, sampleY);
+        ReferenceScene::Hit hit;
+        float luminance = 0.0f;
+        if(scene.Intersect(ray.Origin, ray.Dir, 1.0f, hit))
+        {
+            const Float3 color = ShadePixel(scene, frame, hit, ray, MakeRay(frame, sampleX + 1.0f, sampleY),
+                                            MakeRay(frame, sampleX, sampleY + 1.0f));
+            colorSum += color * filterWeight;
+            coverageSum += filterWeight;
+            luminance = Luminance(color);
+            anyHit = true;
+        }
+
+        weightSum += filterWeight;
+        lumSum += filterWeight * luminance;
+        weight2Sum += filterWeight * filterWeight;
+        weight2LumSum += filterWeight * filterWeight * luminance;
+        weight2Lum2Sum += filterWeight * filterWeight * luminance * luminance;
+
+        if(adaptive && sampleIdx >= minSamples && sampleIdx % AdaptiveBatchSize == 0 && weightSum > 0.0)
+        {
+            const double mean = lumSum / weightSum;
+            const double variance = std::max(weight2Lum2Sum - 2.0 * mean * weight2LumSum + mean * mean * weight2Sum, 0.0);
+            const double standardError = std::sqrt(variance) / weightSum;
+            if(standardError <= settings.TargetError * std::max(mean, double(AdaptiveMinLuminance)))
+                break;
+        }
+    }
+
+    tileStats.NumSamples += sampleIdx;
+    tileStats.MaxPixelSamples = std::max(tileStats.MaxPixelSamples, sampleIdx);
+    if(anyHit)
+        ++tileStats.NumHits;
+
+    if(weightSum <= 0.0)
+        return Float4(0.0f, 0.0f, 0.0f, 0.0f);
+
+    const float invWeightSum = float(1.0 / weightSum);
+    return Float4(colorSum * invWeightSum, float(coverageSum) * invWeightSum);
+}
+
+Float3 ReferenceRenderer::ShadePixel(const ReferenceScene& scene, const FrameConstants& frame,
+                                     const ReferenceScene::Hit& hit, const Ray& ray, const Ray& rayDX,
+                                     const Ray& rayDY) const
+{
+    const ReferenceScene::Vertex& v0 = scene.TriangleVertex(hit.Triangle, 0);
+    const ReferenceScene::Vertex& v1 = scene.TriangleVertex(hit.Triangle, 1);
+    const ReferenceScene::Vertex& v2 = scene.TriangleVertex(hit.Triangle, 2);
+
+    // Barycentrics of where the neighboring rays hit the plane of the triangle, which give the
+    // same derivatives as ddx/ddy on a triangle
+    const Float3& p0 = v0.Position;
+    const Float3 e1 = v1.Position - p0;
+    const Float3 e2 = v2.Position - p0;
+    const Float3& triNormal = scene.TriangleNormal(hit.Triangle);
+    const float d00 = Float3::Dot(e1, e1);
+    const float d01 = Float3::Dot(e1, e2);
+    const float d11 = Float3::Dot(e2, e2);
+    const float invDenom = 1.0f / (d00 * d11 - d01 * d01);
+    const Float2 hitUV = Float2(hit.U, hit.V);
+    auto planeBarycentrics = [&](const Ray& r)
+    {
+        const float dDotN = Float3::Dot(r.Dir, triNormal);
+        if(std::abs(dDotN) < 1e-20f)
+            return hitUV;
+        const float t = Float3::Dot(p0 - r.Origin, triNormal) / dDotN;
+        const Float3 offset = r.Origin + r.Dir * t - p0;
+        const float d20 = Float3::Dot(offset, e1);
+        const float d21 = Float3::Dot(offset, e2);
+        return Float2((d11 * d20 - d01 * d21) * invDenom, (d00 * d21 - d01 * d20) * invDenom);
+    };
+
+    const Float2 baryDX = planeBarycentrics(rayDX);
+    const Float2 baryDY = planeBarycentrics(rayDY);
+    const Float2 dBaryDX = Float2(baryDX.x - hit.U, baryDX.y - hit.V);
+    const Float2 dBaryDY = Float2(baryDY.x - hit.U, baryDY.y - hit.V);
+
+    if(frame.LightingTexture != NULL)
+    {
+        // PSTextureLighting
+        const Float2 uv = v0.TexCoord * (1.0f - hit.U - hit.V) + v1.TexCoord * hit.U + v2.TexCoord * hit.V;
+        const Float2 uvDX = (v1.TexCoord - v0.TexCoord) * dBaryDX.x + (v2.TexCoord - v0.TexCoord) * dBaryDX.y;
+        const Float2 uvDY = (v1.TexCoord - v0.TexCoord) * dBaryDY.x + (v2.TexCoord - v0.TexCoord) * dBaryDY.y;
+        const Float4 lighting = frame.LightingTexture->SampleAniso(uv, uvDX, uvDY);
+        return Float3(lighting.x, lighting.y, lighting.z);
+    }
+
+    return ShadeSurface(scene, frame, hit.Triangle, hitUV, dBaryDX, dBaryDY, ray.Origin + ray.Dir * hit.T);
+}
+
+// Rasterizes every triangle into the lighting texture at its UVs, which is what VS() does with
+// TextureSpaceLighting_, and shades the texels that it covers. Moving one texel over changes the
+// barycentrics by a constant amount for each triangle, which stands in for ddx/ddy.
+void ReferenceRenderer::ShadeLightingTexture(const ReferenceScene& scene, const FrameConstants& frame,
+                                             ReferenceTexture& lightingTexture,
+                                             std::vector<TileStats>& threadStats) const
+{
+    uint32 texWidth = frame.Settings.LightingTextureSize;
+    uint32 texHeight = frame.Settings.LightingTextureSize;
+    if(texWidth == 0)
+    {
+        texWidth = std::max(normalMap.Width() * 2, 1024u);
+        texHeight = std::max(normalMap.Height() * 2, 1024u);
+    }
+
+    struct UVTriangle
+    {
+        Float2 UV0;
+        Float2 Min;
+        Float2 Max;
+        Float2 E1;                  // Rows of the inverse of [uv1 - uv0, uv2 - uv0]
+        Float2 E2;
+        bool Valid;
+    };
+
+    const uint32 numTriangles = scene.NumTriangles();
+    std::vector<UVTriangle> uvTriangles(numTriangles);
+    for(uint32 i = 0; i < numTriangles; ++i)
+    {
+        const Float2& uv0 = scene.TriangleVertex(i, 0).TexCoord;
+        const Float2& uv1 = scene.TriangleVertex(i, 1).TexCoord;
+        const Float2& uv2 = scene.TriangleVertex(i, 2).TexCoord;
+        const Float2 e1 = uv1 - uv0;
+        const Float2 e2 = uv2 - uv0;
+        const float det = e1.x * e2.y - e2.x * e1.y;
+
+        UVTriangle& tri = uvTriangles[i];
+        tri.UV0 = uv0;
+        tri.Min = Float2(std::min(uv0.x, std::min(uv1.x, uv2.x)), std::min(uv0.y, std::min(uv1.y, uv2.y)));
+        tri.Max = Float2(std::max(uv0.x, std::max(uv1.x, uv2.x)), std::max(uv0.y, std::max(uv1.y, uv2.y)));
+        tri.Valid = std::abs(det) > 1e-12f;
+        if(tri.Valid)
+        {
+            tri.E1 = Float2(e2.y, -e2.x) / det;
+            tri.E2 = Float2(-e1.y, e1.x) / det;
+        }
+    }
+
+    // Texels that no triangle covers stay black, the same as the cleared render target
+    std::vector<Float4> texels(uint64(texWidth) * texHeight, Float4(0.0f, 0.0f, 0.0f, 0.0f));
+    const float texelWidth = 1.0f / texWidth;
+    const float texelHeight = 1.0f / texHeight;
+    const float BaryEpsilon = 1e-5f;
+
+    ThreadPool::GlobalPool.ParallelFor(texHeight, [&](uint32 y, uint32 threadIdx)
+    {
+        const float v = (y + 0.5f) * texelHeight;
+        for(uint32 triIdx = 0; triIdx < numTriangles; ++triIdx)
+        {
+            const UVTriangle& tri = uvTriangles[triIdx];
+            if(tri.Valid == false || v < tri.Min.y || v > tri.Max.y)
+                continue;
+
+            const Float2 dBaryDX = Float2(tri.E1.x, tri.E2.x) * texelWidth;
+            const Float2 dBaryDY = Float2(tri.E1.y, tri.E2.y) * texelHeight;
+            const uint32 startX = uint32(Clamp(tri.Min.x * texWidth - 0.5f, 0.0f, float(texWidth)));
+            const uint32 endX = uint32(Clamp(std::ceil(tri.Max.x * texWidth - 0.5f) + 1.0f, 0.0f, float(texWidth)));
+            for(uint32 x = startX; x < endX; ++x)
+            {
+                const Float2 offset = Float2((x + 0.5f) * texelWidth, v) - tri.UV0;
+                const Float2 bary = Float2(tri.E1.x * offset.x + tri.E1.y * offset.y,
+                                           tri.E2.x * offset.x + tri.E2.y * offset.y);
+                if(bary.x < -BaryEpsilon || bary.y < -BaryEpsilon || bary.x + bary.y > 1.0f + BaryEpsilon)
+                    continue;
+
+                const float w0 = 1.0f - bary.x - bary.y;
+                const Float3 positionWS = scene.TriangleVertex(triIdx, 0).Position * w0
+                                        + scene.TriangleVertex(triIdx, 1).Position * bary.x
+                                        + scene.TriangleVertex(triIdx, 2).Position * bary.y;
+                const Float3 color = ShadeSurface(scene, frame, triIdx, bary, dBaryDX, dBaryDY, positionWS);
+                texels[uint64(y) * texWidth + x] = Float4(color, 1.0f);
+                ++threadStats[threadIdx].NumSamples;
+            }
+        }
+    });
+
+    lightingTexture.Initialize(texWidth, texHeight, texels);
+}
+
+Float3 ReferenceRenderer::ShadeSurface(const ReferenceScene& scene, const FrameConstants& frame, uint32 triangle,
+                                       const Float2& bary, const Float2& dBaryDX, const Float2& dBaryDY,
+                                       const Float3& positionWS) const
+{
+    const ReferenceSettings& settings = frame.Settings;
+    const ReferenceScene::Vertex& v0 = scene.TriangleVertex(triangle, 0);
+    const ReferenceScene::Vertex& v1 = scene.TriangleVertex(triangle, 1);
+    const ReferenceScene::Vertex& v2 = scene.TriangleVertex(triangle, 2);
+    const Float2 baryDX = bary + dBaryDX;
+    const Float2 baryDY = bary + dBaryDY;
+
+    auto interpolateNormal = [&](const Float2& bary)
+    {
+        return v0.Normal * (1.0f - bary.x - bary.y) + v1.Normal * bary.x + v2.Normal * bary.y;
+    };
+
+    const float w0 = 1.0f - bary.x - bary.y;
+    const float w1 = bary.x;
+    const float w2 = bary.y;
+
+    const Float3 vtxNormal = Float3::Normalize(interpolateNormal(bary));
+    const Float2 uv = v0.TexCoord * w0 + v1.TexCoord * w1 + v2.TexCoord * w2;
+    const Float2 uvDX = (v1.TexCoord - v0.TexCoord) * dBaryDX.x + (v2.TexCoord - v0.TexCoord) * dBaryDX.y;
+    const Float2 uvDY = (v1.TexCoord - v0.TexCoord) * dBaryDY.x + (v2.TexCoord - v0.TexCoord) * dBaryDY.y;
+
+    ShadingFrame tangentFrame;
+    tangentFrame.Tangent = Float3::Normalize(v0.Tangent * w0 + v1.Tangent * w1 + v2.Tangent * w2);
+    tangentFrame.Bitangent = Float3::Normalize(v0.Bitangent * w0 + v1.Bitangent * w1 + v2.Bitangent * w2);
+    tangentFrame.Normal = vtxNormal;
+
+    // Geometric AA, the same as PS() with the curvature variance from VS()
+    float baseRoughness = settings.Roughness;
+    float normalVariance = 0.0f;
+    if(settings.GeometricAA == GeometricAAVertexCurvature)
+    {
+        auto curvatureVariance = [&](const ReferenceScene::Vertex& vtx)
+        {
+            const float depthVS = Float3::Transform(vtx.Position, frame.View).z;
+            const float footprintCurvature = vtx.Curvature * depthVS * frame.PixelFootprintScale;
+            return 0.5f * footprintCurvature * footprintCurvature;
+        };
+
+        normalVariance = curvatureVariance(v0) * w0 + curvatureVariance(v1) * w1 + curvatureVariance(v2) * w2;
+    }
+    else if(settings.GeometricAA == GeometricAAScreenSpace)
+    {
+        const Float3 vtxNormalDX = Float3::Normalize(interpolateNormal(baryDX)) - vtxNormal;
+        const Float3 vtxNormalDY = Float3::Normalize(interpolateNormal(baryDY)) - vtxNormal;
+        normalVariance = 0.25f * (Float3::Dot(vtxNormalDX, vtxNormalDX) + Float3::Dot(vtxNormalDY, vtxNormalDY));
+    }
+
+    if(settings.GeometricAA != GeometricAADisabled)
+        baseRoughness = std::sqrt(baseRoughness * baseRoughness + std::min(2.0f * normalVariance, 0.18f));
+
+    const Float3 diffuseAlbedo = settings.EnableDiffuse ? 0.5f : 0.0f;
+    const Float3 specularAlbedo = settings.EnableSpecular ? 0.05f : 0.0f;
+
+    // ShaderSSAA samples the normal map with SampleLevel(0), since the samples do the filtering
+    const Float4 normalSample = ShadesSamples(settings.Supersampling) ? normalMap.SampleBilinear(uv, 0)
+                                                                       : normalMap.SampleAniso(uv, uvDX, uvDY);
+    const Float3 normalTS = Float3(normalSample.x, normalSample.y, normalSample.z) * 2.0f - 1.0f;
+    const float normalMapLen = normalTS.Length();
+    const Float3 normalWS = Float3::Normalize(tangentFrame.ToWorld(normalTS));
+
+    const ShadingConstants& constants = frame.Shading;
+    Float3 lighting = 0.0f;
+
+    if(settings.Mode == ShadingModeVMF)
+    {
+        const Float4 vmfSample = vmfMap.SampleAniso(uv, uvDX, uvDY);
+        const Float4 vmfShape = vmfMap.SampleTrilinear(uv, uvDX, uvDY);
+        Float3 mu = Float3(vmfSample.x, vmfSample.y,
+                           std::sqrt(Saturate(1.0f - (vmfSample.x * vmfSample.x + vmfSample.y * vmfSample.y))));
+        mu = Float3::Normalize(tangentFrame.ToWorld(Float3::Normalize(mu)));
+        const float alpha = vmfShape.z;
+        const float kappa = 1.0f / vmfShape.w;
+
+        for(uint32 i = 0; i < NumShadingPointLights; ++i)
+            lighting += CalcPointLightVMF(constants, mu, kappa, alpha, GetShadingPointLight(i), diffuseAlbedo,
+                                          specularAlbedo, baseRoughness, positionWS);
+    }
+    else if(settings.Mode == ShadingModeLEAN || settings.Mode == ShadingModeCLEAN)
+    {
+        const Float4 leanB = leanBMap.SampleAniso(uv, uvDX, uvDY);
+        const Float4 leanM = leanMMap.SampleAniso(uv, uvDX, uvDY);
+        for(uint32 i = 0; i < NumShadingPointLights; ++i)
+            lighting += CalcPointLightLEAN(constants, normalWS, GetShadingPointLight(i), diffuseAlbedo, specularAlbedo,
+                                           baseRoughness, positionWS, Float2(leanB.x, leanB.y), leanM, tangentFrame,
+                                           settings.Mode == ShadingModeCLEAN);
+    }
+    else if(settings.Mode == ShadingModeAnisoRoughness)
+    {
+        // DecodeAnisoRoughness
+        const Float4 encoded = anisoRoughnessMap.SampleAniso(uv, uvDX, uvDY);
+        const Float3 sigma = Float3(encoded.x, encoded.y, encoded.z - 0.5f * (encoded.x + encoded.y));
+        const Float2 meanSlope = Float2(normalTS.x / normalTS.z, normalTS.y / normalTS.z);
+        for(uint32 i = 0; i < NumShadingPointLights; ++i)
+            lighting += CalcPointLightAniso(constants, normalWS, GetShadingPointLight(i), diffuseAlbedo, specularAlbedo,
+                                            baseRoughness, positionWS, meanSlope, sigma, tangentFrame);
+    }
+    else
+    {
+        float roughness = baseRoughness;
+        if(settings.Mode == ShadingModeToksvig)
+        {
+            const float s = RoughnessToSpecPower(roughness);
+            float ft = normalMapLen / Lerp(s, 1.0f, normalMapLen);
+            ft = std::max(ft, 0.01f);
+            roughness = SpecPowerToRoughness(ft * s);
+        }
+        else if(settings.Mode == ShadingModePrecomputedVMF)
+        {
+            const float lobeRoughness = roughnessMap.SampleTrilinear(uv, uvDX, uvDY).x;
+            roughness = std::min(std::sqrt(roughness * roughness + lobeRoughness * lobeRoughness), 1.0f);
+        }
+        else if(settings.Mode == ShadingModePrecomputedToksvig)
+        {
+            const float avgNormalLength = roughnessMap.SampleTrilinear(uv, uvDX, uvDY).y;
+            const float s = RoughnessToSpecPower(roughness);
+            float ft = avgNormalLength / Lerp(s, 1.0f, avgNormalLength);
+            ft = std::max(ft, 0.01f);
+            roughness = SpecPowerToRoughness(ft * s);
+        }
+
+        for(uint32 i = 0; i < NumShadingPointLights; ++i)
+            lighting += CalcPointLight(constants, normalWS, GetShadingPointLight(i), diffuseAlbedo, specularAlbedo,
+                                       roughness, positionWS);
+    }
+
+    return lighting;
+}
\ No newline at end of file
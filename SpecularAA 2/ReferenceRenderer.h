@@ -0,0 +1,326 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/Math.h"
+#include "SampleFramework11/Model.h"
+#include "SampleFramework11/Camera.h"
+#include "SampleFramework11/ImageIO.h"
+
+#include "MapBaker.h"
+#include "MeshShading.h"
+#include "Sampling.h"
+
+using namespace SampleFramework11;
+
+// Linear HDR image, with the coverage of the geometry in alpha
+struct HDRImage
+{
+    uint32 Width;
+    uint32 Height;
+    std::vector<Float4> Pixels;
+
+    HDRImage() : Width(0), Height(0)
+    {
+    }
+
+    void Initialize(uint32 width, uint32 height);
+
+    Float4& Pixel(uint32 x, uint32 y) { return Pixels[y * Width + x]; }
+    const Float4& Pixel(uint32 x, uint32 y) const { return Pixels[y * Width + x]; }
+
+    // Writes an R32G32B32A32_FLOAT DDS file
+    void WriteToDDSFile(const wchar* filePath) const;
+
+    // Writes a PFM file or a tiled image, by the extension. PFM files don't have alpha.
+    void WriteToFloatImageFile(const wchar* filePath, TiledImageFormat tiledFormat = TiledImageFloat) const;
+
+    // Reads a PFM file or a tiled image
+    void LoadFromFile(const wchar* filePath);
+};
+
+// Float copy of a texture and its mip chain, sampled with wrap addressing to match the
+// samplers used by Mesh.hlsl
+class ReferenceTexture
+{
+
+public:
+
+    ReferenceTexture();
+
+    // Copies one array slice of a baked map
+    void Initialize(const BakedTexture& texture, uint32 arraySlice);
+
+    // Unpacks a normal map to [0, 1] and generates the mip chain with a box filter, the same as
+    // the texture that the app loads
+    void Initialize(const NormalMapData& normalMap);
+
+    // Takes over the texels of the top mip level and generates the rest with a box filter, the
+    // same as GenerateMips
+    void Initialize(uint32 width, uint32 height, std::vector<Float4>& texels);
+
+    uint32 Width() const { return width; }
+    uint32 Height() const { return height; }
+    uint32 NumMipLevels() const { return uint32(mips.size()); }
+
+    Float4 SampleBilinear(const Float2& uv, uint32 mipLevel) const;
+
+    // LinearSampler, with the mip level picked from the UV derivatives
+    Float4 SampleTrilinear(const Float2& uv, const Float2& uvDX, const Float2& uvDY) const;
+
+    // AnisoSampler. Takes up to MaxAnisotropy trilinear taps along the major axis of the
+    // footprint, which is close to what hardware does but won't match it exactly.
+    Float4 SampleAniso(const Float2& uv, const Float2& uvDX, const Float2& uvDY) const;
+
+    static const uint32 MaxAnisotropy = 16;
+
+protected:
+
+    Float4 Texel(uint32 mipLevel, int32 x, int32 y) const;
+    Float4 SampleLevel(const Float2& uv, float lod) const;
+    void GenerateMips();
+
+    uint32 width;
+    uint32 height;
+    std::vector<std::vector<Float4>> mips;
+};
+
+// The world-space triangles of a model, with a bounding volume hierarchy for casting rays
+// against them. The BVH is split at the median of the largest axis of the triangle centroids,
+// and the nodes are stored depth-first so that the first child of a node always follows it.
+class ReferenceScene
+{
+
+public:
+
+    struct Vertex
+    {
+        Float3 Position;
+        Float3 Normal;
+        Float2 TexCoord;
+        Float3 Tangent;
+        Float3 Bitangent;
+        float Curvature;            // Already divided by the scale of the world matrix
+    };
+
+    struct Hit
+    {
+        uint32 Triangle;
+        float T;
+        float U;                    // Barycentric weight of the second vertex
+        float V;                    // Barycentric weight of the third vertex
+    };
+
+    ReferenceScene();
+
+    // The meshes need positions, normals, and texture coordinates. Missing tangent frames are
+    // built around the normal, and missing curvature is treated as 0.
+    void Initialize(const Model& model, const Float4x4& world);
+
+    // Finds the closest hit along origin + dir * t with t in (0, maxT). Both sides of the
+    // triangles are hit, since the scenes are closed or viewed from the front.
+    bool Intersect(const Float3& origin, const Float3& dir, float maxT, Hit& hit) const;
+
+    uint32 NumTriangles() const { return uint32(triangles.size()); }
+    uint32 NumNodes() const { return uint32(nodes.size()); }
+
+    const Vertex& TriangleVertex(uint32 triangle, uint32 corner) const
+    {
+        return vertices[triangles[triangle].Indices[corner]];
+    }
+
+    // Geometric normal, not normalized
+    const Float3& TriangleNormal(uint32 triangle) const { return triangles[triangle].Normal; }
+
+protected:
+
+    struct Triangle
+    {
+        Float3 P0;
+        Float3 E1;
+        Float3 E2;
+        Float3 Normal;
+        uint32 Indices[3];
+    };
+
+    struct Node
+    {
+        Float3 Min;
+        uint32 Offset;              // First triangle of a leaf, or the second child
+        Float3 Max;
+        uint32 NumTriangles;        // 0 for interior nodes
+    };
+
+    uint32 BuildNode(uint32 start, uint32 end, const std::vector<Float3>& centroids, std::vector<uint32>& order);
+
+    std::vector<Vertex> vertices;
+    std::vector<Triangle> triangles;
+    std::vector<Node> nodes;
+};
+
+// How many rays are cast per pixel. Uniform is the CPU version of ShaderSSAA, and adaptive
+// keeps adding samples to a pixel until the error of its filtered luminance is low enough.
+// Texture-space is the CPU version of texture-space lighting: every texel of a lighting texture
+// is shaded first, and then each pixel casts one ray and samples the lighting texture.
+enum SupersamplingMode
+{
+    SupersamplingDisabled = 0,
+    SupersamplingUniform,
+    SupersamplingAdaptive,
+    SupersamplingTextureSpace,
+
+    NumSupersamplingModes
+};
+
+const wchar* SupersamplingModeName(SupersamplingMode mode);
+
+struct ReferenceSettings
+{
+    ShadingMode Mode;
+    SpecularBRDF BRDF;
+    GeometricAAMode GeometricAA;
+    float Roughness;
+    bool EnableDiffuse;
+    bool EnableSpecular;
+    bool VMFDiffuseAA;
+
+    SupersamplingMode Supersampling;
+    SampleSequence Sequence;
+    uint32 SequenceSeed;            // Changes the scrambling, for a reference that's independent of the samples
+    float SampleRadius;             // Diameter of the filter in pixels, the same as the SampleRadius slider
+    uint32 UniformSamples;          // Samples along each axis for uniform supersampling, like ShaderSSSamples
+    uint32 MinSamples;              // Adaptive supersampling never stops before this many samples...
+    uint32 MaxSamples;              // ...or takes more than this
+    float TargetError;              // Standard error of the pixel's luminance relative to its mean
+    uint32 LightingTextureSize;     // 0 for the same size as MeshRenderer, twice the normal map and at least 1024
+
+    ReferenceSettings() : Mode(ShadingModeDisabled), BRDF(SpecularBRDFGGX), GeometricAA(GeometricAADisabled),
+                          Roughness(0.05f), EnableDiffuse(true), EnableSpecular(true), VMFDiffuseAA(false),
+                          Supersampling(SupersamplingDisabled), Sequence(SampleSequenceSobol), SequenceSeed(0),
+                          SampleRadius(2.5f), UniformSamples(32),
+                          MinSamples(32), MaxSamples(1024), TargetError(0.02f), LightingTextureSize(0)
+    {
+    }
+};
+
+struct ReferenceStats
+{
+    double Seconds;
+    uint32 NumThreads;
+    uint64 NumPixels;
+    uint64 NumHits;
+    uint64 NumSamples;              // Shaded samples or lighting texels, only counted when supersampling
+    uint32 MaxPixelSamples;
+
+    ReferenceStats() : Seconds(0.0), NumThreads(1), NumPixels(0), NumHits(0), NumSamples(0), MaxPixelSamples(0)
+    {
+    }
+
+    double PixelsPerSecond() const;
+    double SamplesPerPixel() const;
+    std::wstring ToString() const;
+};
+
+// Renders a ReferenceScene on the CPU with the same lighting as Mesh.hlsl, using the maps
+// from MapBaker, so that the shading modes can be compared and timed without a GPU. Each pixel
+// casts a single ray through its center, and rays through the neighboring pixels are
+// intersected with the plane of the hit triangle to get the derivatives that ddx/ddy would
+// give for texture filtering and the screen-space geometric AA. The image is split into tiles
+// that are rendered in parallel on ThreadPool::GlobalPool.
+//
+// With supersampling each sample is its own ray, offset within a disc around the pixel center and
+// weighted with the same cubic filter as ShaderSSAA, and the normal map is sampled from the top
+// mip level. The offsets come from the same Sobol sequence as Sampling.hlsl by default, so
+// uniform supersampling converges to what the GPU shows. Adaptive supersampling
+// takes the samples in the same order, but checks the standard error of the weighted mean
+// luminance after every AdaptiveBatchSize samples and stops once it's below the target. Pixels
+// where the normal-mapped highlight is resolved stop after MinSamples, so nearly all of the work
+// goes to the pixels that need it.
+//
+// Texture-space lighting rasterizes the triangles into the lighting texture by their UVs and
+// shades the texels with derivatives of one texel, the same as the lighting pass of MeshRenderer,
+// so every texel is shaded whether it's visible or not.
+class ReferenceRenderer
+{
+
+public:
+
+    static const uint32 TileSize = 16;
+    static const uint32 AdaptiveBatchSize = 16;
+
+    ReferenceRenderer();
+
+    // Bakes the LEAN/vMF/roughness/anisotropic roughness maps for the normal map
+    void SetNormalMap(const NormalMapData& normalMap, const BakeSettings& settings);
+
+    // Uses maps that were already baked from the normal map with these settings
+    void SetNormalMap(const NormalMapData& normalMap, const BakeSettings& settings, const BakedMaps& maps,
+                      const BakedTexture& anisoRoughnessMap);
+
+    void Render(const ReferenceScene& scene, const Camera& camera, const ReferenceSettings& settings,
+                HDRImage& image);
+
+    // Doesn't touch Stats(), so that several images can be rendered at once from ThreadPool tasks.
+    // Called from inside a task, the image is rendered on that thread alone.
+    void Render(const ReferenceScene& scene, const Camera& camera, const ReferenceSettings& settings,
+                HDRImage& image, ReferenceStats& renderStats) const;
+
+    // Renders to a file (or any other writer) without the whole image in memory. Every thread
+    // shades into its own tile, and hands it to the writer as soon as it's done.
+    void Render(const ReferenceScene& scene, const Camera& camera, const ReferenceSettings& settings,
+                uint32 width, uint32 height, FloatImageWriter& writer);
+    void Render(const ReferenceScene& scene, const Camera& camera, const ReferenceSettings& settings,
+                uint32 width, uint32 height, FloatImageWriter& writer, ReferenceStats& renderStats) const;
+
+    const ReferenceStats& Stats() const { return stats; }
+
+protected:
+
+    struct Ray
+    {
+        Float3 Origin;
+        Float3 Dir;
+    };
+
+    struct FrameConstants;
+    struct TileStats;
+
+    static Ray MakeRay(const FrameConstants& frame, float x, float y);
+
+    void RenderTiles(const ReferenceScene& scene, const Camera& camera, const ReferenceSettings& settings,
+                     uint32 width, uint32 height, HDRImage* image, FloatImageWriter* writer,
+                     ReferenceStats& renderStats) const;
+    void RenderTile(const ReferenceScene& scene, const FrameConstants& frame, uint32 tileX, uint32 tileY,
+                    Float4* pixels, uint32 pitch, TileStats& tileStats) const;
+    Float4 SupersamplePixel(const ReferenceScene& scene, const FrameConstants& frame, uint32 x, uint32 y,
+                            TileStats& tileStats) const;
+    Float3 ShadePixel(const ReferenceScene& scene, const FrameConstants& frame, const ReferenceScene::Hit& hit,
+                      const Ray& ray, const Ray& rayDX, const Ray& rayDY) const;
+    void ShadeLightingTexture(const ReferenceScene& scene, const FrameConstants& frame, ReferenceTexture& lightingTexture,
+                              std::vector<TileStats>& threadStats) const;
+
+    // Shades a point on a triangle, given its barycentrics and how much they change per pixel
+    Float3 ShadeSurface(const ReferenceScene& scene, const FrameConstants& frame, uint32 triangle,
+                        const Float2& bary, const Float2& dBaryDX, const Float2& dBaryDY,
+                        const Float3& positionWS) const;
+
+    float scaleFactor;
+    ReferenceTexture normalMap;
+    ReferenceTexture leanBMap;
+    ReferenceTexture leanMMap;
+    ReferenceTexture vmfMap;
+    ReferenceTexture roughnessMap;
+    ReferenceTexture anisoRoughnessMap;
+
+    ReferenceStats stats;
+};
\ No newline at end of file
@@ -12,10 +12,13 @@
 #include "App.h"
 #include "Exceptions.h"
 #include "Profiler.h"
+#include "ThreadPool.h"
 #include "GUIObject.h"
 #include "Math.h"
 #include "LodePNG/lodepng.h"
 #include "FileIO.h"
+#include "ImageIO.h"
+#include "SIMD.h"
 
 using std::bind;
 using std::mem_fn;
@@ -63,6 +66,8 @@ void App::Run()
 
         Profiler::GlobalProfiler.Initialize(deviceManager.Device(), deviceManager.ImmediateContext());
 
+        ThreadPool::GlobalPool.Initialize();
+
         GUIObject::InitGlobalResources(deviceManager.Device());
 
         window.SetUserMessageFunction(WM_SIZE, bind(mem_fn(&App::WindowResized), this, _1, _2, _3, _4));
@@ -87,6 +92,8 @@ void App::Run()
 
             window.MessageLoop();
         }
+
+        ThreadPool::GlobalPool.Shutdown();
     }
     catch (SampleFramework11::Exception exception)
     {
@@ -241,4 +248,60 @@ void App::SaveScreenshot(const wchar* filePath)
     pngFile.Write(fileData.size(), fileData.data());
 }
 
+void App::SaveHDRScreenshot(ID3D11Texture2D* texture, const wchar* filePath)
+{
+    D3D11_TEXTURE2D_DESC desc;
+    texture->GetDesc(&desc);
+    if(desc.Format != DXGI_FORMAT_R16G16B16A16_FLOAT && desc.Format != DXGI_FORMAT_R32G32B32A32_FLOAT)
+        throw Exception(L"HDR screenshots need an R16G16B16A16_FLOAT or R32G32B32A32_FLOAT texture");
+
+    if(hdrCaptureTexture.Width != desc.Width || hdrCaptureTexture.Height != desc.Height
+       || hdrCaptureTexture.Format != desc.Format)
+        hdrCaptureTexture.Initialize(deviceManager.Device(), desc.Width, desc.Height, desc.Format);
+
+    ID3D11DeviceContext* context = deviceManager.ImmediateContext();
+    context->CopyResource(hdrCaptureTexture.Texture, texture);
+
+    FloatImageFileWriter writer;
+    writer.Create(filePath, desc.Width, desc.Height);
+
+    std::vector<Float4> row(desc.Width);
+    float* rowFloats = &row[0].x;
+    const uint32 numValues = desc.Width * 4;
+
+    uint32 pitch = 0;
+    const uint8* srcData = reinterpret_cast<uint8*>(hdrCaptureTexture.Map(context, 0, pitch));
+
+    // Don't leave the staging texture mapped if the writer fails
+    try
+    {
+        for(uint32 y = 0; y < desc.Height; ++y)
+        {
+            if(desc.Format == DXGI_FORMAT_R32G32B32A32_FLOAT)
+                memcpy(rowFloats, srcData, numValues * sizeof(float));
+            else
+            {
+                // Converted 8 channels (2 pixels) at a time
+                const uint16* srcHalfs = reinterpret_cast<const uint16*>(srcData);
+                uint32 i = 0;
+                for(; i + 8 <= numValues; i += 8)
+                    Float8::FromHalf(srcHalfs + i).Store(rowFloats + i);
+                for(; i < numValues; ++i)
+                    rowFloats[i] = PackedVector::XMConvertHalfToFloat(srcHalfs[i]);
+            }
+
+            writer.WriteRect(0, y, desc.Width, 1, row.data(), desc.Width);
+            srcData += pitch;
+        }
+    }
+    catch(...)
+    {
+        hdrCaptureTexture.Unmap(context, 0);
+        throw;
+    }
+
+    hdrCaptureTexture.Unmap(context, 0);
+    writer.Close();
+}
+
 }
\ No newline at end of file
@@ -53,6 +53,10 @@ protected:
 
     void SaveScreenshot(const wchar* filePath);
 
+    // Writes an R16G16B16A16_FLOAT or R32G32B32A32_FLOAT texture to a PFM file or a tiled image,
+    // by the extension. It's read back through a staging texture and written a row at a time.
+    void SaveHDRScreenshot(ID3D11Texture2D* texture, const wchar* filePath);
+
     Window window;
     DeviceManager deviceManager;
     Timer timer;
@@ -71,6 +75,7 @@ protected:
     uint32 fps;
 
     StagingTexture2D captureTexture;
+    StagingTexture2D hdrCaptureTexture;
 
 public:
 
@@ -0,0 +1,1036 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "BlockCompression.h"
+#include "SIMD.h"
+#include "ThreadPool.h"
+#include "Exceptions.h"
+
+namespace SampleFramework11
+{
+
+static const uint32 BlockDim = 4;
+static const uint32 BlockTexels = 16;
+
+//=================================================================================================
+// Bit packing
+//=================================================================================================
+
+// Packs values into a 128-bit block, starting from the least significant bit
+struct BlockBitWriter
+{
+    uint64 Bits[2];
+    uint32 Position;
+
+    BlockBitWriter() : Position(0)
+    {
+        Bits[0] = Bits[1] = 0;
+    }
+
+    void Write(uint32 value, uint32 numBits)
+    {
+        for(uint32 i = 0; i < numBits; ++i, ++Position)
+            Bits[Position / 64] |= uint64((value >> i) & 1) << (Position % 64);
+    }
+
+    // Writes the bits from the most significant to the least significant
+    void WriteReversed(uint32 value, uint32 numBits)
+    {
+        for(uint32 i = 0; i < numBits; ++i, ++Position)
+            Bits[Position / 64] |= uint64((value >> (numBits - 1 - i)) & 1) << (Position % 64);
+    }
+};
+
+struct BlockBitReader
+{
+    uint64 Bits[2];
+    uint32 Position;
+
+    BlockBitReader(const uint8* block) : Position(0)
+    {
+        memcpy(Bits, block, sizeof(Bits));
+    }
+
+    uint32 Read(uint32 numBits)
+    {
+        uint32 value = 0;
+        for(uint32 i = 0; i < numBits; ++i, ++Position)
+            value |= uint32((Bits[Position / 64] >> (Position % 64)) & 1) << i;
+        return value;
+    }
+
+    uint32 ReadReversed(uint32 numBits)
+    {
+        uint32 value = 0;
+        for(uint32 i = 0; i < numBits; ++i, ++Position)
+            value |= uint32((Bits[Position / 64] >> (Position % 64)) & 1) << (numBits - 1 - i);
+        return value;
+    }
+};
+
+static int32 SignExtend(int32 value, uint32 numBits)
+{
+    const uint32 shift = 32 - numBits;
+    return static_cast<int32>(static_cast<uint32>(value) << shift) >> shift;
+}
+
+//=================================================================================================
+// BC4 and BC5
+//=================================================================================================
+
+// Endpoints of a BC4 block. When Code0 > Code1 the 6 other indices interpolate between the
+// endpoints, otherwise 4 of them do and the last 2 are the extremes of the range.
+struct BC4Endpoints
+{
+    int32 Code0;
+    int32 Code1;
+
+    bool SixValueMode() const { return Code0 <= Code1; }
+};
+
+struct BC4Format
+{
+    float Scale;            // Endpoint code = value * Scale
+    int32 MinCode;
+    int32 MaxCode;
+    float MinValue;         // Value of index 6 in the 6-value mode
+
+    BC4Format(bool isSigned) :  Scale(isSigned ? 127.0f : 255.0f),
+                                MinCode(isSigned ? -127 : 0),
+                                MaxCode(isSigned ? 127 : 255),
+                                MinValue(isSigned ? -1.0f : 0.0f)
+    {
+    }
+
+    int32 Quantize(float value) const
+    {
+        return Clamp(static_cast<int32>(std::floor(value * Scale + 0.5f)), MinCode, MaxCode);
+    }
+
+    float Dequantize(int32 code) const
+    {
+        return std::max(code / Scale, MinValue);
+    }
+};
+
+// Swaps or separates the endpoints so that they select the requested mode
+static void SetBC4Mode(BC4Endpoints& endpoints, bool sixValueMode, const BC4Format& format)
+{
+    if(sixValueMode)
+    {
+        if(endpoints.Code0 > endpoints.Code1)
+            std::swap(endpoints.Code0, endpoints.Code1);
+    }
+    else
+    {
+        if(endpoints.Code0 < endpoints.Code1)
+            std::swap(endpoints.Code0, endpoints.Code1);
+        else if(endpoints.Code0 == endpoints.Code1)
+        {
+            if(endpoints.Code0 < format.MaxCode)
+                ++endpoints.Code0;
+            else
+                --endpoints.Code1;
+        }
+    }
+}
+
+// Chooses the closest palette entry for each value, and returns the total squared error.
+// Positions go from 0 at the first endpoint to the number of steps at the second endpoint, with
+// -1 and -2 marking the minimum and maximum values of the 6-value mode.
+static float FitBC4Positions(const Float8 values[2], const BC4Endpoints& endpoints, const BC4Format& format,
+                             int32 positions[BlockTexels])
+{
+    const bool sixValueMode = endpoints.SixValueMode();
+    const float numSteps = sixValueMode ? 5.0f : 7.0f;
+    const float e0 = format.Dequantize(endpoints.Code0);
+    const float e1 = format.Dequantize(endpoints.Code1);
+    const float range = e1 - e0;
+    const float invStep = range != 0.0f ? numSteps / range : 0.0f;
+
+    Float8 totalError = 0.0f;
+    for(uint32 i = 0; i < 2; ++i)
+    {
+        const Float8& x = values[i];
+        Float8 position = Float8::Floor(Float8::Clamp((x - e0) * invStep, 0.0f, numSteps) + 0.5f);
+        Float8 decoded = position * (range / numSteps) + e0;
+        Float8 error = (x - decoded) * (x - decoded);
+
+        if(sixValueMode)
+        {
+            const Float8 minError = (x - format.MinValue) * (x - format.MinValue);
+            position = Float8::Select(minError < error, -1.0f, position);
+            error = Float8::Min(error, minError);
+
+            const Float8 maxError = (x - 1.0f) * (x - 1.0f);
+            position = Float8::Select(maxError < error, -2.0f, position);
+            error = Float8::Min(error, maxError);
+        }
+
+        Float8::ToInt(position, positions + i * Float8::Width);
+        totalError += error;
+    }
+
+    return Float8::Sum(totalError);
+}
+
+// Least-squares fit of the endpoints for the current positions, keeping the same mode
+static BC4Endpoints RefineBC4Endpoints(const Float8 values[2], const int32 positions[BlockTexels],
+                                       const BC4Endpoints& endpoints, const BC4Format& format)
+{
+    const bool sixValueMode = endpoints.SixValueMode();
+    const float invNumSteps = sixValueMode ? 1.0f / 5.0f : 1.0f / 7.0f;
+
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f, ax = 0.0f, bx = 0.0f;
+    for(uint32 i = 0; i < BlockTexels; ++i)
+    {
+        if(positions[i] < 0)
+            continue;
+
+        const float w = positions[i] * invNumSteps;
+        const float x = values[i / Float8::Width][i % Float8::Width];
+        aa += (1.0f - w) * (1.0f - w);
+        ab += (1.0f - w) * w;
+        bb += w * w;
+        ax += (1.0f - w) * x;
+        bx += w * x;
+    }
+
+    const float det = aa * bb - ab * ab;
+    if(std::abs(det) < 1e-6f)
+        return endpoints;
+
+    BC4Endpoints refined;
+    refined.Code0 = format.Quantize((ax * bb - bx * ab) / det);
+    refined.Code1 = format.Quantize((bx * aa - ax * ab) / det);
+    SetBC4Mode(refined, sixValueMode, format);
+    return refined;
+}
+
+// Best endpoints and positions found so far for a block
+struct BC4Candidate
+{
+    BC4Endpoints Endpoints;
+    int32 Positions[BlockTexels];
+    float Error;
+
+    bool Try(const Float8 values[2], const BC4Endpoints& endpoints, const BC4Format& format)
+    {
+        int32 positions[BlockTexels];
+        const float error = FitBC4Positions(values, endpoints, format, positions);
+        if(error >= Error)
+            return false;
+
+        Endpoints = endpoints;
+        memcpy(Positions, positions, sizeof(positions));
+        Error = error;
+        return true;
+    }
+
+    void Refine(const Float8 values[2], const BC4Format& format, uint32 numIterations)
+    {
+        for(uint32 i = 0; i < numIterations; ++i)
+            if(Try(values, RefineBC4Endpoints(values, Positions, Endpoints, format), format) == false)
+                break;
+    }
+};
+
+static uint32 BC4Index(int32 position, bool sixValueMode)
+{
+    const int32 numSteps = sixValueMode ? 5 : 7;
+    if(position == -1)
+        return 6;
+    else if(position == -2)
+        return 7;
+    else if(position == 0)
+        return 0;
+    else if(position == numSteps)
+        return 1;
+    else
+        return position + 1;
+}
+
+static void EncodeBC4Block(const float texels[BlockTexels], bool isSigned, BCQuality quality, uint8* block)
+{
+    const BC4Format format(isSigned);
+    const Float8 values[2] = { Float8::Load(texels), Float8::Load(texels + Float8::Width) };
+
+    float minValue = texels[0];
+    float maxValue = texels[0];
+    for(uint32 i = 1; i < BlockTexels; ++i)
+    {
+        minValue = std::min(minValue, texels[i]);
+        maxValue = std::max(maxValue, texels[i]);
+    }
+
+    // Start with the 8-value mode spanning the whole block
+    BC4Candidate best;
+    best.Error = FLT_MAX;
+    BC4Endpoints extents = { format.Quantize(maxValue), format.Quantize(minValue) };
+    SetBC4Mode(extents, false, format);
+    best.Try(values, extents, format);
+
+    if(quality >= BCQualityNormal)
+        best.Refine(values, format, quality == BCQualityHigh ? 4 : 2);
+
+    if(quality == BCQualityHigh)
+    {
+        // The 6-value mode, with the endpoints spanning the values that aren't at the extremes
+        const float threshold = 0.5f / format.Scale;
+        float innerMin = FLT_MAX;
+        float innerMax = -FLT_MAX;
+        for(uint32 i = 0; i < BlockTexels; ++i)
+        {
+            if(texels[i] > format.MinValue + threshold && texels[i] < 1.0f - threshold)
+            {
+                innerMin = std::min(innerMin, texels[i]);
+                innerMax = std::max(innerMax, texels[i]);
+            }
+        }
+
+        if(innerMin <= innerMax)
+        {
+            BC4Candidate sixValue;
+            sixValue.Error = FLT_MAX;
+            BC4Endpoints innerExtents = { format.Quantize(innerMin), format.Quantize(innerMax) };
+            SetBC4Mode(innerExtents, true, format);
+            sixValue.Try(values, innerExtents, format);
+            sixValue.Refine(values, format, 4);
+            if(sixValue.Error < best.Error)
+                best = sixValue;
+        }
+
+        // Search the codes next to the best endpoints
+        const BC4Endpoints center = best.Endpoints;
+        for(int32 d0 = -1; d0 <= 1; ++d0)
+        {
+            for(int32 d1 = -1; d1 <= 1; ++d1)
+            {
+                BC4Endpoints neighbor = { Clamp(center.Code0 + d0, format.MinCode, format.MaxCode),
+                                          Clamp(center.Code1 + d1, format.MinCode, format.MaxCode) };
+                best.Try(values, neighbor, format);
+            }
+        }
+    }
+
+    const bool sixValueMode = best.Endpoints.SixValueMode();
+    uint64 bits = uint64(uint8(best.Endpoints.Code0)) | (uint64(uint8(best.Endpoints.Code1)) << 8);
+    for(uint32 i = 0; i < BlockTexels; ++i)
+        bits |= uint64(BC4Index(best.Positions[i], sixValueMode)) << (16 + i * 3);
+    memcpy(block, &bits, sizeof(bits));
+}
+
+static void DecodeBC4Block(const uint8* block, bool isSigned, float texels[BlockTexels])
+{
+    const BC4Format format(isSigned);
+
+    uint64 bits = 0;
+    memcpy(&bits, block, sizeof(bits));
+
+    const int32 code0 = isSigned ? int32(int8(block[0])) : int32(block[0]);
+    const int32 code1 = isSigned ? int32(int8(block[1])) : int32(block[1]);
+
+    float palette[8];
+    palette[0] = format.Dequantize(code0);
+    palette[1] = format.Dequantize(code1);
+    if(code0 > code1)
+    {
+        for(uint32 i = 1; i < 7; ++i)
+            palette[i + 1] = (palette[0] * (7 - i) + palette[1] * i) / 7.0f;
+    }
+    else
+    {
+        for(uint32 i = 1; i < 5; ++i)
+            palette[i + 1] = (palette[0] * (5 - i) + palette[1] * i) / 5.0f;
+        palette[6] = format.MinValue;
+        palette[7] = 1.0f;
+    }
+
+    for(uint32 i = 0; i < BlockTexels; ++i)
+        texels[i] = palette[(bits >> (16 + i * 3)) & 7];
+}
+
+//=================================================================================================
+// BC6H
+//=================================================================================================
+
+static const int32 BC6HWeights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// The single-region modes. When DeltaBits < EndpointBits the second endpoint is stored as a
+// signed delta from the first, and the high bits of the first endpoint come after each delta.
+struct BC6HMode
+{
+    uint32 ModeBits;
+    uint32 EndpointBits;
+    uint32 DeltaBits;
+};
+
+static const BC6HMode BC6HModes[] =
+{
+    { 0x03, 10, 10 },       // Mode 11
+    { 0x07, 11, 9 },        // Mode 12
+    { 0x0B, 12, 8 },        // Mode 13
+    { 0x0F, 16, 4 },        // Mode 14
+};
+
+static const uint32 NumBC6HModes = ARRAYSIZE(BC6HModes);
+
+// Expands a quantized endpoint to the 16-bit range that the weights are applied in
+static int32 UnquantizeBC6H(int32 value, uint32 numBits, bool isSigned)
+{
+    if(isSigned)
+    {
+        if(numBits >= 16)
+            return value;
+
+        const int32 magnitude = std::abs(value);
+        int32 unquantized = 0;
+        if(magnitude >= (1 << (numBits - 1)) - 1)
+            unquantized = 0x7FFF;
+        else if(magnitude > 0)
+            unquantized = ((magnitude << 15) + 0x4000) >> (numBits - 1);
+        return value < 0 ? -unquantized : unquantized;
+    }
+    else
+    {
+        if(numBits >= 15 || value == 0)
+            return value;
+        else if(value == (1 << numBits) - 1)
+            return 0xFFFF;
+        else
+            return ((value << 16) + 0x8000) >> numBits;
+    }
+}
+
+static int32 InterpolateBC6H(int32 e0, int32 e1, int32 weight)
+{
+    return (e0 * (64 - weight) + e1 * weight + 32) >> 6;
+}
+
+// Converts an interpolated value to half-float bits
+static uint16 FinishUnquantizeBC6H(int32 value, bool isSigned)
+{
+    if(isSigned == false)
+        return uint16((value * 31) >> 6);
+
+    value = value < 0 ? -(((-value) * 31) >> 5) : (value * 31) >> 5;
+    return value < 0 ? uint16(0x8000 | -value) : uint16(value);
+}
+
+// Inverse of FinishUnquantizeBC6H, so that the encoder can work in the range that the endpoints
+// are interpolated in. Negative values are clamped to 0 for the unsigned format, and infinities
+// and NaNs are clamped to the largest finite value.
+static float HalfToBC6HRange(uint16 half, bool isSigned)
+{
+    const int32 magnitude = std::min<int32>(half & 0x7FFF, 0x7BFF);
+    if(isSigned)
+        return ((half & 0x8000) ? -magnitude : magnitude) * (32.0f / 31.0f);
+    else
+        return (half & 0x8000) ? 0.0f : magnitude * (64.0f / 31.0f);
+}
+
+static int32 MaxBC6HEndpoint(uint32 numBits, bool isSigned)
+{
+    return isSigned ? (1 << (numBits - 1)) - 1 : (1 << numBits) - 1;
+}
+
+// Finds the quantized endpoint that unquantizes closest to the value
+static int32 QuantizeBC6H(float value, uint32 numBits, bool isSigned)
+{
+    const int32 maxValue = MaxBC6HEndpoint(numBits, isSigned);
+    const int32 minValue = isSigned ? -maxValue : 0;
+    const float stepSize = isSigned ? 32768.0f / (1 << (numBits - 1)) : 65536.0f / (1 << numBits);
+    const int32 estimate = static_cast<int32>(std::floor(value / stepSize));
+
+    int32 best = 0;
+    float bestDistance = FLT_MAX;
+    for(int32 i = estimate - 1; i <= estimate + 1; ++i)
+    {
+        const int32 quantized = Clamp(i, minValue, maxValue);
+        const float distance = std::abs(UnquantizeBC6H(quantized, numBits, isSigned) - value);
+        if(distance < bestDistance)
+        {
+            best = quantized;
+            bestDistance = distance;
+        }
+    }
+
+    return best;
+}
+
+// Quantized endpoints for one of the modes. The second endpoint is the full value, not the delta.
+struct BC6HEndpoints
+{
+    uint32 ModeIdx;
+    int32 Quantized[2][3];
+    int32 Unquantized[2][3];
+
+    // Checks that the endpoints can be stored with the mode, and unquantizes them
+    bool Finalize(bool isSigned)
+    {
+        const BC6HMode& mode = BC6HModes[ModeIdx];
+        const int32 maxValue = MaxBC6HEndpoint(mode.EndpointBits, isSigned);
+        const int32 minValue = isSigned ? -maxValue : 0;
+        const int32 maxDelta = (1 << (mode.DeltaBits - 1)) - 1;
+
+        for(uint32 c = 0; c < 3; ++c)
+        {
+            for(uint32 e = 0; e < 2; ++e)
+            {
+                if(Quantized[e][c] < minValue || Quantized[e][c] > maxValue)
+                    return false;
+                Unquantized[e][c] = UnquantizeBC6H(Quantized[e][c], mode.EndpointBits, isSigned);
+            }
+
+            const int32 delta = Quantized[1][c] - Quantized[0][c];
+            if(mode.DeltaBits < mode.EndpointBits && (delta < -maxDelta - 1 || delta > maxDelta))
+                return false;
+        }
+
+        return true;
+    }
+};
+
+// Quantizes a pair of endpoints for a mode. When the second endpoint is stored as a delta, it's
+// moved towards the first endpoint until the delta fits.
+static BC6HEndpoints QuantizeBC6HEndpoints(const float endpoints[2][3], uint32 modeIdx, bool isSigned)
+{
+    const BC6HMode& mode = BC6HModes[modeIdx];
+    const int32 maxDelta = (1 << (mode.DeltaBits - 1)) - 1;
+
+    BC6HEndpoints quantized;
+    quantized.ModeIdx = modeIdx;
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        quantized.Quantized[0][c] = QuantizeBC6H(endpoints[0][c], mode.EndpointBits, isSigned);
+        quantized.Quantized[1][c] = QuantizeBC6H(endpoints[1][c], mode.EndpointBits, isSigned);
+        if(mode.DeltaBits < mode.EndpointBits)
+        {
+            const int32 delta = Clamp(quantized.Quantized[1][c] - quantized.Quantized[0][c], -maxDelta - 1, maxDelta);
+            quantized.Quantized[1][c] = quantized.Quantized[0][c] + delta;
+        }
+    }
+
+    quantized.Finalize(isSigned);
+    return quantized;
+}
+
+// Block of texels, both in the interpolation range and as the original floats
+struct BC6HBlockValues
+{
+    float Values[3][BlockTexels];
+    float Texels[3][BlockTexels];
+};
+
+// Chooses the closest palette entry for each texel, and returns the total squared error. All 16
+// entries are checked against the decoded floats, 8 texels at a time: the interpolation range is
+// logarithmic, so the palette is far from evenly spaced once it's converted back to floats
+// (especially for signed blocks that cross 0), and the nearest entry along the line between the
+// endpoints is often not the nearest float.
+static float FitBC6HIndices(const BC6HBlockValues& block, const BC6HEndpoints& endpoints, bool isSigned,
+                            uint32 indices[BlockTexels])
+{
+    float palette[16][3];
+    for(uint32 k = 0; k < 16; ++k)
+    {
+        for(uint32 c = 0; c < 3; ++c)
+        {
+            const int32 value = InterpolateBC6H(endpoints.Unquantized[0][c], endpoints.Unquantized[1][c], BC6HWeights[k]);
+            palette[k][c] = PackedVector::XMConvertHalfToFloat(FinishUnquantizeBC6H(value, isSigned));
+        }
+    }
+
+    Float8 totalError = 0.0f;
+    for(uint32 i = 0; i < BlockTexels; i += Float8::Width)
+    {
+        const Float8 r = Float8::Load(block.Texels[0] + i);
+        const Float8 g = Float8::Load(block.Texels[1] + i);
+        const Float8 b = Float8::Load(block.Texels[2] + i);
+
+        Float8 bestError = FLT_MAX;
+        Float8 bestIndex = 0.0f;
+        for(uint32 k = 0; k < 16; ++k)
+        {
+            const Float8 dr = r - palette[k][0];
+            const Float8 dg = g - palette[k][1];
+            const Float8 db = b - palette[k][2];
+            const Float8 error = dr * dr + dg * dg + db * db;
+
+            const Float8 closer = error < bestError;
+            bestError = Float8::Select(closer, error, bestError);
+            bestIndex = Float8::Select(closer, Float8(float(k)), bestIndex);
+        }
+
+        int32 best[Float8::Width];
+        Float8::ToInt(bestIndex, best);
+        for(uint32 j = 0; j < Float8::Width; ++j)
+            indices[i + j] = uint32(best[j]);
+
+        totalError += bestError;
+    }
+
+    return Float8::Sum(totalError);
+}
+
+// Fits the indices, and makes sure that the first index fits in the 3 bits that it's stored with
+// by swapping the endpoints if necessary. Returns FLT_MAX if the swapped endpoints can't be
+// stored with the mode.
+static float EvaluateBC6HEndpoints(const BC6HBlockValues& block, BC6HEndpoints& endpoints,
+                                   uint32 indices[BlockTexels], bool isSigned)
+{
+    const float error = FitBC6HIndices(block, endpoints, isSigned, indices);
+    if(indices[0] < 8)
+        return error;
+
+    for(uint32 c = 0; c < 3; ++c)
+        std::swap(endpoints.Quantized[0][c], endpoints.Quantized[1][c]);
+    if(endpoints.Finalize(isSigned) == false)
+        return FLT_MAX;
+
+    // The weights are symmetric, so the error doesn't change
+    for(uint32 i = 0; i < BlockTexels; ++i)
+        indices[i] = 15 - indices[i];
+
+    return error;
+}
+
+// Corners of the bounding box of the block, along the diagonal that matches the correlation of
+// the channels with the channel that has the largest range
+static void BoundingBoxEndpoints(const float values[3][BlockTexels], float endpoints[2][3])
+{
+    float minValues[3];
+    float maxValues[3];
+    float means[3];
+    uint32 mainChannel = 0;
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        minValues[c] = maxValues[c] = values[c][0];
+        means[c] = 0.0f;
+        for(uint32 i = 0; i < BlockTexels; ++i)
+        {
+            minValues[c] = std::min(minValues[c], values[c][i]);
+            maxValues[c] = std::max(maxValues[c], values[c][i]);
+            means[c] += values[c][i] / BlockTexels;
+        }
+
+        if(maxValues[c] - minValues[c] > maxValues[mainChannel] - minValues[mainChannel])
+            mainChannel = c;
+    }
+
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        float covariance = 0.0f;
+        for(uint32 i = 0; i < BlockTexels; ++i)
+            covariance += (values[c][i] - means[c]) * (values[mainChannel][i] - means[mainChannel]);
+
+        endpoints[0][c] = covariance < 0.0f ? maxValues[c] : minValues[c];
+        endpoints[1][c] = covariance < 0.0f ? minValues[c] : maxValues[c];
+    }
+}
+
+// Endpoints at the extents of the block along its principal axis, which is found with a few
+// power iterations of the covariance matrix starting from the bounding box diagonal
+static void PrincipalAxisEndpoints(const float values[3][BlockTexels], float endpoints[2][3])
+{
+    BoundingBoxEndpoints(values, endpoints);
+
+    float means[3] = { 0.0f, 0.0f, 0.0f };
+    for(uint32 c = 0; c < 3; ++c)
+        for(uint32 i = 0; i < BlockTexels; ++i)
+            means[c] += values[c][i] / BlockTexels;
+
+    float covariance[3][3];
+    for(uint32 c0 = 0; c0 < 3; ++c0)
+    {
+        for(uint32 c1 = c0; c1 < 3; ++c1)
+        {
+            float sum = 0.0f;
+            for(uint32 i = 0; i < BlockTexels; ++i)
+                sum += (values[c0][i] - means[c0]) * (values[c1][i] - means[c1]);
+            covariance[c0][c1] = covariance[c1][c0] = sum;
+        }
+    }
+
+    float axis[3];
+    for(uint32 c = 0; c < 3; ++c)
+        axis[c] = endpoints[1][c] - endpoints[0][c];
+
+    for(uint32 iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[3];
+        float lengthSq = 0.0f;
+        for(uint32 c = 0; c < 3; ++c)
+        {
+            next[c] = covariance[c][0] * axis[0] + covariance[c][1] * axis[1] + covariance[c][2] * axis[2];
+            lengthSq += next[c] * next[c];
+        }
+
+        // All of the texels are the same, so the bounding box is already exact
+        if(lengthSq <= 0.0f)
+            return;
+
+        const float invLength = 1.0f / std::sqrt(lengthSq);
+        for(uint32 c = 0; c < 3; ++c)
+            axis[c] = next[c] * invLength;
+    }
+
+    float minT = FLT_MAX;
+    float maxT = -FLT_MAX;
+    for(uint32 i = 0; i < BlockTexels; ++i)
+    {
+        float t = 0.0f;
+        for(uint32 c = 0; c < 3; ++c)
+            t += (values[c][i] - means[c]) * axis[c];
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        endpoints[0][c] = means[c] + axis[c] * minT;
+        endpoints[1][c] = means[c] + axis[c] * maxT;
+    }
+}
+
+// Least-squares fit of the endpoints for the current indices
+static void RefineBC6HEndpoints(const float values[3][BlockTexels], const uint32 indices[BlockTexels],
+                                float endpoints[2][3])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[3] = { 0.0f, 0.0f, 0.0f };
+    float bx[3] = { 0.0f, 0.0f, 0.0f };
+    for(uint32 i = 0; i < BlockTexels; ++i)
+    {
+        const float w = BC6HWeights[indices[i]] / 64.0f;
+        aa += (1.0f - w) * (1.0f - w);
+        ab += (1.0f - w) * w;
+        bb += w * w;
+        for(uint32 c = 0; c < 3; ++c)
+        {
+            ax[c] += (1.0f - w) * values[c][i];
+            bx[c] += w * values[c][i];
+        }
+    }
+
+    const float det = aa * bb - ab * ab;
+    if(std::abs(det) < 1e-6f)
+        return;
+
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        endpoints[0][c] = (ax[c] * bb - bx[c] * ab) / det;
+        endpoints[1][c] = (bx[c] * aa - ax[c] * ab) / det;
+    }
+}
+
+// Swaps the endpoints if the first texel is closer to the second one, so that its index is
+// likely to fit in 3 bits before quantizing
+static void OrientBC6HEndpoints(const float values[3][BlockTexels], float endpoints[2][3])
+{
+    float along = 0.0f;
+    float lengthSq = 0.0f;
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        const float d = endpoints[1][c] - endpoints[0][c];
+        along += (values[c][0] - endpoints[0][c]) * d;
+        lengthSq += d * d;
+    }
+
+    if(along > 0.5f * lengthSq)
+        for(uint32 c = 0; c < 3; ++c)
+            std::swap(endpoints[0][c], endpoints[1][c]);
+}
+
+static void WriteBC6HBlock(const BC6HEndpoints& endpoints, const uint32 indices[BlockTexels], uint8* block)
+{
+    const BC6HMode& mode = BC6HModes[endpoints.ModeIdx];
+
+    BlockBitWriter writer;
+    writer.Write(mode.ModeBits, 5);
+    for(uint32 c = 0; c < 3; ++c)
+        writer.Write(endpoints.Quantized[0][c] & 0x3FF, 10);
+
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        if(mode.DeltaBits == mode.EndpointBits)
+            writer.Write(endpoints.Quantized[1][c] & 0x3FF, 10);
+        else
+        {
+            const int32 delta = endpoints.Quantized[1][c] - endpoints.Quantized[0][c];
+            writer.Write(delta & ((1 << mode.DeltaBits) - 1), mode.DeltaBits);
+
+            const uint32 numHighBits = mode.EndpointBits - 10;
+            writer.WriteReversed((endpoints.Quantized[0][c] >> 10) & ((1 << numHighBits) - 1), numHighBits);
+        }
+    }
+
+    writer.Write(indices[0], 3);
+    for(uint32 i = 1; i < BlockTexels; ++i)
+        writer.Write(indices[i], 4);
+
+    memcpy(block, writer.Bits, sizeof(writer.Bits));
+}
+
+static void EncodeBC6HBlock(const float texels[3][BlockTexels], bool isSigned, BCQuality quality, uint8* block)
+{
+    // Convert to half-floats 8 at a time, and then into the interpolation range
+    BC6HBlockValues blockValues;
+    float (&values)[3][BlockTexels] = blockValues.Values;
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        for(uint32 i = 0; i < BlockTexels; i += Float8::Width)
+        {
+            uint16 halves[Float8::Width];
+            Float8::ToHalf(Float8::Load(texels[c] + i), halves);
+            for(uint32 j = 0; j < Float8::Width; ++j)
+            {
+                values[c][i + j] = HalfToBC6HRange(halves[j], isSigned);
+                blockValues.Texels[c][i + j] = isSigned ? texels[c][i + j] : std::max(texels[c][i + j], 0.0f);
+            }
+        }
+    }
+
+    float endpoints[2][3];
+    if(quality == BCQualityFast)
+        BoundingBoxEndpoints(values, endpoints);
+    else
+        PrincipalAxisEndpoints(values, endpoints);
+    OrientBC6HEndpoints(values, endpoints);
+
+    const uint32 numRefinements = quality == BCQualityFast ? 0 : (quality == BCQualityNormal ? 1 : 3);
+
+    BC6HEndpoints best;
+    uint32 bestIndices[BlockTexels];
+    float bestError = FLT_MAX;
+    for(uint32 modeIdx = 0; modeIdx < NumBC6HModes; ++modeIdx)
+    {
+        // The fast path only chooses between the widest endpoints and the most precise ones
+        if(quality == BCQualityFast && modeIdx != 0 && modeIdx != NumBC6HModes - 1)
+            continue;
+
+        float modeEndpoints[2][3];
+        memcpy(modeEndpoints, endpoints, sizeof(endpoints));
+        for(uint32 iteration = 0; iteration <= numRefinements; ++iteration)
+        {
+            BC6HEndpoints candidate = QuantizeBC6HEndpoints(modeEndpoints, modeIdx, isSigned);
+            uint32 indices[BlockTexels];
+            const float error = EvaluateBC6HEndpoints(blockValues, candidate, indices, isSigned);
+            if(error < bestError)
+            {
+                best = candidate;
+                memcpy(bestIndices, indices, sizeof(indices));
+                bestError = error;
+            }
+
+            if(iteration < numRefinements)
+            {
+                RefineBC6HEndpoints(values, indices, modeEndpoints);
+                OrientBC6HEndpoints(values, modeEndpoints);
+            }
+        }
+    }
+
+    if(quality == BCQualityHigh)
+    {
+        // Nudge each quantized endpoint component of the best mode by one step
+        for(uint32 e = 0; e < 2; ++e)
+        {
+            for(uint32 c = 0; c < 3; ++c)
+            {
+                for(int32 delta = -1; delta <= 1; delta += 2)
+                {
+                    BC6HEndpoints candidate = best;
+                    candidate.Quantized[e][c] += delta;
+                    if(candidate.Finalize(isSigned) == false)
+                        continue;
+
+                    uint32 indices[BlockTexels];
+                    const float error = EvaluateBC6HEndpoints(blockValues, candidate, indices, isSigned);
+                    if(error < bestError)
+                    {
+                        best = candidate;
+                        memcpy(bestIndices, indices, sizeof(indices));
+                        bestError = error;
+                    }
+                }
+            }
+        }
+    }
+
+    WriteBC6HBlock(best, bestIndices, block);
+}
+
+static void DecodeBC6HBlock(const uint8* block, bool isSigned, Float4 texels[BlockTexels])
+{
+    BlockBitReader reader(block);
+
+    uint32 modeBits = reader.Read(2);
+    if(modeBits >= 2)
+        modeBits |= reader.Read(3) << 2;
+
+    // The two-region modes are never written by CompressBC
+    uint32 modeIdx = 0;
+    while(modeIdx < NumBC6HModes && BC6HModes[modeIdx].ModeBits != modeBits)
+        ++modeIdx;
+    if(modeIdx == NumBC6HModes)
+    {
+        for(uint32 i = 0; i < BlockTexels; ++i)
+            texels[i] = Float4(0.0f, 0.0f, 0.0f, 1.0f);
+        return;
+    }
+
+    const BC6HMode& mode = BC6HModes[modeIdx];
+    int32 e0[3];
+    int32 e1[3];
+    for(uint32 c = 0; c < 3; ++c)
+        e0[c] = reader.Read(10);
+
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        if(mode.DeltaBits == mode.EndpointBits)
+            e1[c] = reader.Read(10);
+        else
+        {
+            e1[c] = reader.Read(mode.DeltaBits);
+            e0[c] |= reader.ReadReversed(mode.EndpointBits - 10) << 10;
+        }
+    }
+
+    for(uint32 c = 0; c < 3; ++c)
+    {
+        if(mode.DeltaBits < mode.EndpointBits)
+            e1[c] = (e0[c] + SignExtend(e1[c], mode.DeltaBits)) & ((1 << mode.EndpointBits) - 1);
+
+        if(isSigned)
+        {
+            e0[c] = SignExtend(e0[c], mode.EndpointBits);
+            e1[c] = SignExtend(e1[c], mode.EndpointBits);
+        }
+
+        e0[c] = UnquantizeBC6H(e0[c], mode.EndpointBits, isSigned);
+        e1[c] = UnquantizeBC6H(e1[c], mode.EndpointBits, isSigned);
+    }
+
+    for(uint32 i = 0; i < BlockTexels; ++i)
+    {
+        const int32 weight = BC6HWeights[reader.Read(i == 0 ? 3 : 4)];
+
+        float channels[3];
+        for(uint32 c = 0; c < 3; ++c)
+        {
+            const uint16 half = FinishUnquantizeBC6H(InterpolateBC6H(e0[c], e1[c], weight), isSigned);
+            channels[c] = PackedVector::XMConvertHalfToFloat(half);
+        }
+
+        texels[i] = Float4(channels[0], channels[1], channels[2], 1.0f);
+    }
+}
+
+//=================================================================================================
+// Public functions
+//=================================================================================================
+
+const wchar* BCQualityName(BCQuality quality)
+{
+    static const wchar* Names[NumBCQualities] = { L"Fast", L"Normal", L"High" };
+    return Names[quality];
+}
+
+bool IsBlockCompressed(DXGI_FORMAT format)
+{
+    return (format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM)
+           || (format >= DXGI_FORMAT_BC6H_TYPELESS && format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+}
+
+uint32 BCBlockSize(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+        case DXGI_FORMAT_BC4_UNORM:
+        case DXGI_FORMAT_BC4_SNORM:
+            return 8;
+        case DXGI_FORMAT_BC5_UNORM:
+        case DXGI_FORMAT_BC5_SNORM:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+            return 16;
+        default:
+            throw Exception(L"Unsupported block-compressed format");
+    }
+}
+
+static bool IsSignedBCFormat(DXGI_FORMAT format)
+{
+    return format == DXGI_FORMAT_BC4_SNORM || format == DXGI_FORMAT_BC5_SNORM || format == DXGI_FORMAT_BC6H_SF16;
+}
+
+void CompressBC(DXGI_FORMAT format, BCQuality quality, uint32 width, uint32 height, const Float4* texels, uint8* blocks)
+{
+    const uint32 blockSize = BCBlockSize(format);
+    const bool isSigned = IsSignedBCFormat(format);
+    const uint32 numBlocksX = (width + BlockDim - 1) / BlockDim;
+    const uint32 numBlocksY = (height + BlockDim - 1) / BlockDim;
+
+    ThreadPool::GlobalPool.ParallelFor(numBlocksY, [&](uint32 blockY, uint32 threadIdx)
+    {
+        float values[3][BlockTexels];
+        for(uint32 blockX = 0; blockX < numBlocksX; ++blockX)
+        {
+            for(uint32 i = 0; i < BlockTexels; ++i)
+            {
+                const uint32 x = std::min(blockX * BlockDim + i % BlockDim, width - 1);
+                const uint32 y = std::min(blockY * BlockDim + i / BlockDim, height - 1);
+                const Float4& texel = texels[uint64(y) * width + x];
+                values[0][i] = texel.x;
+                values[1][i] = texel.y;
+                values[2][i] = texel.z;
+            }
+
+            uint8* block = blocks + (uint64(blockY) * numBlocksX + blockX) * blockSize;
+            if(format == DXGI_FORMAT_BC4_UNORM || format == DXGI_FORMAT_BC4_SNORM)
+                EncodeBC4Block(values[0], isSigned, quality, block);
+            else if(format == DXGI_FORMAT_BC5_UNORM || format == DXGI_FORMAT_BC5_SNORM)
+            {
+                EncodeBC4Block(values[0], isSigned, quality, block);
+                EncodeBC4Block(values[1], isSigned, quality, block + 8);
+            }
+            else
+                EncodeBC6HBlock(values, isSigned, quality, block);
+        }
+    });
+}
+
+void DecompressBCBlock(DXGI_FORMAT format, const uint8* block, Float4 texels[16])
+{
+    const bool isSigned = IsSignedBCFormat(format);
+
+    float red[BlockTexels];
+    float green[BlockTexels];
+    if(format == DXGI_FORMAT_BC4_UNORM || format == DXGI_FORMAT_BC4_SNORM)
+    {
+        DecodeBC4Block(block, isSigned, red);
+        for(uint32 i = 0; i < BlockTexels; ++i)
+            texels[i] = Float4(red[i], 0.0f, 0.0f, 1.0f);
+    }
+    else if(format == DXGI_FORMAT_BC5_UNORM || format == DXGI_FORMAT_BC5_SNORM)
+    {
+        DecodeBC4Block(block, isSigned, red);
+        DecodeBC4Block(block + 8, isSigned, green);
+        for(uint32 i = 0; i < BlockTexels; ++i)
+            texels[i] = Float4(red[i], green[i], 0.0f, 1.0f);
+    }
+    else if(format == DXGI_FORMAT_BC6H_UF16 || format == DXGI_FORMAT_BC6H_SF16)
+        DecodeBC6HBlock(block, isSigned, texels);
+    else
+        throw Exception(L"Unsupported block-compressed format");
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "Math.h"
+
+namespace SampleFramework11
+{
+
+// Trades encoding speed for quality in the block compressors
+enum BCQuality
+{
+    BCQualityFast = 0,      // Endpoints from the extents of the block
+    BCQualityNormal,        // Endpoints refined with a least-squares fit, all BC6H modes
+    BCQualityHigh,          // More refinement, plus a search of the neighboring endpoints
+
+    NumBCQualities
+};
+
+const wchar* BCQualityName(BCQuality quality);
+
+bool IsBlockCompressed(DXGI_FORMAT format);
+
+// Size of a 4x4 block in bytes, for the formats supported by CompressBC
+uint32 BCBlockSize(DXGI_FORMAT format);
+
+// Compresses a width x height image of texels to BC4 (from R), BC5 (from RG), or BC6H (from RGB),
+// in either the signed or unsigned variant. Blocks are written in row-major order, with the
+// texels past the edges of the image clamped to the edge. Rows of blocks are distributed across
+// ThreadPool::GlobalPool. BC6H only uses the single-region modes (11-14), which suit the
+// smoothly-varying data that the compressor is used for.
+void CompressBC(DXGI_FORMAT format, BCQuality quality, uint32 width, uint32 height, const Float4* texels, uint8* blocks);
+
+// Decodes one block into 16 texels in row-major order, for measuring the compression error
+void DecompressBCBlock(DXGI_FORMAT format, const uint8* block, Float4 texels[16]);
+
+}
\ No newline at end of file
@@ -201,4 +201,93 @@ uint64 File::Size() const
     return fileSize.QuadPart;
 }
 
+// == MemoryMappedFile ============================================================================
+
+MemoryMappedFile::MemoryMappedFile() :  fileHandle(INVALID_HANDLE_VALUE),
+                                        mappingHandle(NULL),
+                                        data(NULL),
+                                        size(0),
+                                        writable(false)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    Close();
+}
+
+void MemoryMappedFile::OpenRead(const wchar* filePath)
+{
+    Close();
+
+    fileHandle = CreateFile(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(fileHandle == INVALID_HANDLE_VALUE)
+        Win32Call(false);
+
+    LARGE_INTEGER fileSize;
+    Win32Call(GetFileSizeEx(fileHandle, &fileSize));
+    size = fileSize.QuadPart;
+    writable = false;
+
+    // Empty files can't be mapped
+    if(size == 0)
+        return;
+
+    mappingHandle = CreateFileMapping(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mappingHandle == NULL)
+        Win32Call(false);
+
+    data = reinterpret_cast<uint8*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if(data == NULL)
+        Win32Call(false);
+}
+
+void MemoryMappedFile::Create(const wchar* filePath, uint64 fileSize)
+{
+    Close();
+
+    _ASSERT(fileSize > 0);
+
+    fileHandle = CreateFile(filePath, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(fileHandle == INVALID_HANDLE_VALUE)
+        Win32Call(false);
+
+    // Creating the mapping extends the file to the requested size
+    mappingHandle = CreateFileMapping(fileHandle, NULL, PAGE_READWRITE, static_cast<DWORD>(fileSize >> 32),
+                                      static_cast<DWORD>(fileSize & 0xFFFFFFFF), NULL);
+    if(mappingHandle == NULL)
+        Win32Call(false);
+
+    data = reinterpret_cast<uint8*>(MapViewOfFile(mappingHandle, FILE_MAP_WRITE, 0, 0, 0));
+    if(data == NULL)
+        Win32Call(false);
+
+    size = fileSize;
+    writable = true;
+}
+
+void MemoryMappedFile::Close()
+{
+    if(data != NULL)
+        Win32Call(UnmapViewOfFile(data));
+    data = NULL;
+
+    if(mappingHandle != NULL)
+        Win32Call(CloseHandle(mappingHandle));
+    mappingHandle = NULL;
+
+    if(fileHandle != INVALID_HANDLE_VALUE)
+        Win32Call(CloseHandle(fileHandle));
+    fileHandle = INVALID_HANDLE_VALUE;
+
+    size = 0;
+    writable = false;
+}
+
+void MemoryMappedFile::Flush() const
+{
+    if(data != NULL && writable)
+        Win32Call(FlushViewOfFile(data, 0));
+}
+
 }
\ No newline at end of file
@@ -67,6 +67,46 @@ public:
     uint64 Size() const;
 };
 
+// Maps an entire file into the address space of the process
+class MemoryMappedFile
+{
+
+private:
+
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+    uint8* data;
+    uint64 size;
+    bool writable;
+
+    MemoryMappedFile(const MemoryMappedFile& other);
+    MemoryMappedFile& operator=(const MemoryMappedFile& other);
+
+public:
+
+    // Lifetime
+    MemoryMappedFile();
+    ~MemoryMappedFile();
+
+    // Maps an existing file for reading
+    void OpenRead(const wchar* filePath);
+
+    // Creates a new file with the specified size (replacing any existing file), and maps it
+    // for reading and writing
+    void Create(const wchar* filePath, uint64 size);
+
+    void Close();
+
+    // Writes any modified pages back to the file
+    void Flush() const;
+
+    // Accessors
+    const uint8* Data() const { return data; }
+    uint8* Data() { _ASSERT(writable); return data; }
+    uint64 Size() const { return size; }
+    bool IsOpen() const { return fileHandle != INVALID_HANDLE_VALUE; }
+};
+
 // == File ========================================================================================
 
 template<typename T> void File::Read(T& data) const
@@ -0,0 +1,481 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "ImageIO.h"
+#include "SIMD.h"
+#include "Utility.h"
+
+namespace SampleFramework11
+{
+
+static const uint32 TiledImageMagic = 0x4D494654;           // "TFIM"
+static const uint32 TiledImageVersion = 1;
+
+struct TiledImageHeader
+{
+    uint32 Magic;
+    uint32 Version;
+    uint32 Width;
+    uint32 Height;
+    uint32 NumChannels;
+    uint32 Format;
+    uint32 TileSize;
+    uint32 Reserved;
+};
+
+// a * b + c, or false if it doesn't fit in 64 bits
+static bool CheckedMultiplyAdd(uint64 a, uint64 b, uint64 c, uint64& result)
+{
+    const uint64 MaxValue = ~uint64(0);
+    if(a != 0 && b > MaxValue / a)
+        return false;
+    if(a * b > MaxValue - c)
+        return false;
+    result = a * b + c;
+    return true;
+}
+
+static uint32 BytesPerChannel(TiledImageFormat format)
+{
+    return format == TiledImageHalf ? 2 : 4;
+}
+
+// Packs the first numChannels channels of each pixel. Halfs are converted Float8::Width at a time.
+static void EncodePixels(const Float4* src, uint32 count, uint32 numChannels, TiledImageFormat format, uint8* dst)
+{
+    const float* srcFloats = &src[0].x;
+    const uint32 numValues = count * numChannels;
+
+    if(format == TiledImageFloat)
+    {
+        float* dstFloats = reinterpret_cast<float*>(dst);
+        for(uint32 i = 0; i < numValues; ++i)
+            dstFloats[i] = srcFloats[(i / numChannels) * 4 + i % numChannels];
+        return;
+    }
+
+    uint16* dstHalfs = reinterpret_cast<uint16*>(dst);
+    for(uint32 i = 0; i < numValues; i += 8)
+    {
+        const uint32 batchSize = std::min(numValues - i, 8u);
+        float values[8] = { };
+        for(uint32 j = 0; j < batchSize; ++j)
+            values[j] = srcFloats[((i + j) / numChannels) * 4 + (i + j) % numChannels];
+
+        uint16 halfs[8];
+        Float8::ToHalf(Float8::Load(values), halfs);
+        memcpy(dstHalfs + i, halfs, batchSize * sizeof(uint16));
+    }
+}
+
+static void DecodePixels(const uint8* src, uint32 count, uint32 numChannels, TiledImageFormat format, Float4* dst)
+{
+    for(uint32 i = 0; i < count; ++i)
+        dst[i] = Float4(0.0f, 0.0f, 0.0f, 1.0f);
+
+    float* dstFloats = &dst[0].x;
+    const uint32 numValues = count * numChannels;
+
+    if(format == TiledImageFloat)
+    {
+        const float* srcFloats = reinterpret_cast<const float*>(src);
+        for(uint32 i = 0; i < numValues; ++i)
+            dstFloats[(i / numChannels) * 4 + i % numChannels] = srcFloats[i];
+        return;
+    }
+
+    const uint16* srcHalfs = reinterpret_cast<const uint16*>(src);
+    for(uint32 i = 0; i < numValues; i += 8)
+    {
+        const uint32 batchSize = std::min(numValues - i, 8u);
+        uint16 halfs[8] = { };
+        memcpy(halfs, srcHalfs + i, batchSize * sizeof(uint16));
+
+        float values[8];
+        Float8::FromHalf(halfs).Store(values);
+        for(uint32 j = 0; j < batchSize; ++j)
+            dstFloats[((i + j) / numChannels) * 4 + (i + j) % numChannels] = values[j];
+    }
+}
+
+// The next whitespace-separated token of a PFM header
+static std::string NextPFMToken(const MemoryMappedFile& file, uint64& offset)
+{
+    const uint8* data = file.Data();
+    while(offset < file.Size() && isspace(data[offset]))
+        ++offset;
+
+    std::string token;
+    while(offset < file.Size() && !isspace(data[offset]) && token.length() < 32)
+        token += static_cast<char>(data[offset++]);
+
+    return token;
+}
+
+static float SwapBytes(float x)
+{
+    uint32 bits = 0;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = (bits >> 24) | ((bits >> 8) & 0xFF00) | ((bits << 8) & 0xFF0000) | (bits << 24);
+    memcpy(&x, &bits, sizeof(bits));
+    return x;
+}
+
+//=================================================================================================
+// PFMWriter
+//=================================================================================================
+
+PFMWriter::PFMWriter() : dataOffset(0), width(0), height(0), numChannels(0)
+{
+}
+
+void PFMWriter::Create(const wchar* filePath, uint32 width_, uint32 height_, uint32 numChannels_)
+{
+    if(numChannels_ != 1 && numChannels_ != 3)
+        throw Exception(L"PFM files have 1 or 3 channels");
+    if(width_ == 0 || height_ == 0)
+        throw Exception(L"Can't write an empty PFM file");
+    if(width_ > MaxFloatImageSize || height_ > MaxFloatImageSize)
+        throw Exception(L"PFM files can't be larger than " + ToString(MaxFloatImageSize) + L" pixels on a side");
+
+    width = width_;
+    height = height_;
+    numChannels = numChannels_;
+
+    const std::string header = std::string(numChannels == 3 ? "PF\n" : "Pf\n") + ToAnsiString(width) + " "
+                               + ToAnsiString(height) + "\n-1.0\n";
+    dataOffset = header.length();
+
+    file.Create(filePath, dataOffset + uint64(width) * height * numChannels * sizeof(float));
+    memcpy(file.Data(), header.c_str(), header.length());
+}
+
+void PFMWriter::WriteRect(uint32 x, uint32 y, uint32 rectWidth, uint32 rectHeight, const Float4* pixels, uint32 pitch)
+{
+    _ASSERT(x + rectWidth <= width && y + rectHeight <= height);
+
+    const uint64 pixelSize = numChannels * sizeof(float);
+    for(uint32 row = 0; row < rectHeight; ++row)
+    {
+        // The rows go from the bottom up
+        const uint64 fileRow = height - 1 - (y + row);
+        uint8* dst = file.Data() + dataOffset + (fileRow * width + x) * pixelSize;
+        const Float4* src = pixels + uint64(row) * pitch;
+        for(uint32 i = 0; i < rectWidth; ++i)
+            memcpy(dst + i * pixelSize, &src[i].x, pixelSize);
+    }
+}
+
+void PFMWriter::Flush() const
+{
+    file.Flush();
+}
+
+void PFMWriter::Close()
+{
+    file.Close();
+}
+
+//=================================================================================================
+// PFMReader
+//=================================================================================================
+
+PFMReader::PFMReader() : dataOffset(0), width(0), height(0), numChannels(0), bigEndian(false)
+{
+}
+
+void PFMReader::Open(const wchar* filePath)
+{
+    file.OpenRead(filePath);
+
+    uint64 offset = 0;
+    const std::string type = NextPFMToken(file, offset);
+    const std::string widthText = NextPFMToken(file, offset);
+    const std::string heightText = NextPFMToken(file, offset);
+    const std::string scaleText = NextPFMToken(file, offset);
+
+    if(type != "PF" && type != "Pf")
+        throw Exception(L"Not a PFM file: " + std::wstring(filePath));
+
+    numChannels = type == "PF" ? 3 : 1;
+    width = static_cast<uint32>(strtoul(widthText.c_str(), NULL, 10));
+    height = static_cast<uint32>(strtoul(heightText.c_str(), NULL, 10));
+    bigEndian = strtod(scaleText.c_str(), NULL) > 0.0;
+
+    // A single whitespace character separates the header from the pixels. The size is bounded
+    // before it's used for anything, so that the pixels can't be read past the end of the file.
+    dataOffset = offset + 1;
+    if(width == 0 || height == 0 || width > MaxFloatImageSize || height > MaxFloatImageSize)
+        throw Exception(L"Invalid PFM file: " + std::wstring(filePath));
+
+    uint64 fileSize = 0;
+    if(!CheckedMultiplyAdd(uint64(width) * height, numChannels * sizeof(float), dataOffset, fileSize)
+       || fileSize > file.Size())
+        throw Exception(L"Truncated PFM file: " + std::wstring(filePath));
+}
+
+void PFMReader::Close()
+{
+    file.Close();
+}
+
+void PFMReader::ReadRect(uint32 x, uint32 y, uint32 rectWidth, uint32 rectHeight, Float4* pixels, uint32 pitch) const
+{
+    _ASSERT(x + rectWidth <= width && y + rectHeight <= height);
+
+    for(uint32 row = 0; row < rectHeight; ++row)
+    {
+        const uint64 fileRow = height - 1 - (y + row);
+        const uint8* src = file.Data() + dataOffset + (fileRow * width + x) * numChannels * sizeof(float);
+        Float4* dst = pixels + uint64(row) * pitch;
+        for(uint32 i = 0; i < rectWidth; ++i)
+        {
+            float values[3];
+            memcpy(values, src + i * numChannels * sizeof(float), numChannels * sizeof(float));
+            if(bigEndian)
+            {
+                for(uint32 c = 0; c < numChannels; ++c)
+                    values[c] = SwapBytes(values[c]);
+            }
+
+            if(numChannels == 1)
+                dst[i] = Float4(values[0], values[0], values[0], 1.0f);
+            else
+                dst[i] = Float4(values[0], values[1], values[2], 1.0f);
+        }
+    }
+}
+
+//=================================================================================================
+// TiledImageWriter
+//=================================================================================================
+
+TiledImageWriter::TiledImageWriter() : width(0), height(0), numChannels(0), format(TiledImageFloat), tileSize(0),
+                                       numTilesX(0), tileBytes(0)
+{
+}
+
+void TiledImageWriter::Create(const wchar* filePath, uint32 width_, uint32 height_, uint32 numChannels_,
+                              TiledImageFormat format_, uint32 tileSize_)
+{
+    if(numChannels_ == 0 || numChannels_ > 4)
+        throw Exception(L"Tiled images have 1 to 4 channels");
+    if(width_ == 0 || height_ == 0 || tileSize_ == 0)
+        throw Exception(L"Can't write an empty tiled image");
+    if(width_ > MaxFloatImageSize || height_ > MaxFloatImageSize || tileSize_ > MaxTileSize)
+        throw Exception(L"Tiled images can't be larger than " + ToString(MaxFloatImageSize)
+                        + L" pixels on a side, with tiles of up to " + ToString(uint32(MaxTileSize)));
+
+    width = width_;
+    height = height_;
+    numChannels = numChannels_;
+    format = format_;
+    tileSize = tileSize_;
+    numTilesX = (width + tileSize - 1) / tileSize;
+    tileBytes = uint64(tileSize) * tileSize * numChannels * BytesPerChannel(format);
+
+    const uint32 numTilesY = (height + tileSize - 1) / tileSize;
+    file.Create(filePath, sizeof(TiledImageHeader) + tileBytes * numTilesX * numTilesY);
+
+    TiledImageHeader header;
+    header.Magic = TiledImageMagic;
+    header.Version = TiledImageVersion;
+    header.Width = width;
+    header.Height = height;
+    header.NumChannels = numChannels;
+    header.Format = format;
+    header.TileSize = tileSize;
+    header.Reserved = 0;
+    memcpy(file.Data(), &header, sizeof(header));
+}
+
+void TiledImageWriter::WriteRect(uint32 x, uint32 y, uint32 rectWidth, uint32 rectHeight, const Float4* pixels,
+                                 uint32 pitch)
+{
+    _ASSERT(x + rectWidth <= width && y + rectHeight <= height);
+
+    const uint64 pixelSize = numChannels * BytesPerChannel(format);
+    const uint32 endX = x + rectWidth;
+    for(uint32 row = 0; row < rectHeight; ++row)
+    {
+        // Split the row at the tile boundaries
+        const uint32 pixelY = y + row;
+        uint32 pixelX = x;
+        while(pixelX < endX)
+        {
+            const uint32 tileX = pixelX / tileSize;
+            const uint32 count = std::min(endX, (tileX + 1) * tileSize) - pixelX;
+            const uint64 tileIdx = uint64(pixelY / tileSize) * numTilesX + tileX;
+            const uint64 texelIdx = uint64(pixelY % tileSize) * tileSize + pixelX % tileSize;
+            uint8* dst = file.Data() + sizeof(TiledImageHeader) + tileIdx * tileBytes + texelIdx * pixelSize;
+            EncodePixels(pixels + uint64(row) * pitch + (pixelX - x), count, numChannels, format, dst);
+            pixelX += count;
+        }
+    }
+}
+
+void TiledImageWriter::Flush() const
+{
+    file.Flush();
+}
+
+void TiledImageWriter::Close()
+{
+    file.Close();
+}
+
+//=================================================================================================
+// TiledImageReader
+//=================================================================================================
+
+TiledImageReader::TiledImageReader() : width(0), height(0), numChannels(0), format(TiledImageFloat), tileSize(0),
+                                       numTilesX(0), numTilesY(0), tileBytes(0)
+{
+}
+
+void TiledImageReader::Open(const wchar* filePath)
+{
+    file.OpenRead(filePath);
+
+    TiledImageHeader header;
+    if(file.Size() < sizeof(header))
+        throw Exception(L"Invalid tiled image: " + std::wstring(filePath));
+    memcpy(&header, file.Data(), sizeof(header));
+
+    if(header.Magic != TiledImageMagic)
+        throw Exception(L"Not a tiled image: " + std::wstring(filePath));
+    if(header.Version != TiledImageVersion)
+        throw Exception(L"Unsupported tiled image version: " + std::wstring(filePath));
+
+    width = header.Width;
+    height = header.Height;
+    numChannels = header.NumChannels;
+    format = TiledImageFormat(header.Format);
+    tileSize = header.TileSize;
+
+    // Everything is bounded before the size is computed, so that a bogus header can't make the
+    // tiles point past the end of the file
+    if(width == 0 || height == 0 || width > MaxFloatImageSize || height > MaxFloatImageSize
+       || numChannels == 0 || numChannels > 4 || header.Format >= NumTiledImageFormats
+       || tileSize == 0 || tileSize > TiledImageWriter::MaxTileSize)
+        throw Exception(L"Invalid tiled image: " + std::wstring(filePath));
+
+    numTilesX = (width + tileSize - 1) / tileSize;
+    numTilesY = (height + tileSize - 1) / tileSize;
+    tileBytes = uint64(tileSize) * tileSize * numChannels * BytesPerChannel(format);
+
+    uint64 fileSize = 0;
+    if(!CheckedMultiplyAdd(tileBytes, uint64(numTilesX) * numTilesY, sizeof(TiledImageHeader), fileSize)
+       || fileSize > file.Size())
+        throw Exception(L"Truncated tiled image: " + std::wstring(filePath));
+}
+
+void TiledImageReader::Close()
+{
+    file.Close();
+}
+
+const void* TiledImageReader::TileData(uint32 tileX, uint32 tileY) const
+{
+    _ASSERT(tileX < numTilesX && tileY < numTilesY);
+    return file.Data() + sizeof(TiledImageHeader) + (uint64(tileY) * numTilesX + tileX) * tileBytes;
+}
+
+void TiledImageReader::ReadTile(uint32 tileX, uint32 tileY, Float4* pixels) const
+{
+    const uint8* src = reinterpret_cast<const uint8*>(TileData(tileX, tileY));
+    DecodePixels(src, tileSize * tileSize, numChannels, format, pixels);
+}
+
+void TiledImageReader::ReadRect(uint32 x, uint32 y, uint32 rectWidth, uint32 rectHeight, Float4* pixels,
+                                uint32 pitch) const
+{
+    _ASSERT(x + rectWidth <= width && y + rectHeight <= height);
+
+    const uint64 pixelSize = numChannels * BytesPerChannel(format);
+    const uint32 endX = x + rectWidth;
+    for(uint32 row = 0; row < rectHeight; ++row)
+    {
+        const uint32 pixelY = y + row;
+        uint32 pixelX = x;
+        while(pixelX < endX)
+        {
+            const uint32 tileX = pixelX / tileSize;
+            const uint32 count = std::min(endX, (tileX + 1) * tileSize) - pixelX;
+            const uint64 texelIdx = uint64(pixelY % tileSize) * tileSize + pixelX % tileSize;
+            const uint8* src = reinterpret_cast<const uint8*>(TileData(tileX, pixelY / tileSize)) + texelIdx * pixelSize;
+            DecodePixels(src, count, numChannels, format, pixels + uint64(row) * pitch + (pixelX - x));
+            pixelX += count;
+        }
+    }
+}
+
+//=================================================================================================
+// FloatImageFileWriter
+//=================================================================================================
+
+bool IsFloatImageFile(const wchar* filePath)
+{
+    const std::wstring extension = GetFileExtension(filePath);
+    return _wcsicmp(extension.c_str(), L"pfm") == 0 || _wcsicmp(extension.c_str(), L"tfi") == 0;
+}
+
+FloatImageFileWriter::FloatImageFileWriter() : pfm(false)
+{
+}
+
+void FloatImageFileWriter::Create(const wchar* filePath, uint32 width, uint32 height, TiledImageFormat tiledFormat)
+{
+    pfm = _wcsicmp(GetFileExtension(filePath).c_str(), L"pfm") == 0;
+    if(pfm)
+        pfmWriter.Create(filePath, width, height, 3);
+    else
+        tiledWriter.Create(filePath, width, height, 4, tiledFormat);
+}
+
+void FloatImageFileWriter::WriteRect(uint32 x, uint32 y, uint32 width, uint32 height, const Float4* pixels,
+                                     uint32 pitch)
+{
+    if(pfm)
+        pfmWriter.WriteRect(x, y, width, height, pixels, pitch);
+    else
+        tiledWriter.WriteRect(x, y, width, height, pixels, pitch);
+}
+
+void FloatImageFileWriter::Close()
+{
+    pfmWriter.Close();
+    tiledWriter.Close();
+}
+
+void LoadFloatImage(const wchar* filePath, uint32& width, uint32& height, std::vector<Float4>& pixels)
+{
+    if(_wcsicmp(GetFileExtension(filePath).c_str(), L"pfm") == 0)
+    {
+        PFMReader reader;
+        reader.Open(filePath);
+        width = reader.Width();
+        height = reader.Height();
+        pixels.resize(uint64(width) * height);
+        reader.ReadRect(0, 0, width, height, pixels.data(), width);
+    }
+    else
+    {
+        TiledImageReader reader;
+        reader.Open(filePath);
+        width = reader.Width();
+        height = reader.Height();
+        pixels.resize(uint64(width) * height);
+        reader.ReadRect(0, 0, width, height, pixels.data(), width);
+    }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,210 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "FileIO.h"
+#include "Math.h"
+
+namespace SampleFramework11
+{
+
+// Largest width or height that the readers and writers accept, which keeps the file sizes of
+// bogus headers from overflowing
+const uint32 MaxFloatImageSize = 65536;
+
+// Takes the pixels of a float image one rectangle at a time. The rectangles can come in any order
+// and from any thread, as long as they don't overlap. The pitch is in pixels.
+class FloatImageWriter
+{
+
+public:
+
+    virtual ~FloatImageWriter() {}
+
+    virtual void WriteRect(uint32 x, uint32 y, uint32 width, uint32 height, const Float4* pixels, uint32 pitch) = 0;
+};
+
+// Portable float map: a text header ("PF" for RGB or "Pf" for grayscale, the size, and a scale
+// that's negative for little-endian data), followed by rows of 32-bit floats from the bottom of
+// the image to the top. The file is created at its full size and mapped, so every rectangle goes
+// straight to its place in the file and none of the image is kept in memory.
+class PFMWriter : public FloatImageWriter
+{
+
+public:
+
+    PFMWriter();
+
+    // RGB for 3 channels, or the first channel as grayscale for 1
+    void Create(const wchar* filePath, uint32 width, uint32 height, uint32 numChannels = 3);
+
+    virtual void WriteRect(uint32 x, uint32 y, uint32 width, uint32 height, const Float4* pixels, uint32 pitch);
+
+    // Writes the pages that were written so far back to the file
+    void Flush() const;
+    void Close();
+
+    uint32 Width() const { return width; }
+    uint32 Height() const { return height; }
+    uint32 NumChannels() const { return numChannels; }
+
+protected:
+
+    MemoryMappedFile file;
+    uint64 dataOffset;
+    uint32 width;
+    uint32 height;
+    uint32 numChannels;
+};
+
+// Reads a PFM file through a mapping, so reading part of a large image only touches the pages
+// under it. Big-endian files are swapped as they're read.
+class PFMReader
+{
+
+public:
+
+    PFMReader();
+
+    void Open(const wchar* filePath);
+    void Close();
+
+    // Grayscale is copied to RGB, and alpha is 1
+    void ReadRect(uint32 x, uint32 y, uint32 width, uint32 height, Float4* pixels, uint32 pitch) const;
+
+    uint32 Width() const { return width; }
+    uint32 Height() const { return height; }
+    uint32 NumChannels() const { return numChannels; }
+
+protected:
+
+    MemoryMappedFile file;
+    uint64 dataOffset;
+    uint32 width;
+    uint32 height;
+    uint32 numChannels;
+    bool bigEndian;
+};
+
+enum TiledImageFormat
+{
+    TiledImageFloat = 0,
+    TiledImageHalf,
+
+    NumTiledImageFormats
+};
+
+// Float images that are read a tile at a time. A 32-byte header is followed by the tiles in
+// row-major order, each TileSize x TileSize pixels of NumChannels 32-bit or 16-bit floats, with
+// the tiles along the right and bottom edges padded to the full size. Every tile has a fixed
+// offset, so the tiles can be written in whatever order they're finished in and read without an
+// index. The writer maps the whole file like PFMWriter.
+class TiledImageWriter : public FloatImageWriter
+{
+
+public:
+
+    static const uint32 DefaultTileSize = 64;
+    static const uint32 MaxTileSize = 4096;
+
+    TiledImageWriter();
+
+    void Create(const wchar* filePath, uint32 width, uint32 height, uint32 numChannels = 4,
+                TiledImageFormat format = TiledImageFloat, uint32 tileSize = DefaultTileSize);
+
+    virtual void WriteRect(uint32 x, uint32 y, uint32 width, uint32 height, const Float4* pixels, uint32 pitch);
+
+    void Flush() const;
+    void Close();
+
+    uint32 Width() const { return width; }
+    uint32 Height() const { return height; }
+
+protected:
+
+    MemoryMappedFile file;
+    uint32 width;
+    uint32 height;
+    uint32 numChannels;
+    TiledImageFormat format;
+    uint32 tileSize;
+    uint32 numTilesX;
+    uint64 tileBytes;
+};
+
+class TiledImageReader
+{
+
+public:
+
+    TiledImageReader();
+
+    void Open(const wchar* filePath);
+    void Close();
+
+    // The raw pixels of a tile, TileSize^2 * NumChannels floats or halfs
+    const void* TileData(uint32 tileX, uint32 tileY) const;
+
+    // Decodes a tile to TileSize^2 pixels. Missing channels are 0, and missing alpha is 1.
+    void ReadTile(uint32 tileX, uint32 tileY, Float4* pixels) const;
+    void ReadRect(uint32 x, uint32 y, uint32 width, uint32 height, Float4* pixels, uint32 pitch) const;
+
+    uint32 Width() const { return width; }
+    uint32 Height() const { return height; }
+    uint32 NumChannels() const { return numChannels; }
+    TiledImageFormat Format() const { return format; }
+    uint32 TileSize() const { return tileSize; }
+    uint32 NumTilesX() const { return numTilesX; }
+    uint32 NumTilesY() const { return numTilesY; }
+
+protected:
+
+    MemoryMappedFile file;
+    uint32 width;
+    uint32 height;
+    uint32 numChannels;
+    TiledImageFormat format;
+    uint32 tileSize;
+    uint32 numTilesX;
+    uint32 numTilesY;
+    uint64 tileBytes;
+};
+
+// ".pfm" files, and ".tfi" for tiled images
+bool IsFloatImageFile(const wchar* filePath);
+
+// Writes a PFM file or a tiled image, by the extension of the path. PFM files get RGB, and tiled
+// images get RGBA.
+class FloatImageFileWriter : public FloatImageWriter
+{
+
+public:
+
+    FloatImageFileWriter();
+
+    void Create(const wchar* filePath, uint32 width, uint32 height, TiledImageFormat tiledFormat = TiledImageFloat);
+
+    virtual void WriteRect(uint32 x, uint32 y, uint32 width, uint32 height, const Float4* pixels, uint32 pitch);
+
+    void Close();
+
+protected:
+
+    PFMWriter pfmWriter;
+    TiledImageWriter tiledWriter;
+    bool pfm;
+};
+
+// Reads all of a PFM file or a tiled image
+void LoadFloatImage(const wchar* filePath, uint32& width, uint32& height, std::vector<Float4>& pixels);
+
+}
\ No newline at end of file
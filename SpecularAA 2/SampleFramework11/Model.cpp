@@ -17,6 +17,7 @@
 #include "GraphicsTypes.h"
 #include "Serialization.h"
 #include "FileIO.h"
+#include "ThreadPool.h"
 
 using std::string;
 using std::wstring;
@@ -34,8 +35,9 @@ struct Vertex
     Float2 TexCoord;
     Float3 Tangent;
     Float3 Bitangent;
+    float Curvature;
 
-    Vertex()
+    Vertex() : Curvature(0.0f)
     {
     }
 
@@ -46,6 +48,7 @@ struct Vertex
         TexCoord = tc;
         Tangent = t;
         Bitangent = b;
+        Curvature = 0.0f;
     }
 
     void Transform(const Float3& p, const Float3& s, const Quaternion& q)
@@ -60,15 +63,89 @@ struct Vertex
     }
 };
 
-static const D3D11_INPUT_ELEMENT_DESC VertexInputs[5] =
+static const D3D11_INPUT_ELEMENT_DESC VertexInputs[6] =
 {
     { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
     { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
     { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
     { "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 32, D3D11_INPUT_PER_VERTEX_DATA, 0 },
     { "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 44, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    { "CURVATURE", 0, DXGI_FORMAT_R32_FLOAT, 0, 56, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 };
 
+void ComputeVertexCurvature(const uint8* vertices, uint32 vertexStride, uint32 numVertices, uint32 posOffset,
+                            uint32 nmlOffset, const uint8* indices, uint32 indexSize, uint32 numIndices,
+                            std::vector<float>& curvatures)
+{
+    curvatures.clear();
+    curvatures.resize(numVertices, 0.0f);
+
+    // Build a list of the triangles that use each vertex, so that the vertices can be
+    // processed independently
+    const uint32 numTriangles = numIndices / 3;
+    std::vector<uint32> triangleStarts(numVertices + 1, 0);
+    for(uint32 i = 0; i < numTriangles * 3; ++i)
+    {
+        const uint32 vtxIdx = GetIndex(indices, i, indexSize);
+        if(vtxIdx >= numVertices)
+            throw Exception(L"Can't generate curvature, mesh has an out-of-range index");
+        ++triangleStarts[vtxIdx + 1];
+    }
+
+    for(uint32 i = 0; i < numVertices; ++i)
+        triangleStarts[i + 1] += triangleStarts[i];
+
+    std::vector<uint32> vertexTriangles(numTriangles * 3);
+    std::vector<uint32> fillPositions(triangleStarts.begin(), triangleStarts.end() - 1);
+    for(uint32 i = 0; i < numTriangles * 3; ++i)
+        vertexTriangles[fillPositions[GetIndex(indices, i, indexSize)]++] = i / 3;
+
+    // For every edge leaving the vertex, the change in the normal along the edge gives the normal
+    // curvature in that direction. The RMS over all of the edges is stored, so that a sphere with
+    // radius r ends up with 1 / r.
+    const uint32 VerticesPerTask = 4096;
+    const uint32 numTasks = (numVertices + VerticesPerTask - 1) / VerticesPerTask;
+    ThreadPool::GlobalPool.ParallelFor(numTasks, [&](uint32 taskIdx, uint32 threadIdx)
+    {
+        const uint32 start = taskIdx * VerticesPerTask;
+        const uint32 end = std::min(start + VerticesPerTask, numVertices);
+        for(uint32 vtxIdx = start; vtxIdx < end; ++vtxIdx)
+        {
+            const uint8* vtxData = vertices + vtxIdx * vertexStride;
+            const Float3 p0 = *reinterpret_cast<const Float3*>(vtxData + posOffset);
+            const Float3 n0 = Float3::Normalize(*reinterpret_cast<const Float3*>(vtxData + nmlOffset));
+
+            float sum = 0.0f;
+            uint32 numEdges = 0;
+            for(uint32 i = triangleStarts[vtxIdx]; i < triangleStarts[vtxIdx + 1]; ++i)
+            {
+                const uint32 triIdx = vertexTriangles[i];
+                for(uint32 corner = 0; corner < 3; ++corner)
+                {
+                    const uint32 otherIdx = GetIndex(indices, triIdx * 3 + corner, indexSize);
+                    if(otherIdx == vtxIdx)
+                        continue;
+
+                    const uint8* otherData = vertices + otherIdx * vertexStride;
+                    const Float3 p1 = *reinterpret_cast<const Float3*>(otherData + posOffset);
+                    const Float3 n1 = Float3::Normalize(*reinterpret_cast<const Float3*>(otherData + nmlOffset));
+
+                    const Float3 edge = p1 - p0;
+                    const float edgeLengthSq = Float3::Dot(edge, edge);
+                    if(edgeLengthSq < 1e-12f)
+                        continue;
+
+                    const float k = Float3::Dot(n1 - n0, edge) / edgeLengthSq;
+                    sum += k * k;
+                    ++numEdges;
+                }
+            }
+
+            curvatures[vtxIdx] = numEdges > 0 ? std::sqrt(sum / numEdges) : 0.0f;
+        }
+    });
+}
+
 Mesh::Mesh() :  vertexStride(0),
                 numVertices(0),
                 numIndices(0)
@@ -108,6 +185,8 @@ void Mesh::Initialize(ID3D11Device* device, SDKMesh& sdkMesh, uint32 meshIdx, bo
     if(generateTangents)
         GenerateTangentFrame();
 
+    GenerateCurvature();
+
     D3D11_BUFFER_DESC bufferDesc;
     bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
     bufferDesc.ByteWidth = vertexStride * numVertices;
@@ -264,27 +343,31 @@ void Mesh::InitBox(ID3D11Device* device, const Float3& dimensions, const Float3&
     indices.resize(ibSize, 0);
     memcpy(indices.data(), boxIndices.data(), ibSize);
 
-    D3D11_BUFFER_DESC bufferDesc;
-    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-    bufferDesc.ByteWidth = vbSize;
-    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    bufferDesc.CPUAccessFlags = 0;
-    bufferDesc.MiscFlags = 0;
-    bufferDesc.StructureByteStride = 0;
-
-    D3D11_SUBRESOURCE_DATA initData;
-    initData.pSysMem = vertices.data();
-    initData.SysMemPitch = 0;
-    initData.SysMemSlicePitch = 0;
-    DXCall(device->CreateBuffer(&bufferDesc, &initData, &vertexBuffer));
-
-    bufferDesc.ByteWidth = ibSize;
-    bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    bufferDesc.MiscFlags = 0;
-    bufferDesc.StructureByteStride = 0;
-
-    initData.pSysMem = indices.data();
-    DXCall(device->CreateBuffer(&bufferDesc, &initData, &indexBuffer));
+    // Without a device only the CPU copies are kept, which is enough for the headless tools
+    if(device != NULL)
+    {
+        D3D11_BUFFER_DESC bufferDesc;
+        bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        bufferDesc.ByteWidth = vbSize;
+        bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        bufferDesc.CPUAccessFlags = 0;
+        bufferDesc.MiscFlags = 0;
+        bufferDesc.StructureByteStride = 0;
+
+        D3D11_SUBRESOURCE_DATA initData;
+        initData.pSysMem = vertices.data();
+        initData.SysMemPitch = 0;
+        initData.SysMemSlicePitch = 0;
+        DXCall(device->CreateBuffer(&bufferDesc, &initData, &vertexBuffer));
+
+        bufferDesc.ByteWidth = ibSize;
+        bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+        bufferDesc.MiscFlags = 0;
+        bufferDesc.StructureByteStride = 0;
+
+        initData.pSysMem = indices.data();
+        DXCall(device->CreateBuffer(&bufferDesc, &initData, &indexBuffer));
+    }
 
     meshParts.resize(1);
 
@@ -343,27 +426,31 @@ void Mesh::InitPlane(ID3D11Device* device, const Float2& dimensions, const Float
     indices.resize(ibSize, 0);
     memcpy(indices.data(), planeIndices.data(), ibSize);
 
-    D3D11_BUFFER_DESC bufferDesc;
-    bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
-    bufferDesc.ByteWidth = vbSize;
-    bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-    bufferDesc.CPUAccessFlags = 0;
-    bufferDesc.MiscFlags = 0;
-    bufferDesc.StructureByteStride = 0;
-
-    D3D11_SUBRESOURCE_DATA initData;
-    initData.pSysMem = vertices.data();
-    initData.SysMemPitch = 0;
-    initData.SysMemSlicePitch = 0;
-    DXCall(device->CreateBuffer(&bufferDesc, &initData, &vertexBuffer));
-
-    bufferDesc.ByteWidth = ibSize;
-    bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-    bufferDesc.MiscFlags = 0;
-    bufferDesc.StructureByteStride = 0;
-
-    initData.pSysMem = indices.data();
-    DXCall(device->CreateBuffer(&bufferDesc, &initData, &indexBuffer));
+    // Without a device only the CPU copies are kept, which is enough for the headless tools
+    if(device != NULL)
+    {
+        D3D11_BUFFER_DESC bufferDesc;
+        bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+        bufferDesc.ByteWidth = vbSize;
+        bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        bufferDesc.CPUAccessFlags = 0;
+        bufferDesc.MiscFlags = 0;
+        bufferDesc.StructureByteStride = 0;
+
+        D3D11_SUBRESOURCE_DATA initData;
+        initData.pSysMem = vertices.data();
+        initData.SysMemPitch = 0;
+        initData.SysMemSlicePitch = 0;
+        DXCall(device->CreateBuffer(&bufferDesc, &initData, &vertexBuffer));
+
+        bufferDesc.ByteWidth = ibSize;
+        bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+        bufferDesc.MiscFlags = 0;
+        bufferDesc.StructureByteStride = 0;
+
+        initData.pSysMem = indices.data();
+        DXCall(device->CreateBuffer(&bufferDesc, &initData, &indexBuffer));
+    }
 
     meshParts.resize(1);
 
@@ -499,6 +586,63 @@ void Mesh::GenerateTangentFrame()
     memcpy(vertices.data(), newVertices.data(), numVertices * vertexStride);
 }
 
+void Mesh::GenerateCurvature()
+{
+    uint32 posOffset = 0xFFFFFFFF;
+    uint32 nmlOffset = 0xFFFFFFFF;
+    uint32 curvatureOffset = 0xFFFFFFFF;
+    for(uint32 i = 0; i < inputElements.size(); ++i)
+    {
+        const std::string semantic = inputElements[i].SemanticName;
+        const uint32 offset = inputElements[i].AlignedByteOffset;
+        if(semantic == "POSITION")
+            posOffset = offset;
+        else if(semantic == "NORMAL")
+            nmlOffset = offset;
+        else if(semantic == "CURVATURE")
+            curvatureOffset = offset;
+    }
+
+    if(posOffset == 0xFFFFFFFF || nmlOffset == 0xFFFFFFFF)
+        throw Exception(L"Can't generate curvature, mesh doesn't have positions and normals");
+
+    const uint32 indexSize = indexType == Index16Bit ? 2 : 4;
+    std::vector<float> curvatures;
+    ComputeVertexCurvature(vertices.data(), vertexStride, numVertices, posOffset, nmlOffset,
+                           indices.data(), indexSize, numIndices, curvatures);
+
+    // Add the element to the end of each vertex if the layout doesn't have one
+    if(curvatureOffset == 0xFFFFFFFF)
+    {
+        curvatureOffset = vertexStride;
+
+        D3D11_INPUT_ELEMENT_DESC element;
+        element.SemanticName = "CURVATURE";
+        element.SemanticIndex = 0;
+        element.Format = DXGI_FORMAT_R32_FLOAT;
+        element.InputSlot = 0;
+        element.AlignedByteOffset = curvatureOffset;
+        element.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+        element.InstanceDataStepRate = 0;
+        inputElements.push_back(element);
+
+        const uint32 newStride = vertexStride + sizeof(float);
+        std::vector<uint8> newVertices(numVertices * newStride, 0);
+        for(uint32 i = 0; i < numVertices; ++i)
+            memcpy(newVertices.data() + i * newStride, vertices.data() + i * vertexStride, vertexStride);
+
+        vertexStride = newStride;
+        vertices.swap(newVertices);
+    }
+
+    uint8* vtxData = vertices.data() + curvatureOffset;
+    for(uint32 i = 0; i < numVertices; ++i)
+    {
+        *reinterpret_cast<float*>(vtxData) = curvatures[i];
+        vtxData += vertexStride;
+    }
+}
+
 void Mesh::CreateInputElements(const D3DVERTEXELEMENT9* declaration)
 {
     map<BYTE, LPCSTR> nameMap;
@@ -629,7 +773,8 @@ void Model::GenerateBoxScene(ID3D11Device* device)
     MeshMaterial material;
     material.DiffuseMapName = L"White.png";
     material.NormalMapName = L"Hex.png";
-    LoadMaterialResources(material, L"..\\Content\\Textures\\", device);
+    if(device != NULL)
+        LoadMaterialResources(material, L"..\\Content\\Textures\\", device);
     meshMaterials.push_back(material);
 
     meshes.resize(2);
@@ -643,7 +788,8 @@ void Model::GeneratePlaneScene(ID3D11Device* device, const Float2& dimensions, c
     MeshMaterial material;
     material.DiffuseMapName = L"White.png";
     material.NormalMapName = L"Hex.png";
-    LoadMaterialResources(material, L"..\\Content\\Textures\\", device);
+    if(device != NULL)
+        LoadMaterialResources(material, L"..\\Content\\Textures\\", device);
     meshMaterials.push_back(material);
 
     meshes.resize(1);
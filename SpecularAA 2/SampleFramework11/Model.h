@@ -19,6 +19,15 @@ namespace SampleFramework11
 
 class SDKMesh;
 
+// Estimates the curvature of the surface at every vertex from how much the vertex normals turn
+// along the edges of the triangles that share the vertex. The result is the RMS of the normal
+// curvature over those edges, in radians per unit of distance, so a sphere with radius r gives
+// 1 / r everywhere. Vertices that are split along hard edges or UV seams only see the triangles
+// that reference them. Runs on ThreadPool::GlobalPool.
+void ComputeVertexCurvature(const uint8* vertices, uint32 vertexStride, uint32 numVertices, uint32 posOffset,
+                            uint32 nmlOffset, const uint8* indices, uint32 indexSize, uint32 numIndices,
+                            std::vector<float>& curvatures);
+
 struct MeshMaterial
 {
     Float3 AmbientAlbedo;
@@ -69,7 +78,7 @@ public:
     // Init from loaded files
     void Initialize(ID3D11Device* device, SDKMesh& sdkmesh, uint32 meshIdx, bool generateTangents);
 
-    // Procedural generation
+    // Procedural generation, device can be NULL to skip creating the buffers
     void InitBox(ID3D11Device* device, const Float3& dimensions, const Float3& position,
                  const Quaternion& orientation, uint32 materialIdx);
 
@@ -105,6 +114,7 @@ public:
 protected:
 
     void GenerateTangentFrame();
+    void GenerateCurvature();
     void CreateInputElements(const D3DVERTEXELEMENT9* declaration);
 
     ID3D11BufferPtr vertexBuffer;
@@ -139,7 +149,7 @@ public:
                                 bool generateTangentFrame = false,
                                 bool overrideNormalMaps = false);
 
-    // Procedural generation
+    // Procedural generation, device can be NULL to only generate the geometry
     void GenerateBoxScene(ID3D11Device* device);
     void GeneratePlaneScene(ID3D11Device* device, const Float2& dimensions, const Float3& position,
                             const Quaternion& orientation);
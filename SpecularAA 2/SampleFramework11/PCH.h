@@ -87,6 +87,7 @@ using namespace DirectX;
 #include <tchar.h>
 #include <assert.h>
 #include <limits.h>
+#include <float.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
@@ -104,6 +105,7 @@ using namespace DirectX;
 #include <vector>
 #include <memory>
 #include <map>
+#include <deque>
 #include <cmath>
 #include <sstream>
 #include <fstream>
@@ -111,6 +113,10 @@ using namespace DirectX;
 #include <complex>
 #include <cstdio>
 #include <cstdarg>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 // Static Lib Imports
 #pragma comment(lib, "dxguid.lib")
@@ -0,0 +1,234 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "Random.h"
+
+namespace SampleFramework11
+{
+
+static const uint32 PhiloxM0 = 0xD2511F53;
+static const uint32 PhiloxM1 = 0xCD9E8D57;
+static const uint32 PhiloxW0 = 0x9E3779B9;
+static const uint32 PhiloxW1 = 0xBB67AE85;
+static const uint32 PhiloxRounds = 10;
+
+void Philox4x32(const uint32 counter[4], const uint32 key[2], uint32 result[4])
+{
+    uint32 c0 = counter[0];
+    uint32 c1 = counter[1];
+    uint32 c2 = counter[2];
+    uint32 c3 = counter[3];
+    uint32 k0 = key[0];
+    uint32 k1 = key[1];
+
+    for(uint32 round = 0; round < PhiloxRounds; ++round)
+    {
+        const uint64 product0 = uint64(PhiloxM0) * c0;
+        const uint64 product1 = uint64(PhiloxM1) * c2;
+        c0 = uint32(product1 >> 32) ^ c1 ^ k0;
+        c1 = uint32(product1);
+        c2 = uint32(product0 >> 32) ^ c3 ^ k1;
+        c3 = uint32(product0);
+
+        k0 += PhiloxW0;
+        k1 += PhiloxW1;
+    }
+
+    result[0] = c0;
+    result[1] = c1;
+    result[2] = c2;
+    result[3] = c3;
+}
+
+#if SIMD_AVX2_
+
+// High and low halves of the 32x32 bit products of every lane with m
+static void MulHiLo(__m256i x, __m256i m, __m256i& hi, __m256i& lo)
+{
+    const __m256i even = _mm256_mul_epu32(x, m);
+    const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), m);
+    lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+// Philox4x32 for 8 consecutive blocks, with the counters in structure-of-arrays form. The
+// results are transposed back so that they come out in the same order as the scalar version.
+static void Philox4x32x8(uint64 firstBlock, const uint32 stream[2], const uint32 key[2], uint32* dst)
+{
+    const __m256i first = _mm256_set1_epi32(int32(uint32(firstBlock)));
+    __m256i c0 = _mm256_add_epi32(first, _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    // Lanes where the low word wrapped around carry into the high word. There's no unsigned
+    // comparison, so the sign bits are flipped first.
+    const __m256i signBit = _mm256_set1_epi32(int32(0x80000000));
+    const __m256i carry = _mm256_cmpgt_epi32(_mm256_xor_si256(first, signBit), _mm256_xor_si256(c0, signBit));
+    __m256i c1 = _mm256_sub_epi32(_mm256_set1_epi32(int32(uint32(firstBlock >> 32))), carry);
+    __m256i c2 = _mm256_set1_epi32(int32(stream[0]));
+    __m256i c3 = _mm256_set1_epi32(int32(stream[1]));
+
+    const __m256i m0 = _mm256_set1_epi32(int32(PhiloxM0));
+    const __m256i m1 = _mm256_set1_epi32(int32(PhiloxM1));
+    uint32 k0 = key[0];
+    uint32 k1 = key[1];
+
+    for(uint32 round = 0; round < PhiloxRounds; ++round)
+    {
+        __m256i hi0, lo0, hi1, lo1;
+        MulHiLo(c0, m0, hi0, lo0);
+        MulHiLo(c2, m1, hi1, lo1);
+        c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(int32(k0)));
+        c1 = lo1;
+        c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(int32(k1)));
+        c3 = lo0;
+
+        k0 += PhiloxW0;
+        k1 += PhiloxW1;
+    }
+
+    // 4x8 -> 8x4
+    const __m256i c01Lo = _mm256_unpacklo_epi32(c0, c1);
+    const __m256i c01Hi = _mm256_unpackhi_epi32(c0, c1);
+    const __m256i c23Lo = _mm256_unpacklo_epi32(c2, c3);
+    const __m256i c23Hi = _mm256_unpackhi_epi32(c2, c3);
+    const __m256i blocks04 = _mm256_unpacklo_epi64(c01Lo, c23Lo);
+    const __m256i blocks15 = _mm256_unpackhi_epi64(c01Lo, c23Lo);
+    const __m256i blocks26 = _mm256_unpacklo_epi64(c01Hi, c23Hi);
+    const __m256i blocks37 = _mm256_unpackhi_epi64(c01Hi, c23Hi);
+
+    __m256i* dstVec = reinterpret_cast<__m256i*>(dst);
+    _mm256_storeu_si256(dstVec + 0, _mm256_permute2x128_si256(blocks04, blocks15, 0x20));
+    _mm256_storeu_si256(dstVec + 1, _mm256_permute2x128_si256(blocks26, blocks37, 0x20));
+    _mm256_storeu_si256(dstVec + 2, _mm256_permute2x128_si256(blocks04, blocks15, 0x31));
+    _mm256_storeu_si256(dstVec + 3, _mm256_permute2x128_si256(blocks26, blocks37, 0x31));
+}
+
+#endif
+
+//=================================================================================================
+// Random
+//=================================================================================================
+
+Random::Random(uint64 seed, uint64 stream_) : blockIdx(0), bufferIdx(4)
+{
+    key[0] = uint32(seed);
+    key[1] = uint32(seed >> 32);
+    SetStream(stream_);
+}
+
+void Random::SetStream(uint64 stream_)
+{
+    stream[0] = uint32(stream_);
+    stream[1] = uint32(stream_ >> 32);
+    blockIdx = 0;
+    bufferIdx = 4;
+}
+
+void Random::Seek(uint64 position)
+{
+    blockIdx = position / 4;
+    bufferIdx = 4;
+    if(position % 4 != 0)
+    {
+        RefillBuffer();
+        bufferIdx = uint32(position % 4);
+    }
+}
+
+void Random::RefillBuffer()
+{
+    GenerateBlocks(buffer, 1);
+    bufferIdx = 0;
+}
+
+void Random::GenerateBlocks(uint32* dst, uint64 numBlocks)
+{
+    uint64 blocksDone = 0;
+
+    #if SIMD_AVX2_
+        for(; blocksDone + 8 <= numBlocks; blocksDone += 8)
+            Philox4x32x8(blockIdx + blocksDone, stream, key, dst + blocksDone * 4);
+    #endif
+
+    for(; blocksDone < numBlocks; ++blocksDone)
+    {
+        const uint64 block = blockIdx + blocksDone;
+        const uint32 counter[4] = { uint32(block), uint32(block >> 32), stream[0], stream[1] };
+        Philox4x32(counter, key, dst + blocksDone * 4);
+    }
+
+    blockIdx += numBlocks;
+}
+
+void Random::FillUInts(uint32* dst, uint64 count)
+{
+    // Whatever is left of the current block comes first
+    while(count > 0 && bufferIdx < 4)
+    {
+        *dst++ = buffer[bufferIdx++];
+        --count;
+    }
+
+    const uint64 numBlocks = count / 4;
+    GenerateBlocks(dst, numBlocks);
+    dst += numBlocks * 4;
+    count -= numBlocks * 4;
+
+    while(count > 0)
+    {
+        *dst++ = NextUInt();
+        --count;
+    }
+}
+
+void Random::FillFloats(float* dst, uint64 count)
+{
+    // Generated in chunks that stay in the L1 cache, and converted Float8::Width at a time
+    const uint64 ChunkSize = 1024;
+    uint32 chunk[ChunkSize];
+    while(count > 0)
+    {
+        const uint64 chunkSize = std::min(count, ChunkSize);
+        FillUInts(chunk, chunkSize);
+
+        uint64 i = 0;
+        #if SIMD_AVX2_
+            const __m256 scale = _mm256_set1_ps(1.0f / 16777216.0f);
+            for(; i + 8 <= chunkSize; i += 8)
+            {
+                const __m256i bits = _mm256_srli_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(chunk + i)), 8);
+                _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(bits), scale));
+            }
+        #endif
+
+        for(; i < chunkSize; ++i)
+            dst[i] = UIntToUnitFloat(chunk[i]);
+
+        dst += chunkSize;
+        count -= chunkSize;
+    }
+}
+
+uint32 Random::UIntAt(uint64 seed, uint64 stream, uint64 position)
+{
+    const uint64 block = position / 4;
+    const uint32 counter[4] = { uint32(block), uint32(block >> 32), uint32(stream), uint32(stream >> 32) };
+    const uint32 key[2] = { uint32(seed), uint32(seed >> 32) };
+    uint32 result[4];
+    Philox4x32(counter, key, result);
+    return result[position % 4];
+}
+
+float Random::FloatAt(uint64 seed, uint64 stream, uint64 position)
+{
+    return UIntToUnitFloat(UIntAt(seed, stream, position));
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "Math.h"
+#include "SIMD.h"
+
+namespace SampleFramework11
+{
+
+// Philox4x32-10 from "Parallel Random Numbers: As Easy as 1, 2, 3" (Salmon et al.), which turns
+// a 128-bit counter and a 64-bit key into 4 random uint32's. There's no state to carry from one
+// call to the next, so any number can be computed directly from where it sits in its stream.
+void Philox4x32(const uint32 counter[4], const uint32 key[2], uint32 result[4]);
+
+// Converts the top 24 bits to a float in [0, 1)
+inline float UIntToUnitFloat(uint32 x)
+{
+    return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Stream of random numbers built on Philox4x32. The seed is the key, and the stream index and
+// the position in the stream form the counter, so every combination of seed, stream, and
+// position gives an independent number. Work that runs in parallel should use one stream per
+// item (tile, pixel, texel, ...) rather than one per thread, so that the results don't depend
+// on how many threads there are or which thread picked up the item.
+class Random
+{
+
+public:
+
+    Random(uint64 seed = 0, uint64 stream = 0);
+
+    // Starts over at the beginning of another stream
+    void SetStream(uint64 stream);
+
+    // Moves to an absolute position in the current stream, counted in uint32's
+    void Seek(uint64 position);
+    uint64 Position() const { return blockIdx * 4 + bufferIdx - 4; }
+
+    uint32 NextUInt()
+    {
+        if(bufferIdx == 4)
+            RefillBuffer();
+        return buffer[bufferIdx++];
+    }
+
+    // Uniform in [0, 1)
+    float NextFloat() { return UIntToUnitFloat(NextUInt()); }
+
+    // Uniform in [minVal, maxVal)
+    float NextFloat(float minVal, float maxVal) { return minVal + (maxVal - minVal) * NextFloat(); }
+
+    // Uniform in [0, count), count must be > 0
+    uint32 NextUInt(uint32 count) { return static_cast<uint32>((uint64(NextUInt()) * count) >> 32); }
+
+    Float2 NextFloat2()
+    {
+        const float x = NextFloat();
+        return Float2(x, NextFloat());
+    }
+
+    // Fills dst with the next count numbers, exactly the same as calling NextUInt/NextFloat count
+    // times. Whole blocks are generated Float8::Width at a time.
+    void FillUInts(uint32* dst, uint64 count);
+    void FillFloats(float* dst, uint64 count);
+
+    // The numbers at a position of a stream, without going through a Random
+    static uint32 UIntAt(uint64 seed, uint64 stream, uint64 position);
+    static float FloatAt(uint64 seed, uint64 stream, uint64 position);
+
+    // Packs two 32-bit indices into a stream index, for streams keyed by pixel or tile and frame,
+    // sample, etc.
+    static uint64 StreamIndex(uint32 a, uint32 b) { return (uint64(a) << 32) | b; }
+
+protected:
+
+    void RefillBuffer();
+    void GenerateBlocks(uint32* dst, uint64 numBlocks);
+
+    uint32 key[2];
+    uint32 stream[2];
+    uint64 blockIdx;
+    uint32 buffer[4];
+    uint32 bufferIdx;
+};
+
+}
\ No newline at end of file
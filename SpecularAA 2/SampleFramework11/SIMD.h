@@ -0,0 +1,508 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+// AVX2 is used when the compiler targets it (/arch:AVX2), otherwise everything falls back to
+// plain scalar loops that the compiler is free to auto-vectorize
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define SIMD_AVX2_ 1
+#else
+    #define SIMD_AVX2_ 0
+#endif
+
+namespace SampleFramework11
+{
+
+// 8-wide float vector, used for processing texels and pixels in structure-of-arrays form
+struct Float8
+{
+    static const uint32 Width = 8;
+
+#if SIMD_AVX2_
+
+    __m256 v;
+
+    Float8() {}
+    Float8(float x) : v(_mm256_set1_ps(x)) {}
+    Float8(__m256 x) : v(x) {}
+
+    static Float8 Load(const float* src) { return _mm256_loadu_ps(src); }
+    void Store(float* dst) const { _mm256_storeu_ps(dst, v); }
+
+    float operator[](uint32 idx) const
+    {
+        float tmp[8];
+        _mm256_storeu_ps(tmp, v);
+        return tmp[idx];
+    }
+
+    Float8 operator+(const Float8& other) const { return _mm256_add_ps(v, other.v); }
+    Float8 operator-(const Float8& other) const { return _mm256_sub_ps(v, other.v); }
+    Float8 operator*(const Float8& other) const { return _mm256_mul_ps(v, other.v); }
+    Float8 operator/(const Float8& other) const { return _mm256_div_ps(v, other.v); }
+    Float8 operator-() const { return _mm256_sub_ps(_mm256_setzero_ps(), v); }
+
+    Float8& operator+=(const Float8& other) { v = _mm256_add_ps(v, other.v); return *this; }
+    Float8& operator-=(const Float8& other) { v = _mm256_sub_ps(v, other.v); return *this; }
+    Float8& operator*=(const Float8& other) { v = _mm256_mul_ps(v, other.v); return *this; }
+    Float8& operator/=(const Float8& other) { v = _mm256_div_ps(v, other.v); return *this; }
+
+    // Comparisons return a mask with all bits set in the lanes where the comparison is true
+    Float8 operator<(const Float8& other) const { return _mm256_cmp_ps(v, other.v, _CMP_LT_OQ); }
+    Float8 operator<=(const Float8& other) const { return _mm256_cmp_ps(v, other.v, _CMP_LE_OQ); }
+    Float8 operator>(const Float8& other) const { return _mm256_cmp_ps(v, other.v, _CMP_GT_OQ); }
+    Float8 operator>=(const Float8& other) const { return _mm256_cmp_ps(v, other.v, _CMP_GE_OQ); }
+    Float8 operator==(const Float8& other) const { return _mm256_cmp_ps(v, other.v, _CMP_EQ_OQ); }
+
+    static Float8 Sqrt(const Float8& x) { return _mm256_sqrt_ps(x.v); }
+    static Float8 Min(const Float8& a, const Float8& b) { return _mm256_min_ps(a.v, b.v); }
+    static Float8 Max(const Float8& a, const Float8& b) { return _mm256_max_ps(a.v, b.v); }
+    static Float8 Floor(const Float8& x) { return _mm256_floor_ps(x.v); }
+
+    // Base-2 logarithm for positive, normalized values. The mantissa term uses the first 4 terms
+    // of the atanh series for log2(m) = 2 / ln(2) * atanh((m - 1) / (m + 1)), which keeps the
+    // error below 2e-5.
+    static Float8 Log2(const Float8& x)
+    {
+        const __m256i bits = _mm256_castps_si256(x.v);
+        const __m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+        const __m256i mantissaBits = _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)),
+                                                     _mm256_set1_epi32(0x3F800000));
+        const Float8 m = _mm256_castsi256_ps(mantissaBits);
+
+        const Float8 t = (m - 1.0f) / (m + 1.0f);
+        const Float8 t2 = t * t;
+        const Float8 series = t * (t2 * (t2 * (t2 * (1.0f / 7.0f) + 1.0f / 5.0f) + 1.0f / 3.0f) + 1.0f);
+        return Float8(_mm256_cvtepi32_ps(exponent)) + series * 2.885390082f;
+    }
+
+    // Base-2 exponential, with the input clamped to [-126, 127]. The fractional part is in
+    // [-0.5, 0.5] after rounding, and the Taylor series of 2^f up to the 5th term keeps the
+    // relative error below 3e-6.
+    static Float8 Exp2(const Float8& x)
+    {
+        const __m256 clamped = _mm256_min_ps(_mm256_max_ps(x.v, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(127.0f));
+        const __m256 n = _mm256_round_ps(clamped, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        const Float8 f = _mm256_sub_ps(clamped, n);
+
+        const Float8 series = f * (f * (f * (f * (f * 0.001333355815f + 0.009618129108f) + 0.05550410866f)
+                                        + 0.2402265070f) + 0.6931471806f) + 1.0f;
+        const __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+        return series * Float8(_mm256_castsi256_ps(exponent));
+    }
+
+    // Returns a where the mask is set, otherwise b
+    static Float8 Select(const Float8& mask, const Float8& a, const Float8& b)
+    {
+        return _mm256_blendv_ps(b.v, a.v, mask.v);
+    }
+
+    // Returns true if any lane of the mask is set
+    static bool Any(const Float8& mask) { return _mm256_movemask_ps(mask.v) != 0; }
+
+    // Sum of all 8 lanes
+    static float Sum(const Float8& x)
+    {
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(x.v), _mm256_extractf128_ps(x.v, 1));
+        sum = _mm_hadd_ps(sum, sum);
+        sum = _mm_hadd_ps(sum, sum);
+        return _mm_cvtss_f32(sum);
+    }
+
+    // Rounds to the nearest integer (ties to even), and converts to int32
+    static void ToInt(const Float8& x, int32* dst)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_cvtps_epi32(x.v));
+    }
+
+    // Converts to IEEE half-precision, rounding to the nearest value
+    static void ToHalf(const Float8& x, uint16* dst)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm256_cvtps_ph(x.v, _MM_FROUND_TO_NEAREST_INT));
+    }
+
+    // Converts 8 IEEE half-precision values to floats
+    static Float8 FromHalf(const uint16* src)
+    {
+        return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+    }
+
+    // Converts 8 RGBA8 texels into 4 normalized [0, 1] channels
+    static void UnpackRGBA8(const uint32* src, Float8& r, Float8& g, Float8& b, Float8& a)
+    {
+        const __m256i texels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        const __m256i mask = _mm256_set1_epi32(0xFF);
+        const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+        r.v = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(texels, mask)), scale);
+        g.v = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 8), mask)), scale);
+        b.v = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 16), mask)), scale);
+        a.v = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(texels, 24)), scale);
+    }
+
+#else
+
+    float v[8];
+
+    Float8() {}
+
+    Float8(float x)
+    {
+        for(uint32 i = 0; i < 8; ++i)
+            v[i] = x;
+    }
+
+    static Float8 Load(const float* src)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = src[i];
+        return r;
+    }
+
+    void Store(float* dst) const
+    {
+        for(uint32 i = 0; i < 8; ++i)
+            dst[i] = v[i];
+    }
+
+    float operator[](uint32 idx) const { return v[idx]; }
+
+    #define Float8BinaryOp_(op)                             \
+        Float8 operator op(const Float8& other) const       \
+        {                                                   \
+            Float8 r;                                       \
+            for(uint32 i = 0; i < 8; ++i)                   \
+                r.v[i] = v[i] op other.v[i];                \
+            return r;                                       \
+        }                                                   \
+        Float8& operator op##=(const Float8& other)         \
+        {                                                   \
+            for(uint32 i = 0; i < 8; ++i)                   \
+                v[i] = v[i] op other.v[i];                  \
+            return *this;                                   \
+        }
+
+    Float8BinaryOp_(+)
+    Float8BinaryOp_(-)
+    Float8BinaryOp_(*)
+    Float8BinaryOp_(/)
+
+    #undef Float8BinaryOp_
+
+    Float8 operator-() const { return Float8(0.0f) - *this; }
+
+    #define Float8CompareOp_(op)                                    \
+        Float8 operator op(const Float8& other) const               \
+        {                                                           \
+            Float8 r;                                               \
+            for(uint32 i = 0; i < 8; ++i)                           \
+                r.v[i] = v[i] op other.v[i] ? MaskTrue() : 0.0f;    \
+            return r;                                               \
+        }
+
+    Float8CompareOp_(<)
+    Float8CompareOp_(<=)
+    Float8CompareOp_(>)
+    Float8CompareOp_(>=)
+    Float8CompareOp_(==)
+
+    #undef Float8CompareOp_
+
+    static float MaskTrue()
+    {
+        const uint32 bits = 0xFFFFFFFF;
+        float f;
+        memcpy(&f, &bits, sizeof(float));
+        return f;
+    }
+
+    static bool IsSet(float mask)
+    {
+        uint32 bits;
+        memcpy(&bits, &mask, sizeof(float));
+        return bits != 0;
+    }
+
+    static Float8 Sqrt(const Float8& x)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = std::sqrt(x.v[i]);
+        return r;
+    }
+
+    static Float8 Min(const Float8& a, const Float8& b)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+        return r;
+    }
+
+    static Float8 Max(const Float8& a, const Float8& b)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+        return r;
+    }
+
+    static Float8 Floor(const Float8& x)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = std::floor(x.v[i]);
+        return r;
+    }
+
+    static Float8 Log2(const Float8& x)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = std::log2(x.v[i]);
+        return r;
+    }
+
+    static Float8 Exp2(const Float8& x)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = std::exp2(std::min(std::max(x.v[i], -126.0f), 127.0f));
+        return r;
+    }
+
+    static Float8 Select(const Float8& mask, const Float8& a, const Float8& b)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = IsSet(mask.v[i]) ? a.v[i] : b.v[i];
+        return r;
+    }
+
+    static bool Any(const Float8& mask)
+    {
+        for(uint32 i = 0; i < 8; ++i)
+            if(IsSet(mask.v[i]))
+                return true;
+        return false;
+    }
+
+    static float Sum(const Float8& x)
+    {
+        float sum = 0.0f;
+        for(uint32 i = 0; i < 8; ++i)
+            sum += x.v[i];
+        return sum;
+    }
+
+    static void ToInt(const Float8& x, int32* dst)
+    {
+        for(uint32 i = 0; i < 8; ++i)
+            dst[i] = static_cast<int32>(std::nearbyint(x.v[i]));
+    }
+
+    static void ToHalf(const Float8& x, uint16* dst)
+    {
+        for(uint32 i = 0; i < 8; ++i)
+            dst[i] = PackedVector::XMConvertFloatToHalf(x.v[i]);
+    }
+
+    static Float8 FromHalf(const uint16* src)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = PackedVector::XMConvertHalfToFloat(src[i]);
+        return r;
+    }
+
+    static void UnpackRGBA8(const uint32* src, Float8& r, Float8& g, Float8& b, Float8& a)
+    {
+        for(uint32 i = 0; i < 8; ++i)
+        {
+            r.v[i] = ((src[i] >> 0) & 0xFF) / 255.0f;
+            g.v[i] = ((src[i] >> 8) & 0xFF) / 255.0f;
+            b.v[i] = ((src[i] >> 16) & 0xFF) / 255.0f;
+            a.v[i] = ((src[i] >> 24) & 0xFF) / 255.0f;
+        }
+    }
+
+#endif
+
+    static Float8 Saturate(const Float8& x)
+    {
+        return Min(Max(x, Float8(0.0f)), Float8(1.0f));
+    }
+
+    static Float8 Clamp(const Float8& x, const Float8& minVal, const Float8& maxVal)
+    {
+        return Min(Max(x, minVal), maxVal);
+    }
+
+    static Float8 Lerp(const Float8& x, const Float8& y, const Float8& s)
+    {
+        return x + (y - x) * s;
+    }
+};
+
+inline Float8 operator+(float a, const Float8& b) { return Float8(a) + b; }
+inline Float8 operator-(float a, const Float8& b) { return Float8(a) - b; }
+inline Float8 operator*(float a, const Float8& b) { return Float8(a) * b; }
+inline Float8 operator/(float a, const Float8& b) { return Float8(a) / b; }
+
+// 8-wide int32 vector, for computing the addresses of texels and other data that's gathered into
+// a Float8. The shifts are logical, since the values are meant to be indices.
+struct Int8
+{
+    static const uint32 Width = 8;
+
+#if SIMD_AVX2_
+
+    __m256i v;
+
+    Int8() {}
+    Int8(int32 x) : v(_mm256_set1_epi32(x)) {}
+    Int8(__m256i x) : v(x) {}
+
+    static Int8 Load(const int32* src) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)); }
+    void Store(int32* dst) const { _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), v); }
+
+    Int8 operator+(const Int8& other) const { return _mm256_add_epi32(v, other.v); }
+    Int8 operator-(const Int8& other) const { return _mm256_sub_epi32(v, other.v); }
+    Int8 operator*(const Int8& other) const { return _mm256_mullo_epi32(v, other.v); }
+    Int8 operator&(const Int8& other) const { return _mm256_and_si256(v, other.v); }
+    Int8 operator|(const Int8& other) const { return _mm256_or_si256(v, other.v); }
+    Int8 operator<<(int32 count) const { return _mm256_slli_epi32(v, count); }
+    Int8 operator>>(int32 count) const { return _mm256_srli_epi32(v, count); }
+
+    static Int8 Min(const Int8& a, const Int8& b) { return _mm256_min_epi32(a.v, b.v); }
+    static Int8 Max(const Int8& a, const Int8& b) { return _mm256_max_epi32(a.v, b.v); }
+
+    // Converts with truncation towards zero
+    static Int8 Truncate(const Float8& x) { return _mm256_cvttps_epi32(x.v); }
+    static Float8 ToFloat(const Int8& x) { return _mm256_cvtepi32_ps(x.v); }
+
+    // Loads base[idx] for every lane
+    static Float8 Gather(const float* base, const Int8& idx) { return _mm256_i32gather_ps(base, idx.v, 4); }
+    static Int8 Gather(const int32* base, const Int8& idx) { return _mm256_i32gather_epi32(base, idx.v, 4); }
+
+#else
+
+    int32 v[8];
+
+    Int8() {}
+
+    Int8(int32 x)
+    {
+        for(uint32 i = 0; i < 8; ++i)
+            v[i] = x;
+    }
+
+    static Int8 Load(const int32* src)
+    {
+        Int8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = src[i];
+        return r;
+    }
+
+    void Store(int32* dst) const
+    {
+        for(uint32 i = 0; i < 8; ++i)
+            dst[i] = v[i];
+    }
+
+    #define Int8BinaryOp_(op)                                       \
+        Int8 operator op(const Int8& other) const                   \
+        {                                                           \
+            Int8 r;                                                 \
+            for(uint32 i = 0; i < 8; ++i)                           \
+                r.v[i] = int32(uint32(v[i]) op uint32(other.v[i])); \
+            return r;                                               \
+        }
+
+    Int8BinaryOp_(+)
+    Int8BinaryOp_(-)
+    Int8BinaryOp_(*)
+    Int8BinaryOp_(&)
+    Int8BinaryOp_(|)
+
+    #undef Int8BinaryOp_
+
+    Int8 operator<<(int32 count) const
+    {
+        Int8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = int32(uint32(v[i]) << count);
+        return r;
+    }
+
+    Int8 operator>>(int32 count) const
+    {
+        Int8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = int32(uint32(v[i]) >> count);
+        return r;
+    }
+
+    static Int8 Min(const Int8& a, const Int8& b)
+    {
+        Int8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+        return r;
+    }
+
+    static Int8 Max(const Int8& a, const Int8& b)
+    {
+        Int8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+        return r;
+    }
+
+    static Int8 Truncate(const Float8& x)
+    {
+        Int8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = static_cast<int32>(x.v[i]);
+        return r;
+    }
+
+    static Float8 ToFloat(const Int8& x)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = static_cast<float>(x.v[i]);
+        return r;
+    }
+
+    static Float8 Gather(const float* base, const Int8& idx)
+    {
+        Float8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = base[idx.v[i]];
+        return r;
+    }
+
+    static Int8 Gather(const int32* base, const Int8& idx)
+    {
+        Int8 r;
+        for(uint32 i = 0; i < 8; ++i)
+            r.v[i] = base[idx.v[i]];
+        return r;
+    }
+
+#endif
+};
+
+}
\ No newline at end of file
@@ -44,7 +44,12 @@ public:
     std::wstring Name() const { return name; }
     bool Changed() const { return changed; }
 
-    void SetValue(float newValue) { value = Clamp(newValue, minVal, maxVal); }
+    void SetValue(float newValue)
+    {
+        newValue = Clamp(newValue, minVal, maxVal);
+        changed = changed || newValue != value;
+        value = newValue;
+    }
 
     operator float() const { return Value(); }
 
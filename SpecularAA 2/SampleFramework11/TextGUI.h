@@ -27,7 +27,12 @@ public:
 
     operator uint32() const { return value; }
     bool Changed() const { return changed; }
-    void SetValue(uint32 newValue) { value = std::min(newValue, numValues - 1); }
+    void SetValue(uint32 newValue)
+    {
+        newValue = std::min(newValue, numValues - 1);
+        changed = changed || newValue != value;
+        value = newValue;
+    }
     const std::wstring& ValueName() const { return valueNames[value]; }
 
 protected:
@@ -0,0 +1,346 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "ThreadPool.h"
+
+namespace SampleFramework11
+{
+
+ThreadPool ThreadPool::GlobalPool;
+
+// Set while a thread is executing a task, so that nested ParallelFor calls can run serially
+static thread_local bool ExecutingTask = false;
+
+ThreadPool::ThreadPool() :  currFunc(NULL),
+                            currNumTasks(0),
+                            jobGeneration(0),
+                            nextTask(0),
+                            numTasksDone(0),
+                            numActiveWorkers(0),
+                            shuttingDown(false),
+                            jobFailed(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+    Shutdown();
+}
+
+void ThreadPool::Initialize(uint32 numThreads)
+{
+    Shutdown();
+
+    if(numThreads == 0)
+        numThreads = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+
+    shuttingDown = false;
+    for(uint32 i = 1; i < numThreads; ++i)
+        workers.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+}
+
+void ThreadPool::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        shuttingDown = true;
+    }
+    jobStarted.notify_all();
+
+    for(uint64 i = 0; i < workers.size(); ++i)
+        workers[i].join();
+    workers.clear();
+}
+
+bool ThreadPool::InTask()
+{
+    return ExecutingTask;
+}
+
+void ThreadPool::ParallelFor(uint32 numTasks, const TaskFunction& func)
+{
+    if(numTasks == 0)
+        return;
+
+    if(workers.size() == 0 || numTasks == 1 || ExecutingTask)
+    {
+        for(uint32 i = 0; i < numTasks; ++i)
+            func(i, 0);
+        return;
+    }
+
+    // Only one job can be in flight at a time
+    std::lock_guard<std::mutex> jobLock(jobMutex);
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        currFunc = &func;
+        currNumTasks = numTasks;
+        nextTask = 0;
+        numTasksDone = 0;
+        taskException = nullptr;
+        jobFailed = false;
+        ++jobGeneration;
+    }
+    jobStarted.notify_all();
+
+    RunTasks(0);
+
+    // Wait for the stragglers, and for every worker to let go of the job
+    std::unique_lock<std::mutex> lock(stateMutex);
+    jobFinished.wait(lock, [this]() { return numTasksDone == currNumTasks && numActiveWorkers == 0; });
+    currFunc = NULL;
+    currNumTasks = 0;
+
+    if(taskException)
+    {
+        std::exception_ptr exception = taskException;
+        taskException = nullptr;
+        lock.unlock();
+        std::rethrow_exception(exception);
+    }
+}
+
+void ThreadPool::RunTasks(uint32 threadIdx)
+{
+    ExecutingTask = true;
+
+    // Once a task has thrown, the rest of the job is only counted off so that ParallelFor can
+    // finish waiting for it
+    uint32 taskIdx = nextTask++;
+    while(taskIdx < currNumTasks)
+    {
+        if(!jobFailed)
+        {
+            try
+            {
+                (*currFunc)(taskIdx, threadIdx);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if(!taskException)
+                    taskException = std::current_exception();
+                jobFailed = true;
+            }
+        }
+
+        ++numTasksDone;
+        taskIdx = nextTask++;
+    }
+
+    ExecutingTask = false;
+}
+
+void ThreadPool::WorkerLoop(uint32 threadIdx)
+{
+    uint64 lastGeneration = 0;
+
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            jobStarted.wait(lock, [&]() { return shuttingDown || (currFunc != NULL && jobGeneration != lastGeneration); });
+            if(shuttingDown)
+                return;
+
+            lastGeneration = jobGeneration;
+            ++numActiveWorkers;
+        }
+
+        RunTasks(threadIdx);
+
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            --numActiveWorkers;
+        }
+        jobFinished.notify_all();
+    }
+}
+
+//=================================================================================================
+// TaskScheduler
+//=================================================================================================
+
+// The scheduler and deque that the current thread belongs to, so that Spawn can find its deque
+static thread_local TaskScheduler* CurrentScheduler = NULL;
+static thread_local uint32 CurrentQueue = 0;
+
+TaskScheduler::TaskScheduler() :    numQueues(0),
+                                    numPending(0),
+                                    numQueued(0),
+                                    numSteals(0),
+                                    nextQueue(0),
+                                    shuttingDown(false)
+{
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    Shutdown();
+}
+
+void TaskScheduler::Initialize(uint32 numThreads)
+{
+    Shutdown();
+
+    if(numThreads == 0)
+        numThreads = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+
+    numQueues = numThreads;
+    queues.reset(new WorkerQueue[numQueues]);
+    numPending = 0;
+    numQueued = 0;
+    numSteals = 0;
+    nextQueue = 0;
+
+    shuttingDown = false;
+    for(uint32 i = 1; i < numThreads; ++i)
+        workers.push_back(std::thread(&TaskScheduler::WorkerLoop, this, i));
+}
+
+void TaskScheduler::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        shuttingDown = true;
+    }
+    stateChanged.notify_all();
+
+    for(uint64 i = 0; i < workers.size(); ++i)
+        workers[i].join();
+    workers.clear();
+}
+
+void TaskScheduler::Spawn(const TaskFunction& task)
+{
+    _ASSERT(numQueues > 0);
+
+    uint32 queueIdx = CurrentQueue;
+    if(CurrentScheduler != this)
+        queueIdx = nextQueue++ % numQueues;
+
+    ++numPending;
+    ++numQueued;
+    {
+        WorkerQueue& queue = queues[queueIdx];
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        queue.Tasks.push_back(task);
+    }
+
+    // Taking the lock makes sure that a worker can't miss the notification between checking
+    // numQueued and going to sleep
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+    }
+    stateChanged.notify_one();
+}
+
+void TaskScheduler::Wait()
+{
+    TaskScheduler* prevScheduler = CurrentScheduler;
+    const uint32 prevQueue = CurrentQueue;
+    CurrentScheduler = this;
+    CurrentQueue = 0;
+
+    while(numPending > 0)
+    {
+        if(RunTask(0))
+            continue;
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        stateChanged.wait(lock, [this]() { return numQueued > 0 || numPending == 0; });
+    }
+
+    CurrentScheduler = prevScheduler;
+    CurrentQueue = prevQueue;
+
+    std::exception_ptr exception;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        std::swap(exception, taskException);
+    }
+    if(exception)
+        std::rethrow_exception(exception);
+}
+
+// Runs one task from the back of our own deque, or from the front of another one
+bool TaskScheduler::RunTask(uint32 threadIdx)
+{
+    TaskFunction task;
+    for(uint32 i = 0; i < numQueues && !task; ++i)
+    {
+        WorkerQueue& queue = queues[(threadIdx + i) % numQueues];
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        if(queue.Tasks.empty())
+            continue;
+
+        if(i == 0)
+        {
+            task = std::move(queue.Tasks.back());
+            queue.Tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.Tasks.front());
+            queue.Tasks.pop_front();
+            ++numSteals;
+        }
+    }
+
+    if(!task)
+        return false;
+
+    --numQueued;
+
+    const bool wasExecutingTask = ExecutingTask;
+    ExecutingTask = true;
+    try
+    {
+        task(threadIdx);
+    }
+    catch(...)
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if(!taskException)
+            taskException = std::current_exception();
+    }
+    ExecutingTask = wasExecutingTask;
+
+    if(--numPending == 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+        }
+        stateChanged.notify_all();
+    }
+
+    return true;
+}
+
+void TaskScheduler::WorkerLoop(uint32 threadIdx)
+{
+    CurrentScheduler = this;
+    CurrentQueue = threadIdx;
+
+    while(true)
+    {
+        if(RunTask(threadIdx))
+            continue;
+
+        std::unique_lock<std::mutex> lock(stateMutex);
+        stateChanged.wait(lock, [this]() { return shuttingDown || numQueued > 0; });
+        if(shuttingDown)
+            return;
+    }
+}
+
+}
\ No newline at end of file
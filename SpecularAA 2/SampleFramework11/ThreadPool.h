@@ -0,0 +1,126 @@
+//=================================================================================================
+//
+//  MJP's DX11 Sample Framework
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+namespace SampleFramework11
+{
+
+// Simple fork/join thread pool. A single job of N independent tasks is in flight at a time,
+// and the calling thread helps execute tasks until the job is finished.
+class ThreadPool
+{
+
+public:
+
+    static ThreadPool GlobalPool;
+
+    typedef std::function<void(uint32 taskIdx, uint32 threadIdx)> TaskFunction;
+
+    ThreadPool();
+    ~ThreadPool();
+
+    // Pass 0 to create one thread per hardware thread (the calling thread counts as one)
+    void Initialize(uint32 numThreads = 0);
+    void Shutdown();
+
+    // Runs func for every task index in [0, numTasks), and returns once all tasks have completed.
+    // Calls made from inside a task are executed serially on the calling thread. If a task throws,
+    // the tasks that haven't started yet are skipped and the first exception is rethrown here.
+    void ParallelFor(uint32 numTasks, const TaskFunction& func);
+
+    // Total number of threads that execute tasks, including the calling thread
+    uint32 NumThreads() const { return static_cast<uint32>(workers.size()) + 1; }
+
+    // Whether the calling thread is executing a task, where ParallelFor runs serially
+    static bool InTask();
+
+protected:
+
+    void WorkerLoop(uint32 threadIdx);
+    void RunTasks(uint32 threadIdx);
+
+    std::vector<std::thread> workers;
+
+    std::mutex jobMutex;
+    std::mutex stateMutex;
+    std::condition_variable jobStarted;
+    std::condition_variable jobFinished;
+
+    const TaskFunction* currFunc;
+    uint32 currNumTasks;
+    uint64 jobGeneration;
+    std::atomic<uint32> nextTask;
+    std::atomic<uint32> numTasksDone;
+    uint32 numActiveWorkers;
+    bool shuttingDown;
+
+    std::exception_ptr taskException;   // The first exception thrown by a task of the current job
+    std::atomic<bool> jobFailed;
+};
+
+// Work-stealing scheduler for independent tasks that can spawn more tasks, for work that doesn't
+// fit the single fork/join job of ThreadPool. Every thread has its own deque: tasks spawned from
+// a worker go on the back of its deque and it takes its own work from the back, while idle
+// workers steal from the front of the other deques. Like ThreadPool, the thread that calls Wait
+// helps execute tasks, and ParallelFor calls made from inside a task run serially.
+class TaskScheduler
+{
+
+public:
+
+    typedef std::function<void(uint32 threadIdx)> TaskFunction;
+
+    TaskScheduler();
+    ~TaskScheduler();
+
+    // Pass 0 to create one thread per hardware thread (the thread that calls Wait counts as one)
+    void Initialize(uint32 numThreads = 0);
+    void Shutdown();
+
+    // Tasks spawned from a worker go on its own deque, and the rest are spread over all of them
+    void Spawn(const TaskFunction& task);
+
+    // Executes tasks until every spawned task has completed, including tasks spawned by tasks. If
+    // a task threw, the first exception is rethrown here once the rest have completed.
+    void Wait();
+
+    uint32 NumThreads() const { return numQueues; }
+    uint64 NumSteals() const { return numSteals; }
+
+protected:
+
+    struct WorkerQueue
+    {
+        std::mutex Mutex;
+        std::deque<TaskFunction> Tasks;
+    };
+
+    void WorkerLoop(uint32 threadIdx);
+    bool RunTask(uint32 threadIdx);
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<WorkerQueue[]> queues;
+    uint32 numQueues;
+
+    std::mutex stateMutex;
+    std::condition_variable stateChanged;
+
+    std::atomic<uint64> numPending;     // Spawned and not completed yet
+    std::atomic<uint64> numQueued;      // Sitting in one of the deques
+    std::atomic<uint64> numSteals;
+    std::atomic<uint32> nextQueue;
+    bool shuttingDown;
+
+    std::exception_ptr taskException;
+};
+
+}
\ No newline at end of file
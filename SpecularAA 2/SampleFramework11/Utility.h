@@ -71,7 +71,7 @@ template<typename T> inline T Parse(const std::wstring& str)
     std::wistringstream stream(str);
     wchar_t c;
     T x;
-    if (!(str >> x) || stream.get(c))
+    if (!(stream >> x) || stream.get(c))
         throw Exception(L"Can't parse string \"" + str + L"\"");
     return x;
 }
@@ -0,0 +1,274 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "Sampling.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/Timer.h"
+
+const wchar* SampleSequenceName(SampleSequence sequence)
+{
+    static const wchar* Names[NumSampleSequences] = { L"WhiteNoise", L"Sobol", L"R2" };
+    return Names[sequence];
+}
+
+uint32 ReverseBits(uint32 x)
+{
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+uint32 HashUInt(uint32 x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32 PixelSeed(uint32 x, uint32 y, uint32 sequenceSeed)
+{
+    return HashUInt(x + HashUInt(y + HashUInt(sequenceSeed)));
+}
+
+uint32 LaineKarrasPermutation(uint32 x, uint32 seed)
+{
+    x += seed;
+    x ^= x * 0x6C50B47Cu;
+    x ^= x * 0xB82F1E52u;
+    x ^= x * 0xC7AFE638u;
+    x ^= x * 0x8D22F6E6u;
+    return x;
+}
+
+uint32 NestedUniformScramble(uint32 x, uint32 seed)
+{
+    return ReverseBits(LaineKarrasPermutation(ReverseBits(x), seed));
+}
+
+static Float2 SobolSample(uint32 index, uint32 seed, uint32 seedX, uint32 seedY)
+{
+    index = NestedUniformScramble(index, seed);
+
+    // The first dimension is the van der Corput sequence, which is the reversed index. The
+    // generator matrix of the second is Pascal's triangle mod 2, so by Lucas' theorem bit j of the
+    // reversed result is the XOR of the index bits whose positions contain all of the bits of j.
+    // The Owen scramble reverses the bits again before permuting them, so both dimensions skip
+    // the reversals and go straight to the permutation.
+    uint32 x = index;
+    uint32 y = index;
+    y ^= (y >> 1) & 0x55555555u;
+    y ^= (y >> 2) & 0x33333333u;
+    y ^= (y >> 4) & 0x0F0F0F0Fu;
+    y ^= (y >> 8) & 0x00FF00FFu;
+    y ^= (y >> 16) & 0x0000FFFFu;
+
+    x = ReverseBits(LaineKarrasPermutation(x, seedX));
+    y = ReverseBits(LaineKarrasPermutation(y, seedY));
+
+    return Float2(UIntToUnitFloat(x), UIntToUnitFloat(y));
+}
+
+// Seeds for the scrambling/shift of each dimension
+static uint32 SeedX(uint32 seed)
+{
+    return HashUInt(seed ^ 0x5BD1E995u);
+}
+
+static uint32 SeedY(uint32 seed)
+{
+    return HashUInt(seed ^ 0x1B873593u);
+}
+
+Float2 SobolSample(uint32 index, uint32 seed)
+{
+    return SobolSample(index, seed, SeedX(seed), SeedY(seed));
+}
+
+static Float2 R2Sample(uint32 index, uint32 seedX, uint32 seedY)
+{
+    // 2^32 / g and 2^32 / g^2, where g is the plastic number
+    const uint32 AlphaX = 3242174889u;
+    const uint32 AlphaY = 2447445413u;
+
+    return Float2(UIntToUnitFloat(seedX + index * AlphaX), UIntToUnitFloat(seedY + index * AlphaY));
+}
+
+Float2 R2Sample(uint32 index, uint32 seed)
+{
+    return R2Sample(index, SeedX(seed), SeedY(seed));
+}
+
+Float2 SampleDiscOffset(const Float2& u)
+{
+    // XMScalarSinCos is accurate enough for sample positions, and much cheaper than std::sin/cos
+    float sinTheta, cosTheta;
+    XMScalarSinCos(&sinTheta, &cosTheta, u.x * Pi2);
+    const float r = u.y * 0.5f;
+    return Float2(cosTheta * r, sinTheta * r);
+}
+
+//=================================================================================================
+// PixelSampler
+//=================================================================================================
+
+PixelSampler::PixelSampler(SampleSequence sequence_, uint32 x, uint32 y, uint32 width,
+                           uint32 sequenceSeed_) : sequence(sequence_), sequenceSeed(sequenceSeed_)
+{
+    pixelIdx = y * width + x;
+    seed = PixelSeed(x, y, sequenceSeed);
+    seedX = SeedX(seed);
+    seedY = SeedY(seed);
+}
+
+Float2 PixelSampler::Offset(uint32 sampleIdx) const
+{
+    if(sequence == SampleSequenceWhiteNoise)
+    {
+        // Every pixel has its own Random stream, and both numbers for a sample come from the same
+        // Philox block, at positions sampleIdx * 2 and sampleIdx * 2 + 1
+        const uint32 counter[4] = { sampleIdx / 2, 0, pixelIdx, 0 };
+        const uint32 key[2] = { sequenceSeed, 0 };
+        uint32 block[4];
+        Philox4x32(counter, key, block);
+
+        const uint32* u = block + (sampleIdx % 2) * 2;
+        return SampleDiscOffset(Float2(UIntToUnitFloat(u[0]), UIntToUnitFloat(u[1])));
+    }
+    else if(sequence == SampleSequenceSobol)
+        return SampleDiscOffset(SobolSample(sampleIdx, seed, seedX, seedY));
+    else
+        return SampleDiscOffset(R2Sample(sampleIdx, seedX, seedY));
+}
+
+//=================================================================================================
+// RandomBenchmark
+//=================================================================================================
+
+RandomBenchmark::RandomBenchmark() : NumNumbers(0), NumThreads(1), UsesAVX2(false), KnownAnswersMatch(false),
+                                     BatchMatches(false), ParallelMatches(false), RandFloatSeconds(0.0),
+                                     ScalarSeconds(0.0), BatchSeconds(0.0), ParallelSeconds(0.0)
+{
+}
+
+// Numbers per task for the parallel run, which is also the granularity that it seeks at
+static const uint64 RandomTaskSize = 64 * 1024;
+
+void RandomBenchmark::Run(uint64 numNumbers)
+{
+    NumNumbers = numNumbers;
+    NumThreads = ThreadPool::GlobalPool.NumThreads();
+    UsesAVX2 = SIMD_AVX2_ != 0;
+
+    // Philox4x32-10 test vectors from Random123's kat_vectors
+    struct KnownAnswer
+    {
+        uint32 Counter[4];
+        uint32 Key[2];
+        uint32 Result[4];
+    };
+
+    static const KnownAnswer KnownAnswers[] =
+    {
+        { { 0x00000000, 0x00000000, 0x00000000, 0x00000000 }, { 0x00000000, 0x00000000 },
+          { 0x6627E8D5, 0xE169C58D, 0xBC57AC4C, 0x9B00DBD8 } },
+        { { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF }, { 0xFFFFFFFF, 0xFFFFFFFF },
+          { 0x408F276D, 0x41C83B0E, 0xA20BC7C6, 0x6D5451FD } },
+        { { 0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344 }, { 0xA4093822, 0x299F31D0 },
+          { 0xD16CFE09, 0x94FDCCEB, 0x5001E420, 0x24126EA1 } },
+    };
+
+    KnownAnswersMatch = true;
+    for(uint64 i = 0; i < ARRAYSIZE(KnownAnswers); ++i)
+    {
+        uint32 result[4];
+        Philox4x32(KnownAnswers[i].Counter, KnownAnswers[i].Key, result);
+        for(uint32 j = 0; j < 4; ++j)
+            KnownAnswersMatch = KnownAnswersMatch && result[j] == KnownAnswers[i].Result[j];
+    }
+
+    const uint64 seed = 0x0123456789ABCDEFull;
+    const uint64 stream = Random::StreamIndex(7, 11);
+
+    std::vector<float> randFloatResults(numNumbers);
+    std::vector<uint32> scalarResults(numNumbers);
+    std::vector<uint32> batchResults(numNumbers);
+    std::vector<uint32> parallelResults(numNumbers);
+
+    Timer timer;
+
+    srand(0);
+    for(uint64 i = 0; i < numNumbers; ++i)
+        randFloatResults[i] = RandFloat();
+
+    timer.Update();
+    RandFloatSeconds = timer.DeltaSecondsD();
+
+    Random scalarRandom(seed, stream);
+    for(uint64 i = 0; i < numNumbers; ++i)
+        scalarResults[i] = scalarRandom.NextUInt();
+
+    timer.Update();
+    ScalarSeconds = timer.DeltaSecondsD();
+
+    // Starts one number into the stream, so that the batch has to pick up in the middle of a block
+    Random batchRandom(seed, stream);
+    if(numNumbers > 0)
+        batchResults[0] = batchRandom.NextUInt();
+    if(numNumbers > 1)
+        batchRandom.FillUInts(&batchResults[1], numNumbers - 1);
+
+    timer.Update();
+    BatchSeconds = timer.DeltaSecondsD();
+
+    const uint32 numTasks = uint32((numNumbers + RandomTaskSize - 1) / RandomTaskSize);
+    ThreadPool::GlobalPool.ParallelFor(numTasks, [&](uint32 taskIdx, uint32 threadIdx)
+    {
+        const uint64 start = taskIdx * RandomTaskSize;
+        Random random(seed, stream);
+        random.Seek(start);
+        random.FillUInts(&parallelResults[start], std::min(RandomTaskSize, numNumbers - start));
+    });
+
+    timer.Update();
+    ParallelSeconds = timer.DeltaSecondsD();
+
+    BatchMatches = batchResults == scalarResults;
+    ParallelMatches = parallelResults == scalarResults;
+}
+
+std::wstring RandomBenchmark::ToString() const
+{
+    auto rate = [&](double seconds)
+    {
+        return SampleFramework11::ToString(NumNumbers / std::max(seconds, 1e-9) / 1000000.0) + L"M numbers/s";
+    };
+
+    std::wstring text = L"Numbers: " + SampleFramework11::ToString(NumNumbers) + L", ";
+    text += SampleFramework11::ToString(NumThreads) + L" threads, ";
+    text += UsesAVX2 ? L"AVX2 batches\n" : L"scalar batches\n";
+    text += L"RandFloat: " + rate(RandFloatSeconds) + L"\n";
+    text += L"Philox one at a time: " + rate(ScalarSeconds) + L"\n";
+    text += L"Philox batched: " + rate(BatchSeconds) + L"\n";
+    text += L"Philox batched in parallel: " + rate(ParallelSeconds) + L"\n";
+    text += L"Known answers: " + std::wstring(KnownAnswersMatch ? L"match" : L"DON'T MATCH");
+    text += L", batched: " + std::wstring(BatchMatches ? L"matches" : L"DOESN'T MATCH");
+    text += L", parallel: " + std::wstring(ParallelMatches ? L"matches" : L"DOESN'T MATCH");
+    return text;
+}
\ No newline at end of file
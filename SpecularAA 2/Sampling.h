@@ -0,0 +1,96 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/Math.h"
+#include "SampleFramework11/Random.h"
+
+using namespace SampleFramework11;
+
+// CPU versions of the sample generators in Sampling.hlsl, plus white noise offsets like the
+// random ones that MeshRenderer used to upload for ShaderSSAA, so that they can be compared
+
+enum SampleSequence
+{
+    SampleSequenceWhiteNoise = 0,
+    SampleSequenceSobol,
+    SampleSequenceR2,
+
+    NumSampleSequences
+};
+
+const wchar* SampleSequenceName(SampleSequence sequence);
+
+uint32 ReverseBits(uint32 x);
+uint32 HashUInt(uint32 x);
+uint32 PixelSeed(uint32 x, uint32 y, uint32 sequenceSeed);
+uint32 LaineKarrasPermutation(uint32 x, uint32 seed);
+uint32 NestedUniformScramble(uint32 x, uint32 seed);
+
+// Owen-scrambled and shuffled Sobol point in [0, 1)^2, the same as the shader
+Float2 SobolSample(uint32 index, uint32 seed);
+
+// R2 point (Roberts, "The Unreasonable Effectiveness of Quasirandom Sequences") with a
+// per-seed toroidal shift, computed in 0.32 fixed point so that it's exact for any index
+Float2 R2Sample(uint32 index, uint32 seed);
+
+// Uniform angle and radius in the disc of radius 0.5
+Float2 SampleDiscOffset(const Float2& u);
+
+// Generates the samples of a single pixel, with the hashing of the pixel position and seed done
+// once up front instead of for every sample
+class PixelSampler
+{
+
+public:
+
+    PixelSampler(SampleSequence sequence, uint32 x, uint32 y, uint32 width, uint32 sequenceSeed);
+
+    // Offset in the disc of radius 0.5
+    Float2 Offset(uint32 sampleIdx) const;
+
+protected:
+
+    SampleSequence sequence;
+    uint32 sequenceSeed;
+    uint32 pixelIdx;
+    uint32 seed;
+    uint32 seedX;
+    uint32 seedY;
+};
+
+// Times Random one number at a time, in batches with FillUInts, and in parallel with every task
+// seeking to its own part of the stream, with RandFloat as the baseline. The three ways of using
+// Random have to give exactly the same numbers no matter how many threads there are, and Philox
+// has to match the known answers from Random123.
+struct RandomBenchmark
+{
+    uint64 NumNumbers;
+    uint32 NumThreads;
+    bool UsesAVX2;
+    bool KnownAnswersMatch;
+    bool BatchMatches;
+    bool ParallelMatches;
+
+    double RandFloatSeconds;
+    double ScalarSeconds;
+    double BatchSeconds;
+    double ParallelSeconds;
+
+    RandomBenchmark();
+
+    void Run(uint64 numNumbers);
+
+    bool Passed() const { return KnownAnswersMatch && BatchMatches && ParallelMatches; }
+    std::wstring ToString() const;
+};
\ No newline at end of file
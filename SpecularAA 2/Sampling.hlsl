@@ -0,0 +1,94 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+// Sample positions for ShaderSSAA, generated in the shader from the sample index and the pixel
+// position. Every pixel gets its own Owen-scrambled Sobol sequence (Burley, "Practical Hash-based
+// Owen Scrambling"), so the first 2^n samples of a pixel are always well stratified while
+// neighboring pixels stay uncorrelated. Sampling.cpp has the matching CPU versions.
+
+// ================================================================================================
+// Integer hash with good avalanche, from "Hash Functions for GPU Rendering"
+// ================================================================================================
+uint HashUInt(in uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint PixelSeed(in uint2 pixelPos, in uint sequenceSeed)
+{
+    return HashUInt(pixelPos.x + HashUInt(pixelPos.y + HashUInt(sequenceSeed)));
+}
+
+// ================================================================================================
+// Nested uniform scrambling, which is an Owen scramble of the bits of x
+// ================================================================================================
+uint LaineKarrasPermutation(in uint x, in uint seed)
+{
+    x += seed;
+    x ^= x * 0x6C50B47Cu;
+    x ^= x * 0xB82F1E52u;
+    x ^= x * 0xC7AFE638u;
+    x ^= x * 0x8D22F6E6u;
+    return x;
+}
+
+uint NestedUniformScramble(in uint x, in uint seed)
+{
+    return reversebits(LaineKarrasPermutation(reversebits(x), seed));
+}
+
+// Converts the top 24 bits to a float in [0, 1)
+float UIntToUnitFloat(in uint x)
+{
+    return (x >> 8) * (1.0f / 16777216.0f);
+}
+
+// ================================================================================================
+// 2D Owen-scrambled Sobol point. The index is shuffled with the same scramble, which keeps
+// every power-of-two prefix a (0, m, 2)-net.
+// ================================================================================================
+float2 SobolSample(in uint index, in uint seed)
+{
+    index = NestedUniformScramble(index, seed);
+
+    // The first dimension is the van der Corput sequence, which is the reversed index. The
+    // generator matrix of the second is Pascal's triangle mod 2, so by Lucas' theorem bit j of the
+    // reversed result is the XOR of the index bits whose positions contain all of the bits of j.
+    // The Owen scramble reverses the bits again before permuting them, so both dimensions skip
+    // the reversals and go straight to the permutation.
+    uint x = index;
+    uint y = index;
+    y ^= (y >> 1) & 0x55555555u;
+    y ^= (y >> 2) & 0x33333333u;
+    y ^= (y >> 4) & 0x0F0F0F0Fu;
+    y ^= (y >> 8) & 0x00FF00FFu;
+    y ^= (y >> 16) & 0x0000FFFFu;
+
+    x = reversebits(LaineKarrasPermutation(x, HashUInt(seed ^ 0x5BD1E995u)));
+    y = reversebits(LaineKarrasPermutation(y, HashUInt(seed ^ 0x1B873593u)));
+
+    return float2(UIntToUnitFloat(x), UIntToUnitFloat(y));
+}
+
+// ================================================================================================
+// Maps a point in [0, 1)^2 to an offset in the disc of radius 0.5, with a uniform angle and
+// radius like the random offsets this replaced
+// ================================================================================================
+float2 SampleDiscOffset(in float2 u)
+{
+    const float theta = u.x * Pi2;
+    const float r = u.y * 0.5f;
+    return float2(cos(theta), sin(theta)) * r;
+}
\ No newline at end of file
@@ -31,7 +31,11 @@ static const float Pi_4 = 0.7853981635f;
 static const float InvPi = 0.318309886f;
 static const float InvPi2 = 0.159154943f;
 
-static const uint NumSampleOffsets = 256 * 1024;
+// Ranges of the log-encoded values in the compact LEAN and vMF maps, see MapEncoding.hlsl
+static const float CompactVarianceLog2Min = -16.0f;
+static const float CompactVarianceLog2Max = 8.0f;
+static const float CompactKappaLog2Min = -10.0f;
+static const float CompactKappaLog2Max = 14.0f;
 
 #define NumVMFs_ 1
 static const uint NumVMFs = NumVMFs_;
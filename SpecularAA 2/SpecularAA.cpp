@@ -11,7 +11,9 @@
 #include "PCH.h"
 
 #include "SpecularAA.h"
+#include "CameraPresets.h"
 #include "SharedConstants.h"
+#include "Headless.h"
 
 #include "resource.h"
 #include "SampleFramework11/InterfacePointers.h"
@@ -24,6 +26,9 @@
 #include "SampleFramework11/Camera.h"
 #include "SampleFramework11/ShaderCompilation.h"
 #include "SampleFramework11/Profiler.h"
+#include "SampleFramework11/FileIO.h"
+
+#include <shellapi.h>
 
 using namespace SampleFramework11;
 using std::wstring;
@@ -37,8 +42,78 @@ static const float FarClip = 100.0f;
 static const float ModelScale = 1.0f;
 static const Float4x4 ModelWorldMatrix = XMMatrixScaling(ModelScale, ModelScale, ModelScale) * XMMatrixRotationY(XM_PI);
 
+static const float PathTimeStep = 1.0f / 60.0f;
+
+// The GUI object behind each CameraPathSetting, which is either a TextGUI or a Slider
+static TextGUI* const PathTextGUIs[NumCameraPathSettings] =
+{
+    &AppSettings::SpecularAAMode,
+    &AppSettings::NormalMap,
+    &AppSettings::SuperSamplingMode,
+    &AppSettings::SpecularBRDF,
+    &AppSettings::GeometricAAMode,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    &AppSettings::EnableDiffuse,
+    &AppSettings::EnableSpecular,
+    &AppSettings::VMFDiffuseAA,
+};
+
+static Slider* const PathSliders[NumCameraPathSettings] =
+{
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
+    &AppSettings::Roughness,
+    &AppSettings::ShaderSSSamples,
+    &AppSettings::SampleRadius,
+    &AppSettings::LEANScaleFactor,
+    NULL,
+    NULL,
+    NULL,
+};
+
+static float PathSettingValue(uint32 setting)
+{
+    if(PathTextGUIs[setting] != NULL)
+        return static_cast<float>(static_cast<uint32>(*PathTextGUIs[setting]));
+    return PathSliders[setting]->Value();
+}
+
+static void SetPathSetting(uint32 setting, float value)
+{
+    if(PathTextGUIs[setting] != NULL)
+        PathTextGUIs[setting]->SetValue(static_cast<uint32>(value));
+    else
+        PathSliders[setting]->SetValue(value);
+}
+
+// The argument that follows name on the command line, or an empty string
+static wstring CommandLineOption(const wchar* name)
+{
+    int numArgs = 0;
+    wchar** args = CommandLineToArgvW(GetCommandLineW(), &numArgs);
+    if(args == NULL)
+        return wstring();
+
+    wstring value;
+    for(int i = 0; i + 1 < numArgs; ++i)
+        if(_wcsicmp(args[i], name) == 0)
+            value = args[i + 1];
+
+    LocalFree(args);
+    return value;
+}
+
 SpecularAA::SpecularAA() :  App(L"Specular AA", MAKEINTRESOURCEW(IDI_DEFAULT)),
-    camera(16.0f / 9.0f, Pi_4 * 0.75f, NearClip, FarClip)
+    camera(16.0f / 9.0f, Pi_4 * 0.75f, NearClip, FarClip), validateCPUBake(false),
+    benchmarkGeometricAA(false), geometricAABenchmarked(false), saveHDRScreenshot(false),
+    pathFile(L"CameraPath.campath"), replayingPath(false), replayFrame(0), replaySeconds(0.0), replayMaxSeconds(0.0),
+    frameDelta(0.0f)
 {
     deviceManager.SetMinFeatureLevel(D3D_FEATURE_LEVEL_11_0);
 }
@@ -86,25 +161,39 @@ void SpecularAA::LoadContent()
     font.Initialize(L"Arial", 18, SpriteFont::Regular, true, device);
     spriteRenderer.Initialize(device);
 
-    // Camera setup
-    camera.SetPosition(Float3(0, 1.0f, -10.0f));
-
-    // Overhead testing position for comparison image generation
-    // camera.SetPosition(Float3(0, 20.0f, 0.0f));
-    // camera.SetXRotation(Pi_2);
+    // Camera setup. Use CameraPresetOverhead or CameraPresetGrazing for comparison image generation.
+    ApplyCameraPreset(CameraPresetDefault, camera);
 
-    // Grazing angle position for comparison image generation
-    // camera.SetPosition(Float3(-2.88731456f, 0.619826376f, -6.39299107f));
-    // camera.SetXRotation(0.0616500117f);
-    // camera.SetYRotation(0.472924948f);
-
-    // Load the tank scene
-    model.GeneratePlaneScene(device, Float2(5.0f, 5.0f), Float3(), Quaternion());
+    // Load the tank scene. The plane is flat, so the curved test scene can be loaded instead
+    // for trying out the geometric AA modes.
+    if(wcsstr(GetCommandLineW(), L"-testscene") != NULL)
+        model.CreateFromSDKMeshFile(device, L"..\\Content\\Models\\TestScene\\TestScene.sdkmesh", NULL, true);
+    else
+        model.GeneratePlaneScene(device, Float2(5.0f, 5.0f), Float3(), Quaternion());
     meshRenderer.Initialize(device, deviceManager.ImmediateContext(), &model, SunDirection, SunColor, ModelWorldMatrix);
+
+    // Compare the CPU baker against the GPU maps whenever they're regenerated
+    validateCPUBake = wcsstr(GetCommandLineW(), L"-validatebake") != NULL;
+    if(validateCPUBake)
+        meshRenderer.ValidateCPUBake(deviceManager.ImmediateContext());
     skybox.Initialize(device);
 
     // Init the post processor
     postProcessor.Initialize(device);
+
+    // "-recordpath file" records from the first frame, and "-playpath file" replays a recording
+    const wstring recordPath = CommandLineOption(L"-recordpath");
+    const wstring playPath = CommandLineOption(L"-playpath");
+    if(playPath.length() > 0)
+    {
+        pathFile = playPath;
+        StartPathReplay();
+    }
+    else if(recordPath.length() > 0)
+    {
+        pathFile = recordPath;
+        pathRecorder.Start(pathFile.c_str(), PathTimeStep);
+    }
 }
 
 // Creates all required render targets
@@ -128,9 +217,37 @@ void SpecularAA::Update(const Timer& timer)
     if (kbState.IsKeyDown(KeyboardState::Escape))
         window.Destroy();
 
-    float CamMoveSpeed = 5.0f * timer.DeltaSecondsF();
-    const float CamRotSpeed = 0.180f * timer.DeltaSecondsF();
-    const float MeshRotSpeed = 0.180f * timer.DeltaSecondsF();
+    // Record a camera path with F5, and replay the last one with F6
+    if(kbState.RisingEdge(KeyboardState::F5))
+    {
+        if(pathRecorder.Recording())
+        {
+            pathRecorder.Stop();
+            DebugPrint(L"Recorded " + ToString(pathRecorder.NumFrames()) + L" frames to " + pathFile);
+        }
+        else
+        {
+            replayingPath = false;
+            pathRecorder.Start(pathFile.c_str(), PathTimeStep);
+        }
+    }
+    else if(kbState.RisingEdge(KeyboardState::F6) && FileExists(pathFile.c_str()))
+    {
+        pathRecorder.Stop();
+        StartPathReplay();
+    }
+
+    // Recording and replay run at the fixed timestep of the path instead of the frame time, so
+    // that every replayed frame matches the one that was recorded
+    frameDelta = timer.DeltaSecondsF();
+    if(pathRecorder.Recording())
+        frameDelta = pathRecorder.TimeStep();
+    else if(replayingPath)
+        frameDelta = cameraPath.TimeStep();
+
+    float CamMoveSpeed = 5.0f * frameDelta;
+    const float CamRotSpeed = 0.180f * frameDelta;
+    const float MeshRotSpeed = 0.180f * frameDelta;
 
     // Move the camera with keyboard input
     if(kbState.IsKeyDown(KeyboardState::LeftShift))
@@ -166,31 +283,116 @@ void SpecularAA::Update(const Timer& timer)
     if(kbState.RisingEdge(KeyboardState::V))
         deviceManager.SetVSYNCEnabled(!deviceManager.VSYNCEnabled());
 
+    // Time the geometric AA modes against each other on the next frame
+    if(kbState.RisingEdge(KeyboardState::T))
+        benchmarkGeometricAA = true;
+
+    // Save this frame to HDRScreenshot.pfm, before post-processing
+    if(kbState.RisingEdge(KeyboardState::F7))
+        saveHDRScreenshot = true;
+
     AppSettings::Update(kbState, mouseState);
+
+    // The settings of a replayed frame are applied after the GUI, so that the renderer sees them
+    // as changed
+    if(pathRecorder.Recording())
+        RecordPathFrame();
+    else if(replayingPath)
+        ReplayPathFrame(timer);
+}
+
+void SpecularAA::StartPathReplay()
+{
+    cameraPath.LoadFromFile(pathFile.c_str());
+    replayingPath = cameraPath.NumFrames() > 0;
+    replayFrame = 0;
+    replaySeconds = 0.0;
+    replayMaxSeconds = 0.0;
+}
+
+// Writes the camera and every setting that changed since the last frame. The first frame has
+// all of them.
+void SpecularAA::RecordPathFrame()
+{
+    CameraPathSettingChange changes[NumCameraPathSettings];
+    uint32 numChanges = 0;
+    for(uint32 i = 0; i < NumCameraPathSettings; ++i)
+    {
+        const float value = PathSettingValue(i);
+        if(pathRecorder.NumFrames() == 0 || value != recordedSettings[i])
+        {
+            changes[numChanges].Setting = i;
+            changes[numChanges].Value = value;
+            ++numChanges;
+            recordedSettings[i] = value;
+        }
+    }
+
+    pathRecorder.RecordFrame(camera, changes, numChanges);
+}
+
+void SpecularAA::ReplayPathFrame(const Timer& timer)
+{
+    // The time it took to get here from the last replayed frame
+    if(replayFrame > 0)
+    {
+        replaySeconds += timer.DeltaSecondsD();
+        replayMaxSeconds = std::max(replayMaxSeconds, timer.DeltaSecondsD());
+    }
+
+    cameraPath.ApplyFrame(replayFrame, camera);
+
+    const CameraPathFrame& frame = cameraPath.Frame(replayFrame);
+    for(uint32 i = 0; i < frame.NumSettingChanges; ++i)
+    {
+        const CameraPathSettingChange& change = cameraPath.SettingChange(frame.FirstSettingChange + i);
+        SetPathSetting(change.Setting, change.Value);
+    }
+
+    ++replayFrame;
+    if(replayFrame == cameraPath.NumFrames())
+    {
+        replayingPath = false;
+        const uint32 numTimed = std::max<uint32>(replayFrame - 1, 1);
+        DebugPrint(L"Replayed " + ToString(replayFrame) + L" frames from " + pathFile + L": "
+                   + ToString(replaySeconds * 1000.0 / numTimed) + L"ms average, "
+                   + ToString(replayMaxSeconds * 1000.0) + L"ms max");
+    }
 }
 
 void SpecularAA::Render(const Timer& timer)
 {
     ID3D11DeviceContextPtr context = deviceManager.ImmediateContext();
 
+    bool mapsChanged = true;
     if(AppSettings::NormalMap.Changed())
     {
         meshRenderer.CreateMaps();
-        meshRenderer.GenerateMaps(context);
-        meshRenderer.GenerateLEANMap(context);
+        meshRenderer.LoadMaps(context);
     }
     else if(AppSettings::LEANScaleFactor.Changed())
+    {
         meshRenderer.GenerateLEANMap(context);
-    else if((AppSettings::SpecularAAMode == SpecularAAModeGUI::PrecomputedToksvig ||
-        AppSettings::SpecularAAMode == SpecularAAModeGUI::PrecomputedVMF)
-        && AppSettings::Roughness.Changed())
-        meshRenderer.GenerateMaps(context);
+        meshRenderer.InvalidateCompactMaps();
+        meshRenderer.InvalidateCompressedMaps();
+    }
+    else
+        mapsChanged = false;
+
+    if(mapsChanged && validateCPUBake)
+        meshRenderer.ValidateCPUBake(context);
 
     RenderMainPass();
 
     if(AppSettings::MSAAMode)
         context->ResolveSubresource(colorTarget.Texture, 0, colorTargetMSAA.Texture, 0, colorTargetMSAA.Format);
 
+    if(saveHDRScreenshot)
+    {
+        SaveHDRScreenshot(colorTarget.Texture, L"HDRScreenshot.pfm");
+        saveHDRScreenshot = false;
+    }
+
     // Kick off post-processing
     D3DPERF_BeginEvent(0xFFFFFFFF, L"Post Processing");
     PostProcessor::Constants constants;
@@ -199,7 +401,7 @@ void SpecularAA::Render(const Timer& timer)
     constants.BloomBlurSigma = AppSettings::BloomBlurSigma;
     constants.Tau = AppSettings::AdaptationRate;
     constants.KeyValue = AppSettings::KeyValue;
-    constants.TimeDelta = timer.DeltaSecondsF();
+    constants.TimeDelta = frameDelta;
 
     postProcessor.SetConstants(constants);
     postProcessor.Render(context, colorTarget.SRView, deviceManager.BackBuffer());
@@ -253,7 +455,14 @@ void SpecularAA::RenderModel()
     ID3D11DeviceContext* context = deviceManager.ImmediateContext();
 
     // meshRenderer.RenderDepth(context, camera, ModelWorldMatrix);
-    meshRenderer.Render(context, camera, ModelWorldMatrix, Uint2(colorTarget.Width, colorTarget.Height));
+    if(benchmarkGeometricAA)
+    {
+        meshRenderer.BenchmarkGeometricAA(context, camera, ModelWorldMatrix, Uint2(colorTarget.Width, colorTarget.Height));
+        benchmarkGeometricAA = false;
+        geometricAABenchmarked = true;
+    }
+    else
+        meshRenderer.Render(context, camera, ModelWorldMatrix, Uint2(colorTarget.Width, colorTarget.Height));
 
     skybox.RenderSky(context, SunDirection, true, camera.ViewMatrix(), camera.ProjectionMatrix());
 }
@@ -276,6 +485,39 @@ void SpecularAA::RenderHUD()
     vsyncText += deviceManager.VSYNCEnabled() ? L"Enabled" : L"Disabled";
     spriteRenderer.RenderText(font, vsyncText.c_str(), transform, XMFLOAT4(1, 1, 0, 1));
 
+    transform._42 += 25.0f;
+    wstring cacheText(L"Map Cache: ");
+    cacheText += meshRenderer.CacheStats().ToString();
+    spriteRenderer.RenderText(font, cacheText.c_str(), transform, XMFLOAT4(1, 1, 0, 1));
+
+    transform._42 += 25.0f;
+    wstring benchmarkText(L"Geometric AA Benchmark (T): ");
+    if(geometricAABenchmarked)
+    {
+        for(uint32 i = 0; i < GeometricAAModeGUI::NumValues; ++i)
+        {
+            benchmarkText += i > 0 ? L", " : L"";
+            benchmarkText += GeometricAAModeGUI::Names[i];
+            benchmarkText += L" " + ToString(meshRenderer.GeometricAATiming(i)) + L"ms";
+        }
+    }
+    else
+        benchmarkText += L"Not Run";
+    spriteRenderer.RenderText(font, benchmarkText.c_str(), transform, XMFLOAT4(1, 1, 0, 1));
+
+    transform._42 += 25.0f;
+    wstring pathText(L"Camera Path (F5/F6): ");
+    if(pathRecorder.Recording())
+        pathText += L"Recording frame " + ToString(pathRecorder.NumFrames());
+    else if(replayingPath)
+        pathText += L"Replaying frame " + ToString(replayFrame) + L"/" + ToString(cameraPath.NumFrames());
+    else if(replayFrame > 1)
+        pathText += L"Replayed " + ToString(replayFrame) + L" frames, "
+                    + ToString(replaySeconds * 1000.0 / (replayFrame - 1)) + L"ms average";
+    else
+        pathText += L"Idle";
+    spriteRenderer.RenderText(font, pathText.c_str(), transform, XMFLOAT4(1, 1, 0, 1));
+
     Profiler::GlobalProfiler.EndFrame(spriteRenderer, font);
 
     spriteRenderer.End();
@@ -283,6 +525,10 @@ void SpecularAA::RenderHUD()
 
 int APIENTRY wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
 {
+    int32 exitCode = 0;
+    if(Headless::Run(lpCmdLine, exitCode))
+        return exitCode;
+
     SpecularAA app;
     app.Run();
 }
\ No newline at end of file
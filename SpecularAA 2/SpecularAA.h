@@ -24,6 +24,7 @@
 
 #include "PostProcessor.h"
 #include "MeshRenderer.h"
+#include "CameraPath.h"
 
 using namespace SampleFramework11;
 
@@ -48,6 +49,22 @@ protected:
     Model model;
     MeshRenderer meshRenderer;
 
+    bool validateCPUBake;
+    bool benchmarkGeometricAA;
+    bool geometricAABenchmarked;
+    bool saveHDRScreenshot;
+
+    // Camera path recording (F5) and replay (F6)
+    CameraPathRecorder pathRecorder;
+    CameraPath cameraPath;
+    std::wstring pathFile;
+    float recordedSettings[NumCameraPathSettings];
+    bool replayingPath;
+    uint32 replayFrame;
+    double replaySeconds;
+    double replayMaxSeconds;
+    float frameDelta;
+
     virtual void LoadContent();
     virtual void Render(const Timer& timer);
     virtual void Update(const Timer& timer);
@@ -62,6 +79,10 @@ protected:
     void RenderMainPass();
     void RenderHUD();
 
+    void StartPathReplay();
+    void RecordPathFrame();
+    void ReplayPathFrame(const Timer& timer);
+
 public:
 
     SpecularAA();
@@ -0,0 +1,248 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "TemporalShimmer.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/Timer.h"
+
+static float ToneMappedLuminance(const Float4& color, float exposure)
+{
+    const float luminance = (color.x * 0.2126f + color.y * 0.7152f + color.z * 0.0722f) * exposure;
+    return luminance / (1.0f + luminance);
+}
+
+TemporalShimmerBenchmark::TemporalShimmerBenchmark() : seconds(0.0)
+{
+}
+
+void TemporalShimmerBenchmark::Run(const TemporalShimmerSettings& settings, const ReferenceRenderer& renderer,
+                                   const ReferenceScene& scene, const CameraPath& path)
+{
+    results.clear();
+    referenceLuminance.clear();
+
+    // The reference goes first, so that the others can be compared against it
+    std::vector<Result> configurations;
+    Result config = Result();
+    if(settings.ReferenceSamples > 0)
+    {
+        config.Mode = ShadingModeDisabled;
+        config.Supersampling = SupersamplingUniform;
+        config.Reference = true;
+        configurations.push_back(config);
+        config.Reference = false;
+    }
+
+    for(uint32 mode = 0; mode < NumShadingModes; ++mode)
+    {
+        config.Mode = ShadingMode(mode);
+        config.Supersampling = SupersamplingDisabled;
+        configurations.push_back(config);
+    }
+
+    config.Mode = ShadingModeDisabled;
+    config.Supersampling = SupersamplingUniform;
+    configurations.push_back(config);
+    config.Supersampling = SupersamplingTextureSpace;
+    configurations.push_back(config);
+
+    Timer timer;
+    for(uint64 i = 0; i < configurations.size(); ++i)
+    {
+        results.push_back(configurations[i]);
+        RunConfiguration(settings, renderer, scene, path, results.back());
+
+        if(results.back().Reference)
+            referenceLuminance.swap(frameLuminance);
+    }
+
+    timer.Update();
+    seconds = timer.ElapsedSecondsD();
+}
+
+void TemporalShimmerBenchmark::RunConfiguration(const TemporalShimmerSettings& settings, const ReferenceRenderer& renderer,
+                                                const ReferenceScene& scene, const CameraPath& path, Result& result)
+{
+    ReferenceSettings renderSettings = settings.Shading;
+    renderSettings.Mode = result.Mode;
+    renderSettings.Supersampling = result.Supersampling;
+    renderSettings.Sequence = SampleSequenceSobol;
+    renderSettings.SequenceSeed = result.Reference ? 1 : 0;
+    renderSettings.UniformSamples = result.Reference ? settings.ReferenceSamples : settings.ShaderSSSamples;
+    if(result.Reference)
+        renderSettings.GeometricAA = GeometricAADisabled;
+
+    const uint32 numFrames = path.NumFrames();
+    const uint32 numPixels = settings.Width * settings.Height;
+    frameLuminance.resize(uint64(numFrames) * numPixels);
+
+    // One frame per task, so each frame is rendered on a single thread
+    std::vector<ReferenceStats> frameStats(numFrames);
+    ThreadPool::GlobalPool.ParallelFor(numFrames, [&](uint32 frameIdx, uint32 threadIdx)
+    {
+        FirstPersonCamera camera(float(settings.Width) / settings.Height, Pi_4 * 0.75f, 0.01f, 100.0f);
+        path.ApplyFrame(frameIdx, camera);
+
+        HDRImage image;
+        image.Initialize(settings.Width, settings.Height);
+        renderer.Render(scene, camera, renderSettings, image, frameStats[frameIdx]);
+
+        float* luminance = &frameLuminance[uint64(frameIdx) * numPixels];
+        for(uint32 i = 0; i < numPixels; ++i)
+            luminance[i] = ToneMappedLuminance(image.Pixels[i], settings.Exposure);
+    });
+
+    double renderSeconds = 0.0;
+    uint64 numShaded = 0;
+    uint64 numRendered = 0;
+    for(uint32 frameIdx = 0; frameIdx < numFrames; ++frameIdx)
+    {
+        const ReferenceStats& stats = frameStats[frameIdx];
+        renderSeconds += stats.Seconds;
+        numShaded += stats.NumSamples > 0 ? stats.NumSamples : stats.NumHits;
+        numRendered += stats.NumPixels;
+    }
+
+    result.SecondsPerFrame = renderSeconds / std::max<uint32>(numFrames, 1);
+    result.ShadedPerPixel = double(numShaded) / std::max<uint64>(numRendered, 1);
+
+    // Per-pixel statistics over the frames, one row per task. The frames are the outer loop so
+    // that each row is read contiguously.
+    const bool hasReference = referenceLuminance.size() > 0;
+    result.Map.Initialize(settings.Width, settings.Height);
+    std::vector<double> rowVariance(settings.Height);
+    std::vector<double> rowSquaredDifference(settings.Height);
+    std::vector<double> rowSquaredError(settings.Height);
+    ThreadPool::GlobalPool.ParallelFor(settings.Height, [&](uint32 y, uint32 threadIdx)
+    {
+        std::vector<double> mean(settings.Width, 0.0);
+        std::vector<double> m2(settings.Width, 0.0);
+        std::vector<double> squaredDifference(settings.Width, 0.0);
+        std::vector<double> squaredError(settings.Width, 0.0);
+        for(uint32 frameIdx = 0; frameIdx < numFrames; ++frameIdx)
+        {
+            const uint64 rowOffset = uint64(y) * settings.Width;
+            const uint64 offset = uint64(frameIdx) * numPixels + rowOffset;
+            const uint64 prevOffset = uint64(std::max<uint32>(frameIdx, 1) - 1) * numPixels + rowOffset;
+            const uint64 prevPrevOffset = uint64(std::max<uint32>(frameIdx, 2) - 2) * numPixels + rowOffset;
+            const float* luminance = &frameLuminance[offset];
+            const float* prev = &frameLuminance[prevOffset];
+            const float* prevPrev = &frameLuminance[prevPrevOffset];
+            for(uint32 x = 0; x < settings.Width; ++x)
+            {
+                // Welford's algorithm
+                const double value = luminance[x];
+                const double delta = value - mean[x];
+                mean[x] += delta / (frameIdx + 1);
+                m2[x] += delta * (value - mean[x]);
+
+                if(frameIdx >= 2)
+                {
+                    const double difference = value - 2.0 * prev[x] + prevPrev[x];
+                    squaredDifference[x] += difference * difference;
+                }
+            }
+
+            if(hasReference && frameIdx >= 1)
+            {
+                const float* reference = &referenceLuminance[offset];
+                const float* referencePrev = &referenceLuminance[prevOffset];
+                for(uint32 x = 0; x < settings.Width; ++x)
+                {
+                    const double error = (luminance[x] - prev[x]) - (reference[x] - referencePrev[x]);
+                    squaredError[x] += error * error;
+                }
+            }
+        }
+
+        double varianceSum = 0.0;
+        double squaredDifferenceSum = 0.0;
+        double squaredErrorSum = 0.0;
+        for(uint32 x = 0; x < settings.Width; ++x)
+        {
+            const double variance = numFrames > 1 ? m2[x] / (numFrames - 1) : 0.0;
+            const double flicker = numFrames > 2 ? std::sqrt(squaredDifference[x] / (numFrames - 2)) : 0.0;
+            const double temporalError = numFrames > 1 ? std::sqrt(squaredError[x] / (numFrames - 1)) : 0.0;
+            result.Map.Pixel(x, y) = Float4(float(variance), float(flicker), float(mean[x]), float(temporalError));
+
+            varianceSum += variance;
+            squaredDifferenceSum += squaredDifference[x];
+            squaredErrorSum += squaredError[x];
+        }
+
+        rowVariance[y] = varianceSum;
+        rowSquaredDifference[y] = squaredDifferenceSum;
+        rowSquaredError[y] = squaredErrorSum;
+    });
+
+    double varianceSum = 0.0;
+    double squaredDifferenceSum = 0.0;
+    double squaredErrorSum = 0.0;
+    for(uint32 y = 0; y < settings.Height; ++y)
+    {
+        varianceSum += rowVariance[y];
+        squaredDifferenceSum += rowSquaredDifference[y];
+        squaredErrorSum += rowSquaredError[y];
+    }
+
+    result.MeanVariance = varianceSum / std::max<uint32>(numPixels, 1);
+    const uint64 numDifferences = numFrames > 2 ? uint64(numFrames - 2) * numPixels : 0;
+    result.Flicker = numDifferences > 0 ? std::sqrt(squaredDifferenceSum / numDifferences) : 0.0;
+    const uint64 numErrors = numFrames > 1 ? uint64(numFrames - 1) * numPixels : 0;
+    result.TemporalError = hasReference && numErrors > 0 ? std::sqrt(squaredErrorSum / numErrors) : 0.0;
+}
+
+std::wstring TemporalShimmerBenchmark::Name(const Result& result)
+{
+    if(result.Reference)
+        return L"Reference";
+    else if(result.Supersampling != SupersamplingDisabled)
+        return SupersamplingModeName(result.Supersampling);
+    return ShadingModeName(result.Mode);
+}
+
+std::string TemporalShimmerBenchmark::ToCSV() const
+{
+    std::string csv = "configuration,mode,supersampling,ms_per_frame,shaded_per_pixel,mean_variance,flicker,temporal_error\n";
+    for(uint64 i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        const std::wstring name = Name(r);
+        const std::wstring mode = ShadingModeName(r.Mode);
+        const std::wstring supersampling = SupersamplingModeName(r.Supersampling);
+        csv += std::string(name.begin(), name.end()) + "," + std::string(mode.begin(), mode.end()) + ",";
+        csv += std::string(supersampling.begin(), supersampling.end()) + "," + ToAnsiString(r.SecondsPerFrame * 1000.0) + ",";
+        csv += ToAnsiString(r.ShadedPerPixel) + "," + ToAnsiString(r.MeanVariance) + "," + ToAnsiString(r.Flicker) + ",";
+        csv += ToAnsiString(r.TemporalError) + "\n";
+    }
+
+    return csv;
+}
+
+std::wstring TemporalShimmerBenchmark::ToString() const
+{
+    std::wstring text;
+    for(uint64 i = 0; i < results.size(); ++i)
+    {
+        const Result& r = results[i];
+        text += (i > 0 ? L"\n" : L"") + Name(r) + L": " + SampleFramework11::ToString(r.SecondsPerFrame * 1000.0);
+        text += L"ms/frame, " + SampleFramework11::ToString(r.ShadedPerPixel) + L" shaded/pixel, variance ";
+        text += SampleFramework11::ToString(r.MeanVariance) + L", flicker " + SampleFramework11::ToString(r.Flicker);
+        if(r.TemporalError > 0.0)
+            text += L", temporal error " + SampleFramework11::ToString(r.TemporalError);
+    }
+
+    return text;
+}
\ No newline at end of file
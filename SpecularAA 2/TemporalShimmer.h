@@ -0,0 +1,94 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "ReferenceRenderer.h"
+#include "CameraPath.h"
+
+using namespace SampleFramework11;
+
+struct TemporalShimmerSettings
+{
+    ReferenceSettings Shading;          // The mode and supersampling are set for each configuration
+    uint32 Width;
+    uint32 Height;
+    uint32 ShaderSSSamples;             // Samples along each axis for ShaderSSAA
+    uint32 ReferenceSamples;            // Samples along each axis for the reference, or 0 to skip it
+    float Exposure;                     // Scales the luminance before tone mapping
+
+    TemporalShimmerSettings() : Width(320), Height(180), ShaderSSSamples(4), ReferenceSamples(8), Exposure(1.0f)
+    {
+    }
+};
+
+// Renders every frame of a CameraPath with each shading mode, with the GUI's supersampling modes
+// on top of no specular AA, and with a supersampled reference. The luminance of each pixel is
+// tone mapped with L / (1 + L) so that the highlights don't swamp the rest of the image, and
+// then two things are measured over the frames:
+//
+//  - The temporal variance of each pixel, which includes the change that comes from the motion
+//  - The second difference y[t + 1] - 2 * y[t] + y[t - 1], which cancels out change that's
+//    linear in time. A slowly moving camera changes a smooth image almost linearly from one
+//    frame to the next, so what's left is mostly flicker. Its RMS over every pixel and frame is
+//    the flicker score.
+//  - The temporal error, which is the RMS of the difference between the frame-to-frame change
+//    of each pixel and the change of the same pixel in the reference. Detail that the reference
+//    resolves also moves under the pixels, so this separates shimmer from the texture itself.
+//
+// Each frame only depends on the path, so the frames of a configuration are rendered in parallel
+// with one per ThreadPool task.
+class TemporalShimmerBenchmark
+{
+
+public:
+
+    struct Result
+    {
+        ShadingMode Mode;
+        SupersamplingMode Supersampling;
+        bool Reference;
+
+        double SecondsPerFrame;         // Rendering one frame on one thread
+        double ShadedPerPixel;          // Shaded hits, samples, or lighting texels per pixel
+        double MeanVariance;            // Temporal variance of the tone mapped luminance, averaged over the pixels
+        double Flicker;                 // RMS of the second difference
+        double TemporalError;           // RMS of the change relative to the reference, or 0 without one
+
+        // Per-pixel temporal variance in x, RMS second difference in y, mean tone mapped
+        // luminance in z, and temporal error in w
+        HDRImage Map;
+    };
+
+    TemporalShimmerBenchmark();
+
+    void Run(const TemporalShimmerSettings& settings, const ReferenceRenderer& renderer, const ReferenceScene& scene,
+             const CameraPath& path);
+
+    const std::vector<Result>& Results() const { return results; }
+    double Seconds() const { return seconds; }
+
+    static std::wstring Name(const Result& result);
+
+    std::string ToCSV() const;
+    std::wstring ToString() const;
+
+protected:
+
+    void RunConfiguration(const TemporalShimmerSettings& settings, const ReferenceRenderer& renderer,
+                          const ReferenceScene& scene, const CameraPath& path, Result& result);
+
+    std::vector<Result> results;
+    std::vector<float> frameLuminance;
+    std::vector<float> referenceLuminance;
+    double seconds;
+};
\ No newline at end of file
@@ -0,0 +1,524 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "TextureSampler.h"
+#include "ReferenceRenderer.h"
+#include "SharedConstants.h"
+
+#include "SampleFramework11/Exceptions.h"
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/Timer.h"
+#include "SampleFramework11/Random.h"
+
+const wchar* TextureFilterName(TextureFilter filter)
+{
+    static const wchar* Names[NumTextureFilters] = { L"Bilinear", L"Trilinear", L"Aniso" };
+    return Names[filter];
+}
+
+const wchar* TexelLayoutName(TexelLayout layout)
+{
+    static const wchar* Names[NumTexelLayouts] = { L"Linear", L"Morton" };
+    return Names[layout];
+}
+
+void TextureSampleBatch::Resize(uint32 count)
+{
+    Count = count;
+    for(uint32 i = 0; i < NumChannels; ++i)
+        Data[i].resize(count);
+}
+
+void TextureSampleResults::Resize(uint32 count, uint32 numChannels)
+{
+    Count = count;
+    NumChannels = numChannels;
+    for(uint32 i = 0; i < 4; ++i)
+        Data[i].resize(i < numChannels ? count : 0);
+}
+
+// Number of channels that a format stores, which is how many are kept after decoding
+static uint32 NumFormatChannels(DXGI_FORMAT format)
+{
+    switch(format)
+    {
+        case DXGI_FORMAT_R16G16_UNORM:
+        case DXGI_FORMAT_R16G16_SNORM:
+        case DXGI_FORMAT_BC5_UNORM:
+        case DXGI_FORMAT_BC5_SNORM:
+            return 2;
+        case DXGI_FORMAT_R11G11B10_FLOAT:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+            return 3;
+        case DXGI_FORMAT_BC4_UNORM:
+        case DXGI_FORMAT_BC4_SNORM:
+            return 1;
+        default:
+            return 4;
+    }
+}
+
+// Texel within a mip level, where rowSize is in tiles for the Morton layout
+static uint32 LocalTexelIndex(TexelLayout layout, uint32 x, uint32 y, uint32 rowSize)
+{
+    if(layout == TexelLayoutLinear)
+        return y * rowSize + x;
+
+    const uint32 tile = (y / TiledTexture::TileSize) * rowSize + (x / TiledTexture::TileSize);
+    const uint32 morton = (x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2);
+    return tile * TiledTexture::TileSize * TiledTexture::TileSize + morton;
+}
+
+//=================================================================================================
+// TiledTexture
+//=================================================================================================
+
+TiledTexture::TiledTexture() : width(0), height(0), numChannels(0), layout(TexelLayoutMorton)
+{
+}
+
+void TiledTexture::Initialize(const BakedTexture& texture, uint32 arraySlice, TexelLayout layout_)
+{
+    width = texture.Width;
+    height = texture.Height;
+    numChannels = NumFormatChannels(texture.Format);
+    layout = layout_;
+
+    const uint32 numMipLevels = texture.NumMipLevels;
+    mipWidths.resize(numMipLevels);
+    mipHeights.resize(numMipLevels);
+    mipRowSizes.resize(numMipLevels);
+    mipOffsets.resize(numMipLevels);
+
+    // Partial tiles at the edges of the Morton layout are padded
+    uint64 numTexels = 0;
+    for(uint32 mipLevel = 0; mipLevel < numMipLevels; ++mipLevel)
+    {
+        const uint32 mipWidth = texture.MipWidth(mipLevel);
+        const uint32 mipHeight = texture.MipHeight(mipLevel);
+        mipWidths[mipLevel] = int32(mipWidth);
+        mipHeights[mipLevel] = int32(mipHeight);
+        mipOffsets[mipLevel] = int32(numTexels);
+
+        if(layout == TexelLayoutMorton)
+        {
+            const uint32 tilesX = (mipWidth + TileSize - 1) / TileSize;
+            const uint32 tilesY = (mipHeight + TileSize - 1) / TileSize;
+            mipRowSizes[mipLevel] = int32(tilesX);
+            numTexels += uint64(tilesX) * tilesY * TileSize * TileSize;
+        }
+        else
+        {
+            mipRowSizes[mipLevel] = int32(mipWidth);
+            numTexels += uint64(mipWidth) * mipHeight;
+        }
+    }
+
+    // The gathers take int32 indices
+    if(numTexels * numChannels > 0x7FFFFFFF)
+        throw Exception(L"Texture is too large to sample on the CPU");
+
+    texels.clear();
+    texels.resize(numTexels * numChannels, 0.0f);
+
+    for(uint32 mipLevel = 0; mipLevel < numMipLevels; ++mipLevel)
+    {
+        const uint32 mipWidth = uint32(mipWidths[mipLevel]);
+        ThreadPool::GlobalPool.ParallelFor(uint32(mipHeights[mipLevel]), [&](uint32 y, uint32 threadIdx)
+        {
+            for(uint32 x = 0; x < mipWidth; ++x)
+            {
+                const Float4 texel = texture.Texel(mipLevel, arraySlice, x, y);
+                const uint64 idx = uint64(mipOffsets[mipLevel]) + LocalTexelIndex(layout, x, y, mipRowSizes[mipLevel]);
+                float* dst = &texels[idx * numChannels];
+                for(uint32 c = 0; c < numChannels; ++c)
+                    dst[c] = (&texel.x)[c];
+            }
+        });
+    }
+}
+
+Float4 TiledTexture::Texel(uint32 mipLevel, uint32 x, uint32 y) const
+{
+    const uint64 idx = uint64(mipOffsets[mipLevel]) + LocalTexelIndex(layout, x, y, mipRowSizes[mipLevel]);
+    Float4 texel(0.0f, 0.0f, 0.0f, 1.0f);
+    for(uint32 c = 0; c < numChannels; ++c)
+        (&texel.x)[c] = texels[idx * numChannels + c];
+    return texel;
+}
+
+Int8 TiledTexture::TexelIndex(const Int8& x, const Int8& y, const Int8& rowSize, const Int8& offset) const
+{
+    Int8 local;
+    if(layout == TexelLayoutMorton)
+    {
+        const Int8 tile = (y >> 2) * rowSize + (x >> 2);
+        const Int8 morton = (x & 1) | ((y & 1) << 1) | ((x & 2) << 1) | ((y & 2) << 2);
+        local = (tile << 4) | morton;
+    }
+    else
+    {
+        local = y * rowSize + x;
+    }
+
+    return (offset + local) * Int8(int32(numChannels));
+}
+
+void TiledTexture::SampleBilinear(const Float8& u, const Float8& v, const Int8& mipLevel, Float8* results) const
+{
+    const Int8 mipWidth = Int8::Gather(mipWidths.data(), mipLevel);
+    const Int8 mipHeight = Int8::Gather(mipHeights.data(), mipLevel);
+    const Int8 rowSize = Int8::Gather(mipRowSizes.data(), mipLevel);
+    const Int8 offset = Int8::Gather(mipOffsets.data(), mipLevel);
+    const Float8 mipWidthF = Int8::ToFloat(mipWidth);
+    const Float8 mipHeightF = Int8::ToFloat(mipHeight);
+
+    const Float8 fx = u * mipWidthF - 0.5f;
+    const Float8 fy = v * mipHeightF - 0.5f;
+    Float8 x0 = Float8::Floor(fx);
+    Float8 y0 = Float8::Floor(fy);
+    const Float8 tx = fx - x0;
+    const Float8 ty = fy - y0;
+
+    // Wrap the same way as ReferenceTexture, and then wrap the second texel if it's past the edge
+    x0 = x0 - Float8::Floor(x0 / mipWidthF) * mipWidthF;
+    y0 = y0 - Float8::Floor(y0 / mipHeightF) * mipHeightF;
+    Float8 x1 = x0 + 1.0f;
+    Float8 y1 = y0 + 1.0f;
+    x1 = Float8::Select(x1 >= mipWidthF, 0.0f, x1);
+    y1 = Float8::Select(y1 >= mipHeightF, 0.0f, y1);
+
+    // Rounding in the wrap can't be allowed to push an index outside of the mip
+    const Int8 maxX = mipWidth - 1;
+    const Int8 maxY = mipHeight - 1;
+    const Int8 ix0 = Int8::Max(Int8::Min(Int8::Truncate(x0), maxX), 0);
+    const Int8 iy0 = Int8::Max(Int8::Min(Int8::Truncate(y0), maxY), 0);
+    const Int8 ix1 = Int8::Max(Int8::Min(Int8::Truncate(x1), maxX), 0);
+    const Int8 iy1 = Int8::Max(Int8::Min(Int8::Truncate(y1), maxY), 0);
+
+    const Int8 idx00 = TexelIndex(ix0, iy0, rowSize, offset);
+    const Int8 idx10 = TexelIndex(ix1, iy0, rowSize, offset);
+    const Int8 idx01 = TexelIndex(ix0, iy1, rowSize, offset);
+    const Int8 idx11 = TexelIndex(ix1, iy1, rowSize, offset);
+
+    for(uint32 c = 0; c < numChannels; ++c)
+    {
+        const float* channel = texels.data() + c;
+        const Float8 top = Float8::Lerp(Int8::Gather(channel, idx00), Int8::Gather(channel, idx10), tx);
+        const Float8 bottom = Float8::Lerp(Int8::Gather(channel, idx01), Int8::Gather(channel, idx11), tx);
+        results[c] = Float8::Lerp(top, bottom, ty);
+    }
+}
+
+void TiledTexture::SampleLevel(const Float8& u, const Float8& v, const Float8& lod, Float8* results) const
+{
+    const int32 lastMip = int32(NumMipLevels()) - 1;
+    const Float8 clampedLOD = Float8::Clamp(lod, 0.0f, float(lastMip));
+    const Float8 mip0F = Float8::Floor(clampedLOD);
+    const Float8 t = clampedLOD - mip0F;
+    const Int8 mip0 = Int8::Truncate(mip0F);
+
+    SampleBilinear(u, v, mip0, results);
+
+    // Lanes on the last mip have t = 0, and get the same value back from the lerp
+    if(Float8::Any(t > 0.0f))
+    {
+        Float8 results1[4];
+        SampleBilinear(u, v, Int8::Min(mip0 + 1, lastMip), results1);
+        for(uint32 c = 0; c < numChannels; ++c)
+            results[c] = Float8::Lerp(results[c], results1[c], t);
+    }
+}
+
+void TiledTexture::SampleTrilinear(const Float8& u, const Float8& v, const Float8& uDX, const Float8& vDX,
+                                   const Float8& uDY, const Float8& vDY, Float8* results) const
+{
+    const Float8 dxX = uDX * float(width);
+    const Float8 dxY = vDX * float(height);
+    const Float8 dyX = uDY * float(width);
+    const Float8 dyY = vDY * float(height);
+    const Float8 rho = Float8::Max(Float8::Sqrt(dxX * dxX + dxY * dxY), Float8::Sqrt(dyX * dyX + dyY * dyY));
+    const Float8 lod = Float8::Select(rho > 0.0f, Float8::Log2(rho), 0.0f);
+    SampleLevel(u, v, lod, results);
+}
+
+void TiledTexture::SampleAniso(const Float8& u, const Float8& v, const Float8& uDX, const Float8& vDX,
+                               const Float8& uDY, const Float8& vDY, Float8* results) const
+{
+    const Float8 dxX = uDX * float(width);
+    const Float8 dxY = vDX * float(height);
+    const Float8 dyX = uDY * float(width);
+    const Float8 dyY = vDY * float(height);
+    const Float8 lengthX = Float8::Sqrt(dxX * dxX + dxY * dxY);
+    const Float8 lengthY = Float8::Sqrt(dyX * dyX + dyY * dyY);
+    const Float8 major = Float8::Max(lengthX, lengthY);
+    const Float8 minor = Float8::Min(lengthX, lengthY);
+
+    const Float8 maxAnisotropy = float(MaxAnisotropy);
+    const Float8 ratio = Float8::Select(minor > 0.0f, major / minor, maxAnisotropy);
+    Float8 numTaps = Float8::Min(-Float8::Floor(0.001f - ratio), maxAnisotropy);
+    numTaps = Float8::Select(major > 0.0f, Float8::Max(numTaps, 1.0f), 1.0f);
+    const Float8 lod = Float8::Select(major > 0.0f, Float8::Log2(major / numTaps), 0.0f);
+
+    const Float8 useX = lengthX >= lengthY;
+    const Float8 axisU = Float8::Select(useX, uDX, uDY);
+    const Float8 axisV = Float8::Select(useX, vDX, vDY);
+
+    uint32 maxTaps = 1;
+    for(uint32 lane = 0; lane < Float8::Width; ++lane)
+        maxTaps = std::max(maxTaps, uint32(numTaps[lane]));
+
+    // Lanes that need fewer taps than the others add 0 for the rest of them
+    Float8 sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const Float8 invNumTaps = 1.0f / numTaps;
+    for(uint32 i = 0; i < maxTaps; ++i)
+    {
+        const Float8 tapIdx = float(i);
+        const Float8 offset = (tapIdx + 0.5f) * invNumTaps - 0.5f;
+        Float8 tap[4];
+        SampleLevel(u + axisU * offset, v + axisV * offset, lod, tap);
+
+        const Float8 active = tapIdx < numTaps;
+        for(uint32 c = 0; c < numChannels; ++c)
+            sum[c] += Float8::Select(active, tap[c], 0.0f);
+    }
+
+    for(uint32 c = 0; c < numChannels; ++c)
+        results[c] = sum[c] * invNumTaps;
+}
+
+void TiledTexture::Sample(TextureFilter filter, const TextureSampleBatch& batch, TextureSampleResults& results) const
+{
+    results.Resize(batch.Count, numChannels);
+    Sample(filter, batch, 0, batch.Count, results);
+}
+
+void TiledTexture::Sample(TextureFilter filter, const TextureSampleBatch& batch, uint32 first, uint32 count,
+                          TextureSampleResults& results) const
+{
+    const uint32 end = first + count;
+    for(uint32 i = first; i < end; i += Float8::Width)
+    {
+        const uint32 numLanes = std::min(end - i, uint32(Float8::Width));
+
+        Float8 inputs[TextureSampleBatch::NumChannels];
+        for(uint32 ch = 0; ch < TextureSampleBatch::NumChannels; ++ch)
+        {
+            if(numLanes == Float8::Width)
+            {
+                inputs[ch] = Float8::Load(&batch.Data[ch][i]);
+            }
+            else
+            {
+                float padded[Float8::Width] = { };
+                for(uint32 lane = 0; lane < numLanes; ++lane)
+                    padded[lane] = batch.Data[ch][i + lane];
+                inputs[ch] = Float8::Load(padded);
+            }
+        }
+
+        Float8 sampled[4];
+        if(filter == TextureFilterBilinear)
+            SampleBilinear(inputs[TextureSampleBatch::U], inputs[TextureSampleBatch::V], Int8(0), sampled);
+        else if(filter == TextureFilterTrilinear)
+            SampleTrilinear(inputs[TextureSampleBatch::U], inputs[TextureSampleBatch::V],
+                            inputs[TextureSampleBatch::UDX], inputs[TextureSampleBatch::VDX],
+                            inputs[TextureSampleBatch::UDY], inputs[TextureSampleBatch::VDY], sampled);
+        else
+            SampleAniso(inputs[TextureSampleBatch::U], inputs[TextureSampleBatch::V],
+                        inputs[TextureSampleBatch::UDX], inputs[TextureSampleBatch::VDX],
+                        inputs[TextureSampleBatch::UDY], inputs[TextureSampleBatch::VDY], sampled);
+
+        for(uint32 c = 0; c < numChannels; ++c)
+        {
+            if(numLanes == Float8::Width)
+            {
+                sampled[c].Store(&results.Data[c][i]);
+            }
+            else
+            {
+                float lanes[Float8::Width];
+                sampled[c].Store(lanes);
+                for(uint32 lane = 0; lane < numLanes; ++lane)
+                    results.Data[c][i + lane] = lanes[lane];
+            }
+        }
+    }
+}
+
+//=================================================================================================
+// TextureSamplerBenchmark
+//=================================================================================================
+
+// Samples per task when sampling on every thread
+static const uint32 SamplesPerTask = 4096;
+
+TextureSamplerBenchmark::TextureSamplerBenchmark() : NumSamples(0), NumThreads(1), UsesAVX2(false)
+{
+}
+
+void TextureSamplerBenchmark::Run(const BakedMaps& maps, uint32 numSamples)
+{
+    NumSamples = numSamples;
+    NumThreads = ThreadPool::GlobalPool.NumThreads();
+    UsesAVX2 = SIMD_AVX2_ != 0;
+
+    const BakedTexture* mapTextures[NumMaps] = { &maps.LEANMap, &maps.LEANMap, &maps.VMFMap, &maps.RoughnessMap };
+    const uint32 mapSlices[NumMaps] = { 0, 1, 0, 0 };
+
+    // The samples come in blocks of 8x8 pixels that step across the texture by their derivatives,
+    // the same as a rasterized triangle would. Each block gets a random footprint from 2x
+    // magnification down past the smallest mip, with anisotropy up to 16:1 at any angle, and
+    // starts at a random UV that's often outside of [0, 1] to cover the wrapping.
+    const uint32 width = maps.LEANMap.Width;
+    const uint32 height = maps.LEANMap.Height;
+    const float maxLOD = std::log2(float(std::max(width, height))) + 1.0f;
+    const uint32 BlockSize = 8;
+
+    Random random;
+    TextureSampleBatch batch;
+    batch.Resize(numSamples);
+    for(uint32 blockStart = 0; blockStart < numSamples; blockStart += BlockSize * BlockSize)
+    {
+        const float minor = std::exp2(random.NextFloat(-1.0f, maxLOD));
+        const float major = minor * std::exp2(random.NextFloat(0.0f, 4.0f));
+        const float angle = random.NextFloat(0.0f, Pi2);
+        const float cosAngle = std::cos(angle);
+        const float sinAngle = std::sin(angle);
+
+        Float2 uvDX = Float2(cosAngle * major / width, sinAngle * major / height);
+        Float2 uvDY = Float2(-sinAngle * minor / width, cosAngle * minor / height);
+        if(random.NextUInt(2) == 1)
+            std::swap(uvDX, uvDY);
+
+        const Float2 uv = Float2(random.NextFloat(-2.0f, 3.0f), random.NextFloat(-2.0f, 3.0f));
+        const uint32 blockEnd = std::min(blockStart + BlockSize * BlockSize, numSamples);
+        for(uint32 i = blockStart; i < blockEnd; ++i)
+        {
+            const float x = float((i - blockStart) % BlockSize);
+            const float y = float((i - blockStart) / BlockSize);
+            batch.Data[TextureSampleBatch::U][i] = uv.x + uvDX.x * x + uvDY.x * y;
+            batch.Data[TextureSampleBatch::V][i] = uv.y + uvDX.y * x + uvDY.y * y;
+            batch.Data[TextureSampleBatch::UDX][i] = uvDX.x;
+            batch.Data[TextureSampleBatch::VDX][i] = uvDX.y;
+            batch.Data[TextureSampleBatch::UDY][i] = uvDY.x;
+            batch.Data[TextureSampleBatch::VDY][i] = uvDY.y;
+        }
+    }
+
+    std::vector<Float4> reference(numSamples);
+    TextureSampleResults results;
+
+    for(uint32 mapIdx = 0; mapIdx < NumMaps; ++mapIdx)
+    {
+        ReferenceTexture referenceTexture;
+        referenceTexture.Initialize(*mapTextures[mapIdx], mapSlices[mapIdx]);
+
+        TiledTexture textures[NumTexelLayouts];
+        for(uint32 layout = 0; layout < NumTexelLayouts; ++layout)
+            textures[layout].Initialize(*mapTextures[mapIdx], mapSlices[mapIdx], TexelLayout(layout));
+        const uint32 numChannels = textures[0].NumChannels();
+
+        for(uint32 filter = 0; filter < NumTextureFilters; ++filter)
+        {
+            Result& result = Results[mapIdx][filter];
+            Timer timer;
+
+            for(uint32 i = 0; i < numSamples; ++i)
+            {
+                const Float2 uv(batch.Data[TextureSampleBatch::U][i], batch.Data[TextureSampleBatch::V][i]);
+                const Float2 uvDX(batch.Data[TextureSampleBatch::UDX][i], batch.Data[TextureSampleBatch::VDX][i]);
+                const Float2 uvDY(batch.Data[TextureSampleBatch::UDY][i], batch.Data[TextureSampleBatch::VDY][i]);
+                if(filter == TextureFilterBilinear)
+                    reference[i] = referenceTexture.SampleBilinear(uv, 0);
+                else if(filter == TextureFilterTrilinear)
+                    reference[i] = referenceTexture.SampleTrilinear(uv, uvDX, uvDY);
+                else
+                    reference[i] = referenceTexture.SampleAniso(uv, uvDX, uvDY);
+            }
+
+            timer.Update();
+            result.ScalarSeconds = timer.DeltaSecondsD();
+
+            result.MaxError = 0.0f;
+            for(uint32 layout = 0; layout < NumTexelLayouts; ++layout)
+            {
+                timer.Update();
+                textures[layout].Sample(TextureFilter(filter), batch, results);
+                timer.Update();
+                result.SIMDSeconds[layout] = timer.DeltaSecondsD();
+
+                for(uint32 c = 0; c < numChannels; ++c)
+                {
+                    for(uint32 i = 0; i < numSamples; ++i)
+                    {
+                        const float expected = (&reference[i].x)[c];
+                        const float error = std::abs(results.Data[c][i] - expected) / std::max(std::abs(expected), 1.0f);
+                        result.MaxError = std::max(result.MaxError, error);
+                    }
+                }
+            }
+
+            const TiledTexture& texture = textures[TexelLayoutMorton];
+            const uint32 numTasks = (numSamples + SamplesPerTask - 1) / SamplesPerTask;
+            timer.Update();
+            ThreadPool::GlobalPool.ParallelFor(numTasks, [&](uint32 taskIdx, uint32 threadIdx)
+            {
+                const uint32 first = taskIdx * SamplesPerTask;
+                texture.Sample(TextureFilter(filter), batch, first, std::min(SamplesPerTask, numSamples - first), results);
+            });
+            timer.Update();
+            result.ParallelSeconds = timer.DeltaSecondsD();
+        }
+    }
+}
+
+bool TextureSamplerBenchmark::Passed(float tolerance) const
+{
+    for(uint32 mapIdx = 0; mapIdx < NumMaps; ++mapIdx)
+        for(uint32 filter = 0; filter < NumTextureFilters; ++filter)
+            if(Results[mapIdx][filter].MaxError > tolerance)
+                return false;
+    return true;
+}
+
+std::wstring TextureSamplerBenchmark::ToString() const
+{
+    static const wchar* MapNames[NumMaps] = { L"LEAN slice 0", L"LEAN slice 1", L"vMF", L"Roughness" };
+
+    auto rate = [&](double seconds)
+    {
+        return SampleFramework11::ToString(NumSamples / std::max(seconds, 1e-9) / 1000000.0) + L"M";
+    };
+
+    std::wstring text = L"Samples: " + SampleFramework11::ToString(NumSamples) + L", ";
+    text += SampleFramework11::ToString(uint32(Float8::Width)) + (UsesAVX2 ? L"-wide AVX2, " : L"-wide scalar fallback, ");
+    text += SampleFramework11::ToString(NumThreads) + L" threads (samples/s)";
+
+    for(uint32 mapIdx = 0; mapIdx < NumMaps; ++mapIdx)
+    {
+        text += L"\n" + std::wstring(MapNames[mapIdx]) + L":";
+        for(uint32 filter = 0; filter < NumTextureFilters; ++filter)
+        {
+            const Result& result = Results[mapIdx][filter];
+            text += L"\n  " + std::wstring(TextureFilterName(TextureFilter(filter))) + L": scalar " + rate(result.ScalarSeconds);
+            for(uint32 layout = 0; layout < NumTexelLayouts; ++layout)
+                text += L", SIMD " + std::wstring(TexelLayoutName(TexelLayout(layout))) + L" " + rate(result.SIMDSeconds[layout]);
+            text += L", SIMD Morton on every thread " + rate(result.ParallelSeconds);
+            text += L", max error " + SampleFramework11::ToString(result.MaxError);
+        }
+    }
+
+    return text;
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "SampleFramework11/SIMD.h"
+
+#include "MapBaker.h"
+
+using namespace SampleFramework11;
+
+enum TextureFilter
+{
+    TextureFilterBilinear = 0,          // Top mip level only
+    TextureFilterTrilinear,             // LinearSampler
+    TextureFilterAniso,                 // AnisoSampler
+
+    NumTextureFilters
+};
+
+const wchar* TextureFilterName(TextureFilter filter);
+
+// How the texels of every mip level are ordered in memory. Morton stores 4x4 tiles one after
+// another, with the texels of a tile in Morton order, so that the 4 texels of a bilinear
+// footprint and the taps along the aniso axis usually share cache lines.
+enum TexelLayout
+{
+    TexelLayoutLinear = 0,
+    TexelLayoutMorton,
+
+    NumTexelLayouts
+};
+
+const wchar* TexelLayoutName(TexelLayout layout);
+
+// UVs and their screen-space derivatives for a batch of samples, in structure-of-arrays form
+struct TextureSampleBatch
+{
+    enum Channels
+    {
+        U = 0,
+        V,
+        UDX,
+        VDX,
+        UDY,
+        VDY,
+
+        NumChannels
+    };
+
+    uint32 Count;
+    std::vector<float> Data[NumChannels];
+
+    TextureSampleBatch() : Count(0)
+    {
+    }
+
+    void Resize(uint32 count);
+};
+
+// One array per channel of the texture that was sampled
+struct TextureSampleResults
+{
+    uint32 Count;
+    uint32 NumChannels;
+    std::vector<float> Data[4];
+
+    TextureSampleResults() : Count(0), NumChannels(0)
+    {
+    }
+
+    void Resize(uint32 count, uint32 numChannels);
+};
+
+// CPU copy of one array slice of a baked map and its mip chain, decoded to floats and sampled
+// Float8::Width UVs at a time with wrap addressing. Only the channels that the format has are
+// stored, so the RG16 roughness map takes half the memory of the RGBA16 LEAN and vMF maps. The
+// filters follow ReferenceTexture: trilinear picks the mip from the longer derivative, and aniso
+// takes up to MaxAnisotropy trilinear taps along the major axis of the footprint. Every lane
+// does its own addressing, so lanes can be in different mip levels and take different numbers of
+// aniso taps, and the texels are fetched with gathers.
+class TiledTexture
+{
+
+public:
+
+    static const uint32 TileSize = 4;       // The Morton layout's shifts and masks assume 4
+    static const uint32 MaxAnisotropy = 16;
+
+    TiledTexture();
+
+    void Initialize(const BakedTexture& texture, uint32 arraySlice, TexelLayout layout = TexelLayoutMorton);
+
+    uint32 Width() const { return width; }
+    uint32 Height() const { return height; }
+    uint32 NumMipLevels() const { return uint32(mipWidths.size()); }
+    uint32 NumChannels() const { return numChannels; }
+    TexelLayout Layout() const { return layout; }
+    uint64 SizeInBytes() const { return texels.size() * sizeof(float); }
+
+    Float4 Texel(uint32 mipLevel, uint32 x, uint32 y) const;
+
+    // Each function writes NumChannels() results
+    void SampleBilinear(const Float8& u, const Float8& v, const Int8& mipLevel, Float8* results) const;
+    void SampleTrilinear(const Float8& u, const Float8& v, const Float8& uDX, const Float8& vDX,
+                         const Float8& uDY, const Float8& vDY, Float8* results) const;
+    void SampleAniso(const Float8& u, const Float8& v, const Float8& uDX, const Float8& vDX,
+                     const Float8& uDY, const Float8& vDY, Float8* results) const;
+
+    // Samples the whole batch. The samples that don't fill a whole Float8 are padded.
+    void Sample(TextureFilter filter, const TextureSampleBatch& batch, TextureSampleResults& results) const;
+
+    // Samples [first, first + count) of the batch, for splitting a batch between threads. The
+    // results need to be sized for the whole batch already.
+    void Sample(TextureFilter filter, const TextureSampleBatch& batch, uint32 first, uint32 count,
+                TextureSampleResults& results) const;
+
+protected:
+
+    // Index of the first float of every texel, from the row size and offset of each lane's mip
+    Int8 TexelIndex(const Int8& x, const Int8& y, const Int8& rowSize, const Int8& offset) const;
+
+    void SampleLevel(const Float8& u, const Float8& v, const Float8& lod, Float8* results) const;
+
+    uint32 width;
+    uint32 height;
+    uint32 numChannels;
+    TexelLayout layout;
+    std::vector<float> texels;
+
+    // Indexed with the mip level of each lane
+    std::vector<int32> mipWidths;
+    std::vector<int32> mipHeights;
+    std::vector<int32> mipRowSizes;         // Texels per row, or tiles per row for Morton
+    std::vector<int32> mipOffsets;          // First texel of each level
+};
+
+// Samples the LEAN, vMF, and roughness maps with every filter, over blocks of pixels with random
+// footprints from magnification down to the smallest mip and up to 16:1 anisotropy. The results are checked
+// against ReferenceTexture, and the scalar sampler is timed against the SIMD one with both
+// layouts and against the SIMD one on every thread.
+struct TextureSamplerBenchmark
+{
+    enum Maps
+    {
+        MapLEAN0 = 0,
+        MapLEAN1,
+        MapVMF,
+        MapRoughness,
+
+        NumMaps
+    };
+
+    struct Result
+    {
+        double ScalarSeconds;
+        double SIMDSeconds[NumTexelLayouts];
+        double ParallelSeconds;
+        float MaxError;
+
+        Result() : ScalarSeconds(0.0), ParallelSeconds(0.0), MaxError(0.0f)
+        {
+            for(uint32 i = 0; i < NumTexelLayouts; ++i)
+                SIMDSeconds[i] = 0.0;
+        }
+    };
+
+    uint32 NumSamples;
+    uint32 NumThreads;
+    bool UsesAVX2;
+    Result Results[NumMaps][NumTextureFilters];
+
+    TextureSamplerBenchmark();
+
+    void Run(const BakedMaps& maps, uint32 numSamples);
+
+    bool Passed(float tolerance) const;
+    std::wstring ToString() const;
+};
\ No newline at end of file
@@ -0,0 +1,722 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "VMFMixture.h"
+#include "MapEncoding.h"
+
+#include "SampleFramework11/Exceptions.h"
+#include "SampleFramework11/Utility.h"
+#include "SampleFramework11/ThreadPool.h"
+#include "SampleFramework11/SIMD.h"
+#include "SampleFramework11/Timer.h"
+
+// Keeps log(kappa) finite for lobes that cover the whole hemisphere
+static const float MinKappa = 0.001f;
+
+// A lobe isn't started at a point that's closer than this (1 - cos(theta)) to an existing lobe,
+// so texels with fewer distinct directions than lobes leave the extra lobes empty
+static const float MinSeedDistance = 0.0001f;
+
+static const float Log2E = 1.442695041f;
+static const float Ln2 = 0.6931471806f;
+static const float Log2TwoPi = 2.651496130f;
+
+static const uint32 MaxPoints = 4 * VMFMixtureFitter::MaxLobes;
+
+//=================================================================================================
+// Helpers
+//=================================================================================================
+
+typedef VMFMixtureFitter::LobeLevel LobeLevel;
+
+// The parameters of one lobe for 8 texels
+struct LobeParams
+{
+    Float8 MuX;
+    Float8 MuY;
+    Float8 MuZ;
+    Float8 R;
+    Float8 Kappa;
+    Float8 Alpha;       // 0 for an empty lobe
+
+    static LobeParams Select(const Float8& mask, const LobeParams& a, const LobeParams& b)
+    {
+        LobeParams p;
+        p.MuX = Float8::Select(mask, a.MuX, b.MuX);
+        p.MuY = Float8::Select(mask, a.MuY, b.MuY);
+        p.MuZ = Float8::Select(mask, a.MuZ, b.MuZ);
+        p.R = Float8::Select(mask, a.R, b.R);
+        p.Kappa = Float8::Select(mask, a.Kappa, b.Kappa);
+        p.Alpha = Float8::Select(mask, a.Alpha, b.Alpha);
+        return p;
+    }
+};
+
+// Weighted points that a group of 8 texels is fit to, which are the child lobes
+struct FitData
+{
+    uint32 NumPoints;
+    uint32 Child[MaxPoints];
+    Float8 W[MaxPoints];
+    Float8 MX[MaxPoints];
+    Float8 MY[MaxPoints];
+    Float8 MZ[MaxPoints];
+};
+
+// Same as VMFKappa in SharedConstants.h, clamped to a range that's safe to take the log of
+static Float8 KappaFromR(const Float8& r)
+{
+    Float8 kappa = Float8::Select(r < 1.0f, (r * 3.0f - r * r * r) / (1.0f - r * r), MaxKappa);
+    return Float8::Clamp(kappa, MinKappa, MaxKappa);
+}
+
+// Makes a lobe from a weight and a mean resultant vector, or an empty lobe if the weight is 0
+static LobeParams MakeLobe(const Float8& alpha, const Float8& mx, const Float8& my, const Float8& mz)
+{
+    const Float8 len = Float8::Sqrt(mx * mx + my * my + mz * mz);
+    const Float8 valid = Float8::Select(alpha > 0.0f, len > 0.0f, 0.0f);
+    const Float8 invLen = 1.0f / Float8::Select(valid, len, 1.0f);
+
+    LobeParams lobe;
+    lobe.MuX = Float8::Select(valid, mx * invLen, 0.0f);
+    lobe.MuY = Float8::Select(valid, my * invLen, 0.0f);
+    lobe.MuZ = Float8::Select(valid, mz * invLen, 1.0f);
+    lobe.R = Float8::Min(len, 1.0f);
+    lobe.Kappa = Float8::Select(valid, KappaFromR(lobe.R), MaxKappa);
+    lobe.Alpha = Float8::Select(valid, alpha, 0.0f);
+    return lobe;
+}
+
+// Starts every empty lobe at the point that's furthest from the lobes that have already been
+// placed, with the spread of that point
+static void SeedEmptyLobes(const FitData& data, uint32 numLobes, LobeParams* lobes)
+{
+    for(uint32 k = 1; k < numLobes; ++k)
+    {
+        const Float8 empty = lobes[k].Alpha <= 0.0f;
+        if(!Float8::Any(empty))
+            continue;
+
+        Float8 bestDistance = MinSeedDistance;
+        Float8 bestW = 0.0f;
+        Float8 bestX = 0.0f;
+        Float8 bestY = 0.0f;
+        Float8 bestZ = 0.0f;
+        for(uint32 j = 0; j < data.NumPoints; ++j)
+        {
+            const Float8 len = Float8::Sqrt(data.MX[j] * data.MX[j] + data.MY[j] * data.MY[j] + data.MZ[j] * data.MZ[j]);
+            const Float8 invLen = 1.0f / Float8::Max(len, 1e-8f);
+
+            Float8 maxCos = -1.0f;
+            for(uint32 l = 0; l < numLobes; ++l)
+            {
+                const Float8 cosTheta = (lobes[l].MuX * data.MX[j] + lobes[l].MuY * data.MY[j] + lobes[l].MuZ * data.MZ[j]) * invLen;
+                maxCos = Float8::Select(lobes[l].Alpha > 0.0f, Float8::Max(maxCos, cosTheta), maxCos);
+            }
+
+            const Float8 distance = Float8::Select(data.W[j] > 0.0f, 1.0f - maxCos, 0.0f);
+            const Float8 better = distance > bestDistance;
+            bestDistance = Float8::Select(better, distance, bestDistance);
+            bestW = Float8::Select(better, data.W[j], bestW);
+            bestX = Float8::Select(better, data.MX[j], bestX);
+            bestY = Float8::Select(better, data.MY[j], bestY);
+            bestZ = Float8::Select(better, data.MZ[j], bestZ);
+        }
+
+        const LobeParams seeded = MakeLobe(Float8::Select(bestW > 0.0f, 1.0f / numLobes, 0.0f), bestX, bestY, bestZ);
+        lobes[k] = LobeParams::Select(empty, seeded, lobes[k]);
+    }
+}
+
+// Replaces the lobes with the merge of the child lobes that are closest to them, which gives EM a
+// starting point where every lobe has a weight and a spread that come from the data
+static void MergeIntoClosestLobes(const FitData& data, uint32 numLobes, LobeParams* lobes)
+{
+    Float8 sumW[VMFMixtureFitter::MaxLobes];
+    Float8 sumX[VMFMixtureFitter::MaxLobes];
+    Float8 sumY[VMFMixtureFitter::MaxLobes];
+    Float8 sumZ[VMFMixtureFitter::MaxLobes];
+    for(uint32 k = 0; k < numLobes; ++k)
+        sumW[k] = sumX[k] = sumY[k] = sumZ[k] = 0.0f;
+
+    for(uint32 j = 0; j < data.NumPoints; ++j)
+    {
+        Float8 bestCos = -2.0f;
+        Float8 bestLobe = 0.0f;
+        for(uint32 k = 0; k < numLobes; ++k)
+        {
+            const Float8 cosTheta = lobes[k].MuX * data.MX[j] + lobes[k].MuY * data.MY[j] + lobes[k].MuZ * data.MZ[j];
+            const Float8 closer = Float8::Select(lobes[k].Alpha > 0.0f, cosTheta > bestCos, 0.0f);
+            bestCos = Float8::Select(closer, cosTheta, bestCos);
+            bestLobe = Float8::Select(closer, float(k), bestLobe);
+        }
+
+        for(uint32 k = 0; k < numLobes; ++k)
+        {
+            const Float8 w = Float8::Select(bestLobe == float(k), data.W[j], 0.0f);
+            sumW[k] += w;
+            sumX[k] += w * data.MX[j];
+            sumY[k] += w * data.MY[j];
+            sumZ[k] += w * data.MZ[j];
+        }
+    }
+
+    for(uint32 k = 0; k < numLobes; ++k)
+    {
+        const Float8 invW = 1.0f / Float8::Max(sumW[k], 1e-30f);
+        lobes[k] = MakeLobe(sumW[k], sumX[k] * invW, sumY[k] * invW, sumZ[k] * invW);
+    }
+}
+
+// Runs EM for 8 texels until every lane converges or hits the iteration limit. Returns the
+// average log-likelihood of the data, and the number of iterations done by each lane.
+static Float8 FitLobes(const FitData& data, const VMFFitSettings& settings, LobeParams* lobes,
+                       Float8& iterations, Float8& converged)
+{
+    const uint32 numLobes = settings.NumLobes;
+
+    Float8 active = 1.0f;
+    Float8 logLikelihood = 0.0f;
+    Float8 prevLogLikelihood = -1e30f;
+    iterations = 0.0f;
+
+    for(uint32 iteration = 0; ; ++iteration)
+    {
+        // The log of alpha * C(kappa), in bits, where C(kappa) = kappa / (2 * pi * (1 - e^(-2 * kappa)))
+        // is the normalization term of a vMF lobe written as e^(kappa * (dot(mu, n) - 1))
+        Float8 logNorm[VMFMixtureFitter::MaxLobes];
+        Float8 kappaLog2E[VMFMixtureFitter::MaxLobes];
+        for(uint32 k = 0; k < numLobes; ++k)
+        {
+            const LobeParams& lobe = lobes[k];
+            kappaLog2E[k] = lobe.Kappa * Log2E;
+            const Float8 logC = Float8::Log2(lobe.Kappa) - Float8::Log2(1.0f - Float8::Exp2(kappaLog2E[k] * -2.0f)) - Log2TwoPi;
+            logNorm[k] = Float8::Select(lobe.Alpha > 0.0f, Float8::Log2(Float8::Max(lobe.Alpha, 1e-30f)) + logC, -1e30f);
+        }
+
+        // E-step, accumulating the sums for the M-step as we go. The expected log-likelihood of a
+        // child lobe under a vMF lobe only depends on its mean resultant vector.
+        Float8 sumW[VMFMixtureFitter::MaxLobes];
+        Float8 sumX[VMFMixtureFitter::MaxLobes];
+        Float8 sumY[VMFMixtureFitter::MaxLobes];
+        Float8 sumZ[VMFMixtureFitter::MaxLobes];
+        for(uint32 k = 0; k < numLobes; ++k)
+            sumW[k] = sumX[k] = sumY[k] = sumZ[k] = 0.0f;
+
+        Float8 sumLogLikelihood = 0.0f;
+        for(uint32 j = 0; j < data.NumPoints; ++j)
+        {
+            Float8 logP[VMFMixtureFitter::MaxLobes];
+            Float8 maxLogP = -1e30f;
+            for(uint32 k = 0; k < numLobes; ++k)
+            {
+                const Float8 dp = lobes[k].MuX * data.MX[j] + lobes[k].MuY * data.MY[j] + lobes[k].MuZ * data.MZ[j];
+                logP[k] = logNorm[k] + kappaLog2E[k] * (dp - 1.0f);
+                maxLogP = Float8::Max(maxLogP, logP[k]);
+            }
+
+            Float8 z[VMFMixtureFitter::MaxLobes];
+            // Responsibilities below 2^-64 are flushed to 0, which also takes care of the empty
+            // lobes, since the denormals that they would produce are very slow on x86
+            Float8 sumExp = 0.0f;
+            for(uint32 k = 0; k < numLobes; ++k)
+            {
+                const Float8 logZ = logP[k] - maxLogP;
+                z[k] = Float8::Select(logZ > -64.0f, Float8::Exp2(logZ), 0.0f);
+                sumExp += z[k];
+            }
+
+            sumLogLikelihood += data.W[j] * (maxLogP + Float8::Log2(sumExp));
+
+            const Float8 scale = data.W[j] / sumExp;
+            for(uint32 k = 0; k < numLobes; ++k)
+            {
+                const Float8 wz = z[k] * scale;
+                sumW[k] += wz;
+                sumX[k] += wz * data.MX[j];
+                sumY[k] += wz * data.MY[j];
+                sumZ[k] += wz * data.MZ[j];
+            }
+        }
+
+        logLikelihood = sumLogLikelihood * Ln2;
+
+        if(iteration > 0)
+        {
+            const Float8 delta = logLikelihood - prevLogLikelihood;
+            active = Float8::Select(Float8::Max(delta, -delta) <= settings.Tolerance, 0.0f, active);
+        }
+
+        const Float8 isActive = active > 0.0f;
+        if(iteration == settings.MaxIterations || !Float8::Any(isActive))
+            break;
+
+        // M-step, which only updates the lanes that are still active
+        for(uint32 k = 0; k < numLobes; ++k)
+        {
+            const Float8 invW = 1.0f / Float8::Max(sumW[k], 1e-30f);
+            const LobeParams updated = MakeLobe(Float8::Select(sumW[k] > 1e-7f, sumW[k], 0.0f),
+                                                sumX[k] * invW, sumY[k] * invW, sumZ[k] * invW);
+            lobes[k] = LobeParams::Select(isActive, updated, lobes[k]);
+        }
+
+        iterations += active;
+        prevLogLikelihood = logLikelihood;
+    }
+
+    converged = 1.0f - active;
+    return logLikelihood;
+}
+
+// Sorts the lobes of each lane by weight, largest first, which also moves the empty lobes to the end
+static void SortLobes(uint32 numLobes, LobeParams* lobes)
+{
+    for(uint32 pass = 0; pass + 1 < numLobes; ++pass)
+    {
+        for(uint32 k = 0; k + 1 < numLobes - pass; ++k)
+        {
+            const Float8 swap = lobes[k + 1].Alpha > lobes[k].Alpha;
+            const LobeParams a = lobes[k];
+            lobes[k] = LobeParams::Select(swap, lobes[k + 1], a);
+            lobes[k + 1] = LobeParams::Select(swap, a, lobes[k + 1]);
+        }
+    }
+}
+
+static void StoreHalf4(const Float8& r, const Float8& g, const Float8& b, const Float8& a,
+                       uint16* dst, uint32 numTexels)
+{
+    uint16 values[4][8];
+    Float8::ToHalf(r, values[0]);
+    Float8::ToHalf(g, values[1]);
+    Float8::ToHalf(b, values[2]);
+    Float8::ToHalf(a, values[3]);
+
+    for(uint32 i = 0; i < numTexels; ++i)
+        for(uint32 c = 0; c < 4; ++c)
+            dst[i * 4 + c] = values[c][i];
+}
+
+static uint32 NumTiles(uint32 size, uint32 tileSize)
+{
+    return (size + tileSize - 1) / tileSize;
+}
+
+// The tiles of a level that overlap any of the rects, in order and without duplicates
+static std::vector<uint32> DirtyTiles(const std::vector<TexelRect>& rects, uint32 width, uint32 height)
+{
+    const uint32 numTilesX = NumTiles(width, MapBaker::TileSize);
+    const uint32 numTilesY = NumTiles(height, MapBaker::TileSize);
+    std::vector<bool> dirty(numTilesX * numTilesY, false);
+    for(uint64 rectIdx = 0; rectIdx < rects.size(); ++rectIdx)
+    {
+        const TexelRect rect = rects[rectIdx].Clamp(width, height);
+        if(rect.Empty())
+            continue;
+
+        for(uint32 tileY = rect.MinY / MapBaker::TileSize; tileY <= (rect.MaxY - 1) / MapBaker::TileSize; ++tileY)
+            for(uint32 tileX = rect.MinX / MapBaker::TileSize; tileX <= (rect.MaxX - 1) / MapBaker::TileSize; ++tileX)
+                dirty[tileY * numTilesX + tileX] = true;
+    }
+
+    std::vector<uint32> tiles;
+    for(uint32 i = 0; i < dirty.size(); ++i)
+        if(dirty[i])
+            tiles.push_back(i);
+
+    return tiles;
+}
+
+// Per-thread sums for the stats of one level
+struct LevelTotals
+{
+    double Iterations;
+    uint32 MaxIterations;
+    uint64 NumConverged;
+    double LogLikelihood;
+
+    LevelTotals() : Iterations(0.0), MaxIterations(0), NumConverged(0), LogLikelihood(0.0)
+    {
+    }
+};
+
+//=================================================================================================
+// VMFFitStats
+//=================================================================================================
+
+double VMFFitStats::AvgIterations() const
+{
+    return TexelsProcessed > 0 ? double(TotalIterations) / TexelsProcessed : 0.0;
+}
+
+std::wstring VMFFitStats::ToString() const
+{
+    std::wstring text = L"Fit " + SampleFramework11::ToString(TexelsProcessed) + L" texels in ";
+    text += SampleFramework11::ToString(Seconds * 1000.0) + L"ms using ";
+    text += SampleFramework11::ToString(NumThreads) + L" threads, ";
+    text += SampleFramework11::ToString(AvgIterations()) + L" iterations on average, ";
+    text += SampleFramework11::ToString(NumConverged) + L" converged\n";
+
+    for(uint64 i = 0; i < Levels.size(); ++i)
+    {
+        const VMFFitLevelStats& level = Levels[i];
+        text += L"  Mip " + SampleFramework11::ToString(i + 1) + L" (" + SampleFramework11::ToString(level.Width);
+        text += L"x" + SampleFramework11::ToString(level.Height) + L"): ";
+        text += SampleFramework11::ToString(level.AvgIterations) + L" avg iterations, ";
+        text += SampleFramework11::ToString(level.MaxIterations) + L" max, ";
+        text += SampleFramework11::ToString(level.NumConverged) + L" converged, log-likelihood ";
+        text += SampleFramework11::ToString(level.AvgLogLikelihood) + L", ";
+        text += SampleFramework11::ToString(level.Seconds * 1000.0) + L"ms\n";
+    }
+
+    return text;
+}
+
+//=================================================================================================
+// VMFMixtureFitter
+//=================================================================================================
+
+void VMFMixtureFitter::LobeLevel::Resize(uint32 width, uint32 height, uint32 numLobes)
+{
+    Width = width;
+    Height = height;
+    NumLobes = numLobes;
+    for(uint32 lobe = 0; lobe < MaxLobes; ++lobe)
+        for(uint32 plane = 0; plane < NumPlanes; ++plane)
+            Data[lobe][plane].resize(lobe < numLobes ? width * height : 0);
+}
+
+VMFMixtureFitter::VMFMixtureFitter()
+{
+}
+
+void VMFMixtureFitter::Fit(const MomentPyramid& moments, const VMFFitSettings& settings, BakedTexture& vmfMap)
+{
+    if(settings.NumLobes == 0 || settings.NumLobes > MaxLobes)
+        throw Exception(L"The vMF fitter supports between 1 and " + SampleFramework11::ToString(uint32(MaxLobes)) + L" lobes");
+    if(moments.Levels.empty())
+        throw Exception(L"The moment pyramid hasn't been generated");
+
+    Timer timer;
+
+    const uint32 numMipLevels = static_cast<uint32>(moments.Levels.size());
+    const MomentPyramid::Level& baseLevel = moments.Levels[0];
+    vmfMap.Initialize(baseLevel.Width, baseLevel.Height, DXGI_FORMAT_R16G16B16A16_FLOAT, numMipLevels, settings.NumLobes);
+
+    stats = VMFFitStats();
+    stats.NumThreads = ThreadPool::GlobalPool.NumThreads();
+
+    levels.resize(numMipLevels);
+    for(uint32 mipLevel = 1; mipLevel < numMipLevels; ++mipLevel)
+        levels[mipLevel].Resize(moments.Levels[mipLevel].Width, moments.Levels[mipLevel].Height, settings.NumLobes);
+
+    WriteBaseLevel(baseLevel, settings.NumLobes, std::vector<TexelRect>(1, TexelRect(0, 0, baseLevel.Width, baseLevel.Height)),
+                   vmfMap);
+
+    for(uint32 mipLevel = 1; mipLevel < numMipLevels; ++mipLevel)
+    {
+        const MomentPyramid::Level& level = moments.Levels[mipLevel];
+        std::vector<uint32> tiles(NumTiles(level.Width, MapBaker::TileSize) * NumTiles(level.Height, MapBaker::TileSize));
+        for(uint32 i = 0; i < tiles.size(); ++i)
+            tiles[i] = i;
+        FitLevel(moments, settings, mipLevel, tiles, vmfMap);
+    }
+
+    timer.Update();
+    stats.Seconds = timer.ElapsedSecondsD();
+}
+
+void VMFMixtureFitter::Refit(const MomentPyramid& moments, const VMFFitSettings& settings, const DirtyRegion& region,
+                             BakedTexture& vmfMap)
+{
+    if(CanRefit(moments, settings) == false)
+        throw Exception(L"The vMF lobes have to be fit for the whole moment pyramid before they can be refit");
+    if(vmfMap.Width != moments.Levels[0].Width || vmfMap.Height != moments.Levels[0].Height
+       || vmfMap.NumMipLevels != moments.Levels.size() || vmfMap.ArraySize != settings.NumLobes
+       || vmfMap.Format != DXGI_FORMAT_R16G16B16A16_FLOAT)
+        throw Exception(L"The vMF map doesn't match the moment pyramid, it has to come from the last full fit");
+    if(region.Levels.size() != moments.Levels.size())
+        throw Exception(L"The dirty region doesn't match the moment pyramid");
+
+    Timer timer;
+
+    stats = VMFFitStats();
+    stats.NumThreads = ThreadPool::GlobalPool.NumThreads();
+
+    WriteBaseLevel(moments.Levels[0], settings.NumLobes, region.Levels[0], vmfMap);
+
+    const uint32 numMipLevels = static_cast<uint32>(moments.Levels.size());
+    for(uint32 mipLevel = 1; mipLevel < numMipLevels; ++mipLevel)
+    {
+        const std::vector<uint32> tiles = DirtyTiles(region.Levels[mipLevel], levels[mipLevel].Width, levels[mipLevel].Height);
+        if(tiles.size() > 0)
+            FitLevel(moments, settings, mipLevel, tiles, vmfMap);
+    }
+
+    timer.Update();
+    stats.Seconds = timer.ElapsedSecondsD();
+}
+
+bool VMFMixtureFitter::CanRefit(const MomentPyramid& moments, const VMFFitSettings& settings) const
+{
+    if(moments.Levels.empty() || levels.size() != moments.Levels.size())
+        return false;
+
+    for(uint64 mipLevel = 1; mipLevel < levels.size(); ++mipLevel)
+        if(levels[mipLevel].Width != moments.Levels[mipLevel].Width || levels[mipLevel].Height != moments.Levels[mipLevel].Height
+           || levels[mipLevel].NumLobes != settings.NumLobes)
+            return false;
+
+    return true;
+}
+
+void VMFMixtureFitter::ReleaseLevels()
+{
+    levels.clear();
+    levels.shrink_to_fit();
+}
+
+// Mip 0 is a single lobe for the normal, the same as SolveVMF
+void VMFMixtureFitter::WriteBaseLevel(const MomentPyramid::Level& baseLevel, uint32 numLobes,
+                                      const std::vector<TexelRect>& rects, BakedTexture& vmfMap)
+{
+    for(uint64 rectIdx = 0; rectIdx < rects.size(); ++rectIdx)
+    {
+        const TexelRect& rect = rects[rectIdx];
+        ThreadPool::GlobalPool.ParallelFor(rect.Height(), [&](uint32 row, uint32 threadIdx)
+        {
+            const uint32 y = rect.MinY + row;
+            for(uint32 x = rect.MinX; x < rect.MaxX; ++x)
+            {
+                const uint32 idx = y * baseLevel.Width + x;
+                for(uint32 lobe = 0; lobe < numLobes; ++lobe)
+                {
+                    uint16* dst = reinterpret_cast<uint16*>(vmfMap.Data(0, lobe)) + idx * 4;
+                    if(lobe == 0)
+                    {
+                        dst[0] = PackedVector::XMConvertFloatToHalf(baseLevel.Data[MomentPyramid::AvgNormalX][idx]);
+                        dst[1] = PackedVector::XMConvertFloatToHalf(baseLevel.Data[MomentPyramid::AvgNormalY][idx]);
+                        dst[2] = PackedVector::XMConvertFloatToHalf(1.0f);
+                    }
+                    else
+                    {
+                        dst[0] = dst[1] = dst[2] = PackedVector::XMConvertFloatToHalf(0.0f);
+                    }
+                    dst[3] = PackedVector::XMConvertFloatToHalf(1.0f / MaxKappa);
+                }
+            }
+        });
+    }
+}
+
+// Fits the given tiles of one level from the kept lobes of the level below it. The tiles are always
+// on the same grid, so that a refit puts the same texels in each SIMD group as the full fit did.
+void VMFMixtureFitter::FitLevel(const MomentPyramid& moments, const VMFFitSettings& settings, uint32 mipLevel,
+                                const std::vector<uint32>& tiles, BakedTexture& vmfMap)
+{
+    Timer levelTimer;
+
+    const uint32 numLobes = settings.NumLobes;
+    const uint32 numThreads = ThreadPool::GlobalPool.NumThreads();
+    const MomentPyramid::Level& baseLevel = moments.Levels[0];
+    const LobeLevel& prevLevel = levels[mipLevel - 1];
+    LobeLevel& currLevel = levels[mipLevel];
+
+    const uint32 width = currLevel.Width;
+    const uint32 height = currLevel.Height;
+
+    // Mip 1 is fit straight from the normals
+    const bool fromNormals = mipLevel == 1;
+    const uint32 srcWidth = fromNormals ? baseLevel.Width : prevLevel.Width;
+    const uint32 srcHeight = fromNormals ? baseLevel.Height : prevLevel.Height;
+    const uint32 srcLobes = fromNormals ? 1 : prevLevel.NumLobes;
+
+    std::vector<LevelTotals> totals(numThreads);
+
+    const uint32 numTilesX = NumTiles(width, MapBaker::TileSize);
+    ThreadPool::GlobalPool.ParallelFor(static_cast<uint32>(tiles.size()), [&](uint32 listIdx, uint32 threadIdx)
+    {
+        LevelTotals& threadTotals = totals[threadIdx];
+
+        const uint32 tileIdx = tiles[listIdx];
+        const uint32 tileStartX = (tileIdx % numTilesX) * MapBaker::TileSize;
+        const uint32 tileStartY = (tileIdx / numTilesX) * MapBaker::TileSize;
+        const uint32 tileEndX = std::min(tileStartX + MapBaker::TileSize, width);
+        const uint32 tileEndY = std::min(tileStartY + MapBaker::TileSize, height);
+
+        for(uint32 y = tileStartY; y < tileEndY; ++y)
+        {
+            const uint32 row0 = std::min(y * 2, srcHeight - 1) * srcWidth;
+            const uint32 row1 = std::min(y * 2 + 1, srcHeight - 1) * srcWidth;
+
+            for(uint32 x = tileStartX; x < tileEndX; x += Float8::Width)
+            {
+                const uint32 count = std::min(tileEndX - x, Float8::Width);
+
+                // Gather the child lobes, with the same clamping as ReduceMoments. The lanes
+                // past the end of the row repeat the last texel.
+                FitData data;
+                data.NumPoints = 0;
+                for(uint32 child = 0; child < 4; ++child)
+                {
+                    float w[MaxLobes][8], mx[MaxLobes][8], my[MaxLobes][8], mz[MaxLobes][8];
+                    for(uint32 i = 0; i < Float8::Width; ++i)
+                    {
+                        const uint32 dstX = x + std::min(i, count - 1);
+                        const uint32 srcX = std::min(dstX * 2 + (child & 1), srcWidth - 1);
+                        const uint32 srcIdx = (child < 2 ? row0 : row1) + srcX;
+
+                        for(uint32 l = 0; l < srcLobes; ++l)
+                        {
+                            if(fromNormals)
+                            {
+                                w[l][i] = 0.25f;
+                                mx[l][i] = baseLevel.Data[MomentPyramid::AvgNormalX][srcIdx];
+                                my[l][i] = baseLevel.Data[MomentPyramid::AvgNormalY][srcIdx];
+                                mz[l][i] = baseLevel.Data[MomentPyramid::AvgNormalZ][srcIdx];
+                            }
+                            else
+                            {
+                                w[l][i] = prevLevel.Data[l][LobeLevel::Alpha][srcIdx] * 0.25f;
+                                mx[l][i] = prevLevel.Data[l][LobeLevel::MeanX][srcIdx];
+                                my[l][i] = prevLevel.Data[l][LobeLevel::MeanY][srcIdx];
+                                mz[l][i] = prevLevel.Data[l][LobeLevel::MeanZ][srcIdx];
+                            }
+                        }
+                    }
+
+                    // Child lobes that are empty for all 8 texels are skipped
+                    for(uint32 l = 0; l < srcLobes; ++l)
+                    {
+                        const uint32 j = data.NumPoints;
+                        data.W[j] = Float8::Load(w[l]);
+                        if(!Float8::Any(data.W[j] > 0.0f))
+                            continue;
+
+                        data.Child[j] = child;
+                        data.MX[j] = Float8::Load(mx[l]);
+                        data.MY[j] = Float8::Load(my[l]);
+                        data.MZ[j] = Float8::Load(mz[l]);
+                        ++data.NumPoints;
+                    }
+                }
+
+                // A warm start seeds the lobes from the fitted lobes of the children, starting
+                // with the heaviest one. A cold start only uses the average normals of the
+                // children, which is all that a single-lobe fit of the level above would give.
+                // Either way every child lobe is then merged into the closest seed.
+                LobeParams lobes[MaxLobes];
+                for(uint32 k = 0; k < numLobes; ++k)
+                    lobes[k] = MakeLobe(0.0f, 0.0f, 0.0f, 0.0f);
+
+                if(settings.WarmStart)
+                {
+                    for(uint32 j = 0; j < data.NumPoints; ++j)
+                        lobes[0] = LobeParams::Select(data.W[j] > lobes[0].Alpha,
+                                                      MakeLobe(data.W[j], data.MX[j], data.MY[j], data.MZ[j]), lobes[0]);
+                    SeedEmptyLobes(data, numLobes, lobes);
+                }
+                else
+                {
+                    FitData childMeans;
+                    childMeans.NumPoints = 4;
+                    for(uint32 child = 0; child < 4; ++child)
+                        childMeans.W[child] = childMeans.MX[child] = childMeans.MY[child] = childMeans.MZ[child] = 0.0f;
+
+                    // The lobe weights of each child add up to 1/4
+                    for(uint32 j = 0; j < data.NumPoints; ++j)
+                    {
+                        const uint32 child = data.Child[j];
+                        childMeans.W[child] += data.W[j];
+                        childMeans.MX[child] += data.W[j] * data.MX[j] * 4.0f;
+                        childMeans.MY[child] += data.W[j] * data.MY[j] * 4.0f;
+                        childMeans.MZ[child] += data.W[j] * data.MZ[j] * 4.0f;
+                    }
+
+                    lobes[0] = MakeLobe(childMeans.W[0], childMeans.MX[0], childMeans.MY[0], childMeans.MZ[0]);
+                    SeedEmptyLobes(childMeans, numLobes, lobes);
+                }
+
+                MergeIntoClosestLobes(data, numLobes, lobes);
+
+                Float8 iterations, converged;
+                const Float8 logLikelihood = FitLobes(data, settings, lobes, iterations, converged);
+                SortLobes(numLobes, lobes);
+
+                // Keep the mean resultant vectors for the next level, and write the lobes out
+                const uint32 idx = y * width + x;
+                for(uint32 k = 0; k < numLobes; ++k)
+                {
+                    const LobeParams& lobe = lobes[k];
+                    const Float8 values[LobeLevel::NumPlanes] = { lobe.MuX * lobe.R, lobe.MuY * lobe.R,
+                                                                  lobe.MuZ * lobe.R, lobe.Alpha };
+                    for(uint32 plane = 0; plane < LobeLevel::NumPlanes; ++plane)
+                    {
+                        float tmp[8];
+                        values[plane].Store(tmp);
+                        memcpy(&currLevel.Data[k][plane][idx], tmp, count * sizeof(float));
+                    }
+
+                    const Float8 empty = lobe.Alpha <= 0.0f;
+                    uint16* dst = reinterpret_cast<uint16*>(vmfMap.Data(mipLevel, k)) + idx * 4;
+                    StoreHalf4(lobe.MuX, lobe.MuY, lobe.Alpha, Float8::Select(empty, 1.0f / MaxKappa, 1.0f / lobe.Kappa),
+                               dst, count);
+                }
+
+                float laneIterations[8], laneConverged[8], laneLogLikelihood[8];
+                iterations.Store(laneIterations);
+                converged.Store(laneConverged);
+                logLikelihood.Store(laneLogLikelihood);
+                for(uint32 i = 0; i < count; ++i)
+                {
+                    threadTotals.Iterations += laneIterations[i];
+                    threadTotals.MaxIterations = std::max(threadTotals.MaxIterations, uint32(laneIterations[i]));
+                    threadTotals.NumConverged += laneConverged[i] > 0.0f ? 1 : 0;
+                    threadTotals.LogLikelihood += laneLogLikelihood[i];
+                }
+            }
+        }
+    });
+
+    levelTimer.Update();
+
+    uint64 numTexels = 0;
+    for(uint64 i = 0; i < tiles.size(); ++i)
+    {
+        const uint32 tileX = (tiles[i] % numTilesX) * MapBaker::TileSize;
+        const uint32 tileY = (tiles[i] / numTilesX) * MapBaker::TileSize;
+        numTexels += uint64(std::min(MapBaker::TileSize, width - tileX)) * std::min(MapBaker::TileSize, height - tileY);
+    }
+
+    VMFFitLevelStats levelStats;
+    levelStats.Width = currLevel.Width;
+    levelStats.Height = currLevel.Height;
+    levelStats.Seconds = levelTimer.ElapsedSecondsD();
+
+    double totalIterations = 0.0;
+    double totalLogLikelihood = 0.0;
+    for(uint32 i = 0; i < numThreads; ++i)
+    {
+        totalIterations += totals[i].Iterations;
+        totalLogLikelihood += totals[i].LogLikelihood;
+        levelStats.MaxIterations = std::max(levelStats.MaxIterations, totals[i].MaxIterations);
+        levelStats.NumConverged += totals[i].NumConverged;
+    }
+
+    levelStats.AvgIterations = totalIterations / numTexels;
+    levelStats.AvgLogLikelihood = totalLogLikelihood / numTexels;
+    stats.Levels.push_back(levelStats);
+
+    stats.TexelsProcessed += numTexels;
+    stats.TotalIterations += uint64(totalIterations);
+    stats.NumConverged += levelStats.NumConverged;
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+//=================================================================================================
+//
+//  Specular AA Sample
+//  by MJP
+//  http://mynameismjp.wordpress.com/
+//
+//  All code and content licensed under Microsoft Public License (Ms-PL)
+//
+//=================================================================================================
+
+#pragma once
+
+#include "SampleFramework11/PCH.h"
+
+#include "MapBaker.h"
+
+using namespace SampleFramework11;
+
+struct VMFFitSettings
+{
+    uint32 NumLobes;
+    uint32 MaxIterations;
+    float Tolerance;            // Change in the average log-likelihood (in nats) that counts as converged
+    bool WarmStart;             // Seed from the lobes of the finer level instead of its average normals
+
+    VMFFitSettings() : NumLobes(2), MaxIterations(32), Tolerance(1e-3f), WarmStart(true)
+    {
+    }
+};
+
+struct VMFFitLevelStats
+{
+    uint32 Width;
+    uint32 Height;
+    double Seconds;
+    double AvgIterations;
+    uint32 MaxIterations;
+    uint64 NumConverged;        // Texels that converged before hitting the iteration limit
+    double AvgLogLikelihood;
+
+    VMFFitLevelStats() : Width(0), Height(0), Seconds(0.0), AvgIterations(0.0), MaxIterations(0),
+                         NumConverged(0), AvgLogLikelihood(0.0)
+    {
+    }
+};
+
+struct VMFFitStats
+{
+    double Seconds;
+    uint32 NumThreads;
+    uint64 TexelsProcessed;     // Texels that were fit, which excludes mip 0
+    uint64 TotalIterations;
+    uint64 NumConverged;
+    std::vector<VMFFitLevelStats> Levels;
+
+    VMFFitStats() : Seconds(0.0), NumThreads(1), TexelsProcessed(0), TotalIterations(0), NumConverged(0)
+    {
+    }
+
+    double AvgIterations() const;
+    std::wstring ToString() const;
+};
+
+// Fits a mixture of up to 4 vMF lobes to the NDF of every texel in the mip chain, using EM on the
+// sphere. Every level is fit from the lobes of the level above it instead of from the normals
+// (hierarchical EM), so each texel only ever has 4 children x NumLobes weighted lobes as its data,
+// and the cost per texel doesn't grow with the size of its footprint. The mean of the mixture
+// always matches the average normal in the moment pyramid.
+//
+// Texels are fit 8 at a time with AVX2, with lanes that have converged frozen until the rest
+// catch up, and rows of tiles are distributed across ThreadPool::GlobalPool. Lobes are sorted by
+// weight after fitting, so that lobe i of neighboring texels tends to represent the same features
+// and can be used as the starting point for the next level.
+//
+// The lobes of every level are kept after a fit, so that Refit can update the texels that depend
+// on an edited region without fitting the rest of the mip chain again.
+class VMFMixtureFitter
+{
+
+public:
+
+    static const uint32 MaxLobes = 4;
+
+    // Lobes of one mip level, stored as planes. Each lobe is its weight, plus its mean resultant
+    // vector r * mu, which is all that the next level needs from it.
+    struct LobeLevel
+    {
+        enum Planes
+        {
+            MeanX = 0,
+            MeanY,
+            MeanZ,
+            Alpha,
+
+            NumPlanes
+        };
+
+        uint32 Width;
+        uint32 Height;
+        uint32 NumLobes;
+        std::vector<float> Data[MaxLobes][NumPlanes];
+
+        LobeLevel() : Width(0), Height(0), NumLobes(0)
+        {
+        }
+
+        void Resize(uint32 width, uint32 height, uint32 numLobes);
+    };
+
+    VMFMixtureFitter();
+
+    // Fits every level, and writes the lobes to an R16G16B16A16_FLOAT texture array with one slice
+    // per lobe, in the same (mu.xy, alpha, 1 / kappa) layout as the SolveVMF kernel. Mip 0 has a
+    // single lobe with the normal as its direction.
+    void Fit(const MomentPyramid& moments, const VMFFitSettings& settings, BakedTexture& vmfMap);
+
+    // Re-fits the tiles that the dirty region covers at each level, after the moment pyramid has
+    // been updated for it, and writes them to vmfMap. Each texel is only fit from the lobes of its
+    // 2x2 children, so the result matches a full Fit. vmfMap has to come from the last Fit, and
+    // CanRefit has to be true.
+    void Refit(const MomentPyramid& moments, const VMFFitSettings& settings, const DirtyRegion& region,
+               BakedTexture& vmfMap);
+
+    // Whether the kept lobes come from a fit of a pyramid with the same size and number of lobes
+    bool CanRefit(const MomentPyramid& moments, const VMFFitSettings& settings) const;
+
+    // Frees the lobes that are kept for Refit
+    void ReleaseLevels();
+
+    const VMFFitStats& Stats() const { return stats; }
+
+protected:
+
+    void WriteBaseLevel(const MomentPyramid::Level& baseLevel, uint32 numLobes, const std::vector<TexelRect>& rects,
+                        BakedTexture& vmfMap);
+    void FitLevel(const MomentPyramid& moments, const VMFFitSettings& settings, uint32 mipLevel,
+                  const std::vector<uint32>& tiles, BakedTexture& vmfMap);
+
+    VMFFitStats stats;
+
+    // Lobes of every mip level. Mip 0 is left empty, since mip 1 is fit straight from the normals.
+    std::vector<LobeLevel> levels;
+};
\ No newline at end of file